@@ -18,6 +18,7 @@ int main(void)
     Sprite_t* spr = get_sprite(&assets, "testspr1");
     spr->origin = (Vector2){0, 0};
     spr->frame_size = (Vector2){32, 32};
+    update_sprite_frames(spr);
 
     add_sprite(&assets, "testspr2", tex);
     Sprite_t* spr2 = get_sprite(&assets, "testspr2");
@@ -26,6 +27,7 @@ int main(void)
     spr2->origin = (Vector2){0, 0};
     spr2->frame_size = (Vector2){32, 32};
     spr2->speed = 15;
+    update_sprite_frames(spr2);
 
     add_sound(&assets, "testsnd", "res/sound.ogg");
     Sound* snd = get_sound(&assets, "testsnd");
@@ -117,10 +117,15 @@ struct EntityManager {
     struct sc_queue_uint to_add;
     struct sc_queue_uint to_remove;
     struct sc_queue_ent_evt to_update;
+    // Component changes grouped by type when they are applied
+    struct EntityUpdateEventInfo* evt_buf;
+    uint32_t evt_buf_size;
 };
 
 void init_entity_manager(EntityManager_t* p_manager);
 void init_entity_tag_map(EntityManager_t* p_manager, unsigned int tag_number, unsigned int initial_size);
+// Applies the entity and component changes queued since the last update.
+// Until then, the maps of the manager are left as they are
 void update_entity_manager(EntityManager_t* p_manager);
 void clear_entity_manager(EntityManager_t* p_manager);
 void free_entity_manager(EntityManager_t* p_manager);
@@ -129,6 +134,28 @@ Entity_t* add_entity(EntityManager_t* p_manager, unsigned int tag);
 void remove_entity(EntityManager_t* p_manager, unsigned long id);
 Entity_t *get_entity(EntityManager_t* p_manager, unsigned long id);
 
+// Copy of the entities of a manager and their component data,
+// which can be re-created in one go without running their setup again
+typedef struct EntitySnapshot {
+    uint8_t* data;
+    uint32_t size;
+    uint32_t capacity;
+} EntitySnapshot_t;
+
+// Compact form of the entities in id order, so that two states of the
+// same entities line up byte for byte. Pointers in the components are kept
+// as is, so the data is only valid for the running program
+uint32_t get_serialised_entities_size(EntityManager_t* p_manager);
+// Returns the size written, or 0 if it does not fit
+uint32_t serialise_entities(EntityManager_t* p_manager, uint8_t* buf, uint32_t capacity);
+// The entity ids may differ from the serialised ones. Expects the manager to be cleared
+// Fails on cut short data or a full pool, leaving the entities read so far in the manager
+bool deserialise_entities(EntityManager_t* p_manager, const uint8_t* buf, uint32_t size);
+
+bool snapshot_entities(EntityManager_t* p_manager, EntitySnapshot_t* snapshot);
+bool restore_entities(EntityManager_t* p_manager, const EntitySnapshot_t* snapshot);
+void free_entity_snapshot(EntitySnapshot_t* snapshot);
+
 void* add_component(Entity_t *entity, unsigned int comp_type);
 void* get_component(Entity_t *entity, unsigned int comp_type);
 void remove_component(Entity_t* entity, unsigned int comp_type);
@@ -24,5 +24,6 @@ typedef enum ActionType
     ACTION_REMOVE_TILE,
     ACTION_SWITCH_TILESET,
     ACTION_LOOKAHEAD,
+    ACTION_REWIND,
 }ActionType_t;
 #endif // __ACTIONS_H
@@ -0,0 +1,146 @@
+#include "asset_manifest.h"
+#include <stdio.h>
+#include <string.h>
+
+static bool copy_record_name(char* dst, const char* name)
+{
+    if (strlen(name) >= MAX_NAME_LEN) return false;
+    strncpy(dst, name, MAX_NAME_LEN);
+    return true;
+}
+
+// tex_name,origin x,origin y,frame width,frame height,frame count,frames per row,speed
+bool parse_sprite_record(const char* name, char* info_str, SpriteRecord_t* record)
+{
+    memset(record, 0, sizeof(SpriteRecord_t));
+    if (!copy_record_name(record->name, name)) return false;
+
+    char* tex_name = strtok(info_str, ",");
+    if (tex_name == NULL || !copy_record_name(record->tex, tex_name)) return false;
+    char* spr_data = strtok(NULL, "");
+    if (spr_data == NULL) return false;
+
+    int data_count = sscanf(
+        spr_data, "%f,%f,%f,%f,%d,%d,%d",
+        &record->origin.x, &record->origin.y,
+        &record->frame_size.x, &record->frame_size.y,
+        &record->frame_count, &record->frame_per_row, &record->speed
+    );
+    return data_count == 7;
+}
+
+// type,launch,speed,angle,rotation,lifetime ranges as min-max,spawn delay,one shot
+bool parse_emitter_record(const char* name, char* info_str, EmitterRecord_t* record)
+{
+    memset(record, 0, sizeof(EmitterRecord_t));
+    if (!copy_record_name(record->name, name)) return false;
+
+    EmitterConfig_t* conf = &record->conf;
+    char emitter_type;
+    char one_shot;
+    int data_count = sscanf(
+        info_str, "%c,%f-%f,%f-%f,%f-%f,%f-%f,%f-%f,%f,%c",
+        &emitter_type,
+        conf->launch_range, conf->launch_range + 1,
+        conf->speed_range, conf->speed_range + 1,
+        conf->angle_range, conf->angle_range + 1,
+        conf->rotation_range, conf->rotation_range + 1,
+        conf->particle_lifetime, conf->particle_lifetime + 1,
+        &conf->initial_spawn_delay, &one_shot
+    );
+    if (data_count != 13) return false;
+
+    conf->type = EMITTER_UNKNOWN;
+    if (emitter_type == 'b')
+    {
+        conf->type = EMITTER_BURST;
+    }
+    else if (emitter_type == 's')
+    {
+        conf->type = EMITTER_STREAM;
+    }
+    conf->one_shot = (one_shot == '1');
+    return true;
+}
+
+// Two letters, the row then the column: tl, mc, br...
+static bool parse_anchor_symbol(const char* symbol, uint8_t* anchor)
+{
+    const char* rows = strchr("tmb", symbol[0]);
+    const char* cols = strchr("lcr", symbol[1]);
+    if (symbol[0] == '\0' || symbol[1] == '\0' || rows == NULL || cols == NULL) return false;
+
+    // Same order as AnchorPoint_t
+    *anchor = (rows - "tmb") * 3 + (cols - "lcr");
+    return true;
+}
+
+// offset x,offset y,source anchor,destination anchor
+bool parse_player_sprite_record(const char* name, char* info_str, PlayerSpriteRecord_t* record)
+{
+    memset(record, 0, sizeof(PlayerSpriteRecord_t));
+    if (!copy_record_name(record->name, name)) return false;
+
+    char src_ap_symbol[3];
+    char dest_ap_symbol[3];
+    int data_count = sscanf(
+        info_str, "%f,%f,%2s,%2s",
+        &record->offset.x, &record->offset.y, src_ap_symbol, dest_ap_symbol
+    );
+    if (data_count != 4) return false;
+
+    return parse_anchor_symbol(src_ap_symbol, &record->src_anchor)
+        && parse_anchor_symbol(dest_ap_symbol, &record->dest_anchor);
+}
+
+bool read_asset_manifest(const uint8_t* data, uint32_t size, AssetManifest_t* manifest)
+{
+    AssetManifestHeader_t* header = &manifest->header;
+    if (size < sizeof(AssetManifestHeader_t)) return false;
+    memcpy(header, data, sizeof(AssetManifestHeader_t));
+    if (memcmp(header->magic, ASSET_MANIFEST_MAGIC, 4) != 0) return false;
+
+    if (
+        header->record_sizes[0] != sizeof(FileRecord_t)
+        || header->record_sizes[1] != sizeof(SpriteRecord_t)
+        || header->record_sizes[2] != sizeof(EmitterRecord_t)
+        || header->record_sizes[3] != sizeof(PlayerSpriteRecord_t)
+    )
+    {
+        printf("Asset manifest is of another layout, repack the resources\n");
+        return false;
+    }
+
+    size_t total = sizeof(AssetManifestHeader_t)
+        + (size_t)header->n_files * sizeof(FileRecord_t)
+        + (size_t)header->n_sprites * sizeof(SpriteRecord_t)
+        + (size_t)header->n_emitters * sizeof(EmitterRecord_t)
+        + (size_t)header->n_player_sprites * sizeof(PlayerSpriteRecord_t);
+    if (total > size) return false;
+
+    manifest->files = data + sizeof(AssetManifestHeader_t);
+    manifest->sprites = manifest->files + header->n_files * sizeof(FileRecord_t);
+    manifest->emitters = manifest->sprites + header->n_sprites * sizeof(SpriteRecord_t);
+    manifest->player_sprites = manifest->emitters + header->n_emitters * sizeof(EmitterRecord_t);
+    return true;
+}
+
+void get_manifest_file(const AssetManifest_t* manifest, uint16_t idx, FileRecord_t* record)
+{
+    memcpy(record, manifest->files + idx * sizeof(FileRecord_t), sizeof(FileRecord_t));
+}
+
+void get_manifest_sprite(const AssetManifest_t* manifest, uint16_t idx, SpriteRecord_t* record)
+{
+    memcpy(record, manifest->sprites + idx * sizeof(SpriteRecord_t), sizeof(SpriteRecord_t));
+}
+
+void get_manifest_emitter(const AssetManifest_t* manifest, uint16_t idx, EmitterRecord_t* record)
+{
+    memcpy(record, manifest->emitters + idx * sizeof(EmitterRecord_t), sizeof(EmitterRecord_t));
+}
+
+void get_manifest_player_sprite(const AssetManifest_t* manifest, uint16_t idx, PlayerSpriteRecord_t* record)
+{
+    memcpy(record, manifest->player_sprites + idx * sizeof(PlayerSpriteRecord_t), sizeof(PlayerSpriteRecord_t));
+}
@@ -0,0 +1,79 @@
+#ifndef __ASSET_MANIFEST_H
+#define __ASSET_MANIFEST_H
+#include "assets.h"
+
+// The info files compiled by the packer, so that the game copies the
+// records instead of parsing text. The packer and the game must be
+// built with the same layout, which the header records the sizes of
+#define ASSET_MANIFEST_NAME "assets.man"
+#define ASSET_MANIFEST_MAGIC "AMF1"
+#define MANIFEST_PATH_LEN 128
+
+typedef struct AssetManifestHeader
+{
+    char magic[4];
+    uint16_t n_files;
+    uint16_t n_sprites;
+    uint16_t n_emitters;
+    uint16_t n_player_sprites;
+    uint16_t record_sizes[4];
+}AssetManifestHeader_t;
+
+// Textures, sounds and level packs, by their chunk name
+typedef struct FileRecord
+{
+    uint32_t type; // AssetLoadType_t
+    char name[MAX_NAME_LEN];
+    char path[MANIFEST_PATH_LEN];
+}FileRecord_t;
+
+typedef struct SpriteRecord
+{
+    char name[MAX_NAME_LEN];
+    char tex[MAX_NAME_LEN];
+    Vector2 origin;
+    Vector2 frame_size;
+    int32_t frame_count;
+    int32_t frame_per_row;
+    int32_t speed;
+}SpriteRecord_t;
+
+typedef struct EmitterRecord
+{
+    char name[MAX_NAME_LEN];
+    EmitterConfig_t conf;
+}EmitterRecord_t;
+
+typedef struct PlayerSpriteRecord
+{
+    char name[MAX_NAME_LEN];
+    Vector2 offset;
+    uint8_t src_anchor; // AnchorPoint_t
+    uint8_t dest_anchor;
+    uint8_t dummy[2];
+}PlayerSpriteRecord_t;
+
+// Points into the manifest data, which may not be aligned.
+// Use the getters to copy a record out
+typedef struct AssetManifest
+{
+    AssetManifestHeader_t header;
+    const uint8_t* files;
+    const uint8_t* sprites;
+    const uint8_t* emitters;
+    const uint8_t* player_sprites;
+}AssetManifest_t;
+
+// Parsers of the info file entries, shared with the packer.
+// They modify the string, as they go through it with strtok
+bool parse_sprite_record(const char* name, char* info_str, SpriteRecord_t* record);
+bool parse_emitter_record(const char* name, char* info_str, EmitterRecord_t* record);
+bool parse_player_sprite_record(const char* name, char* info_str, PlayerSpriteRecord_t* record);
+
+// False if the data is not a manifest of the same layout
+bool read_asset_manifest(const uint8_t* data, uint32_t size, AssetManifest_t* manifest);
+void get_manifest_file(const AssetManifest_t* manifest, uint16_t idx, FileRecord_t* record);
+void get_manifest_sprite(const AssetManifest_t* manifest, uint16_t idx, SpriteRecord_t* record);
+void get_manifest_emitter(const AssetManifest_t* manifest, uint16_t idx, EmitterRecord_t* record);
+void get_manifest_player_sprite(const AssetManifest_t* manifest, uint16_t idx, PlayerSpriteRecord_t* record);
+#endif // __ASSET_MANIFEST_H
@@ -7,14 +7,37 @@
 #include "rres.h"
 
 #include "zstd.h"
+#include "sc/heap/sc_heap.h"
 #include <stdio.h>
+#if !defined(PLATFORM_WEB)
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 uint8_t n_loaded[N_ASSETS_TYPE] = {0};
 
+// Textures and level packs can be unloaded, so their slots get reused.
+// Unreferenced ones stay resident until the slot or the memory is needed
+typedef struct AssetSlot
+{
+    uint32_t last_used;
+    size_t size; // Counted against MAX_RESIDENT_ASSET_SIZE
+    uint16_t refs;
+    bool used;
+}AssetSlot_t;
+
+static uint32_t asset_tick = 0;
+static size_t resident_size = 0;
+
 // Hard limit number of 
 typedef struct TextureData
 {
+    AssetSlot_t slot;
     Texture2D texture;
+    // Atlased textures are a region of another texture, the page.
+    // Standalone textures are their own page
+    Rectangle region;
+    uint8_t page_idx;
     char name[MAX_NAME_LEN];
 }TextureData_t;
 typedef struct SpriteData
@@ -34,7 +57,8 @@ typedef struct SoundData
 }SoundData_t;
 typedef struct LevelPackData
 {
-    LevelPack_t pack;
+    LevelPack_t pack; // Keep first, packs are released by pointer
+    AssetSlot_t slot;
     char name[MAX_NAME_LEN];
 }LevelPackData_t;
 typedef struct EmitterConfData
@@ -50,104 +74,442 @@ static SpriteData_t sprites[MAX_SPRITES];
 static LevelPackData_t levelpacks[MAX_LEVEL_PACK];
 static EmitterConfData_t emitter_confs[MAX_EMITTER_CONF];
 
-#define DECOMPRESSOR_INBUF_LEN 4096
-#define DECOMPRESSOR_OUTBUF_LEN 4096
 static struct ZstdDecompressor
 {
     ZSTD_DCtx* ctx;
-    uint8_t in_buffer[DECOMPRESSOR_INBUF_LEN];
-    uint8_t out_buffer[DECOMPRESSOR_OUTBUF_LEN];
+    // Reused for the compressed rres chunks that go through it
+    uint8_t* scratch;
+    size_t scratch_size;
 }level_decompressor;
 
+static void free_zstd_decompressor(struct ZstdDecompressor* decompressor)
+{
+    ZSTD_freeDCtx(decompressor->ctx);
+    free(decompressor->scratch);
+    decompressor->ctx = NULL;
+    decompressor->scratch = NULL;
+    decompressor->scratch_size = 0;
+}
+
+static const uint8_t* decompress_chunk(struct ZstdDecompressor* decompressor, const uint8_t* data, uint32_t packed_size, uint32_t size)
+{
+    if (size > decompressor->scratch_size)
+    {
+        uint8_t* new_scratch = realloc(decompressor->scratch, size);
+        if (new_scratch == NULL) return NULL;
+        decompressor->scratch = new_scratch;
+        decompressor->scratch_size = size;
+    }
+
+    size_t res = ZSTD_decompressDCtx(decompressor->ctx, decompressor->scratch, size, data, packed_size);
+    return (res == size) ? decompressor->scratch : NULL;
+}
+
+#define LEVEL_HEADER_SIZE 40
+#define LEVEL_PACK_V2_MAGIC "LPK2"
+// Same as v2, but the levels are run length encoded
+#define LEVEL_PACK_V3_MAGIC "LPK3"
+#define LEVEL_PACK_V2_HEADER_SIZE 12
+#define LEVEL_ENTRY_V2_SIZE (LEVEL_HEADER_SIZE + 8)
+// Runs are [tile type, 5 bits | water, 3 bits][count]
+#define LEVEL_RUN_TYPE_MASK 0x1F
+#define LEVEL_RUN_WATER_SHIFT 5
+
+typedef struct LevelFrame
+{
+    uint32_t offset;
+    uint32_t size;
+}LevelFrame_t;
+
+struct LevelPackFrames
+{
+    uint8_t* data; // Copy of the whole pack
+    ZSTD_DDict* dict;
+    // Decompressed levels, least recently used goes first
+    int32_t cached_level[LEVEL_PACK_CACHE_SIZE];
+    uint32_t last_used[LEVEL_PACK_CACHE_SIZE];
+    LevelTileInfo_t* tiles[LEVEL_PACK_CACHE_SIZE];
+    size_t tiles_capacity[LEVEL_PACK_CACHE_SIZE];
+    // Spawn list, or the whole decompressed level if run length encoded
+    uint8_t* raw[LEVEL_PACK_CACHE_SIZE];
+    size_t raw_capacity[LEVEL_PACK_CACHE_SIZE];
+    uint32_t tick;
+    uint32_t data_size;
+    bool rle;
+    LevelFrame_t level_frames[];
+};
+
 static void unload_level_pack(LevelPack_t pack)
 {
-    for (uint8_t i = 0; i < pack.n_levels; ++i)
+    if (pack.arena != NULL)
+    {
+        // The tiles point into the arena
+        free(pack.arena);
+    }
+    else if (pack.frames != NULL)
+    {
+        // The tiles point into the cache
+        for (uint8_t i = 0; i < LEVEL_PACK_CACHE_SIZE; ++i)
+        {
+            free(pack.frames->tiles[i]);
+            free(pack.frames->raw[i]);
+        }
+        ZSTD_freeDDict(pack.frames->dict);
+        free(pack.frames->data);
+        free(pack.frames);
+    }
+    else
     {
-        free(pack.levels[i].tiles);
+        for (uint8_t i = 0; i < pack.n_levels; ++i)
+        {
+            free(pack.levels[i].tiles);
+        }
     }
+    free(pack.spawns);
     free(pack.levels);
 }
 
-// Maybe need a circular buffer??
-Texture2D* add_texture(Assets_t* assets, const char* name, const char* path)
+static uint32_t count_level_spawns(const LevelMap_t* level)
 {
-    uint8_t tex_idx = n_loaded[AST_TEXTURE];
-    assert(tex_idx < MAX_TEXTURES);
-    Texture2D tex = LoadTexture(path);
-    if (tex.width == 0 || tex.height == 0) return NULL;
+    uint32_t n_spawns = 0;
+    uint32_t n_tiles = level->width * level->height;
+    for (uint32_t i = 0; i < n_tiles; ++i)
+    {
+        n_spawns += level->tiles[i].tile_type >= LEVEL_SPAWN_TILE_START;
+    }
+    return n_spawns;
+}
+
+static void fill_level_spawns(LevelMap_t* level, LevelSpawn_t* spawns)
+{
+    uint32_t n_tiles = level->width * level->height;
+    level->spawns = spawns;
+    level->n_spawns = 0;
+    for (uint32_t i = 0; i < n_tiles; ++i)
+    {
+        if (level->tiles[i].tile_type < LEVEL_SPAWN_TILE_START) continue;
+
+        LevelSpawn_t* spawn = spawns + level->n_spawns++;
+        spawn->x = i % level->width;
+        spawn->y = i / level->width;
+        spawn->tile_type = level->tiles[i].tile_type;
+    }
+}
+
+// For packs holding every level, one list for all of them
+static bool build_level_pack_spawns(LevelPack_t* pack)
+{
+    uint32_t n_spawns = 0;
+    for (uint32_t i = 0; i < pack->n_levels; ++i)
+    {
+        n_spawns += count_level_spawns(pack->levels + i);
+    }
+
+    pack->spawns = malloc((n_spawns > 0 ? n_spawns : 1) * sizeof(LevelSpawn_t));
+    if (pack->spawns == NULL) return false;
+
+    LevelSpawn_t* spawns = pack->spawns;
+    for (uint32_t i = 0; i < pack->n_levels; ++i)
+    {
+        fill_level_spawns(pack->levels + i, spawns);
+        spawns += pack->levels[i].n_spawns;
+    }
+    return true;
+}
+
+static size_t get_level_pack_size(const LevelPack_t* pack)
+{
+    size_t size = pack->n_levels * sizeof(LevelMap_t);
+    if (pack->frames != NULL)
+    {
+        // The cache of decompressed levels is not counted
+        return size + sizeof(struct LevelPackFrames) + pack->n_levels * sizeof(LevelFrame_t) + pack->frames->data_size;
+    }
+    for (uint32_t i = 0; i < pack->n_levels; ++i)
+    {
+        size += (size_t)pack->levels[i].width * pack->levels[i].height * sizeof(LevelTileInfo_t);
+        size += pack->levels[i].n_spawns * sizeof(LevelSpawn_t);
+    }
+    return size;
+}
+
+static void set_asset_size(AssetSlot_t* slot, size_t size)
+{
+    resident_size = resident_size - slot->size + size;
+    slot->size = size;
+}
+
+// Slots are handed out with one reference, which the caller owns
+static void use_asset_slot(AssetSlot_t* slot)
+{
+    *slot = (AssetSlot_t){0};
+    slot->used = true;
+    slot->refs = 1;
+    slot->last_used = ++asset_tick;
+}
+
+static void free_texture_slot(Assets_t* assets, uint8_t tex_idx);
+
+static void release_texture_slot(Assets_t* assets, uint8_t tex_idx)
+{
+    TextureData_t* tex = textures + tex_idx;
+    if (tex->slot.refs > 0) tex->slot.refs--;
+    // Regions hold no memory of their own, but keep their page alive
+    if (tex->slot.refs == 0 && tex->page_idx != tex_idx)
+    {
+        free_texture_slot(assets, tex_idx);
+    }
+}
+
+static void free_texture_slot(Assets_t* assets, uint8_t tex_idx)
+{
+    TextureData_t* tex = textures + tex_idx;
+    sc_map_del_s64(&assets->m_textures, tex->name);
+    if (tex->page_idx == tex_idx)
+    {
+        if (tex->texture.id != 0) UnloadTexture(tex->texture);
+    }
+    else
+    {
+        release_texture_slot(assets, tex->page_idx);
+    }
+    set_asset_size(&tex->slot, 0);
+    memset(tex, 0, sizeof(TextureData_t));
+}
+
+// Only for packs nobody holds, the scenes keep pointers into the held ones
+static void free_level_pack_slot(Assets_t* assets, uint8_t pack_idx)
+{
+    LevelPackData_t* pack_info = levelpacks + pack_idx;
+    assert(pack_info->slot.refs == 0);
+    sc_map_del_s64(&assets->m_levelpacks, pack_info->name);
+    unload_level_pack(pack_info->pack);
+    set_asset_size(&pack_info->slot, 0);
+    memset(pack_info, 0, sizeof(LevelPackData_t));
+}
+
+static int16_t find_unused_texture(void)
+{
+    int16_t lru_idx = -1;
+    for (uint8_t i = 0; i < n_loaded[AST_TEXTURE]; ++i)
+    {
+        const AssetSlot_t* slot = &textures[i].slot;
+        if (!slot->used || slot->refs > 0) continue;
+        if (lru_idx < 0 || slot->last_used < textures[lru_idx].slot.last_used) lru_idx = i;
+    }
+    return lru_idx;
+}
+
+static int16_t find_unused_level_pack(void)
+{
+    int16_t lru_idx = -1;
+    for (uint8_t i = 0; i < n_loaded[AST_LEVELPACK]; ++i)
+    {
+        const AssetSlot_t* slot = &levelpacks[i].slot;
+        if (!slot->used || slot->refs > 0) continue;
+        if (lru_idx < 0 || slot->last_used < levelpacks[lru_idx].slot.last_used) lru_idx = i;
+    }
+    return lru_idx;
+}
+
+// Unload the least recently used assets nobody holds until within budget
+static void trim_assets(Assets_t* assets)
+{
+    while (resident_size > MAX_RESIDENT_ASSET_SIZE)
+    {
+        int16_t tex_idx = find_unused_texture();
+        int16_t pack_idx = find_unused_level_pack();
+        if (tex_idx < 0 && pack_idx < 0) break;
+
+        if (
+            pack_idx < 0
+            || (tex_idx >= 0 && textures[tex_idx].slot.last_used < levelpacks[pack_idx].slot.last_used)
+        )
+        {
+            free_texture_slot(assets, tex_idx);
+        }
+        else
+        {
+            free_level_pack_slot(assets, pack_idx);
+        }
+    }
+}
+
+// Free slot first, then a new one, then evict. -1 if everything is held
+static int16_t take_texture_slot(Assets_t* assets)
+{
+    for (uint8_t i = 0; i < n_loaded[AST_TEXTURE]; ++i)
+    {
+        if (!textures[i].slot.used) return i;
+    }
+    if (n_loaded[AST_TEXTURE] < MAX_TEXTURES) return n_loaded[AST_TEXTURE]++;
+
+    int16_t tex_idx = find_unused_texture();
+    if (tex_idx >= 0) free_texture_slot(assets, tex_idx);
+    return tex_idx;
+}
+
+static int16_t take_level_pack_slot(Assets_t* assets)
+{
+    for (uint8_t i = 0; i < n_loaded[AST_LEVELPACK]; ++i)
+    {
+        if (!levelpacks[i].slot.used) return i;
+    }
+    if (n_loaded[AST_LEVELPACK] < MAX_LEVEL_PACK) return n_loaded[AST_LEVELPACK]++;
+
+    int16_t pack_idx = find_unused_level_pack();
+    if (pack_idx >= 0) free_level_pack_slot(assets, pack_idx);
+    return pack_idx;
+}
+
+// Sounds are never unloaded, so their slots are only ever taken. -1 if all are
+static int16_t take_sound_slot(const char* name)
+{
+    if (n_loaded[AST_SOUND] >= MAX_SOUNDS)
+    {
+        printf("No sound slot left for %s\n", name);
+        return -1;
+    }
+    return n_loaded[AST_SOUND]++;
+}
+
+// The page of a texture pointer given out by the textures. -1 for any other pointer
+static int16_t find_texture_page(const Texture2D* texture)
+{
+    for (uint8_t i = 0; i < n_loaded[AST_TEXTURE]; ++i)
+    {
+        if (&textures[i].texture == texture) return textures[i].slot.used ? i : -1;
+    }
+    return -1;
+}
 
+// Standalone texture with its slot taken
+static Texture2D* set_texture_slot(Assets_t* assets, int16_t tex_idx, const char* name, Texture2D tex)
+{
     textures[tex_idx].texture = tex;
+    textures[tex_idx].region = (Rectangle){0, 0, tex.width, tex.height};
+    textures[tex_idx].page_idx = tex_idx;
     strncpy(textures[tex_idx].name, name, MAX_NAME_LEN);
     sc_map_put_s64(&assets->m_textures, textures[tex_idx].name, tex_idx);
-    n_loaded[AST_TEXTURE]++;
+    use_asset_slot(&textures[tex_idx].slot);
+    set_asset_size(&textures[tex_idx].slot, GetPixelDataSize(tex.width, tex.height, tex.format));
+    trim_assets(assets);
     return &textures[tex_idx].texture;
 }
 
-Texture2D* add_texture_rres(Assets_t* assets, const char* name, const char* filename, const RresFileInfo_t* rres_file)
+Texture2D* add_texture(Assets_t* assets, const char* name, const char* path)
 {
-    uint8_t tex_idx = n_loaded[AST_TEXTURE];
-    assert(tex_idx < MAX_TEXTURES);
+    Texture2D tex = LoadTexture(path);
+    if (tex.width == 0 || tex.height == 0) return NULL;
 
-    int res_id = rresGetResourceId(rres_file->dir, filename);
-    rresResourceChunk chunk = rresLoadResourceChunk(rres_file->fname, res_id);
+    int16_t tex_idx = take_texture_slot(assets);
+    if (tex_idx < 0)
+    {
+        printf("No texture slot left for %s\n", name);
+        UnloadTexture(tex);
+        return NULL;
+    }
+    return set_texture_slot(assets, tex_idx, name, tex);
+}
 
+Texture2D* add_texture_rres(Assets_t* assets, const char* name, const char* filename, RresFileInfo_t* rres_file)
+{
+    RresChunkView_t chunk;
     Texture2D* out_tex = NULL;
-    if (chunk.info.baseSize > 0)
+    if (get_rres_chunk(rres_file, filename, &chunk))
     {
-        uint32_t sz = chunk.info.baseSize - sizeof(int) - (chunk.data.propCount*sizeof(int));
         //Expect RAW type of png extension
-        Image image = LoadImageFromMemory(GetFileExtension(filename), chunk.data.raw, sz);
-        Texture2D tex = LoadTextureFromImage(image);
+        Image image = LoadImageFromMemory(GetFileExtension(filename), chunk.raw, chunk.size);
+        out_tex = add_texture_from_img(assets, name, image);
         UnloadImage(image); 
-        
-        textures[tex_idx].texture = tex;
-        strncpy(textures[tex_idx].name, name, MAX_NAME_LEN);
-        sc_map_put_s64(&assets->m_textures, textures[tex_idx].name, tex_idx);
-        n_loaded[AST_TEXTURE]++;
-        out_tex = &textures[tex_idx].texture;
-    }
-    rresUnloadResourceChunk(chunk);
+    }
     return out_tex;
 }
 
-Sound* add_sound_rres(Assets_t* assets, const char* name, const char* filename, const RresFileInfo_t* rres_file)
+Texture2D* add_texture_region(Assets_t* assets, const char* name, const char* page_name, Rectangle region)
+{
+    uint8_t page_idx = sc_map_get_s64(&assets->m_textures, page_name);
+    if (!sc_map_found(&assets->m_textures)) return NULL;
+    // Regions of regions are not supported
+    if (textures[page_idx].page_idx != page_idx) return NULL;
+
+    // The page is held, so it is never the one evicted
+    textures[page_idx].slot.refs++;
+    int16_t tex_idx = take_texture_slot(assets);
+    if (tex_idx < 0)
+    {
+        textures[page_idx].slot.refs--;
+        printf("No texture slot left for %s\n", name);
+        return NULL;
+    }
+
+    textures[tex_idx].texture = (Texture2D){0};
+    textures[tex_idx].region = region;
+    textures[tex_idx].page_idx = page_idx;
+    strncpy(textures[tex_idx].name, name, MAX_NAME_LEN);
+    sc_map_put_s64(&assets->m_textures, textures[tex_idx].name, tex_idx);
+    use_asset_slot(&textures[tex_idx].slot);
+    return &textures[page_idx].texture;
+}
+
+// Entries: name[32], then page, x, y, width, height as uint16
+static bool add_atlas_regions(Assets_t* assets, const uint8_t* data, uint32_t n_regions)
+{
+    char page_name[MAX_NAME_LEN];
+    const uint8_t* entry = data;
+    for (uint32_t i = 0; i < n_regions; ++i, entry += ATLAS_REGION_ENTRY_SIZE)
+    {
+        char name[MAX_NAME_LEN];
+        uint16_t vals[5];
+        memcpy(name, entry, MAX_NAME_LEN);
+        name[MAX_NAME_LEN - 1] = '\0';
+        memcpy(vals, entry + MAX_NAME_LEN, sizeof(vals));
+
+        snprintf(page_name, MAX_NAME_LEN, "atlas_%u", vals[0]);
+        Rectangle region = {vals[1], vals[2], vals[3], vals[4]};
+        if (add_texture_region(assets, name, page_name, region) == NULL) return false;
+    }
+    return true;
+}
+
+static Sound* add_sound_from_wave(Assets_t* assets, const char* name, Wave wave)
 {
-    uint8_t snd_idx = n_loaded[AST_SOUND];
-    assert(snd_idx < MAX_SOUNDS);
+    int16_t snd_idx = take_sound_slot(name);
+    if (snd_idx < 0) return NULL;
 
-    int res_id = rresGetResourceId(rres_file->dir, filename);
-    rresResourceChunk chunk = rresLoadResourceChunk(rres_file->fname, res_id);
+    Sound snd = LoadSoundFromWave(wave);
+    sfx[snd_idx].sound = snd;
+    strncpy(sfx[snd_idx].name, name, MAX_NAME_LEN);
+    sc_map_put_s64(&assets->m_sounds, sfx[snd_idx].name, snd_idx);
+    return &sfx[snd_idx].sound;
+}
 
+Sound* add_sound_rres(Assets_t* assets, const char* name, const char* filename, RresFileInfo_t* rres_file)
+{
+    RresChunkView_t chunk;
     Sound* out_snd = NULL;
-    if (chunk.info.baseSize > 0)
+    if (get_rres_chunk(rres_file, filename, &chunk))
     {
-        uint32_t sz = chunk.info.baseSize - sizeof(int) - (chunk.data.propCount*sizeof(int));
-        Wave wave = LoadWaveFromMemory(GetFileExtension(filename), chunk.data.raw, sz);
-        Sound snd = LoadSoundFromWave(wave);
+        Wave wave = LoadWaveFromMemory(GetFileExtension(filename), chunk.raw, chunk.size);
+        out_snd = add_sound_from_wave(assets, name, wave);
         UnloadWave(wave); 
-        
-        sfx[snd_idx].sound = snd;
-        strncpy(sfx[snd_idx].name, name, MAX_NAME_LEN);
-        sc_map_put_s64(&assets->m_sounds, sfx[snd_idx].name, snd_idx);
-        n_loaded[AST_SOUND]++;
-        out_snd = &sfx[snd_idx].sound;
-    }
-    rresUnloadResourceChunk(chunk);
+    }
     return out_snd;
 }
 
 Texture2D* add_texture_from_img(Assets_t* assets, const char* name, Image img)
 {
-    uint8_t tex_idx = n_loaded[AST_TEXTURE];
-    assert(tex_idx < MAX_TEXTURES);
     Texture2D tex = LoadTextureFromImage(img);
     if (tex.width == 0 || tex.height == 0) return NULL;
 
-    textures[tex_idx].texture = tex;
-    strncpy(textures[tex_idx].name, name, MAX_NAME_LEN);
-    sc_map_put_s64(&assets->m_textures, textures[tex_idx].name, tex_idx);
-    n_loaded[AST_TEXTURE]++;
-    return &textures[tex_idx].texture;
+    int16_t tex_idx = take_texture_slot(assets);
+    if (tex_idx < 0)
+    {
+        printf("No texture slot left for %s\n", name);
+        UnloadTexture(tex);
+        return NULL;
+    }
+    return set_texture_slot(assets, tex_idx, name, tex);
 }
 
 Sprite_t* add_sprite(Assets_t* assets, const char* name, Texture2D* texture)
@@ -155,7 +517,7 @@ Sprite_t* add_sprite(Assets_t* assets, const char* name, Texture2D* texture)
     uint8_t spr_idx = n_loaded[AST_SPRITE];
     assert(spr_idx < MAX_SPRITES);
     memset(sprites + spr_idx, 0, sizeof(SpriteData_t));
-    sprites[spr_idx].sprite.texture = texture;
+    set_sprite_texture(assets, &sprites[spr_idx].sprite, texture);
     strncpy(sprites[spr_idx].name, name, MAX_NAME_LEN);
     sc_map_put_s64(&assets->m_sprites, sprites[spr_idx].name, spr_idx);
     n_loaded[AST_SPRITE]++;
@@ -164,12 +526,12 @@ Sprite_t* add_sprite(Assets_t* assets, const char* name, Texture2D* texture)
 
 Sound* add_sound(Assets_t* assets, const char* name, const char* path)
 {
-    uint8_t snd_idx = n_loaded[AST_SOUND];
-    assert(snd_idx < MAX_SOUNDS);
+    int16_t snd_idx = take_sound_slot(name);
+    if (snd_idx < 0) return NULL;
+
     sfx[snd_idx].sound = LoadSound(path);
     strncpy(sfx[snd_idx].name, name, MAX_NAME_LEN);
     sc_map_put_s64(&assets->m_sounds, sfx[snd_idx].name, snd_idx);
-    n_loaded[AST_SOUND]++;
     return &sfx[snd_idx].sound;
 }
 
@@ -195,184 +557,275 @@ EmitterConfig_t* add_emitter_conf(Assets_t* assets, const char* name)
     return &emitter_confs[emitter_idx].conf;
 }
 
+static LevelPack_t* add_level_pack_data(Assets_t* assets, const char* name, LevelPack_t pack)
+{
+    int16_t pack_idx = take_level_pack_slot(assets);
+    if (pack_idx < 0)
+    {
+        printf("No level pack slot left for %s\n", name);
+        unload_level_pack(pack);
+        return NULL;
+    }
+
+    levelpacks[pack_idx].pack = pack;
+    strncpy(levelpacks[pack_idx].name, name, MAX_NAME_LEN);
+    sc_map_put_s64(&assets->m_levelpacks, levelpacks[pack_idx].name, pack_idx);
+    use_asset_slot(&levelpacks[pack_idx].slot);
+    set_asset_size(&levelpacks[pack_idx].slot, get_level_pack_size(&pack));
+    trim_assets(assets);
+    return &levelpacks[pack_idx].pack;
+}
+
 LevelPack_t* add_level_pack(Assets_t* assets, const char* name, const char* path)
 {
     FILE* file = fopen(path, "rb");
     if (file == NULL) return NULL;
 
-    LevelPackData_t* pack_info = levelpacks + n_loaded[AST_LEVELPACK];
-    fread(&pack_info->pack.n_levels, sizeof(uint32_t), 1, file);
-    pack_info->pack.levels = calloc(pack_info->pack.n_levels, sizeof(LevelMap_t));
+    LevelPack_t pack = {0};
+    fread(&pack.n_levels, sizeof(uint32_t), 1, file);
+    pack.levels = calloc(pack.n_levels, sizeof(LevelMap_t));
 
-    for (uint8_t i = 0; i < pack_info->pack.n_levels; ++i)
+    for (uint8_t i = 0; i < pack.n_levels; ++i)
     {
-        fread(pack_info->pack.levels[i].level_name, sizeof(char), 32, file);
-        fread(&pack_info->pack.levels[i].width, sizeof(uint16_t), 1, file);
-        fread(&pack_info->pack.levels[i].height, sizeof(uint16_t), 1, file);
-        uint32_t n_tiles = pack_info->pack.levels[i].width * pack_info->pack.levels[i].height;
+        fread(pack.levels[i].level_name, sizeof(char), 32, file);
+        fread(&pack.levels[i].width, sizeof(uint16_t), 1, file);
+        fread(&pack.levels[i].height, sizeof(uint16_t), 1, file);
+        uint32_t n_tiles = pack.levels[i].width * pack.levels[i].height;
 
-        pack_info->pack.levels[i].tiles = calloc(n_tiles, sizeof(LevelTileInfo_t));
-        fread(pack_info->pack.levels[i].tiles, 4, n_tiles, file);
+        pack.levels[i].tiles = calloc(n_tiles, sizeof(LevelTileInfo_t));
+        fread(pack.levels[i].tiles, 4, n_tiles, file);
     }
     
     fclose(file);
-    uint8_t pack_idx = n_loaded[AST_LEVELPACK];
-    strncpy(pack_info->name, name, MAX_NAME_LEN);
-    sc_map_put_s64(&assets->m_levelpacks, levelpacks[pack_idx].name, pack_idx);
-    n_loaded[AST_LEVELPACK]++;
-
-    return &levelpacks[pack_idx].pack;
+    build_level_pack_spawns(&pack);
+    return add_level_pack_data(assets, name, pack);
 }
 
 
-static LevelPack_t* add_level_pack_zst(Assets_t* assets, const char* name, const uint8_t* zst_buffer, uint32_t len)
+static void read_level_header(LevelMap_t* level, const uint8_t* header)
 {
-    LevelPackData_t* pack_info = levelpacks + n_loaded[AST_LEVELPACK];
-    size_t read = 0;
+    memcpy(level->level_name, header, 32);
+    memcpy(&level->width, header + 32, 2);
+    memcpy(&level->height, header + 34, 2);
+    memcpy(&level->n_chests, header + 36, 2);
+    memcpy(&level->flags, header + 38, 2);
+    level->level_name[31] = '\0';
+}
 
-    ZSTD_inBuffer input = { level_decompressor.in_buffer, read, 0 };
-    ZSTD_outBuffer output = { level_decompressor.out_buffer, 4, 0 };
+// Whole pack in one go. The levels are views into the decompressed data
+static bool decode_level_pack_arena(struct ZstdDecompressor* decompressor, const uint8_t* zst_buffer, uint32_t len, size_t content_size, LevelPack_t* pack)
+{
+    uint8_t* arena = malloc(content_size);
+    if (arena == NULL) return false;
 
-    ZSTD_DCtx_reset(level_decompressor.ctx, ZSTD_reset_session_only);
-    do
+    size_t const ret = ZSTD_decompressDCtx(decompressor->ctx, arena, content_size, zst_buffer, len);
+    if (ZSTD_isError(ret) || ret != content_size || content_size < 4)
     {
-        if (input.pos == input.size)
-        {
-            puts("Read more");
+        printf("Decompression Error: %s\n", ZSTD_isError(ret) ? ZSTD_getErrorName(ret) : "size mismatch");
+        free(arena);
+        return false;
+    }
+
+    uint32_t n_levels = 0;
+    memcpy(&n_levels, arena, 4);
+    if (n_levels > (content_size - 4) / LEVEL_HEADER_SIZE)
+    {
+        free(arena);
+        return false;
+    }
 
-            read = (len < DECOMPRESSOR_INBUF_LEN) ? len : DECOMPRESSOR_INBUF_LEN;
-            memcpy(level_decompressor.in_buffer, zst_buffer, read);
-            zst_buffer += read;
-            len -= read;
+    pack->levels = calloc(n_levels, sizeof(LevelMap_t));
+    if (pack->levels == NULL)
+    {
+        free(arena);
+        return false;
+    }
+    pack->arena = arena;
+
+    size_t offset = 4;
+    for (uint32_t i = 0; i < n_levels; ++i)
+    {
+        if (content_size - offset < LEVEL_HEADER_SIZE) goto truncated;
+        read_level_header(pack->levels + i, arena + offset);
+        offset += LEVEL_HEADER_SIZE;
+
+        size_t tiles_size = (size_t)pack->levels[i].width * pack->levels[i].height * sizeof(LevelTileInfo_t);
+        if (content_size - offset < tiles_size) goto truncated;
+        pack->levels[i].tiles = (LevelTileInfo_t*)(arena + offset);
+        offset += tiles_size;
+        pack->n_levels = i + 1;
+    }
+    return true;
 
-            if (read == 0) break;
+truncated:
+    fprintf(stderr, "Could not read level\n");
+    unload_level_pack(*pack);
+    return false;
+}
 
-            input.size = read;
-            input.pos = 0;
-        }
-        size_t const ret = ZSTD_decompressStream(level_decompressor.ctx, &output , &input);
+static bool read_zst_stream(struct ZstdDecompressor* decompressor, ZSTD_inBuffer* input, void* dst, size_t size)
+{
+    ZSTD_outBuffer output = { dst, size, 0 };
+    while (output.pos < output.size)
+    {
+        size_t in_pos = input->pos;
+        size_t out_pos = output.pos;
+        size_t const ret = ZSTD_decompressStream(decompressor->ctx, &output, input);
         if (ZSTD_isError(ret))
         {
             printf("Decompression Error: %s\n", ZSTD_getErrorName(ret));
-            break;
+            return false;
         }
+        // Out of input
+        if (input->pos == in_pos && output.pos == out_pos) return false;
     }
-    while (output.pos == 0);
+    return true;
+}
 
-    if (output.pos == 0)
+// For packs too big to hold twice, or with no content size.
+// Decompresses straight into the tiles of each level
+static bool decode_level_pack_stream(struct ZstdDecompressor* decompressor, const uint8_t* zst_buffer, uint32_t len, LevelPack_t* pack)
+{
+    ZSTD_inBuffer input = { zst_buffer, len, 0 };
+    uint32_t n_levels = 0;
+    if (!read_zst_stream(decompressor, &input, &n_levels, 4))
     {
-        perror("Could not read number of levels");
-        return NULL;
+        fprintf(stderr, "Could not read number of levels\n");
+        return false;
     }
 
-    // Read number of levels and alloc the memory for the levels
-    uint32_t n_levels = 0;
-    uint8_t lvls = 0;
-    bool err = false;
-    memcpy(&n_levels, level_decompressor.out_buffer, 4);
-    pack_info->pack.levels = calloc(n_levels, sizeof(LevelMap_t));
+    pack->levels = calloc(n_levels, sizeof(LevelMap_t));
+    if (pack->levels == NULL) return false;
 
-    for (lvls = 0; lvls < n_levels; ++lvls)
+    uint8_t header[LEVEL_HEADER_SIZE];
+    for (uint32_t i = 0; i < n_levels; ++i)
     {
-        printf("Parsing level %u\n", lvls);
-        output.size = 40;
-        output.pos = 0;
-
-        do
-        {
-            if (input.pos == input.size)
-            {
-                read = (len < DECOMPRESSOR_INBUF_LEN) ? len : DECOMPRESSOR_INBUF_LEN;
-                memcpy(level_decompressor.in_buffer, zst_buffer, read);
-                zst_buffer += read;
-                len -= read;
-
-                if (read == 0) break;
-                input.size = read;
-                input.pos = 0;
-            }
-            size_t const ret = ZSTD_decompressStream(level_decompressor.ctx, &output , &input);
-            if (ZSTD_isError(ret))
-            {
-                printf("Decompression Error: %s\n", ZSTD_getErrorName(ret));
-                break;
-            }
-            printf("Compare %lu to %lu\n", output.pos, output.size);
-        }
-        while (output.pos != output.size);
-
-        if (output.pos != output.size)
+        if (!read_zst_stream(decompressor, &input, header, LEVEL_HEADER_SIZE))
         {
-            perror("Could not read level");
-            err = true;
-            goto load_end;
+            fprintf(stderr, "Could not read level\n");
+            unload_level_pack(*pack);
+            return false;
         }
-        memcpy(pack_info->pack.levels[lvls].level_name, level_decompressor.out_buffer, 32);
-        memcpy(&pack_info->pack.levels[lvls].width, level_decompressor.out_buffer + 32, 2);
-        memcpy(&pack_info->pack.levels[lvls].height, level_decompressor.out_buffer + 34, 2);
-        memcpy(&pack_info->pack.levels[lvls].n_chests, level_decompressor.out_buffer + 36, 2);
-        memcpy(&pack_info->pack.levels[lvls].flags, level_decompressor.out_buffer + 38, 2);
-        pack_info->pack.levels[lvls].level_name[31] = '\0';
-        printf("Level name: %s\n", pack_info->pack.levels[lvls].level_name);
-        printf("WxH: %u %u\n", pack_info->pack.levels[lvls].width, pack_info->pack.levels[lvls].height);
-
-        uint32_t n_tiles = pack_info->pack.levels[lvls].width * pack_info->pack.levels[lvls].height;
-
-        uint32_t remaining_len = n_tiles * 4;
-        pack_info->pack.levels[lvls].tiles = calloc(n_tiles, sizeof(LevelTileInfo_t));
-        output.size = DECOMPRESSOR_OUTBUF_LEN;
-        output.pos = 0;
-        uint8_t* data_ptr = (uint8_t*)pack_info->pack.levels[lvls].tiles;
-        do
+        read_level_header(pack->levels + i, header);
+
+        uint32_t n_tiles = pack->levels[i].width * pack->levels[i].height;
+        pack->levels[i].tiles = calloc(n_tiles, sizeof(LevelTileInfo_t));
+        pack->n_levels = i + 1;
+        if (
+            pack->levels[i].tiles == NULL
+            || !read_zst_stream(decompressor, &input, pack->levels[i].tiles, n_tiles * sizeof(LevelTileInfo_t))
+        )
         {
-            if (input.pos == input.size)
-            {
-                read = (len < DECOMPRESSOR_INBUF_LEN) ? len : DECOMPRESSOR_INBUF_LEN;
-                memcpy(level_decompressor.in_buffer, zst_buffer, read);
-                zst_buffer += read;
-                len -= read;
-
-                if (read == 0) break;
-                input.size = read;
-                input.pos = 0;
-            }
-            size_t to_read = (remaining_len > DECOMPRESSOR_OUTBUF_LEN) ? DECOMPRESSOR_OUTBUF_LEN : remaining_len;
-            output.size = to_read;
-            output.pos = 0;
-            size_t const ret = ZSTD_decompressStream(level_decompressor.ctx, &output , &input);
-            if (ZSTD_isError(ret))
-            {
-                printf("Decompression Error: %s\n", ZSTD_getErrorName(ret));
-                break;
-            }
-            memcpy(data_ptr, level_decompressor.out_buffer, output.pos);
-            data_ptr += output.pos;
-            remaining_len -= output.pos;
+            fprintf(stderr, "Could not read level tiles\n");
+            unload_level_pack(*pack);
+            return false;
         }
-        while (remaining_len > 0);
+    }
+    return true;
+}
+
+// Only the level info is read, the tiles are decompressed in get_level
+static bool decode_level_pack_indexed(const uint8_t* buffer, uint32_t len, LevelPack_t* pack)
+{
+    if (len < LEVEL_PACK_V2_HEADER_SIZE) return false;
+
+    uint32_t n_levels;
+    uint32_t dict_size;
+    memcpy(&n_levels, buffer + 4, 4);
+    memcpy(&dict_size, buffer + 8, 4);
+    if (n_levels > (len - LEVEL_PACK_V2_HEADER_SIZE) / LEVEL_ENTRY_V2_SIZE) return false;
+
+    uint32_t dict_offset = LEVEL_PACK_V2_HEADER_SIZE + n_levels * LEVEL_ENTRY_V2_SIZE;
+    if (dict_size > len - dict_offset) return false;
+
+    struct LevelPackFrames* frames = calloc(1, sizeof(struct LevelPackFrames) + n_levels * sizeof(LevelFrame_t));
+    if (frames == NULL) return false;
+    pack->frames = frames;
+    for (uint8_t i = 0; i < LEVEL_PACK_CACHE_SIZE; ++i)
+    {
+        frames->cached_level[i] = -1;
+    }
+    frames->rle = memcmp(buffer, LEVEL_PACK_V3_MAGIC, 4) == 0;
+
+    // The source may be a mapped archive, so keep a copy
+    frames->data = malloc(len);
+    pack->levels = calloc(n_levels, sizeof(LevelMap_t));
+    if (frames->data == NULL || pack->levels == NULL) goto error;
+    memcpy(frames->data, buffer, len);
+    frames->data_size = len;
+
+    if (dict_size > 0)
+    {
+        frames->dict = ZSTD_createDDict(frames->data + dict_offset, dict_size);
+        if (frames->dict == NULL) goto error;
+    }
 
-        if (remaining_len > 0)
+    const uint8_t* entry = frames->data + LEVEL_PACK_V2_HEADER_SIZE;
+    for (uint32_t i = 0; i < n_levels; ++i, entry += LEVEL_ENTRY_V2_SIZE)
+    {
+        read_level_header(pack->levels + i, entry);
+        memcpy(&frames->level_frames[i].offset, entry + LEVEL_HEADER_SIZE, 4);
+        memcpy(&frames->level_frames[i].size, entry + LEVEL_HEADER_SIZE + 4, 4);
+        if (
+            frames->level_frames[i].offset > len
+            || frames->level_frames[i].size > len - frames->level_frames[i].offset
+        )
         {
-            free(pack_info->pack.levels[lvls].tiles);
-            perror("Could not read level tiles");
-            err = true;
-            goto load_end;
+            goto error;
         }
     }
-load_end:
-    if (err)
+    pack->n_levels = n_levels;
+    return true;
+
+error:
+    fprintf(stderr, "Invalid level pack\n");
+    unload_level_pack(*pack);
+    memset(pack, 0, sizeof(LevelPack_t));
+    return false;
+}
+
+// Only touches the decompressor and the pack, so packs can be decoded in parallel
+static bool decode_level_pack_zst(struct ZstdDecompressor* decompressor, const uint8_t* zst_buffer, uint32_t len, LevelPack_t* pack)
+{
+    memset(pack, 0, sizeof(LevelPack_t));
+    if (
+        len >= 4
+        && (memcmp(zst_buffer, LEVEL_PACK_V2_MAGIC, 4) == 0 || memcmp(zst_buffer, LEVEL_PACK_V3_MAGIC, 4) == 0)
+    )
     {
-        unload_level_pack(pack_info->pack);
-        return NULL;
+        return decode_level_pack_indexed(zst_buffer, len, pack);
     }
 
-    pack_info->pack.n_levels = lvls;
-    uint8_t pack_idx = n_loaded[AST_LEVELPACK];
-    strncpy(pack_info->name, name, MAX_NAME_LEN);
-    sc_map_put_s64(&assets->m_levelpacks, levelpacks[pack_idx].name, pack_idx);
-    n_loaded[AST_LEVELPACK]++;
+    ZSTD_DCtx_reset(decompressor->ctx, ZSTD_reset_session_only);
 
-    return &levelpacks[pack_idx].pack;
+    // The pack script makes zstd write the content size
+    unsigned long long content_size = ZSTD_getFrameContentSize(zst_buffer, len);
+    if (content_size == ZSTD_CONTENTSIZE_ERROR) return false;
+
+    bool okay;
+    if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size <= MAX_LEVEL_PACK_ARENA_SIZE)
+    {
+        okay = decode_level_pack_arena(decompressor, zst_buffer, len, content_size, pack);
+    }
+    else
+    {
+        okay = decode_level_pack_stream(decompressor, zst_buffer, len, pack);
+    }
+
+    if (okay && !build_level_pack_spawns(pack))
+    {
+        unload_level_pack(*pack);
+        return false;
+    }
+    return okay;
+}
+
+
+static LevelPack_t* add_level_pack_zst(Assets_t* assets, const char* name, const uint8_t* zst_buffer, uint32_t len)
+{
+    LevelPack_t pack = {0};
+    if (!decode_level_pack_zst(&level_decompressor, zst_buffer, len, &pack)) return NULL;
+    return add_level_pack_data(assets, name, pack);
 }
 
 LevelPack_t* uncompress_level_pack(Assets_t* assets, const char* name, const char* path)
@@ -400,33 +853,600 @@ LevelPack_t* uncompress_level_pack(Assets_t* assets, const char* name, const cha
 
 }
 
-LevelPack_t* add_level_pack_rres(Assets_t* assets, const char* name, const char* filename, const RresFileInfo_t* rres_file)
+LevelPack_t* add_level_pack_rres(Assets_t* assets, const char* name, const char* filename, RresFileInfo_t* rres_file)
 {
-    int res_id = rresGetResourceId(rres_file->dir, filename);
-    rresResourceChunk chunk = rresLoadResourceChunk(rres_file->fname, res_id);
-
+    RresChunkView_t chunk;
     LevelPack_t* pack = NULL;
-    if (chunk.info.baseSize > 0 && strcmp(".lpk", (const char*)(chunk.data.props + 1)) == 0)
+    if (get_rres_chunk(rres_file, filename, &chunk) && strncmp(".lpk", (const char*)(chunk.props + 1), 4) == 0)
     {
-        uint32_t sz = chunk.info.baseSize - sizeof(int) - (chunk.data.propCount*sizeof(int));
-        pack = add_level_pack_zst(assets, name, chunk.data.raw, sz);
+        pack = add_level_pack_zst(assets, name, chunk.raw, chunk.size);
     }
     else
     {
         printf("Cannot load level pack for %s\n", name);
     }
-    rresUnloadResourceChunk(chunk);
     return pack;
 }
 
-void init_assets(Assets_t* assets)
+#define ASSET_HANDLE_GEN_MASK 0x7FFF
+
+static AssetHandle_t make_asset_handle(const AssetLoadBatch_t* batch, uint16_t job_idx)
 {
-    sc_map_init_s64(&assets->m_fonts, MAX_FONTS, 0);
-    sc_map_init_s64(&assets->m_sprites, MAX_SPRITES, 0);
-    sc_map_init_s64(&assets->m_textures, MAX_TEXTURES, 0);
-    sc_map_init_s64(&assets->m_sounds, MAX_SOUNDS, 0);
-    sc_map_init_s64(&assets->m_levelpacks, MAX_LEVEL_PACK, 0);
-    sc_map_init_s64(&assets->m_emitter_confs, MAX_EMITTER_CONF, 0);
+    return ((AssetHandle_t)(batch->generation & ASSET_HANDLE_GEN_MASK) << 16) | job_idx;
+}
+
+// Job index of the handle, or -1 if it is not a job of the current batch
+static int32_t get_asset_handle_job(const AssetLoadBatch_t* batch, AssetHandle_t handle)
+{
+    if (handle < 0) return -1;
+    if ((handle >> 16) != (batch->generation & ASSET_HANDLE_GEN_MASK)) return -1;
+    if ((handle & 0xFFFF) >= batch->n_jobs) return -1;
+    return handle & 0xFFFF;
+}
+
+static void end_asset_load_batch(AssetLoadBatch_t* batch)
+{
+    batch->n_jobs = 0;
+    batch->generation++;
+}
+
+static AssetLoadJob_t* new_load_job(AssetLoadBatch_t* batch, AssetLoadType_t type, const char* name, const char* filename)
+{
+    if (batch->n_jobs == MAX_ASSET_LOAD_JOBS) return NULL;
+
+    AssetLoadJob_t* job = batch->jobs + batch->n_jobs;
+    memset(job, 0, sizeof(AssetLoadJob_t));
+    job->type = type;
+    job->priority = ASSET_LOAD_PRIORITY_DEFAULT;
+    strncpy(job->name, name, MAX_NAME_LEN - 1);
+    strncpy(job->filename, filename, sizeof(job->filename) - 1);
+    const char* ext = GetFileExtension(filename);
+    if (ext != NULL) strncpy(job->ext, ext, sizeof(job->ext) - 1);
+    batch->n_jobs++;
+    return job;
+}
+
+static AssetHandle_t queue_load_rres(AssetLoadBatch_t* batch, AssetLoadType_t type, const char* name, const char* filename, RresFileInfo_t* rres_file)
+{
+    // Compressed chunks are decompressed by the workers
+    RresChunkView_t chunk;
+    if (!get_rres_chunk_packed(rres_file, filename, &chunk)) return INVALID_ASSET_HANDLE;
+
+    AssetLoadJob_t* job = new_load_job(batch, type, name, filename);
+    if (job == NULL) return INVALID_ASSET_HANDLE;
+    job->data = chunk.raw;
+    job->size = chunk.size;
+    job->packed_size = chunk.packed_size;
+    job->from_file = false;
+    return make_asset_handle(batch, job - batch->jobs);
+}
+
+static AssetHandle_t queue_load_file(AssetLoadBatch_t* batch, AssetLoadType_t type, const char* name, const char* path)
+{
+    AssetLoadJob_t* job = new_load_job(batch, type, name, path);
+    if (job == NULL) return INVALID_ASSET_HANDLE;
+    job->from_file = true;
+    return make_asset_handle(batch, job - batch->jobs);
+}
+
+AssetHandle_t queue_texture_load(AssetLoadBatch_t* batch, const char* name, const char* path)
+{
+    return queue_load_file(batch, ASSET_LOAD_TEXTURE, name, path);
+}
+
+AssetHandle_t queue_sound_load(AssetLoadBatch_t* batch, const char* name, const char* path)
+{
+    return queue_load_file(batch, ASSET_LOAD_SOUND, name, path);
+}
+
+AssetHandle_t queue_level_pack_load(AssetLoadBatch_t* batch, const char* name, const char* path)
+{
+    return queue_load_file(batch, ASSET_LOAD_LEVELPACK, name, path);
+}
+
+AssetHandle_t queue_texture_load_rres(AssetLoadBatch_t* batch, const char* name, const char* filename, RresFileInfo_t* rres_file)
+{
+    return queue_load_rres(batch, ASSET_LOAD_TEXTURE, name, filename, rres_file);
+}
+
+AssetHandle_t queue_sound_load_rres(AssetLoadBatch_t* batch, const char* name, const char* filename, RresFileInfo_t* rres_file)
+{
+    return queue_load_rres(batch, ASSET_LOAD_SOUND, name, filename, rres_file);
+}
+
+AssetHandle_t queue_level_pack_load_rres(AssetLoadBatch_t* batch, const char* name, const char* filename, RresFileInfo_t* rres_file)
+{
+    RresChunkView_t chunk;
+    if (!get_rres_chunk_packed(rres_file, filename, &chunk) || strncmp(".lpk", (const char*)(chunk.props + 1), 4) != 0)
+    {
+        printf("Cannot load level pack for %s\n", name);
+        return INVALID_ASSET_HANDLE;
+    }
+    return queue_load_rres(batch, ASSET_LOAD_LEVELPACK, name, filename, rres_file);
+}
+
+bool queue_texture_atlas_load_rres(AssetLoadBatch_t* batch, const char* filename, RresFileInfo_t* rres_file)
+{
+    // Not an error, there may be no atlas
+    RresChunkView_t chunk;
+    if (!get_rres_chunk(rres_file, filename, &chunk)) return false;
+
+    uint32_t n_pages = 0;
+    uint32_t n_regions = 0;
+    if (chunk.size >= 8)
+    {
+        memcpy(&n_pages, chunk.raw, 4);
+        memcpy(&n_regions, chunk.raw + 4, 4);
+    }
+    if (
+        strncmp(".atl", (const char*)(chunk.props + 1), 4) != 0
+        || chunk.size < 8 || chunk.size - 8 < n_regions * ATLAS_REGION_ENTRY_SIZE
+    )
+    {
+        printf("Cannot load texture atlas %s\n", filename);
+        return false;
+    }
+
+    // The regions are added after the pages, as jobs are added in order
+    char page_name[MAX_NAME_LEN];
+    char page_file[MAX_NAME_LEN];
+    for (uint32_t i = 0; i < n_pages; ++i)
+    {
+        snprintf(page_name, MAX_NAME_LEN, "atlas_%u", i);
+        snprintf(page_file, MAX_NAME_LEN, "atlas_%u.png", i);
+        if (queue_texture_load_rres(batch, page_name, page_file, rres_file) == INVALID_ASSET_HANDLE) return false;
+    }
+
+    AssetLoadJob_t* job = new_load_job(batch, ASSET_LOAD_ATLAS, filename, filename);
+    if (job == NULL) return false;
+    job->data = chunk.raw + 8;
+    job->size = n_regions;
+    return true;
+}
+
+// CPU side only, safe to run on any thread
+static void decode_load_job(AssetLoadJob_t* job, struct ZstdDecompressor* decompressor)
+{
+    const uint8_t* data = job->data;
+    int size = job->size;
+    uint8_t* file_data = NULL;
+    if (job->from_file)
+    {
+        file_data = LoadFileData(job->filename, &size);
+        if (file_data == NULL) return;
+        data = file_data;
+    }
+    else if (job->packed_size > 0)
+    {
+        // Decoders copy what they need, so the scratch is reused by the next job
+        data = decompress_chunk(decompressor, job->data, job->packed_size, job->size);
+        if (data == NULL) return;
+    }
+
+    switch (job->type)
+    {
+        case ASSET_LOAD_TEXTURE:
+            job->image = LoadImageFromMemory(job->ext, data, size);
+            job->decoded = job->image.data != NULL;
+        break;
+        case ASSET_LOAD_SOUND:
+            job->wave = LoadWaveFromMemory(job->ext, data, size);
+            job->decoded = job->wave.data != NULL;
+        break;
+        case ASSET_LOAD_LEVELPACK:
+            job->decoded = decode_level_pack_zst(decompressor, data, size, &job->pack);
+        break;
+        case ASSET_LOAD_ATLAS:
+            // Small enough to parse when adding the regions
+            job->decoded = true;
+        break;
+    }
+
+    if (file_data != NULL) UnloadFileData(file_data);
+}
+
+// Main thread, as it needs the GPU and audio device
+static bool add_load_job(Assets_t* assets, AssetLoadJob_t* job)
+{
+    if (!job->decoded)
+    {
+        printf("Unable to decode %s for %s\n", job->filename, job->name);
+        return false;
+    }
+
+    bool okay = false;
+    switch (job->type)
+    {
+        case ASSET_LOAD_TEXTURE:
+            okay = add_texture_from_img(assets, job->name, job->image) != NULL;
+            UnloadImage(job->image);
+        break;
+        case ASSET_LOAD_SOUND:
+            okay = add_sound_from_wave(assets, job->name, job->wave) != NULL;
+            UnloadWave(job->wave);
+        break;
+        case ASSET_LOAD_LEVELPACK:
+            okay = add_level_pack_data(assets, job->name, job->pack) != NULL;
+        break;
+        case ASSET_LOAD_ATLAS:
+            okay = add_atlas_regions(assets, job->data, job->size);
+        break;
+    }
+    if (!okay)
+    {
+        printf("Unable to add %s for %s\n", job->filename, job->name);
+    }
+    return okay;
+}
+
+typedef struct AssetLoadWorkers
+{
+    AssetLoadBatch_t* batch;
+    uint16_t next_job;
+#if !defined(PLATFORM_WEB)
+    pthread_mutex_t lock;
+#endif
+}AssetLoadWorkers_t;
+
+static void* asset_load_worker(void* arg)
+{
+    AssetLoadWorkers_t* workers = arg;
+    struct ZstdDecompressor decompressor = { .ctx = ZSTD_createDCtx() };
+
+    while (true)
+    {
+#if !defined(PLATFORM_WEB)
+        pthread_mutex_lock(&workers->lock);
+#endif
+        uint16_t job_idx = workers->next_job++;
+#if !defined(PLATFORM_WEB)
+        pthread_mutex_unlock(&workers->lock);
+#endif
+        if (job_idx >= workers->batch->n_jobs) break;
+
+        decode_load_job(workers->batch->jobs + job_idx, &decompressor);
+    }
+
+    free_zstd_decompressor(&decompressor);
+    return NULL;
+}
+
+bool run_asset_load_batch(Assets_t* assets, AssetLoadBatch_t* batch)
+{
+    AssetLoadWorkers_t workers = {
+        .batch = batch,
+        .next_job = 0,
+    };
+
+#if !defined(PLATFORM_WEB)
+    // The main thread works too
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    if (n_threads > MAX_ASSET_LOAD_WORKERS) n_threads = MAX_ASSET_LOAD_WORKERS;
+    if (n_threads > batch->n_jobs - 1) n_threads = batch->n_jobs - 1;
+
+    pthread_t threads[MAX_ASSET_LOAD_WORKERS];
+    long n_started = 0;
+    pthread_mutex_init(&workers.lock, NULL);
+    for (; n_started < n_threads; ++n_started)
+    {
+        if (pthread_create(threads + n_started, NULL, asset_load_worker, &workers) != 0) break;
+    }
+    asset_load_worker(&workers);
+    for (long i = 0; i < n_started; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&workers.lock);
+#else
+    // No threads on web
+    asset_load_worker(&workers);
+#endif
+
+    bool okay = true;
+    for (uint16_t i = 0; i < batch->n_jobs; ++i)
+    {
+        okay &= add_load_job(assets, batch->jobs + i);
+    }
+    end_asset_load_batch(batch);
+    return okay;
+}
+
+AssetHandle_t find_asset_load(const AssetLoadBatch_t* batch, const char* name)
+{
+    for (uint16_t i = 0; i < batch->n_jobs; ++i)
+    {
+        if (strcmp(batch->jobs[i].name, name) == 0) return make_asset_handle(batch, i);
+    }
+
+    // Textures in an atlas are loaded with their page
+    for (uint16_t i = 0; i < batch->n_jobs; ++i)
+    {
+        const AssetLoadJob_t* job = batch->jobs + i;
+        if (job->type != ASSET_LOAD_ATLAS) continue;
+
+        const uint8_t* entry = job->data;
+        for (uint32_t j = 0; j < job->size; ++j, entry += ATLAS_REGION_ENTRY_SIZE)
+        {
+            if (strncmp((const char*)entry, name, MAX_NAME_LEN) != 0) continue;
+
+            uint16_t page;
+            char page_name[MAX_NAME_LEN];
+            memcpy(&page, entry + MAX_NAME_LEN, sizeof(page));
+            snprintf(page_name, MAX_NAME_LEN, "atlas_%u", page);
+            return find_asset_load(batch, page_name);
+        }
+    }
+    return INVALID_ASSET_HANDLE;
+}
+
+void set_asset_load_priority(AssetLoadBatch_t* batch, AssetHandle_t handle, uint8_t priority)
+{
+    int32_t job_idx = get_asset_handle_job(batch, handle);
+    if (job_idx < 0) return;
+    batch->jobs[job_idx].priority = priority;
+}
+
+void set_asset_load_callback(AssetLoadBatch_t* batch, AssetHandle_t handle, AssetLoadedFunc_t on_loaded, void* user_data)
+{
+    int32_t job_idx = get_asset_handle_job(batch, handle);
+    if (job_idx < 0) return;
+    batch->jobs[job_idx].on_loaded = on_loaded;
+    batch->jobs[job_idx].user_data = user_data;
+}
+
+// Only one batch loads in the background at a time
+static struct AsyncAssetLoader
+{
+    AssetLoadBatch_t* batch;
+    struct sc_heap queue; // Jobs to decode, highest priority first
+    uint16_t n_pending; // Jobs not uploaded yet
+#if !defined(PLATFORM_WEB)
+    pthread_t thread;
+    pthread_mutex_t lock;
+    bool has_thread;
+#endif
+}async_loader;
+
+// Take the slot now, so that lookups give a stable pointer to an empty asset
+// until it is uploaded. Empty textures draw nothing and empty sounds do not play
+static void reserve_load_job(Assets_t* assets, AssetLoadJob_t* job)
+{
+    switch (job->type)
+    {
+        case ASSET_LOAD_TEXTURE:
+        {
+            int16_t tex_idx = take_texture_slot(assets);
+            job->slot = tex_idx;
+            if (tex_idx < 0)
+            {
+                job->state = ASSET_LOAD_FAILED;
+                break;
+            }
+            memset(textures + tex_idx, 0, sizeof(TextureData_t));
+            textures[tex_idx].page_idx = tex_idx;
+            strncpy(textures[tex_idx].name, job->name, MAX_NAME_LEN);
+            sc_map_put_s64(&assets->m_textures, textures[tex_idx].name, tex_idx);
+            use_asset_slot(&textures[tex_idx].slot);
+        }
+        break;
+        case ASSET_LOAD_SOUND:
+        {
+            int16_t snd_idx = take_sound_slot(job->name);
+            job->slot = snd_idx;
+            if (snd_idx < 0)
+            {
+                job->state = ASSET_LOAD_FAILED;
+                break;
+            }
+            memset(sfx + snd_idx, 0, sizeof(SoundData_t));
+            strncpy(sfx[snd_idx].name, job->name, MAX_NAME_LEN);
+            sc_map_put_s64(&assets->m_sounds, sfx[snd_idx].name, snd_idx);
+        }
+        break;
+        case ASSET_LOAD_LEVELPACK:
+        {
+            int16_t pack_idx = take_level_pack_slot(assets);
+            job->slot = pack_idx;
+            if (pack_idx < 0)
+            {
+                job->state = ASSET_LOAD_FAILED;
+                break;
+            }
+            memset(levelpacks + pack_idx, 0, sizeof(LevelPackData_t));
+            strncpy(levelpacks[pack_idx].name, job->name, MAX_NAME_LEN);
+            sc_map_put_s64(&assets->m_levelpacks, levelpacks[pack_idx].name, pack_idx);
+            use_asset_slot(&levelpacks[pack_idx].slot);
+        }
+        break;
+        case ASSET_LOAD_ATLAS:
+            // The pages are queued before, so their slots are taken
+            job->state = add_atlas_regions(assets, job->data, job->size) ? ASSET_LOAD_READY : ASSET_LOAD_FAILED;
+        break;
+    }
+}
+
+// Fill in the reserved slot, on the main thread
+static bool upload_load_job(AssetLoadJob_t* job)
+{
+    if (!job->decoded)
+    {
+        printf("Unable to decode %s for %s\n", job->filename, job->name);
+        return false;
+    }
+
+    switch (job->type)
+    {
+        case ASSET_LOAD_TEXTURE:
+        {
+            Texture2D tex = LoadTextureFromImage(job->image);
+            UnloadImage(job->image);
+            textures[job->slot].texture = tex;
+            textures[job->slot].region = (Rectangle){0, 0, tex.width, tex.height};
+            set_asset_size(&textures[job->slot].slot, GetPixelDataSize(tex.width, tex.height, tex.format));
+            return tex.id != 0;
+        }
+        case ASSET_LOAD_SOUND:
+            sfx[job->slot].sound = LoadSoundFromWave(job->wave);
+            UnloadWave(job->wave);
+        break;
+        case ASSET_LOAD_LEVELPACK:
+            levelpacks[job->slot].pack = job->pack;
+            set_asset_size(&levelpacks[job->slot].slot, get_level_pack_size(&job->pack));
+        break;
+        case ASSET_LOAD_ATLAS:
+        break;
+    }
+    return true;
+}
+
+static bool pop_async_job(AssetLoadJob_t** job)
+{
+    struct sc_heap_data* item = sc_heap_pop(&async_loader.queue);
+    if (item == NULL) return false;
+    *job = item->data;
+    return true;
+}
+
+#if !defined(PLATFORM_WEB)
+static void* async_load_worker(void* arg)
+{
+    (void)arg;
+    struct ZstdDecompressor decompressor = { .ctx = ZSTD_createDCtx() };
+
+    while (true)
+    {
+        AssetLoadJob_t* job;
+        pthread_mutex_lock(&async_loader.lock);
+        bool has_job = pop_async_job(&job);
+        pthread_mutex_unlock(&async_loader.lock);
+        if (!has_job) break;
+
+        decode_load_job(job, &decompressor);
+
+        pthread_mutex_lock(&async_loader.lock);
+        job->state = ASSET_LOAD_DECODED;
+        pthread_mutex_unlock(&async_loader.lock);
+    }
+
+    free_zstd_decompressor(&decompressor);
+    return NULL;
+}
+#endif
+
+bool start_asset_load_batch(Assets_t* assets, AssetLoadBatch_t* batch)
+{
+    if (async_loader.batch != NULL) return false;
+
+    async_loader.batch = batch;
+    async_loader.n_pending = 0;
+    sc_heap_init(&async_loader.queue, batch->n_jobs);
+    for (uint16_t i = 0; i < batch->n_jobs; ++i)
+    {
+        AssetLoadJob_t* job = batch->jobs + i;
+        job->state = ASSET_LOAD_QUEUED;
+        reserve_load_job(assets, job);
+        if (job->state != ASSET_LOAD_QUEUED) continue;
+
+        // Min heap, so higher priorities are negated. Ties go in queue order
+        sc_heap_add(&async_loader.queue, -((int64_t)job->priority << 16) + i, job);
+        async_loader.n_pending++;
+    }
+
+#if !defined(PLATFORM_WEB)
+    pthread_mutex_init(&async_loader.lock, NULL);
+    async_loader.has_thread = pthread_create(&async_loader.thread, NULL, async_load_worker, NULL) == 0;
+#endif
+    return true;
+}
+
+uint16_t update_asset_load_batch(Assets_t* assets)
+{
+    AssetLoadBatch_t* batch = async_loader.batch;
+    if (batch == NULL) return 0;
+
+#if defined(PLATFORM_WEB)
+    // No threads on web, decode one job per update instead
+    AssetLoadJob_t* next_job;
+    if (pop_async_job(&next_job))
+    {
+        decode_load_job(next_job, &level_decompressor);
+        next_job->state = ASSET_LOAD_DECODED;
+    }
+#else
+    if (!async_loader.has_thread)
+    {
+        // Could not start the worker, finish it here
+        async_load_worker(NULL);
+    }
+#endif
+
+    for (uint16_t i = 0; i < batch->n_jobs; ++i)
+    {
+        AssetLoadJob_t* job = batch->jobs + i;
+#if !defined(PLATFORM_WEB)
+        pthread_mutex_lock(&async_loader.lock);
+#endif
+        bool decoded = job->state == ASSET_LOAD_DECODED;
+#if !defined(PLATFORM_WEB)
+        pthread_mutex_unlock(&async_loader.lock);
+#endif
+        if (!decoded) continue;
+
+        bool okay = upload_load_job(job);
+        job->state = okay ? ASSET_LOAD_READY : ASSET_LOAD_FAILED;
+        async_loader.n_pending--;
+        if (job->on_loaded != NULL)
+        {
+            job->on_loaded(make_asset_handle(batch, i), okay, job->user_data);
+        }
+    }
+    trim_assets(assets);
+
+    if (async_loader.n_pending == 0)
+    {
+#if !defined(PLATFORM_WEB)
+        if (async_loader.has_thread) pthread_join(async_loader.thread, NULL);
+        pthread_mutex_destroy(&async_loader.lock);
+#endif
+        sc_heap_term(&async_loader.queue);
+        async_loader.batch = NULL;
+        end_asset_load_batch(batch);
+    }
+    return async_loader.n_pending;
+}
+
+void finish_asset_load_batch(Assets_t* assets)
+{
+#if !defined(PLATFORM_WEB)
+    if (async_loader.batch != NULL && async_loader.has_thread)
+    {
+        // The worker stops once there is nothing left to decode
+        pthread_join(async_loader.thread, NULL);
+        async_loader.has_thread = false;
+    }
+#endif
+    while (update_asset_load_batch(assets) > 0);
+}
+
+bool is_asset_loaded(const AssetLoadBatch_t* batch, AssetHandle_t handle)
+{
+    if (handle < 0) return false;
+    // Only the current batch can still be loading
+    if ((handle >> 16) != (batch->generation & ASSET_HANDLE_GEN_MASK)) return true;
+
+    int32_t job_idx = get_asset_handle_job(batch, handle);
+    if (job_idx < 0) return false;
+    return batch->jobs[job_idx].state == ASSET_LOAD_READY || batch->jobs[job_idx].state == ASSET_LOAD_FAILED;
+}
+
+void init_assets(Assets_t* assets)
+{
+    sc_map_init_s64(&assets->m_fonts, MAX_FONTS, 0);
+    sc_map_init_s64(&assets->m_sprites, MAX_SPRITES, 0);
+    sc_map_init_s64(&assets->m_textures, MAX_TEXTURES, 0);
+    sc_map_init_s64(&assets->m_sounds, MAX_SOUNDS, 0);
+    sc_map_init_s64(&assets->m_levelpacks, MAX_LEVEL_PACK, 0);
+    sc_map_init_s64(&assets->m_emitter_confs, MAX_EMITTER_CONF, 0);
     level_decompressor.ctx = ZSTD_createDCtx();
 }
 
@@ -434,6 +1454,7 @@ void free_all_assets(Assets_t* assets)
 {
     for (uint8_t i = 0; i < n_loaded[AST_TEXTURE]; ++i)
     {
+        if (!textures[i].slot.used || textures[i].page_idx != i) continue;
         UnloadTexture(textures[i].texture);
     }
     for (uint8_t i = 0; i < n_loaded[AST_SOUND]; ++i)
@@ -446,8 +1467,12 @@ void free_all_assets(Assets_t* assets)
     }
     for (uint8_t i = 0; i < n_loaded[AST_LEVELPACK]; ++i)
     {
+        if (!levelpacks[i].slot.used) continue;
         unload_level_pack(levelpacks[i].pack);
     }
+    memset(textures, 0, sizeof(textures));
+    memset(levelpacks, 0, sizeof(levelpacks));
+    resident_size = 0;
 
     sc_map_clear_s64(&assets->m_textures);
     sc_map_clear_s64(&assets->m_fonts);
@@ -467,7 +1492,7 @@ void term_assets(Assets_t* assets)
     sc_map_term_s64(&assets->m_sprites);
     sc_map_term_s64(&assets->m_levelpacks);
     sc_map_term_s64(&assets->m_emitter_confs);
-    ZSTD_freeDCtx(level_decompressor.ctx);
+    free_zstd_decompressor(&level_decompressor);
 }
 
 Texture2D* get_texture(Assets_t* assets, const char* name)
@@ -475,11 +1500,57 @@ Texture2D* get_texture(Assets_t* assets, const char* name)
     uint8_t tex_idx = sc_map_get_s64(&assets->m_textures, name);
     if (sc_map_found(&assets->m_textures))
     {
-        return &textures[tex_idx].texture;
+        uint8_t page_idx = textures[tex_idx].page_idx;
+        textures[page_idx].slot.last_used = ++asset_tick;
+        return &textures[page_idx].texture;
     }
     return NULL;
 }
 
+Texture2D* acquire_texture(Assets_t* assets, const char* name)
+{
+    Texture2D* tex = get_texture(assets, name);
+    if (tex != NULL)
+    {
+        textures[sc_map_get_s64(&assets->m_textures, name)].slot.refs++;
+    }
+    return tex;
+}
+
+void release_texture(Assets_t* assets, const char* name)
+{
+    uint8_t tex_idx = sc_map_get_s64(&assets->m_textures, name);
+    if (!sc_map_found(&assets->m_textures)) return;
+
+    release_texture_slot(assets, tex_idx);
+    trim_assets(assets);
+}
+
+void set_sprite_texture(Assets_t* assets, Sprite_t* spr, Texture2D* texture)
+{
+    if (spr->texture == texture) return;
+
+    int16_t page_idx = find_texture_page(texture);
+    if (page_idx >= 0) textures[page_idx].slot.refs++;
+    page_idx = find_texture_page(spr->texture);
+    spr->texture = texture;
+    if (page_idx >= 0)
+    {
+        release_texture_slot(assets, page_idx);
+        trim_assets(assets);
+    }
+}
+
+Rectangle get_texture_region(Assets_t* assets, const char* name)
+{
+    uint8_t tex_idx = sc_map_get_s64(&assets->m_textures, name);
+    if (sc_map_found(&assets->m_textures))
+    {
+        return textures[tex_idx].region;
+    }
+    return (Rectangle){0};
+}
+
 Sprite_t* get_sprite(Assets_t* assets, const char* name)
 {
     uint8_t spr_idx = sc_map_get_s64(&assets->m_sprites, name);
@@ -500,6 +1571,33 @@ EmitterConfig_t* get_emitter_conf(Assets_t* assets, const char* name)
     return NULL;
 }
 
+AssetId_t get_sprite_id(Assets_t* assets, const char* name)
+{
+    uint8_t spr_idx = sc_map_get_s64(&assets->m_sprites, name);
+    if (!sc_map_found(&assets->m_sprites)) return INVALID_ASSET_ID;
+    return spr_idx;
+}
+
+AssetId_t get_emitter_conf_id(Assets_t* assets, const char* name)
+{
+    uint8_t emitter_idx = sc_map_get_s64(&assets->m_emitter_confs, name);
+    if (!sc_map_found(&assets->m_emitter_confs)) return INVALID_ASSET_ID;
+    return emitter_idx;
+}
+
+Sprite_t* get_sprite_by_id(Assets_t* assets, AssetId_t id)
+{
+    (void)assets;
+    if (id < 0 || id >= n_loaded[AST_SPRITE]) return NULL;
+    return &sprites[id].sprite;
+}
+
+EmitterConfig_t* get_emitter_conf_by_id(Assets_t* assets, AssetId_t id)
+{
+    (void)assets;
+    if (id < 0 || id >= n_loaded[AST_EMITTER_CONF]) return NULL;
+    return &emitter_confs[id].conf;
+}
 
 Sound* get_sound(Assets_t* assets, const char* name)
 {
@@ -526,11 +1624,251 @@ LevelPack_t* get_level_pack(Assets_t* assets, const char* name)
     uint8_t pack_idx = sc_map_get_s64(&assets->m_levelpacks, name);
     if (sc_map_found(&assets->m_levelpacks))
     {
+        levelpacks[pack_idx].slot.last_used = ++asset_tick;
         return &levelpacks[pack_idx].pack;
     }
     return NULL;
 }
 
+LevelPack_t* acquire_level_pack(Assets_t* assets, const char* name)
+{
+    LevelPack_t* pack = get_level_pack(assets, name);
+    if (pack != NULL) retain_level_pack(assets, pack);
+    return pack;
+}
+
+static LevelPackData_t* get_level_pack_data(LevelPack_t* pack)
+{
+    LevelPackData_t* pack_info = (LevelPackData_t*)pack;
+    if (pack_info < levelpacks || pack_info >= levelpacks + n_loaded[AST_LEVELPACK]) return NULL;
+    if (!pack_info->slot.used) return NULL;
+    return pack_info;
+}
+
+void retain_level_pack(Assets_t* assets, LevelPack_t* pack)
+{
+    (void)assets;
+    LevelPackData_t* pack_info = get_level_pack_data(pack);
+    if (pack_info == NULL) return;
+
+    pack_info->slot.refs++;
+    pack_info->slot.last_used = ++asset_tick;
+}
+
+void release_level_pack(Assets_t* assets, LevelPack_t* pack)
+{
+    LevelPackData_t* pack_info = get_level_pack_data(pack);
+    if (pack_info == NULL) return;
+
+    if (pack_info->slot.refs > 0) pack_info->slot.refs--;
+    trim_assets(assets);
+}
+
+size_t get_resident_asset_size(Assets_t* assets)
+{
+    (void)assets;
+    return resident_size;
+}
+
+bool reload_texture(Assets_t* assets, const char* name, const char* path)
+{
+    uint8_t tex_idx = sc_map_get_s64(&assets->m_textures, name);
+    if (!sc_map_found(&assets->m_textures)) return false;
+    if (textures[tex_idx].page_idx != tex_idx) return false;
+    for (uint8_t i = 0; i < n_loaded[AST_TEXTURE]; ++i)
+    {
+        // The regions would no longer line up
+        if (i != tex_idx && textures[i].slot.used && textures[i].page_idx == tex_idx) return false;
+    }
+
+    Texture2D tex = LoadTexture(path);
+    if (tex.id == 0) return false;
+
+    UnloadTexture(textures[tex_idx].texture);
+    textures[tex_idx].texture = tex;
+    textures[tex_idx].region = (Rectangle){0, 0, tex.width, tex.height};
+    set_asset_size(&textures[tex_idx].slot, GetPixelDataSize(tex.width, tex.height, tex.format));
+    trim_assets(assets);
+    return true;
+}
+
+bool reload_level_pack(Assets_t* assets, const char* name, const char* path)
+{
+    uint8_t pack_idx = sc_map_get_s64(&assets->m_levelpacks, name);
+    if (!sc_map_found(&assets->m_levelpacks)) return false;
+
+    int size = 0;
+    unsigned char* data = LoadFileData(path, &size);
+    if (data == NULL) return false;
+
+    LevelPack_t pack;
+    bool okay = decode_level_pack_zst(&level_decompressor, data, size, &pack);
+    UnloadFileData(data);
+    if (!okay) return false;
+
+    pack.revision = levelpacks[pack_idx].pack.revision + 1;
+    unload_level_pack(levelpacks[pack_idx].pack);
+    levelpacks[pack_idx].pack = pack;
+    set_asset_size(&levelpacks[pack_idx].slot, get_level_pack_size(&pack));
+    trim_assets(assets);
+    return true;
+}
+
+static bool reserve_level_buffer(void** buffer, size_t* capacity, size_t size)
+{
+    if (size <= *capacity) return true;
+
+    void* new_buffer = realloc(*buffer, size);
+    if (new_buffer == NULL) return false;
+    *buffer = new_buffer;
+    *capacity = size;
+    return true;
+}
+
+static size_t decompress_level_frame(struct LevelPackFrames* frames, uint32_t level_num, void* dst, size_t size)
+{
+    const LevelFrame_t* frame = frames->level_frames + level_num;
+    size_t ret;
+    if (frames->dict != NULL)
+    {
+        ret = ZSTD_decompress_usingDDict(
+            level_decompressor.ctx, dst, size,
+            frames->data + frame->offset, frame->size, frames->dict
+        );
+    }
+    else
+    {
+        ret = ZSTD_decompressDCtx(
+            level_decompressor.ctx, dst, size,
+            frames->data + frame->offset, frame->size
+        );
+    }
+    return ZSTD_isError(ret) ? 0 : ret;
+}
+
+// [n_spawns, 4 bytes][n_runs, 4 bytes][spawns][runs]
+// The spawns are used in place, and the runs are filled into the tiles
+static bool load_level_runs(struct LevelPackFrames* frames, uint8_t slot, uint32_t level_num, LevelMap_t* level)
+{
+    const LevelFrame_t* frame = frames->level_frames + level_num;
+    unsigned long long size = ZSTD_getFrameContentSize(frames->data + frame->offset, frame->size);
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN || size < 8) return false;
+    if (!reserve_level_buffer((void**)&frames->raw[slot], &frames->raw_capacity[slot], size)) return false;
+    if (decompress_level_frame(frames, level_num, frames->raw[slot], size) != size) return false;
+
+    const uint8_t* raw = frames->raw[slot];
+    uint32_t n_spawns;
+    uint32_t n_runs;
+    memcpy(&n_spawns, raw, 4);
+    memcpy(&n_runs, raw + 4, 4);
+    if ((uint64_t)n_spawns * sizeof(LevelSpawn_t) + (uint64_t)n_runs * 2 + 8 != size) return false;
+
+    level->spawns = (LevelSpawn_t*)(raw + 8);
+    level->n_spawns = n_spawns;
+    for (uint32_t i = 0; i < n_spawns; ++i)
+    {
+        if (level->spawns[i].x >= level->width || level->spawns[i].y >= level->height) return false;
+    }
+
+    uint32_t n_tiles = level->width * level->height;
+    const uint8_t* run = raw + 8 + n_spawns * sizeof(LevelSpawn_t);
+    LevelTileInfo_t* tiles = level->tiles;
+    uint32_t tile_idx = 0;
+    for (uint32_t i = 0; i < n_runs; ++i, run += 2)
+    {
+        uint8_t count = run[1];
+        if (count > n_tiles - tile_idx) return false;
+
+        if (run[0] == 0)
+        {
+            memset(tiles + tile_idx, 0, count * sizeof(LevelTileInfo_t));
+        }
+        else
+        {
+            LevelTileInfo_t tile = {
+                .tile_type = run[0] & LEVEL_RUN_TYPE_MASK,
+                .water = run[0] >> LEVEL_RUN_WATER_SHIFT,
+            };
+            for (uint8_t j = 0; j < count; ++j)
+            {
+                tiles[tile_idx + j] = tile;
+            }
+        }
+        tile_idx += count;
+    }
+    return tile_idx == n_tiles;
+}
+
+static LevelMap_t* load_level_frame(LevelPack_t* pack, uint32_t level_num)
+{
+    struct LevelPackFrames* frames = pack->frames;
+    LevelMap_t* level = pack->levels + level_num;
+    frames->tick++;
+
+    uint8_t slot = 0;
+    for (uint8_t i = 0; i < LEVEL_PACK_CACHE_SIZE; ++i)
+    {
+        if (frames->cached_level[i] == (int32_t)level_num)
+        {
+            frames->last_used[i] = frames->tick;
+            return level;
+        }
+        if (frames->last_used[i] < frames->last_used[slot]) slot = i;
+    }
+
+    if (frames->cached_level[slot] >= 0)
+    {
+        LevelMap_t* evicted = pack->levels + frames->cached_level[slot];
+        evicted->tiles = NULL;
+        evicted->spawns = NULL;
+        evicted->n_spawns = 0;
+        frames->cached_level[slot] = -1;
+    }
+
+    size_t tiles_size = level->width * level->height * sizeof(LevelTileInfo_t);
+    if (!reserve_level_buffer((void**)&frames->tiles[slot], &frames->tiles_capacity[slot], tiles_size)) return NULL;
+    level->tiles = frames->tiles[slot];
+
+    bool okay;
+    if (frames->rle)
+    {
+        okay = load_level_runs(frames, slot, level_num, level);
+    }
+    else
+    {
+        okay = decompress_level_frame(frames, level_num, level->tiles, tiles_size) == tiles_size;
+        if (okay)
+        {
+            uint32_t n_spawns = count_level_spawns(level);
+            okay = reserve_level_buffer(
+                (void**)&frames->raw[slot], &frames->raw_capacity[slot],
+                (n_spawns > 0 ? n_spawns : 1) * sizeof(LevelSpawn_t)
+            );
+            if (okay) fill_level_spawns(level, (LevelSpawn_t*)frames->raw[slot]);
+        }
+    }
+
+    if (!okay)
+    {
+        printf("Unable to decompress level %s\n", level->level_name);
+        level->tiles = NULL;
+        level->spawns = NULL;
+        level->n_spawns = 0;
+        return NULL;
+    }
+
+    frames->cached_level[slot] = level_num;
+    frames->last_used[slot] = frames->tick;
+    return level;
+}
+
+LevelMap_t* get_level(LevelPack_t* pack, uint32_t level_num)
+{
+    if (pack == NULL || level_num >= pack->n_levels) return NULL;
+    if (pack->frames == NULL) return pack->levels + level_num;
+    return load_level_frame(pack, level_num);
+}
+
 void draw_sprite(Sprite_t* spr, int frame_num, Vector2 pos, float rotation, bool flip_x)
 {
     draw_sprite_pro(
@@ -539,21 +1877,53 @@ void draw_sprite(Sprite_t* spr, int frame_num, Vector2 pos, float rotation, bool
     );
 }
 
-void draw_sprite_pro(Sprite_t* spr, int frame_num, Vector2 pos, float rotation, uint8_t flip, Vector2 scale, Color colour)
+static inline Rectangle get_frame_rect(const Sprite_t* spr, int frame)
 {
-    // Rollover behaviour
-    if (frame_num >= spr->frame_count) frame_num %= spr->frame_count;
-
-    if (frame_num < 0) frame_num += spr->frame_count;
-
-    int r = frame_num / spr->frame_per_row;
-    int c = frame_num % spr->frame_per_row;
-    Rectangle rec = {
+    // No row length means a single row
+    int r = (spr->frame_per_row > 0) ? frame / spr->frame_per_row : 0;
+    int c = (spr->frame_per_row > 0) ? frame % spr->frame_per_row : frame;
+    return (Rectangle){
         spr->origin.x + spr->frame_size.x * c,
         spr->origin.y + spr->frame_size.y * r,
-        spr->frame_size.x * ((flip & 1) ? -1 : 1),
-        spr->frame_size.y * ((flip & 2) ? -1 : 1),
+        spr->frame_size.x,
+        spr->frame_size.y,
     };
+}
+
+void update_sprite_frames(Sprite_t* spr)
+{
+    spr->n_frames = 0;
+    if (spr->frame_count > MAX_SPRITE_FRAMES || spr->frame_per_row == 0) return;
+
+    for (int i = 0; i < spr->frame_count; ++i)
+    {
+        spr->frames[i] = get_frame_rect(spr, i);
+    }
+    spr->n_frames = spr->frame_count;
+}
+
+void draw_sprite_pro(Sprite_t* spr, int frame_num, Vector2 pos, float rotation, uint8_t flip, Vector2 scale, Color colour)
+{
+    // Rollover behaviour. Sprites set up by hand may have no frame count
+    if (spr->frame_count <= 0)
+    {
+        frame_num = 0;
+    }
+    else
+    {
+        frame_num %= spr->frame_count;
+        if (frame_num < 0) frame_num += spr->frame_count;
+    }
+
+    draw_sprite_frame(spr, frame_num, pos, rotation, flip, scale, colour);
+}
+
+void draw_sprite_frame(const Sprite_t* spr, int frame, Vector2 pos, float rotation, uint8_t flip, Vector2 scale, Color colour)
+{
+    // Sprites set up by hand may not have their frames worked out
+    Rectangle rec = (frame < spr->n_frames) ? spr->frames[frame] : get_frame_rect(spr, frame);
+    if (flip & 1) rec.width = -rec.width;
+    if (flip & 2) rec.height = -rec.height;
 
     // The anchor here is only for rotation and scaling.
     // Translational anchor is expected to be accounted for
@@ -3,7 +3,7 @@
 #include "sc/map/sc_map.h"
 #include "EC.h"
 #include "raylib.h"
-#include "rres.h"
+#include "rres_archive.h"
 
 #define N_ASSETS_TYPE 6
 typedef enum AssetType
@@ -53,6 +53,16 @@ typedef struct LevelTileInfo
     uint8_t dummy[1];
 }LevelTileInfo_t;
 
+// Tile types from here on are entities, and go in the spawn list
+#define LEVEL_SPAWN_TILE_START 8
+typedef struct LevelSpawn
+{
+    uint16_t x;
+    uint16_t y;
+    uint8_t tile_type;
+    uint8_t dummy[1];
+}LevelSpawn_t;
+
 typedef struct LevelMap
 {
     char level_name[32];
@@ -60,15 +70,28 @@ typedef struct LevelMap
     uint16_t height;
     uint16_t n_chests;
     uint16_t flags; // In case of extras
+    // Entity tiles may be left in here, load the static tiles
+    // from the grid and the entities from the spawn list
     LevelTileInfo_t* tiles;
+    LevelSpawn_t* spawns;
+    uint32_t n_spawns;
 }LevelMap_t;
 
+// Indexed packs only decompress the tiles of a level when it is asked for
+struct LevelPackFrames;
 typedef struct LevelPack
 {
    uint32_t n_levels;
    LevelMap_t* levels;
+   uint8_t* arena; // Holds the tiles of every level if not NULL
+   LevelSpawn_t* spawns; // Of every level, unless the pack is indexed
+   struct LevelPackFrames* frames; // Compressed tiles, if the pack is indexed
+   uint32_t revision; // Bumped when reloaded in place
 }LevelPack_t;
 
+// Size of an entry in the atlas region table written by the packer
+#define ATLAS_REGION_ENTRY_SIZE (MAX_NAME_LEN + 5 * sizeof(uint16_t))
+
 // Credits to bedroomcoders.co.uk for this
 typedef struct Sprite {
     Texture2D* texture;
@@ -79,13 +102,70 @@ typedef struct Sprite {
     int frame_count;
     int speed;
     char* name;
+    // Source rectangle of each frame, see update_sprite_frames
+    Rectangle frames[MAX_SPRITE_FRAMES];
+    uint8_t n_frames;
 } Sprite_t;
 
-typedef struct RresFileInfo
+typedef enum AssetLoadType
 {
-    rresCentralDir dir;
-    const char* fname;
-}RresFileInfo_t;
+    ASSET_LOAD_TEXTURE = 0,
+    ASSET_LOAD_SOUND,
+    ASSET_LOAD_LEVELPACK,
+    ASSET_LOAD_ATLAS,
+}AssetLoadType_t;
+
+typedef enum AssetLoadState
+{
+    ASSET_LOAD_QUEUED = 0,
+    ASSET_LOAD_DECODED,
+    ASSET_LOAD_READY,
+    ASSET_LOAD_FAILED,
+}AssetLoadState_t;
+
+// Index of a job in its batch, in the low 16 bits, and the generation
+// of the batch it was queued in, so that it is not taken for a job of
+// a later batch. Only refers to a job until its batch is done
+typedef int32_t AssetHandle_t;
+#define INVALID_ASSET_HANDLE -1
+#define ASSET_LOAD_PRIORITY_DEFAULT 0
+#define ASSET_LOAD_PRIORITY_HIGH 255
+
+// Called on the thread updating the batch
+typedef void (*AssetLoadedFunc_t)(AssetHandle_t handle, bool okay, void* user_data);
+
+typedef struct AssetLoadJob
+{
+    AssetLoadType_t type;
+    AssetLoadState_t state;
+    uint8_t priority;
+    int16_t slot; // Reserved asset, when loading in the background
+    AssetLoadedFunc_t on_loaded;
+    void* user_data;
+    char name[MAX_NAME_LEN];
+    char filename[256];
+    char ext[8];
+    bool from_file;
+    // Encoded data from an rres archive, must outlive the batch
+    const uint8_t* data;
+    uint32_t size;
+    uint32_t packed_size; // Non zero if data is a zstd frame, decompressing to size bytes
+    bool decoded;
+    // Decoded result, depending on the type
+    Image image;
+    Wave wave;
+    LevelPack_t pack;
+}AssetLoadJob_t;
+
+#define MAX_ASSET_LOAD_JOBS (MAX_TEXTURES + MAX_SOUNDS + MAX_LEVEL_PACK)
+#define MAX_ASSET_LOAD_WORKERS 8
+// Assets are decoded in parallel, then added in the order they are queued
+typedef struct AssetLoadBatch
+{
+    AssetLoadJob_t jobs[MAX_ASSET_LOAD_JOBS];
+    uint16_t n_jobs;
+    uint16_t generation; // Goes up each time the batch is done
+}AssetLoadBatch_t;
 
 void init_assets(Assets_t* assets);
 void free_all_assets(Assets_t* assets);
@@ -93,36 +173,109 @@ void term_assets(Assets_t* assets);
 
 Texture2D* add_texture(Assets_t* assets, const char* name, const char* path);
 Texture2D* add_texture_from_img(Assets_t* assets, const char* name, Image img);
+// The name refers to the region of an already added page texture
+Texture2D* add_texture_region(Assets_t* assets, const char* name, const char* page_name, Rectangle region);
 Sound* add_sound(Assets_t * assets, const char* name, const char* path);
 Font* add_font(Assets_t* assets, const char* name, const char* path);
 LevelPack_t* add_level_pack(Assets_t* assets, const char* name, const char* path);
 LevelPack_t* uncompress_level_pack(Assets_t* assets, const char* name, const char* path);
 
 // Rres version
-Texture2D* add_texture_rres(Assets_t* assets, const char* name, const char* filename, const RresFileInfo_t* rres_file);
-LevelPack_t* add_level_pack_rres(Assets_t* assets, const char* name, const char* filename, const RresFileInfo_t* rres_file);
-Sound* add_sound_rres(Assets_t* assets, const char* name, const char* filename, const RresFileInfo_t* rres_file);
+Texture2D* add_texture_rres(Assets_t* assets, const char* name, const char* filename, RresFileInfo_t* rres_file);
+LevelPack_t* add_level_pack_rres(Assets_t* assets, const char* name, const char* filename, RresFileInfo_t* rres_file);
+Sound* add_sound_rres(Assets_t* assets, const char* name, const char* filename, RresFileInfo_t* rres_file);
+
+AssetHandle_t queue_texture_load(AssetLoadBatch_t* batch, const char* name, const char* path);
+AssetHandle_t queue_sound_load(AssetLoadBatch_t* batch, const char* name, const char* path);
+AssetHandle_t queue_level_pack_load(AssetLoadBatch_t* batch, const char* name, const char* path);
+AssetHandle_t queue_texture_load_rres(AssetLoadBatch_t* batch, const char* name, const char* filename, RresFileInfo_t* rres_file);
+AssetHandle_t queue_sound_load_rres(AssetLoadBatch_t* batch, const char* name, const char* filename, RresFileInfo_t* rres_file);
+AssetHandle_t queue_level_pack_load_rres(AssetLoadBatch_t* batch, const char* name, const char* filename, RresFileInfo_t* rres_file);
+// Queues the atlas pages and the regions of the textures packed into them
+bool queue_texture_atlas_load_rres(AssetLoadBatch_t* batch, const char* filename, RresFileInfo_t* rres_file);
+AssetHandle_t find_asset_load(const AssetLoadBatch_t* batch, const char* name);
+// Only takes effect if set before the batch is started
+void set_asset_load_priority(AssetLoadBatch_t* batch, AssetHandle_t handle, uint8_t priority);
+void set_asset_load_callback(AssetLoadBatch_t* batch, AssetHandle_t handle, AssetLoadedFunc_t on_loaded, void* user_data);
+
+// Decode everything queued in parallel, then upload on the calling thread
+bool run_asset_load_batch(Assets_t* assets, AssetLoadBatch_t* batch);
+
+// Background loading. The assets are added as empty ones on start, so they
+// can be looked up straight away. Decoding happens on another thread by priority,
+// and each update uploads what is decoded. Returns the number of jobs left
+bool start_asset_load_batch(Assets_t* assets, AssetLoadBatch_t* batch);
+uint16_t update_asset_load_batch(Assets_t* assets);
+// Block until the batch is done
+void finish_asset_load_batch(Assets_t* assets);
+// False for an invalid handle. Handles of an earlier batch are done loading
+bool is_asset_loaded(const AssetLoadBatch_t* batch, AssetHandle_t handle);
+
+// Dense index of an added asset. Look it up by name once,
+// then get the asset by id without hashing the name again
+typedef int16_t AssetId_t;
+#define INVALID_ASSET_ID -1
 
 Sprite_t* add_sprite(Assets_t* assets, const char* name, Texture2D* texture);
 EmitterConfig_t* add_emitter_conf(Assets_t* assets, const char* name);
 
+// Atlased textures give the page texture
 Texture2D* get_texture(Assets_t* assets, const char* name);
+Rectangle get_texture_region(Assets_t* assets, const char* name);
 Sprite_t* get_sprite(Assets_t* assets, const char* name);
 EmitterConfig_t* get_emitter_conf(Assets_t* assets, const char* name);
+AssetId_t get_sprite_id(Assets_t* assets, const char* name);
+AssetId_t get_emitter_conf_id(Assets_t* assets, const char* name);
+// NULL for an invalid id
+Sprite_t* get_sprite_by_id(Assets_t* assets, AssetId_t id);
+EmitterConfig_t* get_emitter_conf_by_id(Assets_t* assets, AssetId_t id);
 Sound* get_sound(Assets_t* assets, const char* name);
 Font* get_font(Assets_t* assets, const char* name);
 LevelPack_t* get_level_pack(Assets_t* assets, const char* name);
 
+// Textures and level packs are refcounted. Adding one gives the caller a
+// reference. Once released by everyone, it stays loaded until its slot is
+// needed or MAX_RESIDENT_ASSET_SIZE is exceeded, least recently used first
+Texture2D* acquire_texture(Assets_t* assets, const char* name);
+void release_texture(Assets_t* assets, const char* name);
+LevelPack_t* acquire_level_pack(Assets_t* assets, const char* name);
+void retain_level_pack(Assets_t* assets, LevelPack_t* pack);
+void release_level_pack(Assets_t* assets, LevelPack_t* pack);
+size_t get_resident_asset_size(Assets_t* assets);
+// Sprites hold a reference to the texture page they draw from
+void set_sprite_texture(Assets_t* assets, Sprite_t* spr, Texture2D* texture);
+
+// Replace the data of an added asset, keeping the pointers to it the same.
+// Textures in an atlas cannot be reloaded. On failure, the old data is kept
+bool reload_texture(Assets_t* assets, const char* name, const char* path);
+bool reload_level_pack(Assets_t* assets, const char* name, const char* path);
+// Use this over the levels array, the tiles of an indexed pack may not be loaded.
+// They stay valid until LEVEL_PACK_CACHE_SIZE other levels are asked for
+LevelMap_t* get_level(LevelPack_t* pack, uint32_t level_num);
+
+// Call once the origin, frame size and frame layout of the sprite are set,
+// and whenever they change
+void update_sprite_frames(Sprite_t* spr);
 void draw_sprite(Sprite_t* spr, int frame_num, Vector2 pos, float rotation, bool flip_x);
+// Frame numbers out of range roll over
 void draw_sprite_pro(Sprite_t* spr, int frame_num, Vector2 pos, float rotation, uint8_t flip, Vector2 scale, Color colour);
+// The frame must be within [0, frame_count)
+void draw_sprite_frame(const Sprite_t* spr, int frame, Vector2 pos, float rotation, uint8_t flip, Vector2 scale, Color colour);
 Vector2 get_anchor_offset(Vector2 bbox, AnchorPoint_t anchor, bool flip_x);
 Vector2 shift_bbox(Vector2 bbox, Vector2 new_bbox, AnchorPoint_t anchor);
 
 typedef struct SFX
 {
     Sound* snd;
-    uint8_t plays;
-    uint8_t cooldown;
+    float pitch; // Of the queued play
+    uint8_t plays; // Voices in use
+    uint8_t cooldown; // Frames left before it can be played again
+    uint8_t cooldown_frames;
+    uint8_t priority; // Higher ones steal the voices of lower ones
+    // Plays go to the sfx at alias_idx, which has the same sound
+    uint8_t alias_idx;
+    bool is_alias;
+    bool queued;
 } SFX_t;
 
 #endif // __ASSETS_H
@@ -1,5 +1,62 @@
 #include "collisions.h"
 #include "AABB.h"
+#include <string.h>
+
+void reset_tilemap_chunks(TileGrid_t* tilemap)
+{
+    tilemap->chunk_width = (tilemap->width + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+    tilemap->chunk_height = (tilemap->height + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+    if (tilemap->dirty_chunks == NULL) return;
+
+    memset(tilemap->dirty_chunks, 0xFF, tilemap->chunk_width * tilemap->chunk_height);
+}
+
+void mark_tile_dirty(TileGrid_t* tilemap, unsigned int tile_idx)
+{
+    if (tilemap->dirty_chunks == NULL || tile_idx >= tilemap->n_tiles) return;
+
+    // How a tile is drawn depends on its neighbours,
+    // so chunks next to the tile may need a redraw as well
+    unsigned int tile_x = tile_idx % tilemap->width;
+    unsigned int tile_y = tile_idx / tilemap->width;
+    unsigned int x1 = (tile_x > 0) ? (tile_x - 1) / TILE_CHUNK_SIZE : 0;
+    unsigned int y1 = (tile_y > 0) ? (tile_y - 1) / TILE_CHUNK_SIZE : 0;
+    unsigned int x2 = (tile_x + 1) / TILE_CHUNK_SIZE;
+    unsigned int y2 = (tile_y + 1) / TILE_CHUNK_SIZE;
+    if (x2 >= tilemap->chunk_width) x2 = tilemap->chunk_width - 1;
+    if (y2 >= tilemap->chunk_height) y2 = tilemap->chunk_height - 1;
+
+    for (unsigned int y = y1; y <= y2; ++y)
+    {
+        for (unsigned int x = x1; x <= x2; ++x)
+        {
+            tilemap->dirty_chunks[y * tilemap->chunk_width + x] = 0xFF;
+        }
+    }
+}
+
+TileArea_t get_chunk_tile_area(const TileGrid_t* tilemap, unsigned int chunk_idx)
+{
+    TileArea_t area;
+    area.tile_x1 = (chunk_idx % tilemap->chunk_width) * TILE_CHUNK_SIZE;
+    area.tile_y1 = (chunk_idx / tilemap->chunk_width) * TILE_CHUNK_SIZE;
+    area.tile_x2 = area.tile_x1 + TILE_CHUNK_SIZE - 1;
+    area.tile_y2 = area.tile_y1 + TILE_CHUNK_SIZE - 1;
+    if (area.tile_x2 >= tilemap->width) area.tile_x2 = tilemap->width - 1;
+    if (area.tile_y2 >= tilemap->height) area.tile_y2 = tilemap->height - 1;
+    return area;
+}
+
+TileArea_t get_chunks_in_area(const TileGrid_t* tilemap, TileArea_t area)
+{
+    TileArea_t chunk_area = {
+        area.tile_x1 / TILE_CHUNK_SIZE, area.tile_y1 / TILE_CHUNK_SIZE,
+        area.tile_x2 / TILE_CHUNK_SIZE, area.tile_y2 / TILE_CHUNK_SIZE,
+    };
+    if (chunk_area.tile_x2 >= tilemap->chunk_width) chunk_area.tile_x2 = tilemap->chunk_width - 1;
+    if (chunk_area.tile_y2 >= tilemap->chunk_height) chunk_area.tile_y2 = tilemap->chunk_height - 1;
+    return chunk_area;
+}
 
 void remove_entity_from_tilemap(EntityManager_t *p_manager, TileGrid_t* tilemap, Entity_t* p_ent)
 {
@@ -35,6 +35,9 @@ typedef struct Tile {
     bool wet;
 }Tile_t;
 
+// Square blocks of tiles whose changes are tracked together
+#define TILE_CHUNK_SIZE 8
+
 typedef struct TileGrid
 {
     unsigned int width;
@@ -44,6 +47,11 @@ typedef struct TileGrid
     unsigned int tile_size;
     Tile_t* tiles;
     RenderInfoNode* render_nodes;
+    // Per chunk, all bits are set when the water or type of a tile in or next to it changes
+    // Each cache of the chunks clears its own bit. Holds up to max_tiles chunks
+    uint8_t* dirty_chunks;
+    unsigned int chunk_width;
+    unsigned int chunk_height;
 }TileGrid_t;
 
 typedef struct TileArea {
@@ -61,6 +69,14 @@ typedef struct CollideEntity {
 } CollideEntity_t;
 
 
+// Call when the grid dimensions change. All chunks are marked dirty
+void reset_tilemap_chunks(TileGrid_t* tilemap);
+void mark_tile_dirty(TileGrid_t* tilemap, unsigned int tile_idx);
+// Tiles covered by a chunk, clipped to the grid
+TileArea_t get_chunk_tile_area(const TileGrid_t* tilemap, unsigned int chunk_idx);
+// Chunks overlapping a tile area, in chunk coordinates
+TileArea_t get_chunks_in_area(const TileGrid_t* tilemap, TileArea_t area);
+
 void remove_entity_from_tilemap(EntityManager_t *p_manager, TileGrid_t* tilemap, Entity_t* p_ent);
 uint8_t check_collision(const CollideEntity_t* ent, TileGrid_t* grid, bool check_oneway);
 uint8_t check_collision_line(const CollideEntity_t* ent, TileGrid_t* grid, bool check_oneway);
@@ -11,6 +11,9 @@ void init_engine(GameEngine_t* engine, Vector2 starting_win_size)
     sc_heap_init(&engine->scenes_render_order, 0);
     engine->sfx_list.n_sfx = N_SFX;
     memset(engine->sfx_list.sfx, 0, engine->sfx_list.n_sfx * sizeof(SFX_t));
+    engine->sfx_list.n_queued = 0;
+    engine->sfx_list.n_voices = 0;
+    engine->sfx_list.played_sfx = 0;
     init_memory_pools();
     init_assets(&engine->assets);
     engine->intended_window_size = starting_win_size;
@@ -102,26 +105,56 @@ bool load_sfx(GameEngine_t* engine, const char* snd_name, uint32_t tag_idx)
     if (tag_idx >= engine->sfx_list.n_sfx) return false;
     Sound* snd = get_sound(&engine->assets, snd_name);
     if (snd == NULL) return false;
-    engine->sfx_list.sfx[tag_idx].snd = snd;
-    engine->sfx_list.sfx[tag_idx].cooldown = 0;
-    engine->sfx_list.sfx[tag_idx].plays = 0;
+    SFX_t* sfx = engine->sfx_list.sfx + tag_idx;
+    sfx->is_alias = false;
+    stop_sfx(engine, tag_idx);
+    sfx->snd = snd;
+    sfx->cooldown = 0;
+    sfx->plays = 0;
+
+    // A sound has one voice, so tags with the same sound share one sfx.
+    // Otherwise, each would take a voice for it
+    for (uint32_t i = 0; i < engine->sfx_list.n_sfx; ++i)
+    {
+        const SFX_t* other = engine->sfx_list.sfx + i;
+        if (i == tag_idx || other->is_alias || other->snd != snd) continue;
+
+        sfx->alias_idx = i;
+        sfx->is_alias = true;
+        break;
+    }
     return true;
 }
 
+// The aliased sfx may have been loaded with another sound since
+static inline unsigned int get_sfx_idx(GameEngine_t* engine, unsigned int tag_idx)
+{
+    const SFX_t* sfx = engine->sfx_list.sfx + tag_idx;
+    if (!sfx->is_alias || engine->sfx_list.sfx[sfx->alias_idx].snd != sfx->snd) return tag_idx;
+    return sfx->alias_idx;
+}
+
+void set_sfx_params(GameEngine_t* engine, unsigned int tag_idx, uint8_t priority, uint8_t cooldown_frames)
+{
+    if (tag_idx >= engine->sfx_list.n_sfx) return;
+    tag_idx = get_sfx_idx(engine, tag_idx);
+    engine->sfx_list.sfx[tag_idx].priority = priority;
+    engine->sfx_list.sfx[tag_idx].cooldown_frames = cooldown_frames;
+}
+
 void play_sfx_pitched(GameEngine_t* engine, unsigned int tag_idx, float pitch)
 {
     if (tag_idx >= engine->sfx_list.n_sfx) return;
+    tag_idx = get_sfx_idx(engine, tag_idx);
     SFX_t* sfx = engine->sfx_list.sfx + tag_idx;
-    if (sfx->snd != NULL)
-    {
-        SetSoundPitch(*sfx->snd, pitch);
-        //if (sfx->snd != NULL)
-        {
-            PlaySound(*sfx->snd);
-            //sfx->plays++;
-        }
-        //SetSoundPitch(*sfx->snd, 0.0f);
-    }
+    if (sfx->snd == NULL || sfx->cooldown > 0) return;
+
+    // The last request in the frame sets the pitch
+    sfx->pitch = pitch;
+    if (sfx->queued || engine->sfx_list.n_queued >= N_SFX) return;
+
+    sfx->queued = true;
+    engine->sfx_list.sfx_queue[engine->sfx_list.n_queued++] = tag_idx;
 }
 
 void play_sfx(GameEngine_t* engine, unsigned int tag_idx)
@@ -132,24 +165,92 @@ void play_sfx(GameEngine_t* engine, unsigned int tag_idx)
 void stop_sfx(GameEngine_t* engine, unsigned int tag_idx)
 {
     if (tag_idx >= engine->sfx_list.n_sfx) return;
+    tag_idx = get_sfx_idx(engine, tag_idx);
     SFX_t* sfx = engine->sfx_list.sfx + tag_idx;
-    if (sfx->snd != NULL && IsSoundPlaying(*sfx->snd))
+    if (sfx->queued)
+    {
+        // Taken out of the queue, so that a play after this queues it once again
+        SFXList_t* sfx_list = &engine->sfx_list;
+        uint32_t j = 0;
+        for (uint32_t i = 0; i < sfx_list->n_queued; ++i)
+        {
+            if (sfx_list->sfx_queue[i] != tag_idx) sfx_list->sfx_queue[j++] = sfx_list->sfx_queue[i];
+        }
+        sfx_list->n_queued = j;
+        sfx->queued = false;
+    }
+    if (sfx->plays > 0)
     {
         StopSound(*sfx->snd);
-        //sfx->plays--;
+        sfx->plays = 0;
+        engine->sfx_list.n_voices--;
     }
 }
 
+static bool steal_sfx_voice(GameEngine_t* engine, uint8_t priority)
+{
+    SFX_t* victim = NULL;
+    for (uint32_t i = 0; i < engine->sfx_list.n_sfx; ++i)
+    {
+        SFX_t* sfx = engine->sfx_list.sfx + i;
+        if (sfx->plays == 0 || sfx->priority >= priority) continue;
+        if (victim == NULL || sfx->priority < victim->priority) victim = sfx;
+    }
+    if (victim == NULL) return false;
+
+    StopSound(*victim->snd);
+    victim->plays = 0;
+    engine->sfx_list.n_voices--;
+    return true;
+}
+
 void update_sfx_list(GameEngine_t* engine)
 {
-    for (uint32_t i = 0; i< engine->sfx_list.n_sfx; ++i)
+    SFXList_t* sfx_list = &engine->sfx_list;
+    for (uint32_t i = 0; i < sfx_list->n_sfx; ++i)
     {
-        if (!IsSoundPlaying(*engine->sfx_list.sfx->snd))
+        SFX_t* sfx = sfx_list->sfx + i;
+        if (sfx->cooldown > 0) sfx->cooldown--;
+        if (sfx->plays > 0 && !IsSoundPlaying(*sfx->snd))
         {
-            engine->sfx_list.sfx[i].plays = 0;
+            sfx->plays = 0;
+            sfx_list->n_voices--;
         }
     }
-    engine->sfx_list.played_sfx = 0;
+
+    // Highest priority first, so they get the voices
+    for (uint32_t i = 1; i < sfx_list->n_queued; ++i)
+    {
+        uint32_t tag_idx = sfx_list->sfx_queue[i];
+        uint32_t j = i;
+        for (; j > 0 && sfx_list->sfx[sfx_list->sfx_queue[j - 1]].priority < sfx_list->sfx[tag_idx].priority; --j)
+        {
+            sfx_list->sfx_queue[j] = sfx_list->sfx_queue[j - 1];
+        }
+        sfx_list->sfx_queue[j] = tag_idx;
+    }
+
+    sfx_list->played_sfx = 0;
+    for (uint32_t i = 0; i < sfx_list->n_queued; ++i)
+    {
+        SFX_t* sfx = sfx_list->sfx + sfx_list->sfx_queue[i];
+        if (!sfx->queued) continue;
+        sfx->queued = false;
+
+        // Playing it again restarts the voice it already has
+        if (sfx->plays == 0)
+        {
+            if (sfx_list->n_voices >= MAX_SFX_VOICES && !steal_sfx_voice(engine, sfx->priority)) continue;
+            sfx->plays = 1;
+            sfx_list->n_voices++;
+        }
+
+        SetSoundPitch(*sfx->snd, sfx->pitch);
+        PlaySound(*sfx->snd);
+        sfx->cooldown = sfx->cooldown_frames;
+        sfx_list->played_sfx++;
+    }
+    sfx_list->n_queued = 0;
 }
 
 void init_scene(Scene_t* scene, action_func_t action_func, uint32_t subsystem_init)
@@ -205,6 +306,11 @@ void free_scene(Scene_t* scene)
     }
 }
 
+void entity_sync_system(Scene_t* scene)
+{
+    update_entity_manager(&scene->ent_manager);
+}
+
 inline void update_scene(Scene_t* scene, float delta_time)
 {
     if ((scene->state & SCENE_ACTIVE_BIT) == 0) return;
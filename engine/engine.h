@@ -7,15 +7,20 @@
 #include "assets.h"
 #include "particle_sys.h"
 #include "render_queue.h"
+#include "event_bus.h"
 
 typedef struct Scene Scene_t;
 
+// Plays are queued during the frame and started together in update_sfx_list,
+// at most once per sfx and within the voice budget
 typedef struct SFXList
 {
     SFX_t sfx[N_SFX];
     uint32_t sfx_queue[N_SFX];
+    uint32_t n_queued;
     uint32_t n_sfx;
-    uint32_t played_sfx;
+    uint32_t n_voices;
+    uint32_t played_sfx; // Started in the last update
 } SFXList_t;
 
 typedef struct SceneNode {
@@ -92,11 +97,19 @@ void render_curr_scene(GameEngine_t* engine);
 Scene_t* change_scene(GameEngine_t* engine, unsigned int idx);
 Scene_t* change_active_scene(GameEngine_t* engine, unsigned int idx);
 void change_focused_scene(GameEngine_t* engine, unsigned int idx);
+// Tags loaded with the same sound share one sfx, with its voice, priority and cooldown
 bool load_sfx(GameEngine_t* engine, const char* snd_name, uint32_t tag_idx);
+void set_sfx_params(GameEngine_t* engine, unsigned int tag_idx, uint8_t priority, uint8_t cooldown_frames);
 void play_sfx(GameEngine_t* engine, unsigned int tag_idx);
 void play_sfx_pitched(GameEngine_t* engine, unsigned int tag_idx, float pitch);
+void stop_sfx(GameEngine_t* engine, unsigned int tag_idx);
+// Call once per frame
 void update_sfx_list(GameEngine_t* engine);
 
+// Sync point of the entity manager. Entities and components added or removed by
+// the systems before it show up in the maps for the systems after it
+void entity_sync_system(Scene_t* scene);
+
 // Inline functions, for convenience
 extern void update_scene(Scene_t* scene, float delta_time);
 extern void render_scene(Scene_t* scene);
@@ -6,19 +6,36 @@
 #define MAX_SCENES_TO_RENDER 8
 #define MAX_RENDER_LAYERS 4
 #define MAX_RENDERMANAGER_DEPTH 4
+// Initial render queue capacity, it grows up to what the key sequence can index
+#define MAX_RENDER_COMMANDS 2048
 #define MAX_ENTITIES 2047
-#define MAX_TEXTURES 16
+// Atlas regions take up a slot as well
+#define MAX_TEXTURES 32
 #define MAX_SPRITES 127
+// Frames past this are worked out on every draw
+#define MAX_SPRITE_FRAMES 32
 #define MAX_SOUNDS 32
 #define MAX_FONTS 4
 #define MAX_N_TILES 16384
 #define MAX_NAME_LEN 32
 #define MAX_LEVEL_PACK 4
+// Unused textures and level packs are unloaded past this
+#define MAX_RESIDENT_ASSET_SIZE (32 * 1024 * 1024)
+// Bigger level packs are decompressed level by level
+#define MAX_LEVEL_PACK_ARENA_SIZE (8 * 1024 * 1024)
+// Decompressed levels kept per indexed level pack
+#define LEVEL_PACK_CACHE_SIZE 4
 #define N_SFX 32
+// Sounds playing at once, across all sfx
+#define MAX_SFX_VOICES 8
 #define MAX_EMITTER_CONF 8
 //#define MAX_PARTICLE_EMITTER 8
 #define MAX_ACTIVE_PARTICLE_EMITTER 255
 #define MAX_PARTICLES 32
+// Gameplay events queued in a frame, the rest are dropped
+#define MAX_GAME_EVENTS 128
+// Frames of game state kept for rewinding
+#define MAX_REWIND_FRAMES 1800
 
 #define MAX_TILE_TYPES 16
 #define N_TAGS 10
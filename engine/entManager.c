@@ -11,6 +11,8 @@ void init_entity_manager(EntityManager_t* p_manager)
     sc_queue_init(&p_manager->to_add);
     sc_queue_init(&p_manager->to_remove);
     sc_queue_init(&p_manager->to_update);
+    p_manager->evt_buf = NULL;
+    p_manager->evt_buf_size = 0;
 }
 
 void init_entity_tag_map(EntityManager_t* p_manager, unsigned int tag_number, unsigned int initial_size)
@@ -21,15 +23,116 @@ void init_entity_tag_map(EntityManager_t* p_manager, unsigned int tag_number, un
     p_manager->tag_map_inited[tag_number] = true;
 }
 
+#define ENT_MASK_WORDS ((MAX_COMP_POOL_SIZE + 31) / 32)
+
+static inline bool test_ent_bit(const uint32_t* mask, unsigned long e_idx)
+{
+    return (mask[e_idx >> 5] >> (e_idx & 31)) & 1;
+}
+
+static inline void set_ent_bit(uint32_t* mask, unsigned long e_idx)
+{
+    mask[e_idx >> 5] |= 1U << (e_idx & 31);
+}
+
+static void apply_component_update(EntityManager_t* p_manager, const struct EntityUpdateEventInfo* evt, const uint32_t* removing)
+{
+    if (test_ent_bit(removing, evt->e_id))
+    {
+        // The components still on the entity are freed along with it
+        if (evt->evt_type == COMP_DELETION)
+        {
+            sc_map_del_64v(&p_manager->component_map[evt->comp_type], evt->e_id);
+            free_component_to_mempool(evt->comp_type, evt->c_id);
+        }
+        return;
+    }
+
+    Entity_t* p_entity = sc_map_get_64v(&p_manager->entities, evt->e_id);
+    if(!sc_map_found(&p_manager->entities)) return;
+    switch(evt->evt_type)
+    {
+        case COMP_ADDTION:
+            // Removed again before this update, which is left to its deletion
+            if (p_entity->components[evt->comp_type] != evt->c_id) break;
+            sc_map_put_64v(&p_manager->component_map[evt->comp_type], evt->e_id, get_component_wtih_id(evt->comp_type, evt->c_id));
+        break;
+        case COMP_DELETION:
+            sc_map_del_64v(&p_manager->component_map[evt->comp_type], evt->e_id);
+            free_component_to_mempool(evt->comp_type, evt->c_id);
+        break;
+    }
+}
+
+static void apply_component_updates(EntityManager_t* p_manager, const uint32_t* removing)
+{
+    struct EntityUpdateEventInfo evt;
+    size_t n_evts = sc_queue_size(&p_manager->to_update);
+    if (n_evts > p_manager->evt_buf_size)
+    {
+        struct EntityUpdateEventInfo* buf = realloc(p_manager->evt_buf, n_evts * sizeof(evt));
+        if (buf == NULL)
+        {
+            // Ungrouped then
+            sc_queue_foreach (&p_manager->to_update, evt)
+            {
+                apply_component_update(p_manager, &evt, removing);
+            }
+            return;
+        }
+        p_manager->evt_buf = buf;
+        p_manager->evt_buf_size = n_evts;
+    }
+
+    // Counting sort by component type, keeping the queued order within a type.
+    // The changes to a component map are then done one after another
+    uint32_t offsets[N_COMPONENTS + 1] = {0};
+    sc_queue_foreach (&p_manager->to_update, evt)
+    {
+        offsets[evt.comp_type + 1]++;
+    }
+    for (size_t i = 0; i < N_COMPONENTS; ++i)
+    {
+        offsets[i + 1] += offsets[i];
+    }
+    sc_queue_foreach (&p_manager->to_update, evt)
+    {
+        p_manager->evt_buf[offsets[evt.comp_type]++] = evt;
+    }
+
+    for (size_t i = 0; i < n_evts; ++i)
+    {
+        apply_component_update(p_manager, p_manager->evt_buf + i, removing);
+    }
+}
+
 void update_entity_manager(EntityManager_t* p_manager)
 {
     // This will only update the entity map of the manager
     // It does not make new entities, but will free entity
     // New entities are assigned during add_entity
-	unsigned long e_idx;
-    
+    unsigned long e_idx;
+    uint32_t added[ENT_MASK_WORDS] = {0};
+    uint32_t removing[ENT_MASK_WORDS] = {0};
+
     sc_queue_foreach (&p_manager->to_add, e_idx)
     {
+        set_ent_bit(added, e_idx);
+    }
+    sc_queue_foreach (&p_manager->to_remove, e_idx)
+    {
+        // Ids that were already freed are skipped
+        if (test_ent_bit(added, e_idx) || get_entity(p_manager, e_idx) != NULL)
+        {
+            set_ent_bit(removing, e_idx);
+        }
+    }
+
+    // Entities added and removed before this update never go into the maps
+    sc_queue_foreach (&p_manager->to_add, e_idx)
+    {
+        if (test_ent_bit(removing, e_idx)) continue;
+
         Entity_t *p_entity = get_entity_wtih_id(e_idx);
         sc_map_put_64v(&p_manager->entities, e_idx, (void *)p_entity);
         if (p_manager->tag_map_inited[p_entity->m_tag])
@@ -39,10 +142,16 @@ void update_entity_manager(EntityManager_t* p_manager)
     }
     sc_queue_clear(&p_manager->to_add);
 
+    apply_component_updates(p_manager, removing);
+    sc_queue_clear(&p_manager->to_update);
+
     sc_queue_foreach (&p_manager->to_remove, e_idx)
     {
-        Entity_t *p_entity = (Entity_t *)sc_map_get_64v(&p_manager->entities, e_idx);
-        if (!p_entity) continue;
+        if (!test_ent_bit(removing, e_idx)) continue;
+        // In case it is queued more than once
+        removing[e_idx >> 5] &= ~(1U << (e_idx & 31));
+
+        Entity_t *p_entity = get_entity_wtih_id(e_idx);
         for (size_t i = 0; i < N_COMPONENTS; ++i)
         {
             if (p_entity->components[i] == MAX_COMP_POOL_SIZE) continue;
@@ -50,32 +159,17 @@ void update_entity_manager(EntityManager_t* p_manager)
             sc_map_del_64v(&p_manager->component_map[i], e_idx);
             p_entity->components[i] = MAX_COMP_POOL_SIZE;
         }
-        if (p_manager->tag_map_inited[p_entity->m_tag])
+        if (!test_ent_bit(added, e_idx))
         {
-            sc_map_del_64v(&p_manager->entities_map[p_entity->m_tag], e_idx);
+            if (p_manager->tag_map_inited[p_entity->m_tag])
+            {
+                sc_map_del_64v(&p_manager->entities_map[p_entity->m_tag], e_idx);
+            }
+            sc_map_del_64v(&p_manager->entities, e_idx);
         }
         free_entity_to_mempool(e_idx);
-        sc_map_del_64v(&p_manager->entities, e_idx);
     }
     sc_queue_clear(&p_manager->to_remove);
-
-    struct EntityUpdateEventInfo evt;
-    sc_queue_foreach (&p_manager->to_update, evt)
-    {
-        sc_map_get_64v(&p_manager->entities, evt.e_id);
-        if(!sc_map_found(&p_manager->entities)) continue;
-        switch(evt.evt_type)
-        {
-            case COMP_ADDTION:
-                sc_map_put_64v(&p_manager->component_map[evt.comp_type], evt.e_id, get_component_wtih_id(evt.comp_type, evt.c_id));
-            break;
-            case COMP_DELETION:
-                sc_map_del_64v(&p_manager->component_map[evt.comp_type], evt.e_id);
-                free_component_to_mempool(evt.comp_type, evt.c_id);
-            break;
-        }
-    }
-    sc_queue_clear(&p_manager->to_update);
 }
 
 void clear_entity_manager(EntityManager_t* p_manager)
@@ -107,6 +201,185 @@ void free_entity_manager(EntityManager_t* p_manager)
     sc_queue_term(&p_manager->to_add);
     sc_queue_term(&p_manager->to_remove);
     sc_queue_term(&p_manager->to_update);
+    free(p_manager->evt_buf);
+    p_manager->evt_buf = NULL;
+    p_manager->evt_buf_size = 0;
+}
+
+#if N_COMPONENTS > 32
+#error "Serialised entities keep the components in a 32 bit mask"
+#endif
+
+// Each entity is stored as its tag, flags, position and component mask,
+// followed by the data of its components in component order
+#define ENTITY_RECORD_SIZE (sizeof(uint16_t) + sizeof(uint8_t) + sizeof(Vector2) + sizeof(uint32_t))
+
+static uint32_t get_entity_record_size(const Entity_t* p_ent)
+{
+    uint32_t size = ENTITY_RECORD_SIZE;
+    for (size_t i = 0; i < N_COMPONENTS; ++i)
+    {
+        if (p_ent->components[i] == MAX_COMP_POOL_SIZE) continue;
+        size += comp_mempools[i].elem_size;
+    }
+    return size;
+}
+
+static uint8_t* write_entity_record(uint8_t* ptr, const Entity_t* p_ent)
+{
+    uint16_t tag = p_ent->m_tag;
+    uint8_t flags = (p_ent->m_alive ? 1 : 0) | (p_ent->m_active ? 2 : 0);
+    uint32_t mask = 0;
+    for (size_t i = 0; i < N_COMPONENTS; ++i)
+    {
+        if (p_ent->components[i] != MAX_COMP_POOL_SIZE) mask |= (1U << i);
+    }
+
+    memcpy(ptr, &tag, sizeof(tag));
+    ptr += sizeof(tag);
+    *ptr++ = flags;
+    memcpy(ptr, &p_ent->position, sizeof(Vector2));
+    ptr += sizeof(Vector2);
+    memcpy(ptr, &mask, sizeof(mask));
+    ptr += sizeof(mask);
+
+    for (size_t i = 0; i < N_COMPONENTS; ++i)
+    {
+        if ((mask & (1U << i)) == 0) continue;
+        memcpy(ptr, get_component_wtih_id(i, p_ent->components[i]), comp_mempools[i].elem_size);
+        ptr += comp_mempools[i].elem_size;
+    }
+    return ptr;
+}
+
+static const uint8_t* read_entity_record(EntityManager_t* p_manager, const uint8_t* ptr, const uint8_t* end)
+{
+    if (ptr + ENTITY_RECORD_SIZE > end) return NULL;
+
+    uint16_t tag;
+    uint32_t mask;
+    memcpy(&tag, ptr, sizeof(tag));
+    ptr += sizeof(tag);
+    uint8_t flags = *ptr++;
+    Vector2 position;
+    memcpy(&position, ptr, sizeof(Vector2));
+    ptr += sizeof(Vector2);
+    memcpy(&mask, ptr, sizeof(mask));
+    ptr += sizeof(mask);
+    if (tag >= N_TAGS) return NULL;
+
+    unsigned long e_idx = 0;
+    Entity_t* p_ent = new_entity_from_mempool(&e_idx);
+    if (p_ent == NULL) return NULL;
+
+    // Goes straight into the maps, skipping the update queues
+    p_ent->position = position;
+    p_ent->m_tag = tag;
+    p_ent->m_alive = (flags & 1) != 0;
+    p_ent->m_active = (flags & 2) != 0;
+    p_ent->manager = p_manager;
+    sc_map_put_64v(&p_manager->entities, e_idx, (void *)p_ent);
+    if (p_manager->tag_map_inited[p_ent->m_tag])
+    {
+        sc_map_put_64v(&p_manager->entities_map[p_ent->m_tag], e_idx, (void *)p_ent);
+    }
+
+    for (size_t i = 0; i < N_COMPONENTS; ++i)
+    {
+        if ((mask & (1U << i)) == 0) continue;
+        if (ptr + comp_mempools[i].elem_size > end) return NULL;
+
+        // An entity missing a component would not behave as saved,
+        // so a full pool fails the restore
+        unsigned long c_idx = 0;
+        void* p_comp = new_component_from_mempool(i, &c_idx);
+        if (p_comp == NULL) return NULL;
+
+        memcpy(p_comp, ptr, comp_mempools[i].elem_size);
+        p_ent->components[i] = c_idx;
+        sc_map_put_64v(&p_manager->component_map[i], e_idx, p_comp);
+        ptr += comp_mempools[i].elem_size;
+    }
+    return ptr;
+}
+
+uint32_t get_serialised_entities_size(EntityManager_t* p_manager)
+{
+    // Newly added entities need to be in the map
+    update_entity_manager(p_manager);
+
+    uint32_t size = sizeof(uint32_t);
+    Entity_t* p_ent;
+    sc_map_foreach_value(&p_manager->entities, p_ent)
+    {
+        size += get_entity_record_size(p_ent);
+    }
+    return size;
+}
+
+uint32_t serialise_entities(EntityManager_t* p_manager, uint8_t* buf, uint32_t capacity)
+{
+    update_entity_manager(p_manager);
+
+    uint32_t n_entities = sc_map_size_64v(&p_manager->entities);
+    if (capacity < sizeof(uint32_t)) return 0;
+    memcpy(buf, &n_entities, sizeof(uint32_t));
+
+    // In id order, so that the states of the same entities line up
+    uint8_t* ptr = buf + sizeof(uint32_t);
+    uint8_t* end = buf + capacity;
+    uint32_t n_written = 0;
+    for (unsigned long e_idx = 0; e_idx < MAX_COMP_POOL_SIZE && n_written < n_entities; ++e_idx)
+    {
+        Entity_t* p_ent = get_entity(p_manager, e_idx);
+        if (p_ent == NULL) continue;
+
+        if (ptr + get_entity_record_size(p_ent) > end) return 0;
+        ptr = write_entity_record(ptr, p_ent);
+        n_written++;
+    }
+    return ptr - buf;
+}
+
+bool deserialise_entities(EntityManager_t* p_manager, const uint8_t* buf, uint32_t size)
+{
+    if (size < sizeof(uint32_t)) return false;
+
+    uint32_t n_entities;
+    memcpy(&n_entities, buf, sizeof(uint32_t));
+    const uint8_t* ptr = buf + sizeof(uint32_t);
+    const uint8_t* end = buf + size;
+    for (uint32_t n = 0; n < n_entities; ++n)
+    {
+        ptr = read_entity_record(p_manager, ptr, end);
+        if (ptr == NULL) return false;
+    }
+    return true;
+}
+
+bool snapshot_entities(EntityManager_t* p_manager, EntitySnapshot_t* snapshot)
+{
+    uint32_t size = get_serialised_entities_size(p_manager);
+    if (size > snapshot->capacity)
+    {
+        uint8_t* data = realloc(snapshot->data, size);
+        if (data == NULL) return false;
+        snapshot->data = data;
+        snapshot->capacity = size;
+    }
+    snapshot->size = serialise_entities(p_manager, snapshot->data, snapshot->capacity);
+    return snapshot->size > 0;
+}
+
+bool restore_entities(EntityManager_t* p_manager, const EntitySnapshot_t* snapshot)
+{
+    return deserialise_entities(p_manager, snapshot->data, snapshot->size);
+}
+
+void free_entity_snapshot(EntitySnapshot_t* snapshot)
+{
+    free(snapshot->data);
+    memset(snapshot, 0, sizeof(EntitySnapshot_t));
 }
 
 Entity_t *add_entity(EntityManager_t* p_manager, unsigned int tag)
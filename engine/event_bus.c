@@ -0,0 +1,23 @@
+#include "event_bus.h"
+
+void init_event_bus(EventBus_t* bus)
+{
+    bus->n_events = 0;
+    bus->dropped = 0;
+}
+
+bool push_event(EventBus_t* bus, uint8_t type, uint8_t tag, uint16_t data, Vector2 pos)
+{
+    if (bus->n_events >= MAX_GAME_EVENTS)
+    {
+        bus->dropped++;
+        return false;
+    }
+
+    GameEvent_t* event = bus->events + bus->n_events++;
+    event->pos = pos;
+    event->data = data;
+    event->type = type;
+    event->tag = tag;
+    return true;
+}
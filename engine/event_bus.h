@@ -0,0 +1,28 @@
+#ifndef __EVENT_BUS_H
+#define __EVENT_BUS_H
+#include "raylib.h"
+#include "engine_conf.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// The meaning of the fields is up to the game, the engine only queues them
+typedef struct GameEvent {
+    Vector2 pos;
+    uint16_t data;
+    uint8_t type;
+    uint8_t tag;
+} GameEvent_t;
+
+// Events pushed by the systems during a frame, to be handled together
+// at one point of the frame instead of in the middle of the physics loops
+typedef struct EventBus {
+    GameEvent_t events[MAX_GAME_EVENTS];
+    uint32_t n_events;
+    uint32_t dropped; // Pushed while full, since the last clear
+} EventBus_t;
+
+void init_event_bus(EventBus_t* bus);
+#define clear_event_bus init_event_bus
+
+bool push_event(EventBus_t* bus, uint8_t type, uint8_t tag, uint16_t data, Vector2 pos);
+#endif // __EVENT_BUS_H
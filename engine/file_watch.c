@@ -0,0 +1,103 @@
+#include "file_watch.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__) && !defined(PLATFORM_WEB)
+#include <sys/inotify.h>
+#include <unistd.h>
+
+bool init_file_watch(FileWatch_t* watch)
+{
+    memset(watch, 0, sizeof(FileWatch_t));
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    return watch->fd >= 0;
+}
+
+void free_file_watch(FileWatch_t* watch)
+{
+    if (watch->fd < 0) return;
+
+    // Closing removes the watches as well
+    close(watch->fd);
+    watch->fd = -1;
+    watch->n_dirs = 0;
+}
+
+bool add_file_watch_dir(FileWatch_t* watch, const char* dir)
+{
+    if (watch->fd < 0) return false;
+
+    for (uint8_t i = 0; i < watch->n_dirs; ++i)
+    {
+        if (strcmp(watch->dirs[i], dir) == 0) return true;
+    }
+    if (watch->n_dirs == MAX_WATCHED_DIRS) return false;
+
+    // Editors and scripts may save by renaming a temporary file over it
+    int wd = inotify_add_watch(watch->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0)
+    {
+        printf("Unable to watch %s\n", dir);
+        return false;
+    }
+    watch->wds[watch->n_dirs] = wd;
+    strncpy(watch->dirs[watch->n_dirs], dir, sizeof(watch->dirs[0]) - 1);
+    watch->n_dirs++;
+    return true;
+}
+
+bool poll_file_watch(FileWatch_t* watch, char* path, size_t path_len)
+{
+    if (watch->fd < 0) return false;
+
+    while (true)
+    {
+        if (watch->pos >= watch->len)
+        {
+            ssize_t ret = read(watch->fd, watch->buffer, sizeof(watch->buffer));
+            if (ret <= 0) return false;
+            watch->len = ret;
+            watch->pos = 0;
+        }
+
+        const struct inotify_event* event = (const struct inotify_event*)(watch->buffer + watch->pos);
+        watch->pos += sizeof(struct inotify_event) + event->len;
+        if (event->len == 0) continue;
+
+        for (uint8_t i = 0; i < watch->n_dirs; ++i)
+        {
+            if (watch->wds[i] != event->wd) continue;
+
+            snprintf(path, path_len, "%s/%s", watch->dirs[i], event->name);
+            return true;
+        }
+    }
+}
+#else
+bool init_file_watch(FileWatch_t* watch)
+{
+    memset(watch, 0, sizeof(FileWatch_t));
+    watch->fd = -1;
+    return false;
+}
+
+void free_file_watch(FileWatch_t* watch)
+{
+    watch->fd = -1;
+}
+
+bool add_file_watch_dir(FileWatch_t* watch, const char* dir)
+{
+    (void)watch;
+    (void)dir;
+    return false;
+}
+
+bool poll_file_watch(FileWatch_t* watch, char* path, size_t path_len)
+{
+    (void)watch;
+    (void)path;
+    (void)path_len;
+    return false;
+}
+#endif
@@ -0,0 +1,32 @@
+#ifndef __FILE_WATCH_H
+#define __FILE_WATCH_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MAX_WATCHED_DIRS 8
+#define FILE_WATCH_BUFFER_SIZE 4096
+
+// Reports files written in the watched directories. Only implemented
+// with inotify, elsewhere nothing is ever reported
+typedef struct FileWatch
+{
+    // Events read but not given out yet. Kept first, so that it is aligned
+    // like the struct, which the size_t fields make enough for the events
+    uint8_t buffer[FILE_WATCH_BUFFER_SIZE];
+    int fd; // -1 if not watching
+    int wds[MAX_WATCHED_DIRS];
+    char dirs[MAX_WATCHED_DIRS][256];
+    uint8_t n_dirs;
+    size_t len;
+    size_t pos;
+}FileWatch_t;
+
+bool init_file_watch(FileWatch_t* watch);
+void free_file_watch(FileWatch_t* watch);
+// Not recursive. Adding the same directory again is a no-op
+bool add_file_watch_dir(FileWatch_t* watch, const char* dir);
+// Gives the next changed file as "dir/name", without blocking.
+// A file may be given more than once for one save
+bool poll_file_watch(FileWatch_t* watch, char* path, size_t path_len);
+#endif // __FILE_WATCH_H
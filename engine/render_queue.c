@@ -1,42 +1,140 @@
 #include "render_queue.h"
 #include "raylib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-void init_render_manager(RenderManager *manager)
+#define RENDER_MAX_NODES (RENDER_KEY_SEQ_MASK + 1)
+
+static bool grow_render_manager(RenderManager* manager, uint32_t capacity)
+{
+    RenderInfoNode** nodes = realloc(manager->nodes, capacity * sizeof(RenderInfoNode*));
+    if (nodes == NULL) return false;
+    manager->nodes = nodes;
+
+    uint64_t* keys = realloc(manager->keys, capacity * sizeof(uint64_t));
+    if (keys == NULL) return false;
+    manager->keys = keys;
+
+    uint64_t* sort_buffer = realloc(manager->sort_buffer, capacity * sizeof(uint64_t));
+    if (sort_buffer == NULL) return false;
+    manager->sort_buffer = sort_buffer;
+
+    manager->capacity = capacity;
+    return true;
+}
+
+void init_render_manager(RenderManager* manager)
 {
     memset(manager, 0, sizeof(*manager));
+    grow_render_manager(manager, MAX_RENDER_COMMANDS);
 }
 
-bool add_render_node(RenderManager *manager, RenderInfoNode *node, uint8_t layer_num)
+void reset_render_manager(RenderManager* manager)
+{
+    manager->n_nodes = 0;
+}
+
+void free_render_manager(RenderManager* manager)
+{
+    free(manager->nodes);
+    free(manager->keys);
+    free(manager->sort_buffer);
+    memset(manager, 0, sizeof(*manager));
+}
+
+bool add_render_node(RenderManager* manager, RenderInfoNode* node, uint8_t layer_num)
 {
-    if (node->next != NULL)
-    {
-        return false;
-    }
     if (node->spr == NULL) {
         return false;
     }
+    if (manager->n_nodes >= manager->capacity)
+    {
+        uint32_t capacity = (manager->capacity > 0) ? manager->capacity * 2 : MAX_RENDER_COMMANDS;
+        if (capacity > RENDER_MAX_NODES) capacity = RENDER_MAX_NODES;
+        if (manager->n_nodes >= capacity || !grow_render_manager(manager, capacity))
+        {
+            if (!manager->overflowed)
+            {
+                printf("Render queue is full at %u nodes, further draws are dropped\n", manager->n_nodes);
+                manager->overflowed = true;
+            }
+            return false;
+        }
+    }
     layer_num = (layer_num >= MAX_RENDERMANAGER_DEPTH) ? MAX_RENDERMANAGER_DEPTH - 1 : layer_num;
 
-    node->next = manager->layers[layer_num];
-    manager->layers[layer_num] = node;
+    uint32_t tex_id = (node->spr->texture != NULL) ? node->spr->texture->id : 0;
+    manager->nodes[manager->n_nodes] = node;
+    manager->keys[manager->n_nodes] = ((uint64_t)layer_num << RENDER_KEY_LAYER_SHIFT)
+        | ((uint64_t)tex_id << RENDER_KEY_TEXTURE_SHIFT)
+        | manager->n_nodes;
+    manager->n_nodes++;
     return true;
 }
 
-void execute_render(RenderManager *manager) {
-    for (uint8_t depth = 0; depth < MAX_RENDERMANAGER_DEPTH; ++depth)
+// LSD radix sort on the key bytes. Bytes that are the same
+// for all keys are skipped, which is most of them in practice
+static uint64_t* radix_sort_keys(uint64_t* keys, uint64_t* buffer, uint32_t n)
+{
+    uint32_t counts[8][256] = {0};
+    for (uint32_t i = 0; i < n; ++i)
     {
-        RenderInfoNode* curr = manager->layers[depth];
-        while (curr != NULL)
+        for (uint8_t b = 0; b < 8; ++b)
         {
-            draw_sprite_pro(
-                curr->spr, curr->frame_num, curr->pos,
-                curr->rotation, curr->flip, curr->scale,
-                curr->colour
-            );
-            RenderInfoNode* next = curr->next;
-            curr->next = NULL;
-            curr = next;
+            counts[b][(keys[i] >> (b * 8)) & 0xFF]++;
         }
     }
+
+    uint64_t* src = keys;
+    uint64_t* dst = buffer;
+    for (uint8_t b = 0; b < 8; ++b)
+    {
+        if (counts[b][(src[0] >> (b * 8)) & 0xFF] == n) continue;
+
+        uint32_t offsets[256];
+        uint32_t total = 0;
+        for (uint16_t i = 0; i < 256; ++i)
+        {
+            offsets[i] = total;
+            total += counts[b][i];
+        }
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            dst[offsets[(src[i] >> (b * 8)) & 0xFF]++] = src[i];
+        }
+
+        uint64_t* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    return src;
+}
+
+void sort_render_queue(RenderManager* manager)
+{
+    if (manager->n_nodes == 0) return;
+
+    uint64_t* sorted = radix_sort_keys(manager->keys, manager->sort_buffer, manager->n_nodes);
+    if (sorted != manager->keys)
+    {
+        manager->sort_buffer = manager->keys;
+        manager->keys = sorted;
+    }
+}
+
+void execute_render(RenderManager* manager)
+{
+    sort_render_queue(manager);
+    for (uint32_t i = 0; i < manager->n_nodes; ++i)
+    {
+        // Consecutive draws on the same texture go into the same batch
+        RenderInfoNode* curr = manager->nodes[manager->keys[i] & RENDER_KEY_SEQ_MASK];
+        draw_sprite_pro(
+            curr->spr, curr->frame_num, curr->pos,
+            curr->rotation, curr->flip, curr->scale,
+            curr->colour
+        );
+    }
     reset_render_manager(manager);
 }
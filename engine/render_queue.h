@@ -5,9 +5,6 @@
 
 typedef struct RenderInfoNode RenderInfoNode;
 struct RenderInfoNode {
-    // Intrusive Linked-list Node
-    RenderInfoNode* next;
-
     Sprite_t* spr;
     Vector2 pos;
     int frame_num;
@@ -17,13 +14,30 @@ struct RenderInfoNode {
     uint8_t flip;
 };
 
+// Sort key of a queued node, from the most significant bits:
+//  - Render layer, drawn from the lowest
+//  - Texture id, so that draws on the same texture are contiguous and batched together
+//  - Sequence, which keeps the queueing order within a texture. It is also the node index
+#define RENDER_KEY_LAYER_SHIFT 48
+#define RENDER_KEY_TEXTURE_SHIFT 16
+#define RENDER_KEY_SEQ_MASK 0xFFFF
+
+// Starts with room for MAX_RENDER_COMMANDS nodes, and grows up to what the sequence can index
 typedef struct RenderManager {
-    RenderInfoNode* layers[MAX_RENDERMANAGER_DEPTH];
+    RenderInfoNode** nodes;
+    uint64_t* keys;
+    uint64_t* sort_buffer;
+    uint32_t n_nodes;
+    uint32_t capacity;
+    bool overflowed;
 } RenderManager;
 
 void init_render_manager(RenderManager* manager);
-#define reset_render_manager init_render_manager
+void reset_render_manager(RenderManager* manager);
+void free_render_manager(RenderManager* manager);
 
 bool add_render_node(RenderManager* manager, RenderInfoNode* node, uint8_t layer_num);
+// Orders the keys in draw order. execute_render does this before drawing
+void sort_render_queue(RenderManager* manager);
 void execute_render(RenderManager* manager);
 #endif
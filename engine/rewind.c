@@ -0,0 +1,281 @@
+#include "rewind.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Unchanged bytes needed to end a run of changed bytes
+#define MIN_SKIP_RUN 4
+
+static inline uint8_t xor_byte(const uint8_t* data, const uint8_t* ref, uint32_t i)
+{
+    return (ref != NULL) ? data[i] ^ ref[i] : data[i];
+}
+
+static uint8_t* write_varint(uint8_t* ptr, uint32_t val)
+{
+    while (val >= 0x80)
+    {
+        *ptr++ = (val & 0x7F) | 0x80;
+        val >>= 7;
+    }
+    *ptr++ = val;
+    return ptr;
+}
+
+static const uint8_t* read_varint(const uint8_t* ptr, const uint8_t* end, uint32_t* val)
+{
+    uint32_t res = 0;
+    for (uint8_t shift = 0; ptr < end && shift < 32; shift += 7)
+    {
+        uint8_t byte = *ptr++;
+        res |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *val = res;
+            return ptr;
+        }
+    }
+    return NULL;
+}
+
+// Runs of: unchanged count, changed count, then the XOR of the changed bytes.
+// At worst, this takes about three times the frame size
+static uint32_t encode_frame(const uint8_t* data, const uint8_t* ref, uint32_t size, uint8_t* out)
+{
+    uint8_t* ptr = out;
+    uint32_t i = 0;
+    while (i < size)
+    {
+        uint32_t start = i;
+        while (i < size && xor_byte(data, ref, i) == 0) i++;
+        if (i == size) break;
+        uint32_t skip = i - start;
+
+        // Short runs of unchanged bytes are cheaper to keep in
+        start = i;
+        uint32_t zeros = 0;
+        while (i < size && zeros < MIN_SKIP_RUN)
+        {
+            zeros = (xor_byte(data, ref, i) == 0) ? zeros + 1 : 0;
+            i++;
+        }
+        uint32_t len = i - start - zeros;
+
+        ptr = write_varint(ptr, skip);
+        ptr = write_varint(ptr, len);
+        for (uint32_t j = start; j < start + len; ++j)
+        {
+            *ptr++ = xor_byte(data, ref, j);
+        }
+        i = start + len;
+    }
+    return ptr - out;
+}
+
+static bool apply_frame(uint8_t* out, uint32_t size, const RewindFrame_t* frame)
+{
+    const uint8_t* ptr = frame->data;
+    const uint8_t* end = frame->data + frame->size;
+    uint32_t pos = 0;
+    while (ptr < end)
+    {
+        uint32_t skip;
+        uint32_t len;
+        ptr = read_varint(ptr, end, &skip);
+        if (ptr == NULL) return false;
+        ptr = read_varint(ptr, end, &len);
+        if (ptr == NULL) return false;
+        if ((uint64_t)pos + skip + len > size || len > (uint32_t)(end - ptr)) return false;
+
+        pos += skip;
+        for (uint32_t j = 0; j < len; ++j)
+        {
+            out[pos + j] ^= ptr[j];
+        }
+        pos += len;
+        ptr += len;
+    }
+    return true;
+}
+
+static bool reserve_buffer(uint8_t** buf, uint32_t* capacity, uint32_t size)
+{
+    if (size <= *capacity) return true;
+
+    uint8_t* new_buf = realloc(*buf, size);
+    if (new_buf == NULL) return false;
+    *buf = new_buf;
+    *capacity = size;
+    return true;
+}
+
+static inline RewindFrame_t* get_frame(RewindBuffer_t* buffer, uint32_t n)
+{
+    return buffer->frames + (buffer->head + n) % MAX_REWIND_FRAMES;
+}
+
+static void free_frame(RewindBuffer_t* buffer, RewindFrame_t* frame)
+{
+    buffer->used -= frame->size;
+    if (frame->keyframe) buffer->n_keyframes--;
+    free(frame->data);
+    memset(frame, 0, sizeof(RewindFrame_t));
+}
+
+// The oldest frame is always a keyframe
+static void drop_oldest_keyframe(RewindBuffer_t* buffer)
+{
+    do
+    {
+        free_frame(buffer, get_frame(buffer, 0));
+        buffer->head = (buffer->head + 1) % MAX_REWIND_FRAMES;
+        buffer->count--;
+    } while (buffer->count > 0 && !get_frame(buffer, 0)->keyframe);
+}
+
+void init_rewind_buffer(RewindBuffer_t* buffer, size_t budget, uint32_t key_interval)
+{
+    memset(buffer, 0, sizeof(RewindBuffer_t));
+    buffer->budget = budget;
+    buffer->key_interval = key_interval;
+}
+
+void free_rewind_buffer(RewindBuffer_t* buffer)
+{
+    clear_rewind_buffer(buffer);
+    free(buffer->key);
+    free(buffer->scratch);
+    free(buffer->out);
+    buffer->key = NULL;
+    buffer->scratch = NULL;
+    buffer->out = NULL;
+    buffer->key_capacity = 0;
+    buffer->scratch_capacity = 0;
+    buffer->out_capacity = 0;
+}
+
+void clear_rewind_buffer(RewindBuffer_t* buffer)
+{
+    drop_rewind_frames(buffer, buffer->count);
+}
+
+bool push_rewind_frame(RewindBuffer_t* buffer, const uint8_t* data, uint32_t size)
+{
+    if (!reserve_buffer(&buffer->scratch, &buffer->scratch_capacity, size * 3 + 16)) return false;
+
+    bool keyframe = (
+        buffer->count == 0
+        || size != buffer->key_size
+        || buffer->since_key >= buffer->key_interval
+    );
+    uint32_t enc_size = encode_frame(data, keyframe ? NULL : buffer->key, size, buffer->scratch);
+
+    while (
+        buffer->count > 0
+        && (buffer->count == MAX_REWIND_FRAMES || buffer->used + enc_size > buffer->budget)
+    )
+    {
+        if (!keyframe && buffer->n_keyframes == 1)
+        {
+            // The frame would lose the keyframe it is diffed against
+            keyframe = true;
+            enc_size = encode_frame(data, NULL, size, buffer->scratch);
+            continue;
+        }
+        drop_oldest_keyframe(buffer);
+    }
+    if (enc_size > buffer->budget) return false;
+
+    uint8_t* frame_data = malloc(enc_size > 0 ? enc_size : 1);
+    if (frame_data == NULL) return false;
+    if (keyframe)
+    {
+        if (!reserve_buffer(&buffer->key, &buffer->key_capacity, size))
+        {
+            free(frame_data);
+            return false;
+        }
+        memcpy(buffer->key, data, size);
+        buffer->key_size = size;
+        buffer->since_key = 0;
+        buffer->n_keyframes++;
+    }
+    else
+    {
+        buffer->since_key++;
+    }
+    memcpy(frame_data, buffer->scratch, enc_size);
+
+    RewindFrame_t* frame = get_frame(buffer, buffer->count);
+    frame->data = frame_data;
+    frame->size = enc_size;
+    frame->raw_size = size;
+    frame->keyframe = keyframe;
+    buffer->count++;
+    buffer->used += enc_size;
+    return true;
+}
+
+const uint8_t* get_rewind_frame(RewindBuffer_t* buffer, uint32_t frames_back, uint32_t* size)
+{
+    if (frames_back >= buffer->count) return NULL;
+
+    uint32_t n = buffer->count - 1 - frames_back;
+    RewindFrame_t* frame = get_frame(buffer, n);
+    if (!reserve_buffer(&buffer->out, &buffer->out_capacity, frame->raw_size)) return NULL;
+
+    uint32_t key_n = n;
+    while (!get_frame(buffer, key_n)->keyframe) key_n--;
+
+    // Frames after the newest keyframe are diffed against the copy in the buffer
+    if (buffer->count - 1 - key_n == buffer->since_key)
+    {
+        memcpy(buffer->out, buffer->key, frame->raw_size);
+    }
+    else
+    {
+        memset(buffer->out, 0, frame->raw_size);
+        if (!apply_frame(buffer->out, frame->raw_size, get_frame(buffer, key_n))) return NULL;
+    }
+    if (key_n != n && !apply_frame(buffer->out, frame->raw_size, frame)) return NULL;
+
+    *size = frame->raw_size;
+    return buffer->out;
+}
+
+void drop_rewind_frames(RewindBuffer_t* buffer, uint32_t n)
+{
+    if (n > buffer->count) n = buffer->count;
+
+    bool key_dropped = false;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        RewindFrame_t* frame = get_frame(buffer, buffer->count - 1);
+        key_dropped |= frame->keyframe;
+        free_frame(buffer, frame);
+        buffer->count--;
+    }
+    if (buffer->count == 0)
+    {
+        buffer->head = 0;
+        buffer->since_key = 0;
+        buffer->key_size = 0;
+        return;
+    }
+
+    uint32_t key_n = buffer->count - 1;
+    while (!get_frame(buffer, key_n)->keyframe) key_n--;
+    buffer->since_key = buffer->count - 1 - key_n;
+    if (!key_dropped) return;
+
+    // The newest keyframe is now an older one, which needs decoding
+    RewindFrame_t* key_frame = get_frame(buffer, key_n);
+    if (!reserve_buffer(&buffer->key, &buffer->key_capacity, key_frame->raw_size))
+    {
+        // Without the keyframe, nothing newer can be diffed
+        clear_rewind_buffer(buffer);
+        return;
+    }
+    memset(buffer->key, 0, key_frame->raw_size);
+    apply_frame(buffer->key, key_frame->raw_size, key_frame);
+    buffer->key_size = key_frame->raw_size;
+}
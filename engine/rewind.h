@@ -0,0 +1,47 @@
+#ifndef __REWIND_H
+#define __REWIND_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "engine_conf.h"
+
+// A frame is stored as the XOR against the newest keyframe, with the runs
+// of unchanged bytes cut out. Keyframes are stored the same way against zeros
+typedef struct RewindFrame {
+    uint8_t* data;
+    uint32_t size;
+    uint32_t raw_size;
+    bool keyframe;
+} RewindFrame_t;
+
+// Ring of the most recent frames, bounded by a byte budget.
+// The oldest keyframe is dropped along with its deltas when it runs out
+typedef struct RewindBuffer {
+    RewindFrame_t frames[MAX_REWIND_FRAMES];
+    uint32_t head; // Oldest frame
+    uint32_t count;
+    uint32_t n_keyframes;
+    size_t used;
+    size_t budget;
+    uint32_t key_interval;
+    uint32_t since_key;
+    // Decoded newest keyframe, which new frames are diffed against
+    uint8_t* key;
+    uint32_t key_size;
+    uint32_t key_capacity;
+    uint8_t* scratch;
+    uint32_t scratch_capacity;
+    uint8_t* out;
+    uint32_t out_capacity;
+} RewindBuffer_t;
+
+void init_rewind_buffer(RewindBuffer_t* buffer, size_t budget, uint32_t key_interval);
+void free_rewind_buffer(RewindBuffer_t* buffer);
+void clear_rewind_buffer(RewindBuffer_t* buffer);
+bool push_rewind_frame(RewindBuffer_t* buffer, const uint8_t* data, uint32_t size);
+// Decode the frame that is frames_back before the newest one.
+// The data is valid until the next call on the buffer
+const uint8_t* get_rewind_frame(RewindBuffer_t* buffer, uint32_t frames_back, uint32_t* size);
+// Drop the newest n frames, which is how the buffer is rewound
+void drop_rewind_frames(RewindBuffer_t* buffer, uint32_t n);
+#endif // __REWIND_H
@@ -0,0 +1,233 @@
+#include "rres_archive.h"
+#include "zstd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+static const uint8_t* map_file(const char* fname, size_t* size)
+{
+    FILE* file = fopen(fname, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0L, SEEK_END);
+    long sz = ftell(file);
+    rewind(file);
+
+    uint8_t* data = (sz > 0) ? malloc(sz) : NULL;
+    if (data != NULL && fread(data, 1, sz, file) != (size_t)sz)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = sz;
+    return data;
+}
+
+static void unmap_file(const uint8_t* data, size_t size)
+{
+    (void)size;
+    free((void*)data);
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint8_t* map_file(const char* fname, size_t* size)
+{
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping stays valid after closing
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    *size = st.st_size;
+    return data;
+}
+
+static void unmap_file(const uint8_t* data, size_t size)
+{
+    munmap((void*)data, size);
+}
+#endif
+
+static bool read_chunk_info(const RresFileInfo_t* rres_file, size_t offset, rresResourceChunkInfo* info)
+{
+    if (offset + sizeof(rresResourceChunkInfo) > rres_file->size) return false;
+    memcpy(info, rres_file->data + offset, sizeof(rresResourceChunkInfo));
+    return offset + sizeof(rresResourceChunkInfo) + info->packedSize <= rres_file->size;
+}
+
+static bool build_index(RresFileInfo_t* rres_file)
+{
+    rresFileHeader header;
+    if (rres_file->size < sizeof(rresFileHeader)) return false;
+    memcpy(&header, rres_file->data, sizeof(rresFileHeader));
+
+    if (memcmp(header.id, "rres", 4) != 0 || header.version != 100)
+    {
+        printf("%s is not a valid rres file\n", rres_file->fname);
+        return false;
+    }
+    if (header.cdOffset == 0)
+    {
+        printf("%s has no central directory\n", rres_file->fname);
+        return false;
+    }
+
+    // Offset of the central directory does not count the file header
+    rresResourceChunkInfo info;
+    size_t cd_offset = sizeof(rresFileHeader) + header.cdOffset;
+    if (!read_chunk_info(rres_file, cd_offset, &info)) return false;
+    if (memcmp(info.type, "CDIR", 4) != 0) return false;
+
+    // propCount, props[], then the entries
+    const uint8_t* ptr = rres_file->data + cd_offset + sizeof(rresResourceChunkInfo);
+    const uint8_t* end = ptr + info.packedSize;
+    unsigned int prop_count;
+    unsigned int n_entries;
+    if (ptr + 2 * sizeof(unsigned int) > end) return false;
+    memcpy(&prop_count, ptr, sizeof(unsigned int));
+    memcpy(&n_entries, ptr + sizeof(unsigned int), sizeof(unsigned int));
+    ptr += (prop_count + 1) * sizeof(unsigned int);
+
+    for (unsigned int i = 0; i < n_entries; ++i)
+    {
+        // id, offset, reserved, fileNameSize, fileName
+        unsigned int entry[4];
+        if (ptr + sizeof(entry) > end) return false;
+        memcpy(entry, ptr, sizeof(entry));
+        sc_map_put_64(&rres_file->index, entry[0], entry[1]);
+        ptr += sizeof(entry) + entry[3];
+    }
+    return true;
+}
+
+struct RresScratchBlock
+{
+    struct RresScratchBlock* next;
+    uint8_t data[];
+};
+
+static uint8_t* alloc_scratch(RresFileInfo_t* rres_file, size_t size)
+{
+    // One block per chunk, so the views stay valid until the archive is closed
+    struct RresScratchBlock* block = malloc(sizeof(struct RresScratchBlock) + size);
+    if (block == NULL) return NULL;
+
+    block->next = rres_file->scratch;
+    rres_file->scratch = block;
+    return block->data;
+}
+
+static bool decompress_chunk(RresFileInfo_t* rres_file, const char* filename, RresChunkView_t* view)
+{
+    if (rres_file->dctx == NULL) rres_file->dctx = ZSTD_createDCtx();
+    uint8_t* data = alloc_scratch(rres_file, view->size);
+    if (rres_file->dctx == NULL || data == NULL) return false;
+
+    size_t res = ZSTD_decompressDCtx(rres_file->dctx, data, view->size, view->raw, view->packed_size);
+    if (res != view->size)
+    {
+        printf("Unable to decompress %s\n", filename);
+        return false;
+    }
+    view->raw = data;
+    view->packed_size = 0;
+    return true;
+}
+
+bool open_rres_file(RresFileInfo_t* rres_file, const char* fname)
+{
+    memset(rres_file, 0, sizeof(RresFileInfo_t));
+    rres_file->fname = fname;
+    rres_file->data = map_file(fname, &rres_file->size);
+    if (rres_file->data == NULL)
+    {
+        printf("Unable to open file %s\n", fname);
+        return false;
+    }
+
+    sc_map_init_64(&rres_file->index, 0, 0);
+    if (!build_index(rres_file))
+    {
+        close_rres_file(rres_file);
+        return false;
+    }
+    return true;
+}
+
+void close_rres_file(RresFileInfo_t* rres_file)
+{
+    if (rres_file->data == NULL) return;
+
+    sc_map_term_64(&rres_file->index);
+    unmap_file(rres_file->data, rres_file->size);
+    while (rres_file->scratch != NULL)
+    {
+        struct RresScratchBlock* next = rres_file->scratch->next;
+        free(rres_file->scratch);
+        rres_file->scratch = next;
+    }
+    ZSTD_freeDCtx(rres_file->dctx);
+    rres_file->dctx = NULL;
+    rres_file->data = NULL;
+    rres_file->size = 0;
+}
+
+bool get_rres_chunk_packed(RresFileInfo_t* rres_file, const char* filename, RresChunkView_t* view)
+{
+    if (rres_file->data == NULL) return false;
+
+    // Resource ids are the CRC32 of the packed file name
+    unsigned int id = rresComputeCRC32((unsigned char*)filename, strlen(filename));
+    uint64_t offset = sc_map_get_64(&rres_file->index, id);
+    if (!sc_map_found(&rres_file->index)) return false;
+
+    if (!read_chunk_info(rres_file, offset, &view->info)) return false;
+    if (view->info.id != id) return false;
+    if (view->info.compType != RRES_COMP_NONE && view->info.compType != RRES_COMP_ZSTD) return false;
+    if (view->info.cipherType != RRES_CIPHER_NONE) return false;
+
+    // The mapping is read only. rresComputeCRC32 takes a mutable pointer but only reads from it
+    const uint8_t* data = rres_file->data + offset + sizeof(rresResourceChunkInfo);
+    if (rresComputeCRC32((unsigned char*)data, view->info.packedSize) != view->info.crc32)
+    {
+        printf("CRC32 mismatch for %s, data may be corrupted\n", filename);
+        return false;
+    }
+
+    memcpy(&view->prop_count, data, sizeof(unsigned int));
+    uint32_t header_size = (view->prop_count + 1) * sizeof(unsigned int);
+    if (header_size > view->info.baseSize || header_size > view->info.packedSize) return false;
+
+    memset(view->props, 0, sizeof(view->props));
+    unsigned int n_props = (view->prop_count < RRES_VIEW_MAX_PROPS) ? view->prop_count : RRES_VIEW_MAX_PROPS;
+    memcpy(view->props, data + sizeof(unsigned int), n_props * sizeof(unsigned int));
+
+    view->raw = data + header_size;
+    view->size = view->info.baseSize - header_size;
+    view->packed_size = 0;
+    if (view->info.compType == RRES_COMP_ZSTD)
+    {
+        view->packed_size = view->info.packedSize - header_size;
+    }
+    return true;
+}
+
+bool get_rres_chunk(RresFileInfo_t* rres_file, const char* filename, RresChunkView_t* view)
+{
+    if (!get_rres_chunk_packed(rres_file, filename, view)) return false;
+    if (view->packed_size == 0) return true;
+    return decompress_chunk(rres_file, filename, view);
+}
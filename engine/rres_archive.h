@@ -0,0 +1,56 @@
+#ifndef __RRES_ARCHIVE_H
+#define __RRES_ARCHIVE_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sc/map/sc_map.h"
+#include "rres.h"
+
+// Enough for the chunk types packed by rres_packer
+#define RRES_VIEW_MAX_PROPS 4
+
+// Private extension of rresCompressionType, not part of the rres format, so other
+// rres tools cannot read these chunks. It follows the steps of 10 of the listed
+// values and would clash if rres.h ever adds its own 50.
+// The props are left as is, so that they can be read without decompressing,
+// and the raw data is a zstd frame. baseSize is still the size once decompressed
+#define RRES_COMP_ZSTD 50
+
+struct RresScratchBlock;
+struct ZSTD_DCtx_s;
+
+// The archive is mapped once, and chunks are looked up through
+// the central directory instead of scanning the file
+typedef struct RresFileInfo
+{
+    const char* fname;
+    const uint8_t* data;
+    size_t size;
+    struct sc_map_64 index; // Resource id to chunk offset
+    // Decompressed chunks, freed when the archive is closed
+    struct RresScratchBlock* scratch;
+    struct ZSTD_DCtx_s* dctx;
+}RresFileInfo_t;
+
+// Points into the mapped archive or its scratch blocks,
+// valid until the archive is closed
+typedef struct RresChunkView
+{
+    rresResourceChunkInfo info;
+    unsigned int prop_count;
+    unsigned int props[RRES_VIEW_MAX_PROPS];
+    const uint8_t* raw;
+    uint32_t size;
+    // Non zero if raw is still a zstd frame of this size, decompressing to size bytes
+    uint32_t packed_size;
+}RresChunkView_t;
+
+bool open_rres_file(RresFileInfo_t* rres_file, const char* fname);
+void close_rres_file(RresFileInfo_t* rres_file);
+// Only uncompressed or zstd compressed, and unencrypted chunks can be viewed.
+// Compressed chunks are decompressed into the scratch blocks of the archive
+bool get_rres_chunk(RresFileInfo_t* rres_file, const char* filename, RresChunkView_t* view);
+// Leaves compressed chunks as they are, for them to be decompressed elsewhere,
+// like on the asset load workers
+bool get_rres_chunk_packed(RresFileInfo_t* rres_file, const char* filename, RresChunkView_t* view);
+#endif // __RRES_ARCHIVE_H
@@ -28,10 +28,9 @@ int main(void)
 
     LevelScene_t scene;
     scene.scene.engine = &engine;
-    scene.data.level_pack = pack;
-    scene.data.current_level = 0;
-
     init_game_scene(&scene);
+    set_level_pack(&scene, pack);
+    scene.data.current_level = 0;
     assert(load_level_tilemap(&scene, 0) == true);
 
     scene.data.tile_sprites[ONEWAY_TILE] = get_sprite(&engine.assets, "tl_owp");
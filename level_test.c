@@ -2,6 +2,7 @@
 #include "assets_loader.h"
 #include "scene_impl.h"
 #include "ent_impl.h"
+#include "game_systems.h"
 #include "mempool.h"
 #include "constants.h"
 #include <stdio.h>
@@ -35,6 +36,7 @@ int main(int argc, char** argv)
     load_from_infofile("res/assets.info.raw", &engine.assets);
     init_player_creation("res/player_spr.info", &engine.assets);
     init_item_creation(&engine.assets);
+    init_game_asset_ids(&engine.assets);
 
     load_sfx(&engine, "snd_jump", PLAYER_JMP_SFX);
     load_sfx(&engine, "snd_land", PLAYER_LAND_SFX);
@@ -83,7 +85,7 @@ int main(int argc, char** argv)
         printf("Level numbers out of bound. Picking 0");
         selected_level = 0;
     }
-    level_scene.data.level_pack = pack;
+    set_level_pack(&level_scene, pack);
     level_scene.data.current_level = selected_level;
     scenes[0] = &level_scene.scene;
     reload_level_tilemap(&level_scene);
@@ -2,6 +2,7 @@
 #include "assets_loader.h"
 #include "scene_impl.h"
 #include "ent_impl.h"
+#include "game_systems.h"
 #include "mempool.h"
 #include "constants.h"
 #include <stdio.h>
@@ -22,6 +23,23 @@ const int screenHeight = VIEWABLE_MAP_HEIGHT * TILE_SIZE;
 // Maintain own queue to handle key presses
 struct sc_queue_32 key_buffer;
 
+// Needed by the main menu and the level select, the rest can come in later
+static const char* first_assets[] = {"lvl_board", "lvl_select", "DefLevels"};
+
+static void set_tex_wrap(AssetHandle_t handle, bool okay, void* user_data)
+{
+    (void)handle;
+    if (!okay) return;
+    SetTextureWrap(*(Texture2D*)user_data, TEXTURE_WRAP_REPEAT);
+}
+
+static void set_level_select_pack(AssetHandle_t handle, bool okay, void* user_data)
+{
+    (void)handle;
+    (void)okay;
+    refresh_level_select_list(user_data);
+}
+
 int main(void) 
 {
     // Initialization
@@ -30,13 +48,16 @@ int main(void)
     init_engine(&engine, (Vector2){screenWidth, screenHeight});
     SetTargetFPS(60);               // Set our game to run at 60 frames-per-second
 #ifndef NDEBUG
-    load_from_infofile("res/assets.info.raw", &engine.assets);
+    start_loading_from_infofile("res/assets.info.raw", &engine.assets, first_assets, sizeof(first_assets) / sizeof(first_assets[0]));
     init_player_creation("res/player_spr.info", &engine.assets);
+    watch_infofile("res/assets.info.raw", &engine.assets);
+    watch_asset_file("res/player_spr.info", &reload_player_creation);
 #else
-    load_from_rres("res/myresources.rres", &engine.assets);
-    init_player_creation_rres("res/myresources.rres", "player_spr.info", &engine.assets);
+    start_loading_from_rres("res/myresources.rres", &engine.assets, first_assets, sizeof(first_assets) / sizeof(first_assets[0]));
+    init_player_creation_rres("res/myresources.rres", &engine.assets);
 #endif
     init_item_creation(&engine.assets);
+    init_game_asset_ids(&engine.assets);
 
     load_sfx(&engine, "snd_jump", PLAYER_JMP_SFX);
     load_sfx(&engine, "snd_land", PLAYER_LAND_SFX);
@@ -56,6 +77,20 @@ int main(void)
     load_sfx(&engine, "snd_arrhit", ARROW_DESTROY_SFX);
     load_sfx(&engine, "snd_launch", ARROW_RELEASE_SFX);
     load_sfx(&engine, "snd_launch", BOMB_RELEASE_SFX);
+    // Player feedback keeps its voice. Sounds that many entities
+    // can trigger at once are held back for a few frames
+    set_sfx_params(&engine, PLAYER_DEAD_SFX, 2, 0);
+    set_sfx_params(&engine, PLAYER_JMP_SFX, 1, 0);
+    set_sfx_params(&engine, PLAYER_LAND_SFX, 1, 0);
+    set_sfx_params(&engine, PLAYER_DROWNING_SFX, 1, 0);
+    set_sfx_params(&engine, COIN_SFX, 1, 0);
+    set_sfx_params(&engine, WOOD_LAND_SFX, 0, 4);
+    set_sfx_params(&engine, BOULDER_LAND_SFX, 0, 4);
+    set_sfx_params(&engine, WOOD_DESTROY_SFX, 0, 4);
+    set_sfx_params(&engine, METAL_DESTROY_SFX, 0, 4);
+    set_sfx_params(&engine, BOULDER_DESTROY_SFX, 0, 4);
+    set_sfx_params(&engine, ARROW_DESTROY_SFX, 0, 4);
+    set_sfx_params(&engine, EXPLOSION_SFX, 0, 6);
 
     LevelScene_t sandbox_scene;
     sandbox_scene.scene.engine = &engine;
@@ -71,12 +106,15 @@ int main(void)
     level_scene.data.tile_sprites[SPIKES + TILE_90CCWROT] = get_sprite(&engine.assets, "r_spikes");
     level_scene.data.tile_sprites[SPIKES + TILE_180ROT] = get_sprite(&engine.assets, "u_spikes");
     Texture2D* tex = get_texture(&engine.assets, "bg_tex");
-    SetTextureWrap(*tex, TEXTURE_WRAP_REPEAT);
+    if (!on_asset_loaded("bg_tex", &set_tex_wrap, tex))
+    {
+        SetTextureWrap(*tex, TEXTURE_WRAP_REPEAT);
+    }
 
     LevelPack_t* pack = get_level_pack(&engine.assets, "DefLevels");
     if (pack != NULL)
     {
-        level_scene.data.level_pack = pack;
+        set_level_pack(&level_scene, pack);
         level_scene.data.current_level = 0;
     }
 
@@ -86,8 +124,10 @@ int main(void)
 
     LevelSelectScene_t level_sel_scene;
     level_sel_scene.scene.engine = &engine;
-    level_sel_scene.data.level_pack = pack;
+    level_sel_scene.data.level_pack = NULL;
     init_level_select_scene(&level_sel_scene);
+    select_level_pack(&level_sel_scene, "DefLevels", NULL);
+    on_asset_loaded("DefLevels", &set_level_select_pack, &level_sel_scene);
 
     scenes[MAIN_MENU_SCENE] = &menu_scene.scene;
     scenes[LEVEL_SELECT_SCENE] = &level_sel_scene.scene;
@@ -107,6 +147,26 @@ int main(void)
             break;
         }
 
+        if (engine.curr_scene != MAIN_MENU_SCENE)
+        {
+            // Other scenes need everything
+            finish_asset_loading(&engine.assets);
+        }
+        else
+        {
+            update_asset_loading(&engine.assets);
+        }
+
+#ifndef NDEBUG
+        if (update_asset_watch(&engine.assets) > 0)
+        {
+            // Level names may have changed
+            refresh_level_select_list(&level_sel_scene);
+            // Textures are swapped in place, so the cached chunks are stale
+            reset_tilemap_chunks(&level_scene.data.tilemap);
+            reset_tilemap_chunks(&sandbox_scene.data.tilemap);
+        }
+#endif
         process_inputs(&engine, curr_scene);
 
 
@@ -123,6 +183,10 @@ int main(void)
             sc_queue_clear(&key_buffer);
         }
     }
+    finish_asset_loading(&engine.assets);
+#ifndef NDEBUG
+    stop_asset_watch();
+#endif
     free_sandbox_scene(&sandbox_scene);
     free_game_scene(&level_scene);
     free_level_select_scene(&level_sel_scene);
@@ -67,6 +67,7 @@ int main(void)
         .speed = 0,
         .name = "test_spr"
     };
+    update_sprite_frames(&spr);
 
     const float DT = 1.0f/60.0f;
     float delta_time = 0.0f;
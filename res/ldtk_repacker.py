@@ -6,6 +6,9 @@ import struct
 
 parser = argparse.ArgumentParser()
 parser.add_argument('filename')
+parser.add_argument('--indexed', action='store_true', help="Write the v2 pack, with each level as its own zstd frame. It is already compressed, so skip zstd on it")
+parser.add_argument('--dict-size', type=int, default=0, help="Train a shared zstd dictionary of this size for --indexed")
+parser.add_argument('--rle', action='store_true', help="With --indexed, run length encode the static tiles and list the entities separately")
 args = parser.parse_args()
 
 print("Parsing", args.filename)
@@ -79,78 +82,145 @@ else:
     fileparts[-1] = "lvldata"
 converted_filename = '.'.join(fileparts)
 
+# Matches LEVEL_SPAWN_TILE_START
+SPAWN_TILE_START = 8
+
+# [n_spawns, 4 bytes][n_runs, 4 bytes]
+# then the spawns as [x, 2 bytes][y, 2 bytes][tile_type, 1 byte][padding, 1 byte]
+# then the static tiles as [tile_type, 5 bits | water, 3 bits][count, 1 byte]
+def encode_level_runs(tiles_info, width) -> bytes:
+    spawns = []
+    runs = []
+    for i, (tile_type, _, water) in enumerate(tiles_info):
+        if tile_type >= SPAWN_TILE_START:
+            spawns.append(struct.pack("<2HBx", i % width, i // width, tile_type))
+            tile_type = 0
+        packed_tile = tile_type | (min(water, 7) << 5)
+        if runs and runs[-1][0] == packed_tile and runs[-1][1] < 255:
+            runs[-1][1] += 1
+        else:
+            runs.append([packed_tile, 1])
+    return (
+        struct.pack("<II", len(spawns), len(runs))
+        + b"".join(spawns)
+        + b"".join(struct.pack("<2B", *run) for run in runs)
+    )
+
 # Each level should be packed as: [width, 2 bytes][height, 2 bytes][tile_type,entity,water,padding 1,1,1,1 bytes][tile_type,entity,water,padding 1,1,1,1 bytes]...
-with open(converted_filename, 'wb+') as out_file:
-    out_file.write(struct.pack("<I", n_levels))
-    # Then loop the levels. Read the layerIndstances
-    for level in all_levels:
-        n_chests : int = 0
-        # Search for __identifier for the level layout
-        level_name = "" 
-
-        level_metadata = level['fieldInstances']
-        level_tileset = 0;
-        for data in level_metadata:
-            if data["__identifier"] == "TileSet":
-                level_tileset = data["__value"]
-            if data["__identifier"] == "Name":
-                level_name = data["__value"]
-
-        print("Parsing level", level_name)
-
-        level_layout = {}
-        entity_layout = {}
-        water_layout = {}
-        for layer in level['layerInstances']:
-            if layer["__identifier"] == "Tiles":
-                level_layout = layer
-            elif layer["__identifier"] == "Entities":
-                entity_layout = layer
-            elif layer["__identifier"] == "Water":
-                water_layout = layer
-
-        # Dimensions of each level is obtained via __cWid and __cHei. Get the __gridSize as well
-        width = level_layout["__cWid"]
-        height = level_layout["__cHei"]
-        print(f"Dim.: {width}x{height}. N Tiles: {width * height}")
-        # Create a W x H array of tile information
-        n_tiles = width * height
-        tiles_info = [[0,0,0] for _ in range(n_tiles)]
-        # Loop through gridTiles, get "d" as the index to fill the info
-        for i, tile in enumerate(level_layout["gridTiles"]):
-            try:
-                tiles_info[tile["d"][0]][0] = ids_tiletype_map[tile["t"]]
-                if tiles_info[tile["d"][0]][0] == ENUMIDS_TILETYPE_MAPPING ["Chest"]:
-                    n_chests += 1
-            except Exception as e:
-                print("Error on tile", i, i % width, i // height)
-                print(e)
-                tiles_info[tile["d"][0]][0] = 0
-
-        for i, water_level in enumerate(water_layout["intGridCsv"]):
-            tiles_info[i][2] = water_level
-
-        # Subject to change
-        for ent in entity_layout["entityInstances"]:
-            x,y = ent["__grid"]
-            tiles_info[y*width + x][0] = ENUMIDS_TILETYPE_MAPPING[ent["__identifier"]]
-            if ent["__identifier"] == "Urchin":
-                spd_encoding = 0
-                for urchin_data in ent['fieldInstances']:
-                    if urchin_data["__identifier"] == "Direction":
-                        spd_encoding |= urchin_data["__value"] << 2
-                    elif urchin_data["__identifier"] == "SpeedLevel":
-                        spd_encoding |= urchin_data["__value"]
-
-                tiles_info[y*width + x][0] += spd_encoding
-
-        out_file.write(struct.pack("<32s4H", level_name.encode('utf-8'), width, height, n_chests, level_tileset))
-        for tile in tiles_info:
-            out_file.write(struct.pack("<3Bx", *tile))
-
-
-        #for y in range(height):
-        #    for x in range(width):
-        #        print(tiles_info[y*width + x], end=" ")
-        #    print()
+packed_levels = []
+# Then loop the levels. Read the layerIndstances
+for level in all_levels:
+    n_chests : int = 0
+    # Search for __identifier for the level layout
+    level_name = "" 
+
+    level_metadata = level['fieldInstances']
+    level_tileset = 0;
+    level_flags = 0;
+    for data in level_metadata:
+        if data["__identifier"] == "TileSet":
+            level_tileset = data["__value"]
+        if data["__identifier"] == "CellularWater" and data["__value"]:
+            # Matches LEVEL_FLAG_CELLULAR_WATER
+            level_flags |= 1 << 8
+        if data["__identifier"] == "Name":
+            level_name = data["__value"]
+
+    print("Parsing level", level_name)
+
+    level_layout = {}
+    entity_layout = {}
+    water_layout = {}
+    for layer in level['layerInstances']:
+        if layer["__identifier"] == "Tiles":
+            level_layout = layer
+        elif layer["__identifier"] == "Entities":
+            entity_layout = layer
+        elif layer["__identifier"] == "Water":
+            water_layout = layer
+
+    # Dimensions of each level is obtained via __cWid and __cHei. Get the __gridSize as well
+    width = level_layout["__cWid"]
+    height = level_layout["__cHei"]
+    print(f"Dim.: {width}x{height}. N Tiles: {width * height}")
+    # Create a W x H array of tile information
+    n_tiles = width * height
+    tiles_info = [[0,0,0] for _ in range(n_tiles)]
+    # Loop through gridTiles, get "d" as the index to fill the info
+    for i, tile in enumerate(level_layout["gridTiles"]):
+        try:
+            tiles_info[tile["d"][0]][0] = ids_tiletype_map[tile["t"]]
+            if tiles_info[tile["d"][0]][0] == ENUMIDS_TILETYPE_MAPPING ["Chest"]:
+                n_chests += 1
+        except Exception as e:
+            print("Error on tile", i, i % width, i // height)
+            print(e)
+            tiles_info[tile["d"][0]][0] = 0
+
+    for i, water_level in enumerate(water_layout["intGridCsv"]):
+        tiles_info[i][2] = water_level
+
+    # Subject to change
+    for ent in entity_layout["entityInstances"]:
+        x,y = ent["__grid"]
+        tiles_info[y*width + x][0] = ENUMIDS_TILETYPE_MAPPING[ent["__identifier"]]
+        if ent["__identifier"] == "Urchin":
+            spd_encoding = 0
+            for urchin_data in ent['fieldInstances']:
+                if urchin_data["__identifier"] == "Direction":
+                    spd_encoding |= urchin_data["__value"] << 2
+                elif urchin_data["__identifier"] == "SpeedLevel":
+                    spd_encoding |= urchin_data["__value"]
+
+            tiles_info[y*width + x][0] += spd_encoding
+
+    level_header = struct.pack("<32s4H", level_name.encode('utf-8'), width, height, n_chests, level_tileset | level_flags)
+    if args.rle:
+        level_tiles = encode_level_runs(tiles_info, width)
+    else:
+        level_tiles = b"".join(struct.pack("<3Bx", *tile) for tile in tiles_info)
+    packed_levels.append((level_header, level_tiles))
+
+
+    #for y in range(height):
+    #    for x in range(width):
+    #        print(tiles_info[y*width + x], end=" ")
+    #    print()
+
+if not args.indexed:
+    with open(converted_filename, 'wb+') as out_file:
+        out_file.write(struct.pack("<I", n_levels))
+        for level_header, level_tiles in packed_levels:
+            out_file.write(level_header)
+            out_file.write(level_tiles)
+    sys.exit(0)
+
+# v2: [magic "LPK2", or "LPK3" with --rle][n_levels, 4 bytes][dict size, 4 bytes]
+# then per level [header, 40 bytes][frame offset, 4 bytes][frame size, 4 bytes],
+# then the dictionary, then the tiles of each level as a zstd frame
+import zstandard
+
+dict_data = b""
+if args.dict_size > 0:
+    try:
+        dict_data = zstandard.train_dictionary(args.dict_size, [tiles for _, tiles in packed_levels]).as_bytes()
+    except zstandard.ZstdError as e:
+        print("Not using a dictionary:", e)
+
+if dict_data:
+    compressor = zstandard.ZstdCompressor(level=19, dict_data=zstandard.ZstdCompressionDict(dict_data), write_content_size=True)
+else:
+    compressor = zstandard.ZstdCompressor(level=19, write_content_size=True)
 
+frames = [compressor.compress(tiles) for _, tiles in packed_levels]
+offset = 12 + 48 * n_levels + len(dict_data)
+with open(converted_filename, 'wb+') as out_file:
+    out_file.write(b"LPK3" if args.rle else b"LPK2")
+    out_file.write(struct.pack("<II", n_levels, len(dict_data)))
+    for (level_header, _), frame in zip(packed_levels, frames):
+        out_file.write(level_header)
+        out_file.write(struct.pack("<II", offset, len(frame)))
+        offset += len(frame)
+    out_file.write(dict_data)
+    for frame in frames:
+        out_file.write(frame)
@@ -2,11 +2,18 @@
 
 #define RRES_IMPLEMENTATION
 #include "rres.h"              // Required to read rres data chunks
+#include "asset_manifest.h"
+
+#include "rres_archive.h"
+#include "zstd.h"
 
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
 
 // Load a continuous data buffer from rresResourceChunkData struct
 static unsigned char *LoadDataBuffer(rresResourceChunkData data, unsigned int rawSize)
@@ -26,89 +33,41 @@ static void UnloadDataBuffer(unsigned char *buffer)
     RRES_FREE(buffer);
 }
 
-static void addTextFile(rresFileHeader* header, const char* filename, FILE* rresFile, rresDirEntry* entry)
+// High, as only the changed chunks are compressed again, in parallel.
+// Compression that saves less than 1/16 is not worth decompressing for,
+// which is the case of most PNG and OGG files
+#define PACK_ZSTD_LEVEL 19
+#define MIN_COMPRESSION_SAVING 16
+
+// Only the raw data is compressed, see RRES_COMP_ZSTD
+static void compressChunk(rresResourceChunkInfo* chunkInfo, unsigned char** buffer, unsigned int header_size)
 {
-    rresResourceChunkInfo chunkInfo = { 0 };    // Chunk info
-    rresResourceChunkData chunkData = { 0 };    // Chunk data
-                                                //
-    unsigned char *buffer = NULL;
+    unsigned int size = chunkInfo->baseSize - header_size;
+    size_t bound = ZSTD_compressBound(size);
+    unsigned char* packed = RRES_MALLOC(header_size + bound);
+    if (packed == NULL) return;
 
-    // ----- Text files
-    char *text = LoadFileText(filename);
-    if (text == NULL)
+    size_t packed_size = ZSTD_compress(packed + header_size, bound, *buffer + header_size, size, PACK_ZSTD_LEVEL);
+    if (ZSTD_isError(packed_size) || packed_size + size / MIN_COMPRESSION_SAVING >= size)
     {
-        printf("Cannot pack text file %s\n", filename);
+        RRES_FREE(packed);
         return;
     }
-    unsigned int rawSize = strlen(text);
-
-    // Define chunk info: TEXT
-    chunkInfo.type[0] = 'T';         // Resource chunk type (FourCC)
-    chunkInfo.type[1] = 'E';         // Resource chunk type (FourCC)
-    chunkInfo.type[2] = 'X';         // Resource chunk type (FourCC)
-    chunkInfo.type[3] = 'T';         // Resource chunk type (FourCC)
-    
-    // Resource chunk identifier (generated from filename CRC32 hash)
-    chunkInfo.id = rresComputeCRC32((unsigned char*)filename, strlen(filename));
-
-    if (entry != NULL)
-    {
-        entry->id = chunkInfo.id;
-        entry->offset = ftell(rresFile);
-        entry->fileNameSize = strlen(filename);
-        strcpy(entry->fileName, filename);
-    }
-    
-    chunkInfo.compType = RRES_COMP_NONE,     // Data compression algorithm
-    chunkInfo.cipherType = RRES_CIPHER_NONE, // Data encription algorithm
-    chunkInfo.flags = 0,             // Data flags (if required)
-    chunkInfo.baseSize = 5*sizeof(unsigned int) + rawSize;   // Data base size (uncompressed/unencrypted)
-    chunkInfo.packedSize = chunkInfo.baseSize; // Data chunk size (compressed/encrypted + custom data appended)
-    chunkInfo.nextOffset = 0;        // Next resource chunk global offset (if resource has multiple chunks)
-    chunkInfo.reserved = 0;          // <reserved>
-                                     //
-    // Define chunk data: TEXT
-    chunkData.propCount = 4;
-    chunkData.props = (unsigned int *)RRES_CALLOC(chunkData.propCount, sizeof(unsigned int));
-    chunkData.props[0] = rawSize;    // props[0]:size (bytes)
-    chunkData.props[1] = RRES_TEXT_ENCODING_UNDEFINED;  // props[1]:rresTextEncoding
-    chunkData.props[2] = RRES_CODE_LANG_UNDEFINED;      // props[2]:rresCodeLang
-    chunkData.props[3] = 0x0409;     // props[3]:cultureCode: en-US: English - United States
-    chunkData.raw = text;
-    // Get a continuous data buffer from chunkData
-    buffer = LoadDataBuffer(chunkData, rawSize);
-    
-    // Compute data chunk CRC32 (propCount + props[] + data)
-    chunkInfo.crc32 = rresComputeCRC32(buffer, chunkInfo.packedSize);
 
-    // Write resource chunk into rres file
-    fwrite(&chunkInfo, sizeof(rresResourceChunkInfo), 1, rresFile);
-    fwrite(buffer, 1, chunkInfo.packedSize, rresFile);
-    
-    // Free required memory
-    RRES_FREE(chunkData.props);
-    UnloadDataBuffer(buffer);
-    UnloadFileText(text);
-
-    header->chunkCount++;
+    memcpy(packed, *buffer, header_size);
+    RRES_FREE(*buffer);
+    *buffer = packed;
+    chunkInfo->compType = RRES_COMP_ZSTD;
+    chunkInfo->packedSize = header_size + packed_size;
 }
 
-static bool addRawData(rresFileHeader* header, const char* filename, FILE* rresFile, const char* ext, rresDirEntry* entry)
+// Chunk info followed by the chunk data, ready to be written as is
+static unsigned char* buildRawChunk(const char* filename, const unsigned char* raw, unsigned int size, const char* ext, unsigned int* chunk_size)
 {
     rresResourceChunkInfo chunkInfo = { 0 };    // Chunk info
     rresResourceChunkData chunkData = { 0 };    // Chunk data
     unsigned char *buffer = NULL;
 
-    // Load file data
-    unsigned int size = 0;
-    unsigned char* raw = LoadFileData(filename, &size);
-    if (raw == NULL)
-    {
-        printf("Cannot pack raw file %s\n", filename);
-        UnloadDataBuffer(buffer);
-        return false;
-    }
-
     // Define chunk info: RAWD
     chunkInfo.type[0] = 'R';         // Resource chunk type (FourCC)
     chunkInfo.type[1] = 'A';         // Resource chunk type (FourCC)
@@ -117,14 +76,6 @@ static bool addRawData(rresFileHeader* header, const char* filename, FILE* rresF
     
     // Resource chunk identifier (generated from filename CRC32 hash)
     chunkInfo.id = rresComputeCRC32((unsigned char*)filename, strlen(filename));
-    
-    if (entry != NULL)
-    {
-        entry->id = chunkInfo.id;
-        entry->offset = ftell(rresFile);
-        entry->fileNameSize = strlen(filename);
-        strcpy(entry->fileName, filename);
-    }
 
     chunkInfo.compType = RRES_COMP_NONE,     // Data compression algorithm
     chunkInfo.cipherType = RRES_CIPHER_NONE, // Data encription algorithm
@@ -141,28 +92,309 @@ static bool addRawData(rresFileHeader* header, const char* filename, FILE* rresF
     memcpy(chunkData.props + 1, ext, 4);
     chunkData.props[2] = 0x0;     // props[2]:rresPixelFormat
     chunkData.props[3] = 0x0;     // props[2]:rresPixelFormat
-    chunkData.raw = raw;
+    chunkData.raw = (void*)raw;
     
 
     // Get a continuous data buffer from chunkData
     buffer = LoadDataBuffer(chunkData, size);
+    compressChunk(&chunkInfo, &buffer, (chunkData.propCount + 1) * sizeof(unsigned int));
     
     // Compute data chunk CRC32 (propCount + props[] + data)
     chunkInfo.crc32 = rresComputeCRC32(buffer, chunkInfo.packedSize);
 
-    // Write resource chunk into rres file
-    fwrite(&chunkInfo, sizeof(rresResourceChunkInfo), 1, rresFile);
-    fwrite(buffer, 1, chunkInfo.packedSize, rresFile);
+    *chunk_size = sizeof(rresResourceChunkInfo) + chunkInfo.packedSize;
+    unsigned char* chunk = RRES_MALLOC(*chunk_size);
+    memcpy(chunk, &chunkInfo, sizeof(rresResourceChunkInfo));
+    memcpy(chunk + sizeof(rresResourceChunkInfo), buffer, chunkInfo.packedSize);
     
     // Free required memory
     RRES_FREE(chunkData.props);
     UnloadDataBuffer(buffer);
-    UnloadFileData(raw);
+    return chunk;
+}
+
+static bool print_stats = false;
+
+static struct PackStats
+{
+    unsigned int n_built;
+    unsigned int n_reused;
+    uint64_t base_size;
+    uint64_t packed_size;
+}pack_stats;
+
+static void writeChunk(rresFileHeader* header, const unsigned char* chunk, unsigned int chunk_size, const char* filename, FILE* rresFile, rresDirEntry* entry, bool reused)
+{
+    rresResourceChunkInfo chunkInfo;
+    memcpy(&chunkInfo, chunk, sizeof(rresResourceChunkInfo));
+
+    if (entry != NULL)
+    {
+        entry->id = chunkInfo.id;
+        entry->offset = ftell(rresFile);
+        entry->fileNameSize = strlen(filename);
+        strcpy(entry->fileName, filename);
+    }
 
+    // Write resource chunk into rres file
+    fwrite(chunk, 1, chunk_size, rresFile);
     header->chunkCount++;
+
+    if (reused) pack_stats.n_reused++;
+    else pack_stats.n_built++;
+    pack_stats.base_size += chunkInfo.baseSize;
+    pack_stats.packed_size += chunkInfo.packedSize;
+    if (print_stats)
+    {
+        printf(
+            "%-40s %10u -> %10u (%5.1f%%) %s\n", filename,
+            chunkInfo.baseSize, chunkInfo.packedSize,
+            100.0f * chunkInfo.packedSize / chunkInfo.baseSize,
+            reused ? "reused" : "built"
+        );
+    }
+}
+
+static void addRawBuffer(rresFileHeader* header, const char* filename, unsigned char* raw, unsigned int size, FILE* rresFile, const char* ext, rresDirEntry* entry)
+{
+    unsigned int chunk_size;
+    unsigned char* chunk = buildRawChunk(filename, raw, size, ext, &chunk_size);
+    writeChunk(header, chunk, chunk_size, filename, rresFile, entry, false);
+    RRES_FREE(chunk);
+}
+
+static bool addRawData(rresFileHeader* header, const char* filename, FILE* rresFile, const char* ext, rresDirEntry* entry)
+{
+    // Load file data
+    unsigned int size = 0;
+    unsigned char* raw = LoadFileData(filename, &size);
+    if (raw == NULL)
+    {
+        printf("Cannot pack raw file %s\n", filename);
+        return false;
+    }
+
+    addRawBuffer(header, filename, raw, size, rresFile, ext, entry);
+    UnloadFileData(raw);
+    return true;
+}
+
+// Sprite sheets are packed into atlas pages, so that sprites
+// from different sheets can be drawn in one batch
+#define ATLAS_PAGE_SIZE 2048
+#define ATLAS_PADDING 2
+#define MAX_ATLAS_TEXTURES 32
+#define MAX_ATLAS_PAGES 4
+// Must match the entry read by add_texture_atlas_rres
+#define ATLAS_NAME_LEN 32
+#define ATLAS_ENTRY_SIZE (ATLAS_NAME_LEN + 5 * sizeof(uint16_t))
+
+typedef struct AtlasTexture
+{
+    char name[ATLAS_NAME_LEN];
+    char path[256];
+    Image image;
+    uint16_t page;
+    uint16_t x;
+    uint16_t y;
+}AtlasTexture_t;
+
+typedef struct AtlasBuilder
+{
+    // Names of the textures used by sprites
+    char sheets[MAX_ATLAS_TEXTURES][ATLAS_NAME_LEN];
+    uint16_t n_sheets;
+    AtlasTexture_t textures[MAX_ATLAS_TEXTURES];
+    uint16_t n_textures;
+}AtlasBuilder_t;
+
+static bool isSpriteSheet(const AtlasBuilder_t* atlas, const char* name)
+{
+    for (uint16_t i = 0; i < atlas->n_sheets; ++i)
+    {
+        if (strcmp(atlas->sheets[i], name) == 0) return true;
+    }
+    return false;
+}
+
+// Go through the sprites to find which textures are sprite sheets.
+// Textures that are drawn as a whole, like backgrounds, are left as is
+static void findSpriteSheets(AtlasBuilder_t* atlas, const char* info_file)
+{
+    FILE* in_file = fopen(info_file, "r");
+    if (in_file == NULL) return;
+
+    char buffer[256];
+    char* tmp;
+    bool is_sprite = false;
+    while (true)
+    {
+        tmp = fgets(buffer, 256, in_file);
+        if (tmp == NULL) break;
+        tmp[strcspn(tmp, "\r\n")] = '\0';
+
+        if (tmp[0] == '-')
+        {
+            is_sprite = strcmp(tmp + 1, "Sprite") == 0;
+            continue;
+        }
+        if (!is_sprite) continue;
+
+        char* name = strtok(buffer, ":");
+        char* info_str = strtok(NULL, ":");
+        if (name == NULL || info_str == NULL) continue;
+
+        while(*info_str == ' ' || *info_str == '\t') info_str++;
+        char* tex_name = strtok(info_str, ",");
+        if (tex_name == NULL || isSpriteSheet(atlas, tex_name)) continue;
+        if (atlas->n_sheets == MAX_ATLAS_TEXTURES) break;
+
+        strncpy(atlas->sheets[atlas->n_sheets], tex_name, ATLAS_NAME_LEN - 1);
+        atlas->n_sheets++;
+    }
+    fclose(in_file);
+}
+
+static bool addAtlasTexture(AtlasBuilder_t* atlas, const char* name, const char* path)
+{
+    if (atlas->n_textures == MAX_ATLAS_TEXTURES) return false;
+
+    Image image = LoadImage(path);
+    if (image.data == NULL) return false;
+
+    // Too large to share a page, pack it on its own
+    if (image.width + ATLAS_PADDING > ATLAS_PAGE_SIZE || image.height + ATLAS_PADDING > ATLAS_PAGE_SIZE)
+    {
+        UnloadImage(image);
+        return false;
+    }
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    AtlasTexture_t* tex = atlas->textures + atlas->n_textures;
+    memset(tex, 0, sizeof(AtlasTexture_t));
+    strncpy(tex->name, name, ATLAS_NAME_LEN - 1);
+    strncpy(tex->path, path, sizeof(tex->path) - 1);
+    tex->image = image;
+    atlas->n_textures++;
     return true;
 }
 
+static int compareAtlasHeight(const void* a, const void* b)
+{
+    const AtlasTexture_t* tex_a = a;
+    const AtlasTexture_t* tex_b = b;
+    return tex_b->image.height - tex_a->image.height;
+}
+
+// Pack the sprite sheets in rows of decreasing height,
+// then write out the pages and the region of each sheet
+static void addAtlas(rresFileHeader* header, AtlasBuilder_t* atlas, FILE* rresFile, rresCentralDir* central)
+{
+    if (atlas->n_textures == 0) return;
+
+    qsort(atlas->textures, atlas->n_textures, sizeof(AtlasTexture_t), compareAtlasHeight);
+
+    uint16_t page_heights[MAX_ATLAS_PAGES] = {0};
+    uint16_t n_pages = 1;
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint16_t row_height = 0;
+    uint16_t n_packed = 0;
+    for (; n_packed < atlas->n_textures; ++n_packed)
+    {
+        AtlasTexture_t* tex = atlas->textures + n_packed;
+        uint16_t width = tex->image.width + ATLAS_PADDING;
+        uint16_t height = tex->image.height + ATLAS_PADDING;
+        if (x + width > ATLAS_PAGE_SIZE)
+        {
+            x = 0;
+            y += row_height;
+            row_height = 0;
+        }
+        if (y + height > ATLAS_PAGE_SIZE)
+        {
+            if (n_pages == MAX_ATLAS_PAGES) break;
+            n_pages++;
+            x = 0;
+            y = 0;
+            row_height = 0;
+        }
+        tex->page = n_pages - 1;
+        tex->x = x;
+        tex->y = y;
+        x += width;
+        if (height > row_height) row_height = height;
+        if (y + row_height > page_heights[tex->page]) page_heights[tex->page] = y + row_height;
+    }
+
+    // Out of pages, the rest are packed on their own
+    for (uint16_t i = n_packed; i < atlas->n_textures; ++i)
+    {
+        printf("No atlas space for %s\n", atlas->textures[i].name);
+        if (addRawData(header, atlas->textures[i].path, rresFile, GetFileExtension(atlas->textures[i].path), central->entries + central->count))
+        {
+            central->count++;
+        }
+    }
+
+    char page_name[32];
+    for (uint16_t p = 0; p < n_pages; ++p)
+    {
+        // Only as tall as needed
+        Image page = GenImageColor(ATLAS_PAGE_SIZE, page_heights[p], BLANK);
+        for (uint16_t i = 0; i < n_packed; ++i)
+        {
+            AtlasTexture_t* tex = atlas->textures + i;
+            if (tex->page != p) continue;
+
+            ImageDraw(
+                &page, tex->image,
+                (Rectangle){0, 0, tex->image.width, tex->image.height},
+                (Rectangle){tex->x, tex->y, tex->image.width, tex->image.height},
+                WHITE
+            );
+        }
+
+        int size = 0;
+        unsigned char* png = ExportImageToMemory(page, ".png", &size);
+        UnloadImage(page);
+        if (png == NULL)
+        {
+            printf("Cannot export atlas page %u\n", p);
+            continue;
+        }
+
+        snprintf(page_name, sizeof(page_name), "atlas_%u.png", p);
+        printf("Atlas page %s: %ux%u\n", page_name, ATLAS_PAGE_SIZE, page_heights[p]);
+        addRawBuffer(header, page_name, png, size, rresFile, ".png", central->entries + central->count);
+        central->count++;
+        MemFree(png);
+    }
+
+    // Header: number of pages and regions, then one entry per region
+    unsigned int size = 2 * sizeof(uint32_t) + n_packed * ATLAS_ENTRY_SIZE;
+    unsigned char* rects = RRES_CALLOC(size, 1);
+    uint32_t counts[2] = {n_pages, n_packed};
+    memcpy(rects, counts, sizeof(counts));
+    unsigned char* entry = rects + sizeof(counts);
+    for (uint16_t i = 0; i < n_packed; ++i, entry += ATLAS_ENTRY_SIZE)
+    {
+        const AtlasTexture_t* tex = atlas->textures + i;
+        uint16_t vals[5] = {tex->page, tex->x, tex->y, tex->image.width, tex->image.height};
+        memcpy(entry, tex->name, ATLAS_NAME_LEN);
+        memcpy(entry + ATLAS_NAME_LEN, vals, sizeof(vals));
+        printf("Atlas region %s: page %u at %u,%u\n", tex->name, tex->page, tex->x, tex->y);
+    }
+    addRawBuffer(header, "atlas.rects", rects, size, rresFile, ".atl", central->entries + central->count);
+    central->count++;
+    RRES_FREE(rects);
+
+    for (uint16_t i = 0; i < atlas->n_textures; ++i)
+    {
+        UnloadImage(atlas->textures[i].image);
+    }
+}
+
 static void addCentralDir(rresFileHeader* header, const rresCentralDir* central, FILE* rresFile)
 {
     rresResourceChunkInfo chunkInfo = { 0 };    // Chunk info
@@ -231,12 +463,449 @@ typedef enum AssetInfoType
     SPRITE_INFO,
     LEVELPACK_INFO,
     SOUND_INFO,
+    EMITTER_INFO,
     INVALID_INFO
 }AssetInfoType_t;
 
-int main(void)
+// The records are written in the order that they are read
+typedef struct ManifestBuilder
+{
+    FileRecord_t* files;
+    SpriteRecord_t* sprites;
+    EmitterRecord_t* emitters;
+    PlayerSpriteRecord_t* player_sprites;
+    uint16_t n_files;
+    uint16_t n_sprites;
+    uint16_t n_emitters;
+    uint16_t n_player_sprites;
+}ManifestBuilder_t;
+
+// Grow the array one record at a time, the info files are small
+static void* appendRecord(void** records, uint16_t* count, size_t record_size)
+{
+    if (*count == UINT16_MAX) return NULL;
+    void* new_ptr = realloc(*records, (*count + 1) * record_size);
+    if (new_ptr == NULL) return NULL;
+
+    *records = new_ptr;
+    return (uint8_t*)new_ptr + (*count)++ * record_size;
+}
+
+static bool addFileRecord(ManifestBuilder_t* manifest, AssetLoadType_t type, const char* name, const char* path)
 {
-    FILE *rresFile = fopen("myresources.rres", "wb");
+    if (strlen(name) >= MAX_NAME_LEN || strlen(path) >= MANIFEST_PATH_LEN) return false;
+
+    FileRecord_t* record = appendRecord((void**)&manifest->files, &manifest->n_files, sizeof(FileRecord_t));
+    if (record == NULL) return false;
+
+    memset(record, 0, sizeof(FileRecord_t));
+    record->type = type;
+    strncpy(record->name, name, MAX_NAME_LEN);
+    strncpy(record->path, path, MANIFEST_PATH_LEN);
+    return true;
+}
+
+static bool readPlayerSprites(ManifestBuilder_t* manifest, const char* info_file)
+{
+    FILE* in_file = fopen(info_file, "r");
+    if (in_file == NULL)
+    {
+        printf("%s must be present\n", info_file);
+        return false;
+    }
+
+    char buffer[256];
+    char* tmp;
+    unsigned int line_num = 0;
+    bool okay = true;
+    while (okay)
+    {
+        tmp = fgets(buffer, 256, in_file);
+        if (tmp == NULL) break;
+        tmp[strcspn(tmp, "\r\n")] = '\0';
+        line_num++;
+
+        char* name = strtok(buffer, ":");
+        char* info_str = strtok(NULL, ":");
+        if (name == NULL) continue;
+
+        while(*name == ' ' || *name == '\t') name++;
+        PlayerSpriteRecord_t* record = appendRecord(
+            (void**)&manifest->player_sprites, &manifest->n_player_sprites,
+            sizeof(PlayerSpriteRecord_t)
+        );
+        okay = record != NULL && info_str != NULL;
+        if (okay)
+        {
+            while(*info_str == ' ' || *info_str == '\t') info_str++;
+            okay = parse_player_sprite_record(name, info_str, record);
+        }
+        if (!okay) printf("%s:%u: invalid player sprite entry\n", info_file, line_num);
+    }
+    fclose(in_file);
+    return okay;
+}
+
+static void addManifest(rresFileHeader* header, const ManifestBuilder_t* manifest, FILE* rresFile, rresDirEntry* entry)
+{
+    AssetManifestHeader_t manifest_header = {
+        .n_files = manifest->n_files,
+        .n_sprites = manifest->n_sprites,
+        .n_emitters = manifest->n_emitters,
+        .n_player_sprites = manifest->n_player_sprites,
+        .record_sizes = {
+            sizeof(FileRecord_t), sizeof(SpriteRecord_t),
+            sizeof(EmitterRecord_t), sizeof(PlayerSpriteRecord_t)
+        },
+    };
+    memcpy(manifest_header.magic, ASSET_MANIFEST_MAGIC, 4);
+
+    unsigned int files_size = manifest->n_files * sizeof(FileRecord_t);
+    unsigned int sprites_size = manifest->n_sprites * sizeof(SpriteRecord_t);
+    unsigned int emitters_size = manifest->n_emitters * sizeof(EmitterRecord_t);
+    unsigned int player_size = manifest->n_player_sprites * sizeof(PlayerSpriteRecord_t);
+    unsigned int size = sizeof(AssetManifestHeader_t) + files_size + sprites_size + emitters_size + player_size;
+    unsigned char* buffer = RRES_CALLOC(size, 1);
+
+    unsigned char* ptr = buffer;
+    memcpy(ptr, &manifest_header, sizeof(AssetManifestHeader_t));
+    ptr += sizeof(AssetManifestHeader_t);
+    if (files_size > 0) memcpy(ptr, manifest->files, files_size);
+    ptr += files_size;
+    if (sprites_size > 0) memcpy(ptr, manifest->sprites, sprites_size);
+    ptr += sprites_size;
+    if (emitters_size > 0) memcpy(ptr, manifest->emitters, emitters_size);
+    ptr += emitters_size;
+    if (player_size > 0) memcpy(ptr, manifest->player_sprites, player_size);
+
+    printf("Manifest: %u files, %u sprites, %u emitters, %u player sprites\n",
+        manifest->n_files, manifest->n_sprites, manifest->n_emitters, manifest->n_player_sprites
+    );
+    addRawBuffer(header, ASSET_MANIFEST_NAME, buffer, size, rresFile, ".man", entry);
+    RRES_FREE(buffer);
+}
+
+static void freeManifest(ManifestBuilder_t* manifest)
+{
+    free(manifest->files);
+    free(manifest->sprites);
+    free(manifest->emitters);
+    free(manifest->player_sprites);
+}
+
+// Inputs of the last pack, so that unchanged files are copied over
+// from the previous archive instead of being packed again
+#define PACK_CACHE_NAME "myresources.cache"
+#define PACK_CACHE_MAGIC "RPC2"
+#define ATLAS_CACHE_KEY "#atlas"
+#define MAX_PACK_WORKERS 8
+
+typedef struct PackCacheEntry
+{
+    char path[MANIFEST_PATH_LEN];
+    uint64_t hash;
+    int64_t mod_time;
+    int64_t size;
+}PackCacheEntry_t;
+
+typedef struct PackCache
+{
+    PackCacheEntry_t* entries;
+    uint16_t n_entries;
+}PackCache_t;
+
+static void loadPackCache(PackCache_t* cache, const char* fname)
+{
+    memset(cache, 0, sizeof(PackCache_t));
+    if (!FileExists(fname)) return;
+
+    int size = 0;
+    unsigned char* data = LoadFileData(fname, &size);
+    if (data == NULL) return;
+
+    uint32_t n_entries = 0;
+    if (
+        size >= 4 + (int)sizeof(uint32_t) && memcmp(data, PACK_CACHE_MAGIC, 4) == 0
+        && (memcpy(&n_entries, data + 4, sizeof(uint32_t)), n_entries <= UINT16_MAX)
+        && size == 4 + (int)sizeof(uint32_t) + (int)(n_entries * sizeof(PackCacheEntry_t))
+    )
+    {
+        cache->entries = malloc(n_entries * sizeof(PackCacheEntry_t));
+        if (cache->entries != NULL)
+        {
+            memcpy(cache->entries, data + 4 + sizeof(uint32_t), n_entries * sizeof(PackCacheEntry_t));
+            cache->n_entries = n_entries;
+        }
+    }
+    UnloadFileData(data);
+}
+
+static bool savePackCache(const PackCache_t* cache, const char* fname)
+{
+    unsigned int size = 4 + sizeof(uint32_t) + cache->n_entries * sizeof(PackCacheEntry_t);
+    unsigned char* data = malloc(size);
+    if (data == NULL) return false;
+
+    uint32_t n_entries = cache->n_entries;
+    memcpy(data, PACK_CACHE_MAGIC, 4);
+    memcpy(data + 4, &n_entries, sizeof(uint32_t));
+    if (n_entries > 0) memcpy(data + 4 + sizeof(uint32_t), cache->entries, n_entries * sizeof(PackCacheEntry_t));
+    bool okay = SaveFileData(fname, data, size);
+    free(data);
+    return okay;
+}
+
+static const PackCacheEntry_t* findPackCacheEntry(const PackCache_t* cache, const char* path)
+{
+    for (uint16_t i = 0; i < cache->n_entries; ++i)
+    {
+        if (strcmp(cache->entries[i].path, path) == 0) return cache->entries + i;
+    }
+    return NULL;
+}
+
+static void addPackCacheEntry(PackCache_t* cache, const char* path, uint64_t hash, int64_t mod_time, int64_t size)
+{
+    PackCacheEntry_t* entry = appendRecord((void**)&cache->entries, &cache->n_entries, sizeof(PackCacheEntry_t));
+    if (entry == NULL) return;
+
+    memset(entry, 0, sizeof(PackCacheEntry_t));
+    strncpy(entry->path, path, MANIFEST_PATH_LEN - 1);
+    entry->hash = hash;
+    entry->mod_time = mod_time;
+    entry->size = size;
+}
+
+// FNV-1a
+static uint64_t hashData(const unsigned char* data, size_t size, uint64_t hash)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+#define HASH_SEED 0xcbf29ce484222325ULL
+
+// A file to be packed into its own chunk, or to be put into the atlas
+typedef struct PackJob
+{
+    char name[MAX_NAME_LEN];
+    char path[MANIFEST_PATH_LEN];
+    char ext[8];
+    bool in_atlas;
+    const PackCacheEntry_t* cached;
+    // Set by the workers
+    int64_t mod_time;
+    int64_t size;
+    uint64_t hash;
+    bool unchanged;
+    unsigned char* chunk;
+    unsigned int chunk_size;
+}PackJob_t;
+
+static bool addPackJob(PackJob_t** jobs, uint16_t* n_jobs, const char* name, const char* path, const char* ext, bool in_atlas)
+{
+    PackJob_t* job = appendRecord((void**)jobs, n_jobs, sizeof(PackJob_t));
+    if (job == NULL) return false;
+
+    memset(job, 0, sizeof(PackJob_t));
+    strncpy(job->name, name, MAX_NAME_LEN - 1);
+    strncpy(job->path, path, MANIFEST_PATH_LEN - 1);
+    strncpy(job->ext, ext, sizeof(job->ext) - 1);
+    job->in_atlas = in_atlas;
+    return true;
+}
+
+// Files that have the same size and time as the last pack are taken as
+// unchanged without reading them. Otherwise they are hashed, and the chunk
+// is only built if the content did change
+static void preparePackJob(PackJob_t* job)
+{
+    job->mod_time = GetFileModTime(job->path);
+    job->size = GetFileLength(job->path);
+    const PackCacheEntry_t* cached = job->cached;
+    if (cached != NULL && cached->mod_time == job->mod_time && cached->size == job->size)
+    {
+        job->hash = cached->hash;
+        job->unchanged = true;
+        return;
+    }
+
+    int size = 0;
+    unsigned char* raw = LoadFileData(job->path, &size);
+    if (raw == NULL) return;
+
+    job->hash = hashData(raw, size, hashData((unsigned char*)job->ext, strlen(job->ext), HASH_SEED));
+    job->unchanged = cached != NULL && cached->hash == job->hash;
+    // Sprite sheets are drawn into the atlas pages later
+    if (!job->unchanged && !job->in_atlas)
+    {
+        job->chunk = buildRawChunk(job->path, raw, size, job->ext, &job->chunk_size);
+    }
+    UnloadFileData(raw);
+}
+
+typedef struct PackWorkers
+{
+    PackJob_t* jobs;
+    uint16_t n_jobs;
+    uint16_t next_job;
+    pthread_mutex_t lock;
+}PackWorkers_t;
+
+static void* packWorker(void* arg)
+{
+    PackWorkers_t* workers = arg;
+    while (true)
+    {
+        pthread_mutex_lock(&workers->lock);
+        uint16_t job_idx = workers->next_job++;
+        pthread_mutex_unlock(&workers->lock);
+        if (job_idx >= workers->n_jobs) break;
+
+        preparePackJob(workers->jobs + job_idx);
+    }
+    return NULL;
+}
+
+static void runPackJobs(PackJob_t* jobs, uint16_t n_jobs)
+{
+    if (n_jobs == 0) return;
+
+    PackWorkers_t workers = {
+        .jobs = jobs,
+        .n_jobs = n_jobs,
+        .next_job = 0,
+    };
+
+    // The main thread works too
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    if (n_threads > MAX_PACK_WORKERS) n_threads = MAX_PACK_WORKERS;
+    if (n_threads > n_jobs - 1) n_threads = n_jobs - 1;
+
+    pthread_t threads[MAX_PACK_WORKERS];
+    long n_started = 0;
+    pthread_mutex_init(&workers.lock, NULL);
+    for (; n_started < n_threads; ++n_started)
+    {
+        if (pthread_create(threads + n_started, NULL, packWorker, &workers) != 0) break;
+    }
+    packWorker(&workers);
+    for (long i = 0; i < n_started; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&workers.lock);
+}
+
+// Chunks are position independent, so they are copied over as is
+static bool copyChunk(RresFileInfo_t* old_rres, rresFileHeader* header, const char* filename, FILE* rresFile, rresDirEntry* entry)
+{
+    if (old_rres->data == NULL) return false;
+
+    unsigned int id = rresComputeCRC32((unsigned char*)filename, strlen(filename));
+    uint64_t offset = sc_map_get_64(&old_rres->index, id);
+    if (!sc_map_found(&old_rres->index)) return false;
+
+    rresResourceChunkInfo chunkInfo;
+    if (offset + sizeof(rresResourceChunkInfo) > old_rres->size) return false;
+    memcpy(&chunkInfo, old_rres->data + offset, sizeof(rresResourceChunkInfo));
+    if (chunkInfo.id != id || offset + sizeof(rresResourceChunkInfo) + chunkInfo.packedSize > old_rres->size) return false;
+
+    writeChunk(
+        header, old_rres->data + offset, sizeof(rresResourceChunkInfo) + chunkInfo.packedSize,
+        filename, rresFile, entry, true
+    );
+    return true;
+}
+
+// The pages only depend on the sprite sheets that go into them
+static uint64_t getAtlasKey(const PackJob_t* jobs, uint16_t n_jobs)
+{
+    uint64_t key = HASH_SEED;
+    for (uint16_t i = 0; i < n_jobs; ++i)
+    {
+        if (!jobs[i].in_atlas) continue;
+        key = hashData((unsigned char*)jobs[i].name, strlen(jobs[i].name) + 1, key);
+        key = hashData((unsigned char*)&jobs[i].hash, sizeof(uint64_t), key);
+    }
+    return key;
+}
+
+static bool copyAtlas(RresFileInfo_t* old_rres, rresFileHeader* header, const PackJob_t* jobs, uint16_t n_jobs, FILE* rresFile, rresCentralDir* central)
+{
+    if (!copyChunk(old_rres, header, "atlas.rects", rresFile, central->entries + central->count)) return false;
+    central->count++;
+
+    char page_name[32];
+    for (uint16_t p = 0; p < MAX_ATLAS_PAGES; ++p)
+    {
+        snprintf(page_name, sizeof(page_name), "atlas_%u.png", p);
+        if (!copyChunk(old_rres, header, page_name, rresFile, central->entries + central->count)) break;
+        central->count++;
+    }
+    // Along with the sheets that did not fit
+    for (uint16_t i = 0; i < n_jobs; ++i)
+    {
+        if (!jobs[i].in_atlas) continue;
+        if (copyChunk(old_rres, header, jobs[i].path, rresFile, central->entries + central->count))
+        {
+            central->count++;
+        }
+    }
+    return true;
+}
+
+static void printUsage(const char* prog)
+{
+    printf("Usage: %s [-f] [-s]\n", prog);
+    puts("  -f  Pack every file again, ignoring the cache");
+    puts("  -s  Print the sizes of each chunk");
+}
+
+int main(int argc, char** argv)
+{
+    bool use_cache = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-f") == 0)
+        {
+            use_cache = false;
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            print_stats = true;
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    struct timespec start_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    // The previous archive stays mapped while the new one is written next to it
+    RresFileInfo_t old_rres = {0};
+    PackCache_t old_cache = {0};
+    if (use_cache && FileExists("myresources.rres"))
+    {
+        loadPackCache(&old_cache, PACK_CACHE_NAME);
+        if (old_cache.n_entries > 0) open_rres_file(&old_rres, "myresources.rres");
+    }
+    PackCache_t new_cache = {0};
+
+    FILE *rresFile = fopen("myresources.rres.tmp", "wb");
+    if (rresFile == NULL)
+    {
+        puts("Cannot create myresources.rres.tmp");
+        close_rres_file(&old_rres);
+        free(old_cache.entries);
+        return 1;
+    }
 
     // Define rres file header
     // NOTE: We are loading 4 files that generate 5 resource chunks to save in rres
@@ -251,20 +920,21 @@ int main(void)
         .reserved = 0           // <reserved>
     };
     
-#define STARTING_CHUNKS 64
     // Central Directory
     rresCentralDir central = {
         .count = 0,
         .entries = NULL
     };
-    central.entries = RRES_CALLOC(sizeof(rresDirEntry), STARTING_CHUNKS);
     fseek(rresFile, sizeof(rresFileHeader), SEEK_SET);
     
+    // Malformed entries are reported here, instead of when the game loads them
+    bool okay = false;
+    ManifestBuilder_t manifest = {0};
+    PackJob_t* jobs = NULL;
+    uint16_t n_jobs = 0;
 
-    addTextFile(&header, "assets.info", rresFile, central.entries);
-    addTextFile(&header, "player_spr.info", rresFile, central.entries + 1);
-    central.count = 2;
-    uint16_t max_chunks = STARTING_CHUNKS;
+    static AtlasBuilder_t atlas = {0};
+    findSpriteSheets(&atlas, "assets.info");
 
     {
         FILE* in_file = fopen("assets.info", "r");
@@ -276,26 +946,17 @@ int main(void)
         
         char buffer[256];
         char* tmp;
+        unsigned int line_num = 0;
+        uint16_t n_atlas_jobs = 0;
         AssetInfoType_t info_type = INVALID_INFO;
 
-        while (true)
+        okay = true;
+        while (okay)
         {
             tmp = fgets(buffer, 256, in_file);
             if (tmp == NULL) break;
             tmp[strcspn(tmp, "\r\n")] = '\0';
-
-            if (central.count == max_chunks)
-            {
-                void* new_ptr = realloc(central.entries, (max_chunks*2) * sizeof(rresDirEntry));
-                if (new_ptr == NULL)
-                {
-                    puts("Cannot realloc central entries");
-                    fclose(in_file);
-                    goto end;
-                }
-                central.entries = new_ptr;
-                max_chunks *= 2;
-            }
+            line_num++;
 
             if (tmp[0] == '-')
             {
@@ -304,6 +965,10 @@ int main(void)
                 {
                     info_type = TEXTURE_INFO;
                 }
+                else if (strcmp(tmp, "Sprite") == 0)
+                {
+                    info_type = SPRITE_INFO;
+                }
                 else if (strcmp(tmp, "LevelPack") == 0)
                 {
                     info_type = LEVELPACK_INFO;
@@ -312,6 +977,10 @@ int main(void)
                 {
                     info_type = SOUND_INFO;
                 }
+                else if (strcmp(tmp, "Emitter") == 0)
+                {
+                    info_type = EMITTER_INFO;
+                }
                 else
                 {
                     info_type = INVALID_INFO;
@@ -329,56 +998,131 @@ int main(void)
                 {
                     case TEXTURE_INFO:
                     {
+                        okay = addFileRecord(&manifest, ASSET_LOAD_TEXTURE, name, info_str);
+                        if (!okay) break;
+
                         // ---- SpriteSheets
-                        if (
-                            addRawData(
-                                &header, info_str,
-                                rresFile, GetFileExtension(info_str),
-                                central.entries + central.count
-                           )
-                        )
-                        {
-                            central.count++;
-                        }
+                        bool in_atlas = isSpriteSheet(&atlas, name) && n_atlas_jobs < MAX_ATLAS_TEXTURES;
+                        if (in_atlas) n_atlas_jobs++;
+                        okay = addPackJob(&jobs, &n_jobs, name, info_str, GetFileExtension(info_str), in_atlas);
                     }
                     break;
                     case SOUND_INFO:
                     {
                         // ---- OGG Sound
-                        if (
-                            addRawData(
-                                &header, info_str,
-                                rresFile, ".ogg",
-                                central.entries + central.count
-                            )
-                        )
-                        {
-                            central.count++;
-                        }
+                        okay = addFileRecord(&manifest, ASSET_LOAD_SOUND, name, info_str)
+                            && addPackJob(&jobs, &n_jobs, name, info_str, ".ogg", false);
                     }
                     break;
                     case LEVELPACK_INFO:
                     {
                         // ---- Compressed Level Data
-                        if (
-                            addRawData(
-                                &header, info_str,
-                                rresFile, ".lpk",
-                                central.entries + central.count
-                            )
-                        )
-                        {
-                            central.count++;
-                        }
+                        okay = addFileRecord(&manifest, ASSET_LOAD_LEVELPACK, name, info_str)
+                            && addPackJob(&jobs, &n_jobs, name, info_str, ".lpk", false);
+                    }
+                    break;
+                    case SPRITE_INFO:
+                    {
+                        SpriteRecord_t* record = appendRecord(
+                            (void**)&manifest.sprites, &manifest.n_sprites,
+                            sizeof(SpriteRecord_t)
+                        );
+                        okay = record != NULL && parse_sprite_record(name, info_str, record);
+                    }
+                    break;
+                    case EMITTER_INFO:
+                    {
+                        EmitterRecord_t* record = appendRecord(
+                            (void**)&manifest.emitters, &manifest.n_emitters,
+                            sizeof(EmitterRecord_t)
+                        );
+                        okay = record != NULL && parse_emitter_record(name, info_str, record);
                     }
                     break;
                     default:
                     break;
                 }
+                if (!okay) printf("assets.info:%u: invalid entry %s\n", line_num, name);
             }
         }
         fclose(in_file);
     }
+    if (!okay) goto end;
+
+    okay = readPlayerSprites(&manifest, "player_spr.info");
+    if (!okay) goto end;
+
+    // One chunk per file at most, then the atlas pages, the region table
+    // and the manifest
+    central.entries = RRES_CALLOC(sizeof(rresDirEntry), n_jobs + MAX_ATLAS_PAGES + 2);
+    if (central.entries == NULL)
+    {
+        puts("Cannot allocate central entries");
+        okay = false;
+        goto end;
+    }
+
+    for (uint16_t i = 0; i < n_jobs; ++i)
+    {
+        jobs[i].cached = (old_rres.data != NULL) ? findPackCacheEntry(&old_cache, jobs[i].path) : NULL;
+    }
+    runPackJobs(jobs, n_jobs);
+
+    for (uint16_t i = 0; i < n_jobs; ++i)
+    {
+        PackJob_t* job = jobs + i;
+        if (job->in_atlas)
+        {
+            addPackCacheEntry(&new_cache, job->path, job->hash, job->mod_time, job->size);
+            continue;
+        }
+
+        if (job->unchanged && copyChunk(&old_rres, &header, job->path, rresFile, central.entries + central.count))
+        {
+            central.count++;
+            addPackCacheEntry(&new_cache, job->path, job->hash, job->mod_time, job->size);
+            continue;
+        }
+        if (job->chunk == NULL && job->unchanged)
+        {
+            // Not in the previous archive after all
+            job->cached = NULL;
+            preparePackJob(job);
+        }
+        if (job->chunk == NULL)
+        {
+            printf("Cannot pack raw file %s\n", job->path);
+            continue;
+        }
+        writeChunk(&header, job->chunk, job->chunk_size, job->path, rresFile, central.entries + central.count, false);
+        central.count++;
+        addPackCacheEntry(&new_cache, job->path, job->hash, job->mod_time, job->size);
+    }
+
+    // Drawing the atlas pages is the slowest part, so they are only drawn
+    // again if any of the sprite sheets changed
+    uint64_t atlas_key = getAtlasKey(jobs, n_jobs);
+    const PackCacheEntry_t* cached_atlas = findPackCacheEntry(&old_cache, ATLAS_CACHE_KEY);
+    if (
+        cached_atlas == NULL || cached_atlas->hash != atlas_key
+        || !copyAtlas(&old_rres, &header, jobs, n_jobs, rresFile, &central)
+    )
+    {
+        for (uint16_t i = 0; i < n_jobs; ++i)
+        {
+            if (!jobs[i].in_atlas || addAtlasTexture(&atlas, jobs[i].name, jobs[i].path)) continue;
+
+            if (addRawData(&header, jobs[i].path, rresFile, jobs[i].ext, central.entries + central.count))
+            {
+                central.count++;
+            }
+        }
+        addAtlas(&header, &atlas, rresFile, &central);
+    }
+    addPackCacheEntry(&new_cache, ATLAS_CACHE_KEY, atlas_key, 0, 0);
+
+    addManifest(&header, &manifest, rresFile, central.entries + central.count);
+    central.count++;
 
     addCentralDir(&header, &central, rresFile); 
 
@@ -388,6 +1132,51 @@ int main(void)
 
 end:
     fclose(rresFile);
+    close_rres_file(&old_rres);
+    if (okay && rename("myresources.rres.tmp", "myresources.rres") != 0)
+    {
+        puts("Cannot replace myresources.rres");
+        okay = false;
+    }
+    // Do not leave a half written archive for the game to load
+    if (!okay)
+    {
+        remove("myresources.rres.tmp");
+    }
+    else if (!savePackCache(&new_cache, PACK_CACHE_NAME))
+    {
+        // Only slows down the next pack
+        printf("Cannot save %s\n", PACK_CACHE_NAME);
+    }
+
+    if (okay)
+    {
+        struct timespec end_time;
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        double elapsed = (end_time.tv_sec - start_time.tv_sec) * 1000.0
+            + (end_time.tv_nsec - start_time.tv_nsec) / 1000000.0;
+        printf(
+            "Packed %u chunks in %.1f ms, %u reused\n",
+            pack_stats.n_built + pack_stats.n_reused, elapsed, pack_stats.n_reused
+        );
+        if (print_stats && pack_stats.base_size > 0)
+        {
+            printf(
+                "Total %lu -> %lu (%.1f%%)\n",
+                (unsigned long)pack_stats.base_size, (unsigned long)pack_stats.packed_size,
+                100.0 * pack_stats.packed_size / pack_stats.base_size
+            );
+        }
+    }
+
+    for (uint16_t i = 0; i < n_jobs; ++i)
+    {
+        RRES_FREE(jobs[i].chunk);
+    }
+    free(jobs);
+    free(old_cache.entries);
+    free(new_cache.entries);
     RRES_FREE(central.entries);
-    return 0;
+    freeManifest(&manifest);
+    return okay ? 0 : 1;
 }
@@ -3,6 +3,7 @@
 #endif
 #include "scene_impl.h"
 #include "ent_impl.h"
+#include "game_systems.h"
 #include "assets_loader.h"
 #include <stdio.h>
 #include <unistd.h>
@@ -50,9 +51,10 @@ int main(void)
     init_player_creation("res/player_spr.info", &engine.assets);
 #else
     load_from_rres("res/myresources.rres", &engine.assets);
-    init_player_creation_rres("res/myresources.rres", "player_spr.info", &engine.assets);
+    init_player_creation_rres("res/myresources.rres", &engine.assets);
 #endif
     init_item_creation(&engine.assets);
+    init_game_asset_ids(&engine.assets);
 
     load_sfx(&engine, "snd_jump", PLAYER_JMP_SFX);
     load_sfx(&engine, "snd_land", PLAYER_LAND_SFX);
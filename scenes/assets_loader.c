@@ -1,4 +1,6 @@
 #include "assets_loader.h"
+#include "asset_manifest.h"
+#include "file_watch.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -13,62 +15,6 @@ typedef enum AssetInfoType
     INVALID_INFO
 }AssetInfoType_t;
 
-typedef struct SpriteInfo
-{
-    char* tex;
-    Vector2 origin;
-    Vector2 frame_size;
-    int speed;
-    int frame_count;
-    int frame_per_row;
-}SpriteInfo_t;
-
-static bool parse_sprite_info(char* sprite_info_str, SpriteInfo_t* spr_info)
-{
-    char* tex_name = strtok(sprite_info_str, ",");
-    if (tex_name == NULL) return false;
-    spr_info->tex = tex_name;
-    char* spr_data = tex_name + strlen(tex_name) + 1;
-    int data_count = sscanf(
-        spr_data, "%f,%f,%f,%f,%d,%d,%d",
-        &spr_info->origin.x, &spr_info->origin.y,
-        &spr_info->frame_size.x, &spr_info->frame_size.y,
-        &spr_info->frame_count, &spr_info->frame_per_row, &spr_info->speed
-    );
-    return data_count == 7;
-}
-
-static bool parse_emitter_info(char* emitter_info_str, EmitterConfig_t* conf)
-{
-    char emitter_type;
-    uint8_t one_shot;
-    int data_count = sscanf(
-        emitter_info_str, "%c,%f-%f,%f-%f,%f-%f,%f-%f,%f-%f,%f,%c",
-        &emitter_type,
-        conf->launch_range, conf->launch_range + 1,
-        conf->speed_range, conf->speed_range + 1,
-        conf->angle_range, conf->angle_range + 1,
-        conf->rotation_range, conf->rotation_range + 1,
-        conf->particle_lifetime, conf->particle_lifetime + 1,
-        &conf->initial_spawn_delay, &one_shot
-    );
-
-    if (data_count == 13)
-    {
-        conf->type = EMITTER_UNKNOWN;
-        if (emitter_type == 'b')
-        {
-            conf->type = EMITTER_BURST;
-        }
-        else if (emitter_type == 's')
-        {
-            conf->type = EMITTER_STREAM;
-        }
-        conf->one_shot = (one_shot == '1');
-    }
-    return data_count == 13;
-}
-
 static inline AssetInfoType_t get_asset_type(const char* str)
 {
     if (strcmp(str, "Texture") == 0) return TEXTURE_INFO;
@@ -86,143 +32,220 @@ static inline AssetInfoType_t get_asset_type(const char* str)
     return INVALID_INFO;
 }
 
-static inline bool add_a_sprite(Assets_t* assets, const SpriteInfo_t* spr_info, char* name)
+// Sprites that are already added are changed in place
+static inline bool add_a_sprite(Assets_t* assets, const SpriteRecord_t* record)
 {
-    Texture2D* tex = get_texture(assets, spr_info->tex);
+    Texture2D* tex = get_texture(assets, record->tex);
     if (tex == NULL)
     {
-        printf("Unable to get texture info %s for sprite %s\n", spr_info->tex, name);
+        printf("Unable to get texture info %s for sprite %s\n", record->tex, record->name);
         return false;
     }
-    printf("Added Sprite %s from texture %s\n", name, spr_info->tex);
-    Sprite_t* spr = add_sprite(assets, name, tex);
-    spr->origin = spr_info->origin;
-    spr->frame_size = spr_info->frame_size;
-    spr->frame_count = spr_info->frame_count;
+    Sprite_t* spr = get_sprite(assets, record->name);
+    if (spr == NULL)
+    {
+        printf("Added Sprite %s from texture %s\n", record->name, record->tex);
+        spr = add_sprite(assets, record->name, tex);
+    }
+    set_sprite_texture(assets, spr, tex);
+    // Frames are relative to the texture, which may be packed in an atlas
+    Rectangle region = get_texture_region(assets, record->tex);
+    spr->origin = record->origin;
+    spr->origin.x += region.x;
+    spr->origin.y += region.y;
+    spr->frame_size = record->frame_size;
+    spr->frame_count = record->frame_count;
     if (spr->frame_count == 0)
     {
         // Cannot be zero
         spr->frame_count = 1;
     }
-    spr->frame_per_row = spr_info->frame_per_row;
-    spr->speed = spr_info->speed;
+    spr->frame_per_row = record->frame_per_row;
+    spr->speed = record->speed;
+    update_sprite_frames(spr);
     return true;
 }
 
-bool load_from_rres(const char* file, Assets_t* assets)
+// Emitters that are already added are changed in place
+static inline void add_an_emitter(Assets_t* assets, const EmitterRecord_t* record)
 {
-    RresFileInfo_t rres_file;
-    rres_file.dir = rresLoadCentralDirectory(file);
-    rres_file.fname = file;
-
-    if (rres_file.dir.count == 0)
+    EmitterConfig_t* conf = get_emitter_conf(assets, record->name);
+    if (conf == NULL)
     {
-        puts("Empty central directory");
-        return false;
+        conf = add_emitter_conf(assets, record->name);
+        printf("Added Emitter %s\n", record->name);
     }
+    *conf = record->conf;
+}
 
-    int res_id = rresGetResourceId(rres_file.dir, "assets.info");
-    rresResourceChunk chunk = rresLoadResourceChunk(file, res_id); // Hardcoded
-    bool okay = false;
+// Shared by the loaders, so only one is ever loading at a time
+static AssetLoadBatch_t load_batch;
 
-    if (chunk.info.baseSize > 0)
+// Give the next "name: info" entry, keeping track of the section it is in
+static bool read_info_entry(FILE* in_file, char* buffer, AssetInfoType_t* info_type, char** name, char** info_str, size_t* line_num)
+{
+    while (fgets(buffer, 256, in_file) != NULL)
     {
-        FILE* in_file = fmemopen(chunk.data.raw, chunk.info.baseSize, "rb");
-
-        char buffer[256];
-        char* tmp;
-        size_t line_num = 0;
-        AssetInfoType_t info_type = INVALID_INFO;
+        (*line_num)++;
+        buffer[strcspn(buffer, "\r\n")] = '\0';
 
-        while (true)
+        if (buffer[0] == '-')
         {
-            tmp = fgets(buffer, 256, in_file);
-            if (tmp == NULL) break;
-            tmp[strcspn(tmp, "\r\n")] = '\0';
+            *info_type = get_asset_type(buffer + 1);
+            continue;
+        }
 
-            if (tmp[0] == '-')
-            {
-                tmp++;
-                info_type = get_asset_type(tmp);
-            }
-            else
-            {
-                char* name = strtok(buffer, ":");
-                char* info_str = strtok(NULL, ":");
-                if (name == NULL || info_str == NULL) continue;
+        *name = strtok(buffer, ":");
+        *info_str = strtok(NULL, ":");
+        if (*name == NULL || *info_str == NULL) continue;
+
+        while(**name == ' ' || **name == '\t') (*name)++;
+        while(**info_str == ' ' || **info_str == '\t') (*info_str)++;
+        return true;
+    }
+    return false;
+}
 
-                while(*name == ' ' || *name == '\t') name++;
-                while(*info_str == ' ' || *info_str == '\t') info_str++;
-                switch(info_type)
+// Second pass, once the queued assets are in.
+// Sprites and emitters refer to them, and are cheap to add
+static void add_info_entries(FILE* in_file, Assets_t* assets)
+{
+    char buffer[256];
+    char* name;
+    char* info_str;
+    size_t line_num = 0;
+    AssetInfoType_t info_type = INVALID_INFO;
+
+    rewind(in_file);
+    while (read_info_entry(in_file, buffer, &info_type, &name, &info_str, &line_num))
+    {
+        switch(info_type)
+        {
+            case TEXTURE_INFO:
+                if (get_texture(assets, name) == NULL)
                 {
-                    case TEXTURE_INFO:
-                    {
-                        //if (add_texture(assets, name, info_str) == NULL)
-                        if (add_texture_rres(assets, name, info_str, &rres_file) == NULL)
-                        {
-                            printf("Unable to add texture at line %lu\n", line_num);
-                            break;
-                        }
-                        printf("Added texture %s as %s\n", info_str, name);
-                        //strcpy(tmp2, name);
-                    }
-                    break;
-                    case LEVELPACK_INFO:
-                    {
-                        //if (add_level_pack(assets, name, info_str) == NULL)
-                        if (add_level_pack_rres(assets, name, info_str, &rres_file) == NULL)
-                        {
-                            printf("Unable to add level pack at line %lu\n", line_num);
-                            break;
-                        }
-                        printf("Added level pack %s as %s\n", info_str, name);
-                    }
+                    printf("Unable to add texture at line %lu\n", line_num);
                     break;
-                    case SOUND_INFO:
-                    {
-                        if (add_sound_rres(assets, name, info_str, &rres_file) == NULL)
-                        {
-                            printf("Unable to add sound at line %lu\n", line_num);
-                            break;
-                        }
-                        printf("Added sound %s as %s\n", info_str, name);
-                    }
+                }
+                printf("Added texture %s as %s\n", info_str, name);
+            break;
+            case SOUND_INFO:
+                if (get_sound(assets, name) == NULL)
+                {
+                    printf("Unable to add sound at line %lu\n", line_num);
                     break;
-                    case SPRITE_INFO:
-                    {
-                        SpriteInfo_t spr_info = {0};
-                        if (!parse_sprite_info(info_str, &spr_info))
-                        {
-                            printf("Unable to parse info for sprite at line %lu\n", line_num);
-                            break;
-                        }
-                        add_a_sprite(assets, &spr_info, name);
-                    }
+                }
+                printf("Added sound %s as %s\n", info_str, name);
+            break;
+            case LEVELPACK_INFO:
+                if (get_level_pack(assets, name) == NULL)
+                {
+                    printf("Unable to add level pack at line %lu\n", line_num);
                     break;
-                    case EMITTER_INFO:
-                    {
-                        EmitterConfig_t parsed_conf;
-                        if (!parse_emitter_info(info_str, &parsed_conf))
-                        {
-                            printf("Parse error for emitter %s", name);
-                            break;
-                        }
-                        EmitterConfig_t* conf = add_emitter_conf(assets, name);
-                        *conf = parsed_conf;
-                        printf("Added Emitter %s\n", name);
-                    }
+                }
+                printf("Added level pack %s as %s\n", info_str, name);
+            break;
+            case SPRITE_INFO:
+            {
+                SpriteRecord_t record;
+                if (!parse_sprite_record(name, info_str, &record))
+                {
+                    printf("Unable to parse info for sprite at line %lu\n", line_num);
                     break;
-                    default:
+                }
+                add_a_sprite(assets, &record);
+            }
+            break;
+            case EMITTER_INFO:
+            {
+                EmitterRecord_t record;
+                if (!parse_emitter_record(name, info_str, &record))
+                {
+                    printf("Parse error for emitter %s\n", name);
                     break;
                 }
+                add_an_emitter(assets, &record);
             }
-            line_num++; 
+            break;
+            default:
+            break;
         }
-        fclose(in_file);
-        okay = true;
     }
-    rresUnloadResourceChunk(chunk);
-    rresUnloadCentralDirectory(rres_file.dir);
+}
+
+static bool get_rres_manifest(RresFileInfo_t* rres_file, AssetManifest_t* manifest)
+{
+    RresChunkView_t chunk;
+    if (
+        !get_rres_chunk(rres_file, ASSET_MANIFEST_NAME, &chunk)
+        || !read_asset_manifest(chunk.raw, chunk.size, manifest)
+    )
+    {
+        printf("No valid asset manifest in %s\n", rres_file->fname);
+        return false;
+    }
+    return true;
+}
+
+static void queue_manifest_files(const AssetManifest_t* manifest, RresFileInfo_t* rres_file)
+{
+    // Optional, the packer only makes one if there are sprite sheets
+    queue_texture_atlas_load_rres(&load_batch, "atlas.rects", rres_file);
+
+    FileRecord_t record;
+    for (uint16_t i = 0; i < manifest->header.n_files; ++i)
+    {
+        get_manifest_file(manifest, i, &record);
+        switch(record.type)
+        {
+            case ASSET_LOAD_TEXTURE:
+                // Sprite sheets in the atlas have no chunk of their own
+                queue_texture_load_rres(&load_batch, record.name, record.path, rres_file);
+            break;
+            case ASSET_LOAD_LEVELPACK:
+                queue_level_pack_load_rres(&load_batch, record.name, record.path, rres_file);
+            break;
+            case ASSET_LOAD_SOUND:
+                queue_sound_load_rres(&load_batch, record.name, record.path, rres_file);
+            break;
+            default:
+            break;
+        }
+    }
+}
+
+// Sprites and emitters, once the queued assets have their slots
+static void add_manifest_entries(const AssetManifest_t* manifest, Assets_t* assets)
+{
+    SpriteRecord_t spr_record;
+    for (uint16_t i = 0; i < manifest->header.n_sprites; ++i)
+    {
+        get_manifest_sprite(manifest, i, &spr_record);
+        add_a_sprite(assets, &spr_record);
+    }
+    EmitterRecord_t emitter_record;
+    for (uint16_t i = 0; i < manifest->header.n_emitters; ++i)
+    {
+        get_manifest_emitter(manifest, i, &emitter_record);
+        add_an_emitter(assets, &emitter_record);
+    }
+}
+
+bool load_from_rres(const char* file, Assets_t* assets)
+{
+    RresFileInfo_t rres_file;
+    if (!open_rres_file(&rres_file, file)) return false;
+
+    AssetManifest_t manifest;
+    bool okay = get_rres_manifest(&rres_file, &manifest);
+    if (okay)
+    {
+        queue_manifest_files(&manifest, &rres_file);
+        // The chunks are read from the archive, so it must still be open
+        run_asset_load_batch(assets, &load_batch);
+        add_manifest_entries(&manifest, assets);
+    }
+    close_rres_file(&rres_file);
     return okay;
 }
 
@@ -236,103 +259,417 @@ bool load_from_infofile(const char* file, Assets_t* assets)
     }
     
     char buffer[256];
-    char* tmp;
+    char* name;
+    char* info_str;
     size_t line_num = 0;
     AssetInfoType_t info_type = INVALID_INFO;
-
-    while (true)
+    while (read_info_entry(in_file, buffer, &info_type, &name, &info_str, &line_num))
     {
-        tmp = fgets(buffer, 256, in_file);
-        if (tmp == NULL) break;
-        tmp[strcspn(tmp, "\r\n")] = '\0';
-
-        if (tmp[0] == '-')
+        switch(info_type)
         {
-            tmp++;
-            info_type = get_asset_type(tmp);
+            case TEXTURE_INFO:
+                queue_texture_load(&load_batch, name, info_str);
+            break;
+            case SOUND_INFO:
+                queue_sound_load(&load_batch, name, info_str);
+            break;
+            case LEVELPACK_INFO:
+                queue_level_pack_load(&load_batch, name, info_str);
+            break;
+            case FONT_INFO:
+            {
+                // Loaded straight to the GPU, nothing to decode
+                if (add_font(assets, name, info_str) == NULL)
+                {
+                    printf("Unable to add font at line %lu\n", line_num);
+                    break;
+                }
+                printf("Added font %s as %s\n", info_str, name);
+            }
+            break;
+            default:
+            break;
         }
-        else
+    }
+
+    run_asset_load_batch(assets, &load_batch);
+    add_info_entries(in_file, assets);
+    fclose(in_file);
+    return true;
+}
+
+// Kept open while the queued chunks are read in the background
+static RresFileInfo_t loading_rres;
+static bool is_loading = false;
+
+// Sprites are loaded with the texture they are on
+static void prioritise_info_entries(FILE* in_file, const char** first, uint8_t n_first)
+{
+    char buffer[256];
+    char* name;
+    char* info_str;
+    size_t line_num = 0;
+    AssetInfoType_t info_type = INVALID_INFO;
+
+    rewind(in_file);
+    while (read_info_entry(in_file, buffer, &info_type, &name, &info_str, &line_num))
+    {
+        for (uint8_t i = 0; i < n_first; ++i)
         {
-            char* name = strtok(buffer, ":");
-            char* info_str = strtok(NULL, ":");
-            if (name == NULL || info_str == NULL) continue;
+            if (strcmp(name, first[i]) != 0) continue;
+
+            const char* asset_name = (info_type == SPRITE_INFO) ? strtok(info_str, ",") : name;
+            if (asset_name == NULL) break;
+            set_asset_load_priority(
+                &load_batch, find_asset_load(&load_batch, asset_name),
+                ASSET_LOAD_PRIORITY_HIGH
+            );
+            break;
+        }
+    }
+}
 
-            while(*name == ' ' || *name == '\t') name++;
-            while(*info_str == ' ' || *info_str == '\t') info_str++;
-            switch(info_type)
+static void queue_info_entries(FILE* in_file, Assets_t* assets)
+{
+    char buffer[256];
+    char* name;
+    char* info_str;
+    size_t line_num = 0;
+    AssetInfoType_t info_type = INVALID_INFO;
+
+    rewind(in_file);
+    while (read_info_entry(in_file, buffer, &info_type, &name, &info_str, &line_num))
+    {
+        switch(info_type)
+        {
+            case TEXTURE_INFO:
+                queue_texture_load(&load_batch, name, info_str);
+            break;
+            case SOUND_INFO:
+                queue_sound_load(&load_batch, name, info_str);
+            break;
+            case LEVELPACK_INFO:
+                queue_level_pack_load(&load_batch, name, info_str);
+            break;
+            case FONT_INFO:
             {
-                case TEXTURE_INFO:
-                {
-                    if (add_texture(assets, name, info_str) == NULL)
-                    {
-                        printf("Unable to add texture at line %lu\n", line_num);
-                        break;
-                    }
-                    printf("Added texture %s as %s\n", info_str, name);
-                }
-                break;
-                case SOUND_INFO:
+                // Fonts are small, and needed by the first scene
+                if (add_font(assets, name, info_str) == NULL)
                 {
-                    if (add_sound(assets, name, info_str) == NULL)
-                    {
-                        printf("Unable to add sound at line %lu\n", line_num);
-                        break;
-                    }
-                    printf("Added sound %s as %s\n", info_str, name);
+                    printf("Unable to add font at line %lu\n", line_num);
+                    break;
                 }
-                break;
-                case FONT_INFO:
+                printf("Added font %s as %s\n", info_str, name);
+            }
+            break;
+            default:
+            break;
+        }
+    }
+}
+
+// Sprites are loaded with the texture they are on
+static void prioritise_manifest_entries(const AssetManifest_t* manifest, const char** first, uint8_t n_first)
+{
+    SpriteRecord_t record;
+    for (uint8_t i = 0; i < n_first; ++i)
+    {
+        const char* asset_name = first[i];
+        for (uint16_t j = 0; j < manifest->header.n_sprites; ++j)
+        {
+            get_manifest_sprite(manifest, j, &record);
+            if (strcmp(record.name, first[i]) != 0) continue;
+
+            asset_name = record.tex;
+            break;
+        }
+        set_asset_load_priority(
+            &load_batch, find_asset_load(&load_batch, asset_name),
+            ASSET_LOAD_PRIORITY_HIGH
+        );
+    }
+}
+
+static bool start_loading(FILE* in_file, Assets_t* assets, const char** first, uint8_t n_first)
+{
+    queue_info_entries(in_file, assets);
+    prioritise_info_entries(in_file, first, n_first);
+    if (!start_asset_load_batch(assets, &load_batch)) return false;
+
+    // The assets have their slots now, so sprites can refer to them
+    add_info_entries(in_file, assets);
+    is_loading = true;
+    return true;
+}
+
+bool start_loading_from_rres(const char* file, Assets_t* assets, const char** first, uint8_t n_first)
+{
+    if (is_loading) return false;
+    if (!open_rres_file(&loading_rres, file)) return false;
+
+    AssetManifest_t manifest;
+    bool okay = get_rres_manifest(&loading_rres, &manifest);
+    if (okay)
+    {
+        queue_manifest_files(&manifest, &loading_rres);
+        prioritise_manifest_entries(&manifest, first, n_first);
+        okay = start_asset_load_batch(assets, &load_batch);
+    }
+    if (!okay)
+    {
+        close_rres_file(&loading_rres);
+        return false;
+    }
+
+    add_manifest_entries(&manifest, assets);
+    is_loading = true;
+    return true;
+}
+
+bool start_loading_from_infofile(const char* file, Assets_t* assets, const char** first, uint8_t n_first)
+{
+    if (is_loading) return false;
+
+    FILE* in_file = fopen(file, "r");
+    if (in_file == NULL)
+    {
+        printf("Unable to open file %s\n", file);
+        return false;
+    }
+    bool okay = start_loading(in_file, assets, first, n_first);
+    fclose(in_file);
+    return okay;
+}
+
+static void end_loading(void)
+{
+    // No-op if loading from the info file
+    close_rres_file(&loading_rres);
+    is_loading = false;
+}
+
+bool update_asset_loading(Assets_t* assets)
+{
+    if (!is_loading) return true;
+    if (update_asset_load_batch(assets) > 0) return false;
+
+    end_loading();
+    return true;
+}
+
+void finish_asset_loading(Assets_t* assets)
+{
+    if (!is_loading) return;
+    finish_asset_load_batch(assets);
+    end_loading();
+}
+
+bool on_asset_loaded(const char* name, AssetLoadedFunc_t on_loaded, void* user_data)
+{
+    AssetHandle_t handle = find_asset_load(&load_batch, name);
+    if (handle == INVALID_ASSET_HANDLE) return false;
+
+    set_asset_load_callback(&load_batch, handle, on_loaded, user_data);
+    return true;
+}
+
+bool is_asset_ready(const char* name)
+{
+    // Not in the batch means it is not waiting to be loaded
+    AssetHandle_t handle = find_asset_load(&load_batch, name);
+    return handle == INVALID_ASSET_HANDLE || is_asset_loaded(&load_batch, handle);
+}
+
+#define MAX_WATCHED_FILES (MAX_TEXTURES + MAX_LEVEL_PACK + 4)
+typedef struct WatchedFile
+{
+    // Textures and level packs are reloaded by name, anything else by the function
+    AssetInfoType_t type;
+    char name[MAX_NAME_LEN];
+    char path[256];
+    AssetFileReloadFunc_t on_change;
+}WatchedFile_t;
+
+static struct AssetWatch
+{
+    FileWatch_t watch;
+    WatchedFile_t files[MAX_WATCHED_FILES];
+    uint8_t n_files;
+    bool started;
+}asset_watch;
+
+static WatchedFile_t* find_watched_file(AssetInfoType_t type, const char* name)
+{
+    for (uint8_t i = 0; i < asset_watch.n_files; ++i)
+    {
+        WatchedFile_t* file = asset_watch.files + i;
+        if (file->type != type) continue;
+        // Other files are only known by their path
+        if (strcmp((type == INVALID_INFO) ? file->path : file->name, name) == 0) return file;
+    }
+    return NULL;
+}
+
+static WatchedFile_t* watch_path(AssetInfoType_t type, const char* name, const char* path)
+{
+    if (!asset_watch.started)
+    {
+        if (!init_file_watch(&asset_watch.watch)) return NULL;
+        asset_watch.started = true;
+    }
+
+    WatchedFile_t* file = find_watched_file(type, name);
+    if (file == NULL)
+    {
+        if (asset_watch.n_files == MAX_WATCHED_FILES) return NULL;
+        file = asset_watch.files + asset_watch.n_files++;
+        memset(file, 0, sizeof(WatchedFile_t));
+        file->type = type;
+        strncpy(file->name, name, MAX_NAME_LEN - 1);
+    }
+    strncpy(file->path, path, sizeof(file->path) - 1);
+
+    char dir[256] = ".";
+    const char* slash = strrchr(path, '/');
+    if (slash != NULL && (size_t)(slash - path) < sizeof(dir))
+    {
+        memcpy(dir, path, slash - path);
+        dir[slash - path] = '\0';
+    }
+    add_file_watch_dir(&asset_watch.watch, dir);
+    return file;
+}
+
+// Add what is new, and reload what has moved to another file
+static bool reload_infofile(const char* path, Assets_t* assets)
+{
+    FILE* in_file = fopen(path, "r");
+    if (in_file == NULL) return false;
+
+    char buffer[256];
+    char* name;
+    char* info_str;
+    size_t line_num = 0;
+    AssetInfoType_t info_type = INVALID_INFO;
+    while (read_info_entry(in_file, buffer, &info_type, &name, &info_str, &line_num))
+    {
+        switch(info_type)
+        {
+            case TEXTURE_INFO:
+            case LEVELPACK_INFO:
+            {
+                WatchedFile_t* file = find_watched_file(info_type, name);
+                bool moved = file != NULL && strcmp(file->path, info_str) != 0;
+                if (info_type == TEXTURE_INFO)
                 {
-                    if (add_font(assets, name, info_str) == NULL)
-                    {
-                        printf("Unable to add font at line %lu\n", line_num);
-                        break;
-                    }
-                    printf("Added font %s as %s\n", info_str, name);
+                    if (get_texture(assets, name) == NULL) add_texture(assets, name, info_str);
+                    else if (moved) reload_texture(assets, name, info_str);
                 }
-                break;
-                case LEVELPACK_INFO:
+                else
                 {
-                    //if (add_level_pack(assets, name, info_str) == NULL)
-                    if (uncompress_level_pack(assets, name, info_str) == NULL)
-                    {
-                        printf("Unable to add level pack at line %lu\n", line_num);
-                        break;
-                    }
-                    printf("Added level pack %s as %s\n", info_str, name);
+                    if (get_level_pack(assets, name) == NULL) uncompress_level_pack(assets, name, info_str);
+                    else if (moved) reload_level_pack(assets, name, info_str);
                 }
-                break;
-                case SPRITE_INFO:
+                watch_path(info_type, name, info_str);
+            }
+            break;
+            case SOUND_INFO:
+                if (get_sound(assets, name) == NULL) add_sound(assets, name, info_str);
+            break;
+            case FONT_INFO:
+                if (get_font(assets, name) == NULL) add_font(assets, name, info_str);
+            break;
+            case SPRITE_INFO:
+            {
+                SpriteRecord_t record;
+                if (!parse_sprite_record(name, info_str, &record))
                 {
-                    SpriteInfo_t spr_info = {0};
-                    if (!parse_sprite_info(info_str, &spr_info))
-                    {
-                        printf("Unable to parse info for sprite at line %lu\n", line_num);
-                        break;
-                    }
-                    //printf("Compare %s,%s = %d\n", tmp2, spr_info.tex, strcmp(tmp2, spr_info.tex));
-                    add_a_sprite(assets, &spr_info, name);
+                    printf("Unable to parse info for sprite at line %lu\n", line_num);
+                    break;
                 }
-                break;
-                case EMITTER_INFO:
+                add_a_sprite(assets, &record);
+            }
+            break;
+            case EMITTER_INFO:
+            {
+                EmitterRecord_t record;
+                if (!parse_emitter_record(name, info_str, &record))
                 {
-                    EmitterConfig_t parsed_conf;
-                    if (!parse_emitter_info(info_str, &parsed_conf))
-                    {
-                        printf("Parse error for emitter %s", name);
-                        break;
-                    }
-                    EmitterConfig_t* conf = add_emitter_conf(assets, name);
-                    *conf = parsed_conf;
-                    printf("Added Emitter %s\n", name);
+                    printf("Parse error for emitter %s\n", name);
+                    break;
                 }
-                break;
-                default:
-                break;
+                add_an_emitter(assets, &record);
             }
+            break;
+            default:
+            break;
         }
-        line_num++; 
     }
     fclose(in_file);
     return true;
 }
+
+bool watch_infofile(const char* file, Assets_t* assets)
+{
+    if (!watch_asset_file(file, &reload_infofile)) return false;
+    // Only picks up the paths, as everything is loaded already
+    return reload_infofile(file, assets);
+}
+
+bool watch_asset_file(const char* file, AssetFileReloadFunc_t on_change)
+{
+    WatchedFile_t* watched = watch_path(INVALID_INFO, file, file);
+    if (watched == NULL) return false;
+    watched->on_change = on_change;
+    return true;
+}
+
+uint8_t update_asset_watch(Assets_t* assets)
+{
+    // Reloading assets that are still loading would race with it
+    if (!asset_watch.started || is_loading) return 0;
+
+    // A save may give more than one event, reload once per frame
+    bool changed[MAX_WATCHED_FILES] = {0};
+    char path[512];
+    while (poll_file_watch(&asset_watch.watch, path, sizeof(path)))
+    {
+        const char* rel_path = (strncmp(path, "./", 2) == 0) ? path + 2 : path;
+        for (uint8_t i = 0; i < asset_watch.n_files; ++i)
+        {
+            if (strcmp(asset_watch.files[i].path, rel_path) == 0) changed[i] = true;
+        }
+    }
+
+    uint8_t n_reloaded = 0;
+    for (uint8_t i = 0; i < asset_watch.n_files; ++i)
+    {
+        if (!changed[i]) continue;
+
+        WatchedFile_t* file = asset_watch.files + i;
+        bool okay = false;
+        switch (file->type)
+        {
+            case TEXTURE_INFO:
+                okay = reload_texture(assets, file->name, file->path);
+            break;
+            case LEVELPACK_INFO:
+                okay = reload_level_pack(assets, file->name, file->path);
+            break;
+            default:
+                okay = file->on_change(file->path, assets);
+            break;
+        }
+        printf("%s %s\n", okay ? "Reloaded" : "Unable to reload", file->path);
+        if (okay) n_reloaded++;
+    }
+    return n_reloaded;
+}
+
+void stop_asset_watch(void)
+{
+    if (!asset_watch.started) return;
+    free_file_watch(&asset_watch.watch);
+    asset_watch.n_files = 0;
+    asset_watch.started = false;
+}
@@ -7,4 +7,26 @@
 bool load_from_infofile(const char* file, Assets_t* assets);
 bool load_from_rres(const char* file, Assets_t* assets);
 
+// Load in the background, with the named assets first. Sprites and
+// emitters are added straight away, the rest are empty until loaded
+bool start_loading_from_infofile(const char* file, Assets_t* assets, const char** first, uint8_t n_first);
+bool start_loading_from_rres(const char* file, Assets_t* assets, const char** first, uint8_t n_first);
+// Call once per frame, true once everything is loaded
+bool update_asset_loading(Assets_t* assets);
+void finish_asset_loading(Assets_t* assets);
+// Called from update_asset_loading, false if the asset is not being loaded
+bool on_asset_loaded(const char* name, AssetLoadedFunc_t on_loaded, void* user_data);
+bool is_asset_ready(const char* name);
+
+// For development. Reload the assets when their files are written, keeping
+// the pointers to them the same. Textures and level packs named in the
+// info file are reloaded, and so is the info file itself, which changes
+// the sprites and emitters in place and adds what is new
+typedef bool (*AssetFileReloadFunc_t)(const char* path, Assets_t* assets);
+bool watch_infofile(const char* file, Assets_t* assets);
+bool watch_asset_file(const char* file, AssetFileReloadFunc_t on_change);
+// Call once per frame, gives the number of files reloaded
+uint8_t update_asset_watch(Assets_t* assets);
+void stop_asset_watch(void);
+
 #endif // __ASSETS_LOADER_H
@@ -40,6 +40,31 @@ typedef enum SFXTag {
     COIN_SFX,
 } SFXTag_t;
 
+// Assets used while the game runs, looked up by tag instead of by name
+typedef enum SpriteTag {
+    LADDER_PARTICLE_SPR = 0,
+    WOOD_PARTICLE_SPR,
+    SPIKE_PARTICLE_SPR,
+    METAL_PARTICLE_SPR,
+    ROCK_PARTICLE_SPR,
+    COIN_PARTICLE_SPR,
+    ARROW_PARTICLE_SPR,
+    URCHIN_PARTICLE_SPR,
+    WATER_PARTICLE_SPR,
+    BIG_BUBBLE_SPR,
+    EYE_SPR,
+    CHEST_SPR,
+    N_SPRITE_TAGS,
+} SpriteTag_t;
+
+typedef enum EmitterTag {
+    BURST_EMITTER = 0,
+    SINGLE_EMITTER,
+    BUBBLING_EMITTER,
+    SLOW_EMITTER,
+    N_EMITTER_TAGS,
+} EmitterTag_t;
+
 typedef enum SceneType {
     MAIN_MENU_SCENE = 0,
     LEVEL_SELECT_SCENE,
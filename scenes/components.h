@@ -100,16 +100,9 @@ typedef struct _CAirTimer_t {
 typedef struct _BFSTile {
     int32_t to;
     int32_t from;
-    bool reachable;
+    int32_t depth; // Steps from the search root, used for path tracing
 }BFSTile_t;
 
-typedef struct _BFSTileMap {
-    BFSTile_t* tilemap;
-    int32_t width;
-    int32_t height;
-    int32_t len;
-}BFSTileMap_t;
-
 typedef enum _WaterRunnerState
 {
     BFS_RESET = 0,
@@ -119,13 +112,25 @@ typedef enum _WaterRunnerState
     REACHABILITY_SEARCH,
     SCANLINE_FILL,
     FILL_COMPLETE,
+    RUNNER_MERGED,
 }WaterRunerState_t;
 
+#define MAX_WATER_RUNNERS 32
+
 typedef struct _CWaterRunner {
-    BFSTileMap_t bfs_tilemap;
+    struct WaterSolver* solver;
     WaterRunerState_t state;
     struct sc_queue_32 bfs_queue;
-    bool* visited;
+    // Reachable tiles not yet known to be full, lowest row first
+    struct sc_heap lowest_heap;
+    // A tile is reachable if its stamp in the solver matches this
+    // Taking a new stamp invalidates the search without clearing
+    uint32_t bfs_epoch;
+    uint32_t visit_seq;
+    bool reroot;
+    uint8_t slot;
+    uint8_t n_sources; // Number of runners merged into this one, including itself
+    int8_t contact_slot; // Another runner search that this one ran into
     int32_t current_tile;
     int32_t target_tile;
     int32_t fill_idx;
@@ -50,6 +50,14 @@
 
 #define MAX_LEVEL_NUM 50
 
+// Level flags. The lower byte selects the solid tileset
+#define LEVEL_TILESET_MASK 0x00FF
+#define LEVEL_FLAG_CELLULAR_WATER (1 << 8)
+
+// Bits of the tilemap dirty chunks, one per chunk cache
+#define CHUNK_DIRTY_WATER (1 << 0)
+#define CHUNK_DIRTY_TILES (1 << 1)
+
 static const uint8_t CONNECTIVITY_TILE_MAPPING[16] = {
     0,3,15,14,
     1,2,12,13,
@@ -2,16 +2,27 @@
 #include "scene_impl.h"
 #include "game_systems.h"
 #include "water_flow.h"
+#include "water_render.h"
 #include "constants.h"
 #include "ent_impl.h"
 #include "mempool.h"
 #include "raylib.h"
 #include "raymath.h"
 #include "AABB.h"
+#include "rewind.h"
 #include <stdio.h>
 
 static Tile_t all_tiles[MAX_N_TILES] = {0};
 
+// Up to 30 seconds of play at 60 FPS, as MAX_REWIND_FRAMES caps it
+#define REWIND_BUDGET (4 * 1024 * 1024)
+#define REWIND_KEYFRAME_INTERVAL 120
+static RewindBuffer_t rewind_buffer;
+static uint8_t* rewind_state = NULL;
+static uint32_t rewind_state_capacity = 0;
+static bool rewinding = false;
+static struct sc_array_systems simulation_systems;
+
 enum EntitySpawnSelection {
     TOGGLE_TILE = 0,
     TOGGLE_ONEWAY,
@@ -140,7 +151,7 @@ static void level_scene_render_func(Scene_t* scene)
             selection_rec.x + current_spawn_selection * SELECTION_TILE_SIZE, selection_rec.y,
             SELECTION_TILE_SIZE, SELECTION_TILE_SIZE, GREEN
         );
-        DrawText("R to reset the map, Q/E to cycle the selection,\nF to toggle metal crates. T to toggle crate spawn behaviour\nZ to change tileset, X to toggle grid\nC to set spawn point, V to toggle free cam, B to toggle slowmo", selection_rec.x, selection_rec.y + selection_rec.height + 2, 14, BLACK);
+        DrawText("R to reset the map, Q/E to cycle the selection,\nF to toggle metal crates. T to toggle crate spawn behaviour\nZ to change tileset, X to toggle grid\nC to set spawn point, V to toggle free cam, B to toggle slowmo\nHold G to rewind", selection_rec.x, selection_rec.y + selection_rec.height + 2, 14, BLACK);
 
         draw_pos.x = game_rec.x + (MAX_SPAWN_TYPE + 1) * SELECTION_TILE_SIZE;
         sprintf(buffer, "%s", get_spawn_selection_string(current_spawn_selection));
@@ -347,10 +358,12 @@ static void render_editor_game_scene(Scene_t* scene)
         add_render_node(&data->render_manager, &p_cspr->node, p_cspr->depth);
     }
 
-    Texture2D* bg = get_texture(&scene->engine->assets, "bg_tex");
+    TileArea_t view = {min.x, min.y, max.x - 1, max.y - 1};
+    update_water_layer(data->water_layer, &data->tilemap, view);
+
     BeginTextureMode(scene->layers.render_layers[GAME_LAYER].layer_tex);
         ClearBackground(WHITE);
-        DrawTexturePro(*bg,
+        DrawTexturePro(*data->bg_tex,
             //(Rectangle){0,0,64,64},
             (Rectangle){min.x,0,(tilemap.width+1)*tilemap.tile_size*2, (tilemap.height+1)*tilemap.tile_size*2},
             (Rectangle){0,0,(tilemap.width+1)*tilemap.tile_size*2, (tilemap.height+1)*tilemap.tile_size*2},
@@ -576,36 +589,6 @@ static void render_editor_game_scene(Scene_t* scene)
                     }
                 }
 
-                if (tilemap.tiles[i].wet)
-                {
-#define     SURFACE_THICKNESS 4
-                    int up = i - tilemap.width;
-                    unsigned int bot = i + tilemap.width;
-                    int right = i + 1;
-                    int left = i - 1;
-                    int bot_line = y + TILE_SIZE - tilemap.tiles[i].water_level * WATER_BBOX_STEP - SURFACE_THICKNESS / 2;
-                    if (up >= 0 && tilemap.tiles[up].wet)
-                    {
-                        DrawLineEx((Vector2){x + TILE_SIZE / 2, y}, (Vector2){x + TILE_SIZE / 2, y + TILE_SIZE - tilemap.tiles[i].water_level * WATER_BBOX_STEP}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
-                    }
-
-
-                    if (
-                        bot <= tilemap.n_tiles
-                        && tilemap.tiles[i].water_level == 0
-                        )
-                    {
-                        if (i % tilemap.width != 0 && tilemap.tiles[left].wet && (tilemap.tiles[bot].solid == SOLID || tilemap.tiles[bot-1].solid == SOLID))
-                        {
-                            DrawLineEx((Vector2){x, bot_line}, (Vector2){x + TILE_SIZE / 2, bot_line}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
-                        }
-                        if (right % tilemap.width != 0 && tilemap.tiles[right].wet && (tilemap.tiles[bot].solid == SOLID || tilemap.tiles[bot+1].solid == SOLID))
-                        {
-                            DrawLineEx((Vector2){x + TILE_SIZE / 2, bot_line}, (Vector2){x + TILE_SIZE, bot_line}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
-                        }
-                    }
-                }
-
                 if (tilemap.tiles[i].max_water_level < MAX_WATER_LEVEL)
                 {
                     DrawRectangleLinesEx((Rectangle){x, y, TILE_SIZE, TILE_SIZE}, 2.0, ColorAlpha(BLUE, 0.5));
@@ -615,26 +598,7 @@ static void render_editor_game_scene(Scene_t* scene)
 
         draw_particle_system(&scene->part_sys);
 
-        // Draw water tile
-        for (int tile_y = min.y; tile_y < max.y; tile_y++)
-        {
-            for (int tile_x = min.x; tile_x < max.x; tile_x++)
-            {
-                int i = tile_x + tile_y * tilemap.width;
-                int x = tile_x * TILE_SIZE;
-                int y = tile_y * TILE_SIZE;
-
-                uint32_t water_height = tilemap.tiles[i].water_level * WATER_BBOX_STEP;
-                Color water_colour = ColorAlpha(BLUE, 0.5);
-                DrawRectangle(
-                    x,
-                    y + (TILE_SIZE - water_height),
-                    TILE_SIZE,
-                    water_height,
-                    water_colour
-                );
-            }
-        }
+        draw_water_layer(data->water_layer, &data->tilemap, view);
 
         if (data->show_grid)
         {
@@ -677,7 +641,7 @@ static void render_editor_game_scene(Scene_t* scene)
         {
             CAirTimer_t* p_air = get_component(p_ent, CAIRTIMER_T);
 
-            Sprite_t* spr = get_sprite(&scene->engine->assets, "p_bigbubble");
+            Sprite_t* spr = get_tagged_sprite(&scene->engine->assets, BIG_BUBBLE_SPR);
             Vector2 air_pos = {data->game_rec.width - 32, data->game_rec.height - 32};
             for (uint8_t i = 0; i < p_air->curr_count; i++)
             {
@@ -817,7 +781,7 @@ static void toggle_block_system(Scene_t* scene, ActionType_t action, bool presse
                 break;
                 case SPAWN_WATER_RUNNER:
                 {
-                    Entity_t* p_ent = create_water_runner(&scene->ent_manager, DEFAULT_MAP_WIDTH, DEFAULT_MAP_HEIGHT, tile_idx);
+                    Entity_t* p_ent = create_water_runner(&scene->ent_manager, data->water_solver, tile_idx);
                     if (p_ent != NULL)
                     {
                         p_ent->position.x = (tile_idx % tilemap.width) * tilemap.tile_size;
@@ -858,17 +822,20 @@ static void toggle_block_system(Scene_t* scene, ActionType_t action, bool presse
                     }
                 break;
             }
-            change_a_tile(&tilemap, tile_idx, new_type);
+            bool basin_changed = change_a_tile(&tilemap, tile_idx, new_type);
             last_tile_idx = tile_idx;
-            CWaterRunner_t* p_crunner;
-            sc_map_foreach_value(&scene->ent_manager.component_map[CWATERRUNNER_T], p_crunner)
+            if (basin_changed || sel == TOGGLE_WATER || sel == TOGGLE_AIR_POCKET)
             {
-                p_crunner->state = BFS_RESET;
+                reset_water_basins(data->water_solver);
             }
         }
         else if (action == ACTION_REMOVE_TILE && pressed)
         {
-            change_a_tile(&tilemap, tile_idx, EMPTY_TILE);
+            bool basin_changed = change_a_tile(&tilemap, tile_idx, EMPTY_TILE);
+            if (basin_changed || tilemap.tiles[tile_idx].water_level > 0)
+            {
+                reset_water_basins(data->water_solver);
+            }
             tilemap.tiles[tile_idx].water_level = 0;
 
             Entity_t* ent;
@@ -946,6 +913,7 @@ static void restart_editor_level(Scene_t* scene)
         tilemap.tiles[i].size = (Vector2){TILE_SIZE, TILE_SIZE};
 
     }
+    reset_tilemap_chunks(&data->tilemap);
     clear_all_game_entities(CONTAINER_OF(scene, LevelScene_t, scene));
 
     Entity_t* p_player = create_player(&scene->ent_manager);
@@ -964,6 +932,47 @@ static void restart_editor_level(Scene_t* scene)
     }
 }
 
+static void simulation_system(Scene_t* scene)
+{
+    // Nothing may move or play sounds from a state that is about to be replaced
+    if (rewinding) return;
+
+    system_func_t sys;
+    sc_array_foreach(&simulation_systems, sys)
+    {
+        sys(scene);
+    }
+}
+
+// Runs after the update. While rewinding, there is no update,
+// and the state goes back to the one of the previous frame instead
+static void rewind_system(Scene_t* scene)
+{
+    LevelScene_t* level_scene = CONTAINER_OF(scene, LevelScene_t, scene);
+    if (rewinding)
+    {
+        uint32_t size;
+        const uint8_t* state = get_rewind_frame(&rewind_buffer, 0, &size);
+        if (state == NULL) return;
+
+        load_level_state(level_scene, state, size);
+        // Stay on the oldest frame
+        if (rewind_buffer.count > 1) drop_rewind_frames(&rewind_buffer, 1);
+        return;
+    }
+
+    uint32_t size = get_level_state_size(level_scene);
+    if (size > rewind_state_capacity)
+    {
+        uint8_t* buf = realloc(rewind_state, size);
+        if (buf == NULL) return;
+        rewind_state = buf;
+        rewind_state_capacity = size;
+    }
+    size = save_level_state(level_scene, rewind_state, rewind_state_capacity);
+    if (size > 0) push_rewind_frame(&rewind_buffer, rewind_state, size);
+}
+
 static void level_do_action(Scene_t* scene, ActionType_t action, bool pressed)
 {
     LevelSceneData_t* data = &(CONTAINER_OF(scene, LevelScene_t, scene)->data);
@@ -1209,6 +1218,9 @@ static void level_do_action(Scene_t* scene, ActionType_t action, bool pressed)
                 data->camera.mode = (data->camera.mode == CAMERA_FOLLOW_PLAYER) ? CAMERA_RANGED_MOVEMENT : CAMERA_FOLLOW_PLAYER;
             }
         break;
+        case ACTION_REWIND:
+            rewinding = pressed;
+        break;
         default:
         break;
     }
@@ -1277,8 +1289,8 @@ void init_sandbox_scene(LevelScene_t* scene)
     scene->data.tile_sprites[SPIKES + TILE_180ROT] = get_sprite(&scene->scene.engine->assets, "u_spikes");
     scene->data.selected_solid_tilemap = 0;
     scene->data.solid_tile_sprites = get_sprite(&scene->scene.engine->assets, SOLID_TILE_SELECTIONS[0]);
-    Texture2D* tex = get_texture(&scene->scene.engine->assets, "bg_tex");
-    SetTextureWrap(*tex, TEXTURE_WRAP_REPEAT);
+    scene->data.bg_tex = acquire_texture(&scene->scene.engine->assets, "bg_tex");
+    SetTextureWrap(*scene->data.bg_tex, TEXTURE_WRAP_REPEAT);
 
     for (size_t i = 0; i < scene->data.tilemap.width; ++i)
     {
@@ -1502,35 +1514,41 @@ void init_sandbox_scene(LevelScene_t* scene)
 
 
     // insert level scene systems
-    sc_array_add(&scene->scene.systems, &player_movement_input_system);
-    sc_array_add(&scene->scene.systems, &player_bbox_update_system);
-    sc_array_add(&scene->scene.systems, &player_pushing_system);
-    sc_array_add(&scene->scene.systems, &friction_coefficient_update_system);
-    sc_array_add(&scene->scene.systems, &global_external_forces_system);
-
-    sc_array_add(&scene->scene.systems, &moveable_update_system);
-    sc_array_add(&scene->scene.systems, &movement_update_system);
-    sc_array_add(&scene->scene.systems, &boulder_destroy_wooden_tile_system);
-    sc_array_add(&scene->scene.systems, &update_tilemap_system);
-    sc_array_add(&scene->scene.systems, &tile_collision_system);
-    sc_array_add(&scene->scene.systems, &update_tilemap_system);
-    sc_array_add(&scene->scene.systems, &hitbox_update_system);
-    sc_array_add(&scene->scene.systems, &player_crushing_system);
-    sc_array_add(&scene->scene.systems, &spike_collision_system);
-    //sc_array_add(&scene->scene.systems, &edge_velocity_check_system);
-    sc_array_add(&scene->scene.systems, &state_transition_update_system);
-    sc_array_add(&scene->scene.systems, &update_entity_emitter_system);
-    sc_array_add(&scene->scene.systems, &player_ground_air_transition_system);
-    sc_array_add(&scene->scene.systems, &lifetimer_update_system);
-    sc_array_add(&scene->scene.systems, &airtimer_update_system);
-    sc_array_add(&scene->scene.systems, &container_destroy_system);
-    sc_array_add(&scene->scene.systems, &sprite_animation_system);
-    sc_array_add(&scene->scene.systems, &camera_update_system);
-    sc_array_add(&scene->scene.systems, &player_dir_reset_system);
-    sc_array_add(&scene->scene.systems, &update_water_runner_system);
-    sc_array_add(&scene->scene.systems, &check_player_dead_system);
-    sc_array_add(&scene->scene.systems, &level_end_detection_system);
-    sc_array_add(&scene->scene.systems, &level_state_management_system);
+    // These make up the simulation, which is held while rewinding
+    sc_array_init(&simulation_systems);
+    sc_array_add(&simulation_systems, &player_movement_input_system);
+    sc_array_add(&simulation_systems, &player_bbox_update_system);
+    sc_array_add(&simulation_systems, &player_pushing_system);
+    sc_array_add(&simulation_systems, &friction_coefficient_update_system);
+    sc_array_add(&simulation_systems, &global_external_forces_system);
+
+    sc_array_add(&simulation_systems, &moveable_update_system);
+    sc_array_add(&simulation_systems, &movement_update_system);
+    sc_array_add(&simulation_systems, &boulder_destroy_wooden_tile_system);
+    sc_array_add(&simulation_systems, &update_tilemap_system);
+    sc_array_add(&simulation_systems, &tile_collision_system);
+    sc_array_add(&simulation_systems, &update_tilemap_system);
+    sc_array_add(&simulation_systems, &hitbox_update_system);
+    sc_array_add(&simulation_systems, &player_crushing_system);
+    sc_array_add(&simulation_systems, &spike_collision_system);
+    //sc_array_add(&simulation_systems, &edge_velocity_check_system);
+    sc_array_add(&simulation_systems, &state_transition_update_system);
+    sc_array_add(&simulation_systems, &update_entity_emitter_system);
+    sc_array_add(&simulation_systems, &player_ground_air_transition_system);
+    sc_array_add(&simulation_systems, &lifetimer_update_system);
+    sc_array_add(&simulation_systems, &airtimer_update_system);
+    sc_array_add(&simulation_systems, &container_destroy_system);
+    sc_array_add(&simulation_systems, &sprite_animation_system);
+    sc_array_add(&simulation_systems, &camera_update_system);
+    sc_array_add(&simulation_systems, &player_dir_reset_system);
+    sc_array_add(&simulation_systems, &update_water_runner_system);
+    sc_array_add(&simulation_systems, &check_player_dead_system);
+    sc_array_add(&simulation_systems, &level_end_detection_system);
+    sc_array_add(&simulation_systems, &gameplay_event_system);
+    sc_array_add(&simulation_systems, &level_state_management_system);
+    sc_array_add(&simulation_systems, &entity_sync_system);
+    sc_array_add(&scene->scene.systems, &simulation_system);
+    sc_array_add(&scene->scene.systems, &rewind_system);
     sc_array_add(&scene->scene.systems, &render_editor_game_scene);
     sc_array_add(&scene->scene.systems, &level_scene_render_func);
 
@@ -1558,13 +1576,21 @@ void init_sandbox_scene(LevelScene_t* scene)
     sc_map_put_64(&scene->scene.action_map, KEY_C, ACTION_SET_SPAWNPOINT);
     sc_map_put_64(&scene->scene.action_map, KEY_V, ACTION_LOOKAHEAD);
     sc_map_put_64(&scene->scene.action_map, KEY_B, ACTION_TOGGLE_TIMESLOW);
+    sc_map_put_64(&scene->scene.action_map, KEY_G, ACTION_REWIND);
     sc_map_put_64(&scene->scene.action_map, MOUSE_LEFT_BUTTON, ACTION_SPAWN_TILE);
     sc_map_put_64(&scene->scene.action_map, MOUSE_RIGHT_BUTTON, ACTION_REMOVE_TILE);
 
+    init_rewind_buffer(&rewind_buffer, REWIND_BUDGET, REWIND_KEYFRAME_INTERVAL);
 }
 
 void free_sandbox_scene(LevelScene_t* scene)
 {
+    free_rewind_buffer(&rewind_buffer);
+    sc_array_term(&simulation_systems);
+    free(rewind_state);
+    rewind_state = NULL;
+    rewind_state_capacity = 0;
+    release_texture(&scene->scene.engine->assets, "bg_tex");
     clear_all_game_entities(scene);
     free_scene(&scene->scene);
     term_level_scene_data(&scene->data);
@@ -12,7 +12,7 @@ DEFINE_COMP_MEMPOOL_BUF(CHurtbox_t, MAX_COMP_POOL_SIZE)
 DEFINE_COMP_MEMPOOL_BUF(CSprite_t, MAX_COMP_POOL_SIZE)
 DEFINE_COMP_MEMPOOL_BUF(CMoveable_t, MAX_COMP_POOL_SIZE)
 DEFINE_COMP_MEMPOOL_BUF(CLifeTimer_t, MAX_COMP_POOL_SIZE)
-DEFINE_COMP_MEMPOOL_BUF(CWaterRunner_t, 32)
+DEFINE_COMP_MEMPOOL_BUF(CWaterRunner_t, MAX_WATER_RUNNERS)
 DEFINE_COMP_MEMPOOL_BUF(CAirTimer_t, 8)
 DEFINE_COMP_MEMPOOL_BUF(CEmitter_t, 32)
 DEFINE_COMP_MEMPOOL_BUF(CSquishable_t, MAX_COMP_POOL_SIZE)
@@ -4,7 +4,9 @@
 #include "components.h"
 
 bool init_player_creation(const char* info_file, Assets_t* assets);
-bool init_player_creation_rres(const char* rres_file, const char* file, Assets_t* assets);
+bool init_player_creation_rres(const char* rres_file, Assets_t* assets);
+// Read the info file again, for hot reloading
+bool reload_player_creation(const char* info_file, Assets_t* assets);
 Entity_t* create_player(EntityManager_t* ent_manager);
 Entity_t* create_dead_player(EntityManager_t* ent_manager);
 Entity_t* create_player_finish(EntityManager_t* ent_manager);
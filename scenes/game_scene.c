@@ -3,6 +3,8 @@
 #include "scene_impl.h"
 #include "game_systems.h"
 #include "water_flow.h"
+#include "water_render.h"
+#include "tile_render.h"
 #include "constants.h"
 #include "ent_impl.h"
 #include "mempool.h"
@@ -53,7 +55,7 @@ static void level_scene_render_func(Scene_t* scene)
         {
             CAirTimer_t* p_air = get_component(p_ent, CAIRTIMER_T);
 
-            Sprite_t* spr = get_sprite(&scene->engine->assets, "p_bigbubble");
+            Sprite_t* spr = get_tagged_sprite(&scene->engine->assets, BIG_BUBBLE_SPR);
             Vector2 air_pos = {data->game_rec.width - 32, data->game_rec.height - 32};
             for (uint8_t i = 0; i < p_air->curr_count; i++)
             {
@@ -74,7 +76,7 @@ static void level_scene_render_func(Scene_t* scene)
         DrawRectangle(0, 0, data->game_rec.width, 32, (Color){0,0,0,128});
         {
             DrawText("Z", 300, 5, 24, RED);
-            Sprite_t* spr = get_sprite(&scene->engine->assets, "eye");
+            Sprite_t* spr = get_tagged_sprite(&scene->engine->assets, EYE_SPR);
             if (data->camera.mode == CAMERA_RANGED_MOVEMENT)
             {
                 draw_sprite(spr, 1, (Vector2){332, 0}, 0, false);
@@ -89,7 +91,7 @@ static void level_scene_render_func(Scene_t* scene)
             sprintf(buffer, "%u / %u", data->coins.current, data->coins.total);
             gui_x = data->game_rec.width - MeasureText(buffer, 24) - 5;
             // TODO: Use the chest sprite
-            Sprite_t* spr = get_sprite(&scene->engine->assets, "chest");
+            Sprite_t* spr = get_tagged_sprite(&scene->engine->assets, CHEST_SPR);
             draw_sprite_pro(spr, 0, (Vector2){gui_x-32, 8}, 0, 0, (Vector2){0.5,0.5}, WHITE);
             DrawText(buffer, gui_x, 5, 24, RED);
         }
@@ -161,7 +163,6 @@ static void level_do_action(Scene_t* scene, ActionType_t action, bool pressed)
 static void render_regular_game_scene(Scene_t* scene)
 {
     TracyCZoneN(ctx, "GameRender", true)
-    update_entity_manager(&scene->ent_manager);
     // This function will render the game scene outside of the intended draw function
     // Just for clarity and separation of logic
     LevelSceneData_t* data = &(CONTAINER_OF(scene, LevelScene_t, scene)->data);
@@ -184,26 +185,10 @@ static void render_regular_game_scene(Scene_t* scene)
     max.y = (int)fmin(tilemap.height, max.y + 1);
 
     // Queue TileMap rendering
-    for (int tile_y = min.y; tile_y < max.y; tile_y++)
-    {
-        for (int tile_x = min.x; tile_x < max.x; tile_x++)
-        {
-
-            int i = tile_x + tile_y * tilemap.width;
-            // Tile render nodes is static on load and is not dynamically updated.
-            // We exploit the fact that all tiles can only change into an empty
-            // tile.
-            // This won't work if a tile can change into something else
-            if (tilemap.tiles[i].tile_type == EMPTY_TILE) continue;
-
-            uint8_t depth = 2;
-            if (tilemap.tiles[i].tile_type == LADDER)
-            {
-                depth = 0;
-            }
-            add_render_node(&data->render_manager, all_tile_rendernodes + i, depth);
-        }
-    }
+    // Tiles only change through change_a_tile, so they are cached per chunk
+    // and only the chunks with changed tiles are drawn again
+    TileArea_t view = {min.x, min.y, max.x - 1, max.y - 1};
+    queue_tile_layer(data->tile_layer, &data->tilemap, view, &data->render_manager);
 
     // Queue Sprite rendering
     unsigned int ent_idx;
@@ -257,11 +242,11 @@ static void render_regular_game_scene(Scene_t* scene)
         add_render_node(&data->render_manager, &p_cspr->node, p_cspr->depth);
     }
 
-    Texture2D* bg = get_texture(&scene->engine->assets, "bg_tex");
+    update_water_layer(data->water_layer, &data->tilemap, view);
 
     BeginTextureMode(scene->layers.render_layers[GAME_LAYER].layer_tex);
         ClearBackground(WHITE);
-        DrawTexturePro(*bg,
+        DrawTexturePro(*data->bg_tex,
             //(Rectangle){0,0,64,64},
             (Rectangle){min.x,0, data->game_rec.width, data->game_rec.height},
             (Rectangle){0,0, data->game_rec.width, data->game_rec.height},
@@ -436,61 +421,7 @@ static void render_regular_game_scene(Scene_t* scene)
         draw_particle_system(&scene->part_sys);
 
         // Render water
-        for (int tile_y = min.y; tile_y < max.y; tile_y++)
-        {
-            for (int tile_x = min.x; tile_x < max.x; tile_x++)
-            {
-                int i = tile_x + tile_y * tilemap.width;
-                if (!tilemap.tiles[i].wet && tilemap.tiles[i].water_level == 0) {
-                    continue;
-                }
-
-                int x = tile_x * TILE_SIZE;
-                int y = tile_y * TILE_SIZE;
-
-                // Draw water flow
-#define SURFACE_THICKNESS 4
-                int up = i - tilemap.width;
-                unsigned int bot = i + tilemap.width;
-                int right = i + 1;
-                int left = i - 1;
-                int bot_line = y + TILE_SIZE - tilemap.tiles[i].water_level * WATER_BBOX_STEP - SURFACE_THICKNESS / 2;
-                if (up >= 0 && tilemap.tiles[up].wet)
-                {
-                    DrawLineEx((Vector2){x + TILE_SIZE / 2, y}, (Vector2){x + TILE_SIZE / 2, y + TILE_SIZE - tilemap.tiles[i].water_level * WATER_BBOX_STEP}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
-                }
-
-                if (
-                    bot <= tilemap.n_tiles
-                    && tilemap.tiles[i].water_level == 0
-                    )
-                {
-                    if (i % tilemap.width != 0 && tilemap.tiles[left].wet && (tilemap.tiles[bot].solid == SOLID || tilemap.tiles[bot-1].solid == SOLID))
-                    {
-                        DrawLineEx((Vector2){x, bot_line}, (Vector2){x + TILE_SIZE / 2, bot_line}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
-                    }
-                    if (right % tilemap.width != 0 && tilemap.tiles[right].wet && (tilemap.tiles[bot].solid == SOLID || tilemap.tiles[bot+1].solid == SOLID))
-                    {
-                        DrawLineEx((Vector2){x + TILE_SIZE / 2, bot_line}, (Vector2){x + TILE_SIZE, bot_line}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
-                    }
-                }
-
-                //if (tilemap.tiles[i].max_water_level < MAX_WATER_LEVEL)
-                //{
-                //    DrawRectangleLinesEx((Rectangle){x, y, TILE_SIZE, TILE_SIZE}, 2.0, ColorAlpha(BLUE, 0.5));
-                //}
-
-                uint32_t water_height = tilemap.tiles[i].water_level * WATER_BBOX_STEP;
-                Color water_colour = ColorAlpha(BLUE, 0.5);
-                DrawRectangle(
-                    x,
-                    y + (TILE_SIZE - water_height),
-                    TILE_SIZE,
-                    water_height,
-                    water_colour
-                );
-            }
-        }
+        draw_water_layer(data->water_layer, &data->tilemap, view);
         EndMode2D();
     EndTextureMode();
     TracyCZoneEnd(ctx)
@@ -535,6 +466,7 @@ void init_game_scene(LevelScene_t* scene)
             VIEWABLE_MAP_WIDTH*TILE_SIZE, VIEWABLE_MAP_HEIGHT*TILE_SIZE
         }
     );
+    scene->data.bg_tex = acquire_texture(&scene->scene.engine->assets, "bg_tex");
     for (size_t i = 0; i < MAX_N_TILES; i++)
     {
         memset(all_tile_rendernodes + i, 0, sizeof(RenderInfoNode));
@@ -594,7 +526,9 @@ void init_game_scene(LevelScene_t* scene)
     sc_array_add(&scene->scene.systems, &update_water_runner_system);
     sc_array_add(&scene->scene.systems, &check_player_dead_system);
     sc_array_add(&scene->scene.systems, &level_end_detection_system);
+    sc_array_add(&scene->scene.systems, &gameplay_event_system);
     sc_array_add(&scene->scene.systems, &level_state_management_system);
+    sc_array_add(&scene->scene.systems, &entity_sync_system);
     sc_array_add(&scene->scene.systems, &render_regular_game_scene);
     sc_array_add(&scene->scene.systems, &level_scene_render_func);
     // This avoid graphical glitch, not essential
@@ -615,6 +549,8 @@ void init_game_scene(LevelScene_t* scene)
 
 void free_game_scene(LevelScene_t* scene)
 {
+    set_level_pack(scene, NULL);
+    release_texture(&scene->scene.engine->assets, "bg_tex");
     clear_all_game_entities(scene);
     free_scene(&scene->scene);
     term_level_scene_data(&scene->data);
@@ -5,6 +5,7 @@
 
 #include "scene_impl.h"
 #include "ent_impl.h"
+#include "water_flow.h"
 
 #include "particle_sys.h"
 #include "AABB.h"
@@ -22,6 +23,51 @@ bool check_in_water(const ParticleEmitter_t* emitter, float delta_time);
 static const Vector2 GRAVITY = {0, GRAV_ACCEL};
 static const Vector2 UPTHRUST = {0, -GRAV_ACCEL * 1.25};
 
+static const char* SPRITE_TAG_NAMES[N_SPRITE_TAGS] = {
+    [LADDER_PARTICLE_SPR] = "p_ladder",
+    [WOOD_PARTICLE_SPR] = "p_wood",
+    [SPIKE_PARTICLE_SPR] = "p_spike",
+    [METAL_PARTICLE_SPR] = "p_metal",
+    [ROCK_PARTICLE_SPR] = "p_rock",
+    [COIN_PARTICLE_SPR] = "p_coin",
+    [ARROW_PARTICLE_SPR] = "p_arrow",
+    [URCHIN_PARTICLE_SPR] = "p_urc",
+    [WATER_PARTICLE_SPR] = "p_water",
+    [BIG_BUBBLE_SPR] = "p_bigbubble",
+    [EYE_SPR] = "eye",
+    [CHEST_SPR] = "chest",
+};
+static const char* EMITTER_TAG_NAMES[N_EMITTER_TAGS] = {
+    [BURST_EMITTER] = "pe_burst",
+    [SINGLE_EMITTER] = "pe_single",
+    [BUBBLING_EMITTER] = "pe_bubbling",
+    [SLOW_EMITTER] = "pe_slow",
+};
+static AssetId_t sprite_ids[N_SPRITE_TAGS];
+static AssetId_t emitter_ids[N_EMITTER_TAGS];
+
+void init_game_asset_ids(Assets_t* assets)
+{
+    for (uint8_t i = 0; i < N_SPRITE_TAGS; ++i)
+    {
+        sprite_ids[i] = get_sprite_id(assets, SPRITE_TAG_NAMES[i]);
+    }
+    for (uint8_t i = 0; i < N_EMITTER_TAGS; ++i)
+    {
+        emitter_ids[i] = get_emitter_conf_id(assets, EMITTER_TAG_NAMES[i]);
+    }
+}
+
+Sprite_t* get_tagged_sprite(Assets_t* assets, SpriteTag_t tag)
+{
+    return get_sprite_by_id(assets, sprite_ids[tag]);
+}
+
+EmitterConfig_t* get_tagged_emitter_conf(Assets_t* assets, EmitterTag_t tag)
+{
+    return get_emitter_conf_by_id(assets, emitter_ids[tag]);
+}
+
 static inline unsigned int get_tile_idx(int x, int y, TileGrid_t gridmap)
 {
     unsigned int tile_x = x / gridmap.tile_size;
@@ -31,44 +77,18 @@ static inline unsigned int get_tile_idx(int x, int y, TileGrid_t gridmap)
 
 static inline void destroy_tile(LevelSceneData_t* lvl_data, unsigned int tile_idx)
 {
-    Scene_t* scene = &CONTAINER_OF(lvl_data, LevelScene_t, data)->scene;
     TileGrid_t tilemap = lvl_data->tilemap;
 
-    Sprite_t* spr = NULL;
-    switch (tilemap.tiles[tile_idx].tile_type)
-    {
-        case LADDER:
-            spr = get_sprite(&scene->engine->assets, "p_ladder");
-        break;
-        case ONEWAY_TILE:
-            spr = get_sprite(&scene->engine->assets, "p_wood");
-        break;
-        case SPIKES:
-            spr = get_sprite(&scene->engine->assets, "p_spike");
-        break;
-        default:
-        break;
-    }
+    Vector2 pos = {
+        .x = tile_idx % tilemap.width * tilemap.tile_size + (tilemap.tile_size >> 1),
+        .y = tile_idx / tilemap.width * tilemap.tile_size + (tilemap.tile_size >> 1),
+    };
+    push_event(&lvl_data->events, EVENT_TILE_DESTROYED, tilemap.tiles[tile_idx].tile_type, 0, pos);
 
-
-    if (spr != NULL)
+    if (change_a_tile(&tilemap, tile_idx, EMPTY_TILE))
     {
-        ParticleEmitter_t emitter = {
-            .spr = spr,
-            .config = get_emitter_conf(&scene->engine->assets, "pe_burst"),
-            .position = {
-                .x = tile_idx % tilemap.width * tilemap.tile_size + (tilemap.tile_size >> 1),
-                .y = tile_idx / tilemap.width * tilemap.tile_size + (tilemap.tile_size >> 1),
-            },
-            .n_particles = 5,
-            .user_data = CONTAINER_OF(lvl_data, LevelScene_t, data),
-            .update_func = &simple_particle_system_update,
-            .emitter_update_func = NULL,
-        };
-        play_particle_emitter(&scene->part_sys, &emitter);
+        reset_water_basins(lvl_data->water_solver);
     }
-
-    change_a_tile(&tilemap, tile_idx, EMPTY_TILE);
 }
 
 // ------------------------- Collision functions ------------------------------------
@@ -184,6 +204,7 @@ collision_end:
 
 static void destroy_entity(Scene_t* scene, TileGrid_t* tilemap, Entity_t* p_ent)
 {
+    LevelSceneData_t* data = &(CONTAINER_OF(scene, LevelScene_t, scene)->data);
     Vector2 half_size = {0,0};
     CBBox_t* p_bbox = get_component(p_ent, CBBOX_COMP_T);
     if (p_bbox != NULL)
@@ -191,87 +212,13 @@ static void destroy_entity(Scene_t* scene, TileGrid_t* tilemap, Entity_t* p_ent)
         half_size = p_bbox->half_size;
     }
 
-    if (p_ent->m_tag == BOULDER_ENT_TAG)
-    {
-        ParticleEmitter_t emitter = {
-            .spr = get_sprite(&scene->engine->assets, "p_rock"),
-            .config = get_emitter_conf(&scene->engine->assets, "pe_burst"),
-            .position = Vector2Add(p_ent->position, half_size),
-            .n_particles = 5,
-            .user_data = CONTAINER_OF(scene, LevelScene_t, scene),
-            .update_func = &simple_particle_system_update,
-            .emitter_update_func = NULL,
-        };
-        play_particle_emitter(&scene->part_sys, &emitter);
-        play_sfx(scene->engine, BOULDER_DESTROY_SFX);
-    }
-    else if (p_ent->m_tag == CRATES_ENT_TAG)
+    uint16_t material = WOODEN_CONTAINER;
+    const CContainer_t* p_container = get_component(p_ent, CCONTAINER_T);
+    if (p_container != NULL)
     {
-        const CContainer_t* p_container = get_component(p_ent, CCONTAINER_T);
-        ParticleEmitter_t emitter = {
-            .spr = get_sprite(&scene->engine->assets, (p_container->material == WOODEN_CONTAINER) ? "p_wood" : "p_metal"),
-            .config = get_emitter_conf(&scene->engine->assets, "pe_burst"),
-            .position = Vector2Add(p_ent->position, half_size),
-            .n_particles = 5,
-            .user_data = CONTAINER_OF(scene, LevelScene_t, scene),
-            .update_func = &simple_particle_system_update,
-            .emitter_update_func = NULL,
-        };
-        play_particle_emitter(&scene->part_sys, &emitter);
-    }
-    else if (p_ent->m_tag == CHEST_ENT_TAG)
-    {
-        ParticleEmitter_t emitter = {
-            .spr = get_sprite(&scene->engine->assets, "p_wood"),
-            .config = get_emitter_conf(&scene->engine->assets, "pe_burst"),
-            .position = Vector2Add(p_ent->position, half_size),
-            .n_particles = 5,
-            .user_data = CONTAINER_OF(scene, LevelScene_t, scene),
-            .update_func = &simple_particle_system_update,
-            .emitter_update_func = NULL,
-        };
-        play_particle_emitter(&scene->part_sys, &emitter);
-
-        ParticleEmitter_t emitter2 = {
-            .spr = get_sprite(&scene->engine->assets, "p_coin"),
-            .config = get_emitter_conf(&scene->engine->assets, "pe_single"),
-            .position = Vector2Add(p_ent->position, half_size),
-            .n_particles = 1,
-            .user_data = CONTAINER_OF(scene, LevelScene_t, scene),
-            .update_func = &simple_particle_system_update,
-            .emitter_update_func = NULL,
-        };
-        play_particle_emitter(&scene->part_sys, &emitter2);
-
-        play_sfx(scene->engine, COIN_SFX);
-    }
-    else if (p_ent->m_tag == ARROW_ENT_TAG)
-    {
-        ParticleEmitter_t emitter = {
-            .spr = get_sprite(&scene->engine->assets, "p_arrow"),
-            .config = get_emitter_conf(&scene->engine->assets, "pe_burst"),
-            .position = Vector2Add(p_ent->position, half_size),
-            .n_particles = 2,
-            .user_data = CONTAINER_OF(scene, LevelScene_t, scene),
-            .update_func = &simple_particle_system_update,
-            .emitter_update_func = NULL,
-        };
-        play_particle_emitter(&scene->part_sys, &emitter);
-        play_sfx(scene->engine, ARROW_DESTROY_SFX);
-    }
-    else if (p_ent->m_tag == URCHIN_ENT_TAG)
-    {
-        ParticleEmitter_t emitter = {
-            .spr = get_sprite(&scene->engine->assets, "p_urc"),
-            .config = get_emitter_conf(&scene->engine->assets, "pe_burst"),
-            .position = Vector2Add(p_ent->position, half_size),
-            .n_particles = 8,
-            .user_data = CONTAINER_OF(scene, LevelScene_t, scene),
-            .update_func = &simple_particle_system_update,
-            .emitter_update_func = NULL,
-        };
-        play_particle_emitter(&scene->part_sys, &emitter);
+        material = p_container->material;
     }
+    push_event(&data->events, EVENT_DESTROYED, p_ent->m_tag, material, Vector2Add(p_ent->position, half_size));
 
     clear_an_entity(scene, tilemap, p_ent);
 }
@@ -1050,6 +997,7 @@ void global_external_forces_system(Scene_t* scene)
 
 void moveable_update_system(Scene_t* scene)
 {
+    LevelSceneData_t* data = &(CONTAINER_OF(scene, LevelScene_t, scene)->data);
     CMoveable_t* p_moveable;
     unsigned long ent_idx;
     sc_map_foreach(&scene->ent_manager.component_map[CMOVEABLE_T], ent_idx, p_moveable)
@@ -1068,7 +1016,7 @@ void moveable_update_system(Scene_t* scene)
                 p_moveable->gridmove = false;
                 p_bbox->solid = true;
                 p_ctransform->movement_mode = REGULAR_MOVEMENT;
-                play_sfx(scene->engine, BOULDER_LAND_SFX);
+                push_event(&data->events, EVENT_LANDED, p_ent->m_tag, 0, p_ent->position);
             }
             else if (remaining_distance > 0.1)
             {
@@ -1524,29 +1472,11 @@ void state_transition_update_system(Scene_t* scene)
         }
         if (p_mstate->ground_state == 0b01)
         {
-            if (p_ent->m_tag == BOULDER_ENT_TAG)
-            {
-                play_sfx(scene->engine, BOULDER_LAND_SFX);
-            }
-            else if (p_ent->m_tag == CRATES_ENT_TAG || p_ent->m_tag == CHEST_ENT_TAG)
-            {
-                play_sfx(scene->engine, WOOD_LAND_SFX);
-            }
+            push_event(&data->events, EVENT_LANDED, p_ent->m_tag, 0, p_ent->position);
         }
         if (p_mstate->water_state == 0b01)
         {
-            play_sfx(scene->engine, WATER_IN_SFX);
-            ParticleEmitter_t emitter = {
-                .spr = get_sprite(&scene->engine->assets, "p_water"),
-                .config = get_emitter_conf(&scene->engine->assets, "pe_burst"),
-                .position = Vector2Add(p_ent->position, p_bbox->half_size),
-                .n_particles = 5,
-                .user_data = (CONTAINER_OF(scene, LevelScene_t, scene)),
-                .update_func = &simple_particle_system_update,
-                .emitter_update_func = NULL,
-            };
-            play_particle_emitter(&scene->part_sys, &emitter);
-
+            push_event(&data->events, EVENT_ENTERED_WATER, p_ent->m_tag, 0, Vector2Add(p_ent->position, p_bbox->half_size));
         }
 
     }
@@ -1850,26 +1780,23 @@ void container_destroy_system(Scene_t* scene)
 
             Entity_t* new_ent;
             AnchorPoint_t spawn_anchor = AP_MID_CENTER;
+            ContainerItem_t released = p_container->item;
             switch (p_container->item)
             {
                 case CONTAINER_LEFT_ARROW:
                     new_ent = create_arrow(&scene->ent_manager, 0);
-                    play_sfx(scene->engine, ARROW_RELEASE_SFX);
                     spawn_anchor = AP_MID_LEFT;
                 break;
                 case CONTAINER_RIGHT_ARROW:
                     new_ent = create_arrow(&scene->ent_manager, 1);
-                    play_sfx(scene->engine, ARROW_RELEASE_SFX);
                     spawn_anchor = AP_MID_RIGHT;
                 break;
                 case CONTAINER_UP_ARROW:
                     new_ent = create_arrow(&scene->ent_manager, 2);
-                    play_sfx(scene->engine, ARROW_RELEASE_SFX);
                     spawn_anchor = AP_TOP_CENTER;
                 break;
                 case CONTAINER_DOWN_ARROW:
                     new_ent = create_arrow(&scene->ent_manager, 3);
-                    play_sfx(scene->engine, ARROW_RELEASE_SFX);
                     spawn_anchor = AP_BOT_CENTER;
                 break;
                 case CONTAINER_BOMB:
@@ -1887,17 +1814,15 @@ void container_destroy_system(Scene_t* scene)
                             launch_dir.x = -1;
                         }
                         new_ent = create_bomb(&scene->ent_manager, launch_dir);
-                        play_sfx(scene->engine, BOMB_RELEASE_SFX);
                     }
                     else
                     {
                         new_ent = create_explosion(&scene->ent_manager); 
-                        play_sfx(scene->engine, EXPLOSION_SFX);
+                        released = CONTAINER_EXPLOSION;
                     }
                 break;
                 case CONTAINER_EXPLOSION:
                     new_ent = create_explosion(&scene->ent_manager);
-                    play_sfx(scene->engine, EXPLOSION_SFX);
                 break;
                 default:
                     new_ent = NULL;
@@ -1913,16 +1838,11 @@ void container_destroy_system(Scene_t* scene)
                     )
                 );
             }
-
-            // In case there's more materials
-            if (p_container->material == WOODEN_CONTAINER)
-            {
-                play_sfx(scene->engine, WOOD_DESTROY_SFX);
-            }
             else
             {
-                play_sfx(scene->engine, METAL_DESTROY_SFX);
+                released = CONTAINER_EMPTY;
             }
+            push_event(&data->events, EVENT_ITEM_RELEASED, released, p_container->material, p_ent->position);
         }
     }
 }
@@ -2022,8 +1942,8 @@ void airtimer_update_system(Scene_t* scene)
                     //new_pos.y += p_bbox->half_size.y;
 
                     ParticleEmitter_t emitter = {
-                        .spr = get_sprite(&scene->engine->assets, "p_water"),
-                        .config = get_emitter_conf(&scene->engine->assets, "pe_bubbling"),
+                        .spr = get_tagged_sprite(&scene->engine->assets, WATER_PARTICLE_SPR),
+                        .config = get_tagged_emitter_conf(&scene->engine->assets, BUBBLING_EMITTER),
                         //.position = new_pos,
                         .position = p_ent->position,
                         .n_particles = 5,
@@ -2050,8 +1970,8 @@ void airtimer_update_system(Scene_t* scene)
                     p_air->curr_count--;
                     p_air->curr_ftimer += p_air->max_ftimer;
                     ParticleEmitter_t emitter = {
-                        .spr = get_sprite(&scene->engine->assets, "p_bigbubble"),
-                        .config = get_emitter_conf(&scene->engine->assets, "pe_slow"),
+                        .spr = get_tagged_sprite(&scene->engine->assets, BIG_BUBBLE_SPR),
+                        .config = get_tagged_emitter_conf(&scene->engine->assets, SLOW_EMITTER),
                         .position = p_ent->position,
                         .n_particles = 1,
                         .user_data = CONTAINER_OF(scene, LevelScene_t, scene),
@@ -2195,6 +2115,134 @@ void level_state_management_system(Scene_t* scene)
     }
 }
 
+static void spawn_particles(Scene_t* scene, SpriteTag_t spr_tag, EmitterTag_t conf_tag, Vector2 pos, uint8_t n_particles)
+{
+    ParticleEmitter_t emitter = {
+        .spr = get_tagged_sprite(&scene->engine->assets, spr_tag),
+        .config = get_tagged_emitter_conf(&scene->engine->assets, conf_tag),
+        .position = pos,
+        .n_particles = n_particles,
+        .user_data = CONTAINER_OF(scene, LevelScene_t, scene),
+        .update_func = &simple_particle_system_update,
+        .emitter_update_func = NULL,
+    };
+    play_particle_emitter(&scene->part_sys, &emitter);
+}
+
+static uint32_t handle_destroyed_event(Scene_t* scene, const GameEvent_t* event)
+{
+    switch (event->tag)
+    {
+        case BOULDER_ENT_TAG:
+            spawn_particles(scene, ROCK_PARTICLE_SPR, BURST_EMITTER, event->pos, 5);
+        return 1U << BOULDER_DESTROY_SFX;
+        case CRATES_ENT_TAG:
+            spawn_particles(
+                scene, (event->data == WOODEN_CONTAINER) ? WOOD_PARTICLE_SPR : METAL_PARTICLE_SPR,
+                BURST_EMITTER, event->pos, 5
+            );
+        return 0;
+        case CHEST_ENT_TAG:
+            spawn_particles(scene, WOOD_PARTICLE_SPR, BURST_EMITTER, event->pos, 5);
+            spawn_particles(scene, COIN_PARTICLE_SPR, SINGLE_EMITTER, event->pos, 1);
+        return 1U << COIN_SFX;
+        case ARROW_ENT_TAG:
+            spawn_particles(scene, ARROW_PARTICLE_SPR, BURST_EMITTER, event->pos, 2);
+        return 1U << ARROW_DESTROY_SFX;
+        case URCHIN_ENT_TAG:
+            spawn_particles(scene, URCHIN_PARTICLE_SPR, BURST_EMITTER, event->pos, 8);
+        return 0;
+        default:
+        return 0;
+    }
+}
+
+static uint32_t handle_item_released_event(const GameEvent_t* event)
+{
+    // In case there's more materials
+    uint32_t sfx_mask = (event->data == WOODEN_CONTAINER) ? (1U << WOOD_DESTROY_SFX) : (1U << METAL_DESTROY_SFX);
+    switch (event->tag)
+    {
+        case CONTAINER_LEFT_ARROW:
+        case CONTAINER_RIGHT_ARROW:
+        case CONTAINER_UP_ARROW:
+        case CONTAINER_DOWN_ARROW:
+            sfx_mask |= 1U << ARROW_RELEASE_SFX;
+        break;
+        case CONTAINER_BOMB:
+            sfx_mask |= 1U << BOMB_RELEASE_SFX;
+        break;
+        case CONTAINER_EXPLOSION:
+            sfx_mask |= 1U << EXPLOSION_SFX;
+        break;
+        default:
+        break;
+    }
+    return sfx_mask;
+}
+
+void gameplay_event_system(Scene_t* scene)
+{
+    LevelSceneData_t* data = &(CONTAINER_OF(scene, LevelScene_t, scene)->data);
+
+    // A sound is played once per frame, no matter how many events asked for it.
+    // N_SFX must fit in the mask
+    uint32_t sfx_mask = 0;
+    for (uint32_t i = 0; i < data->events.n_events; ++i)
+    {
+        const GameEvent_t* event = data->events.events + i;
+        switch (event->type)
+        {
+            case EVENT_LANDED:
+                if (event->tag == BOULDER_ENT_TAG)
+                {
+                    sfx_mask |= 1U << BOULDER_LAND_SFX;
+                }
+                else if (event->tag == CRATES_ENT_TAG || event->tag == CHEST_ENT_TAG)
+                {
+                    sfx_mask |= 1U << WOOD_LAND_SFX;
+                }
+            break;
+            case EVENT_ENTERED_WATER:
+                spawn_particles(scene, WATER_PARTICLE_SPR, BURST_EMITTER, event->pos, 5);
+                sfx_mask |= 1U << WATER_IN_SFX;
+            break;
+            case EVENT_DESTROYED:
+                sfx_mask |= handle_destroyed_event(scene, event);
+            break;
+            case EVENT_TILE_DESTROYED:
+                if (event->tag == LADDER)
+                {
+                    spawn_particles(scene, LADDER_PARTICLE_SPR, BURST_EMITTER, event->pos, 5);
+                }
+                else if (event->tag == ONEWAY_TILE)
+                {
+                    spawn_particles(scene, WOOD_PARTICLE_SPR, BURST_EMITTER, event->pos, 5);
+                }
+                else if (event->tag == SPIKES)
+                {
+                    spawn_particles(scene, SPIKE_PARTICLE_SPR, BURST_EMITTER, event->pos, 5);
+                }
+            break;
+            case EVENT_ITEM_RELEASED:
+                sfx_mask |= handle_item_released_event(event);
+            break;
+            default:
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; sfx_mask != 0; ++i, sfx_mask >>= 1)
+    {
+        if (sfx_mask & 1) play_sfx(scene->engine, i);
+    }
+    if (data->events.dropped > 0)
+    {
+        printf("Event bus full, %u events dropped\n", data->events.dropped);
+    }
+    clear_event_bus(&data->events);
+}
+
 static inline bool is_point_in_water(Vector2 pos, TileGrid_t tilemap)
 {
     unsigned int tile_idx = get_tile_idx(pos.x, pos.y, tilemap);
@@ -1,6 +1,21 @@
 #ifndef __GAME_SYSTEMS_H
 #define __GAME_SYSTEMS_H
 #include "scene_impl.h"
+#include "assets_tag.h"
+
+// Look up the tagged assets. Call once the sprites and emitters are added
+void init_game_asset_ids(Assets_t* assets);
+Sprite_t* get_tagged_sprite(Assets_t* assets, SpriteTag_t tag);
+EmitterConfig_t* get_tagged_emitter_conf(Assets_t* assets, EmitterTag_t tag);
+
+// Pushed to the event bus of the level, and handled by gameplay_event_system
+typedef enum GameEventType {
+    EVENT_LANDED = 0, // tag: entity tag
+    EVENT_ENTERED_WATER,
+    EVENT_DESTROYED, // tag: entity tag, data: container material
+    EVENT_TILE_DESTROYED, // tag: tile type
+    EVENT_ITEM_RELEASED, // tag: container item, data: container material
+} GameEventType_t;
 
 void player_movement_input_system(Scene_t* scene);
 void player_bbox_update_system(Scene_t* scene);
@@ -27,5 +42,9 @@ void airtimer_update_system(Scene_t* scene);
 void spike_collision_system(Scene_t* scene);
 void level_end_detection_system(Scene_t* scene);
 void level_state_management_system(Scene_t* scene);
+// Plays the sounds and particles of the events queued in the frame.
+// Events pushed by the systems after it, like level_state_management_system
+// and entity_sync_system, wait in the bus until the next frame
+void gameplay_event_system(Scene_t* scene);
 
 #endif // __GAME_SYSTEMS_H
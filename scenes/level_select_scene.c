@@ -40,7 +40,13 @@ static void level_preview_render_func(Scene_t* scene)
 
     if (!data->update_preview) return;
 
-    LevelMap_t level = data->level_pack->levels[data->scroll_area.curr_selection];
+    LevelMap_t* selected = get_level(data->level_pack, data->scroll_area.curr_selection);
+    if (selected == NULL)
+    {
+        data->update_preview = false;
+        return;
+    }
+    LevelMap_t level = *selected;
 
     const uint32_t n_tiles = level.width * level.height;
     uint16_t max_dim = (level.width > level.height ? level.width : level.height);
@@ -65,9 +71,60 @@ static void level_preview_render_func(Scene_t* scene)
         {
             uint32_t pos_x = tile_size * (i % level.width) + x_offset;
             uint32_t pos_y = tile_size * (i / level.width) + y_offset;
-            if (level.tiles[i].tile_type >= 8 && level.tiles[i].tile_type < 20)
+            switch(level.tiles[i].tile_type) {
+                case SOLID_TILE:
+                    DrawRectangle(pos_x, pos_y, tile_size, tile_size, BLACK);
+                break;
+                case ONEWAY_TILE:
+                    DrawRectangle(pos_x, pos_y, tile_size, tile_halfsize, (Color){128,64,0,255});
+                break;
+                case LADDER:
+                    DrawRectangleLines(pos_x, pos_y, tile_size, tile_size, (Color){214,141,64,255});
+                break;
+                case 4:
+                case 5:
+                case 6:
+                case 7:
+                    // Copied from level generation
+                    // Priority: Down, Up, Left, Right
+                    if (i + level.width < n_tiles && level.tiles[i + level.width].tile_type == SOLID_TILE)
+                    {
+                        DrawRectangle(pos_x, pos_y + tile_halfsize , tile_size, tile_halfsize, danger_col);
+                    }
+                    else if (i >= level.width && level.tiles[i - level.width].tile_type == SOLID_TILE)
+                    {
+                        DrawRectangle(pos_x, pos_y, tile_size, tile_halfsize, danger_col);
+                    }
+                    else if (i % level.width != 0 && level.tiles[i - 1].tile_type == SOLID_TILE)
+                    {
+                        DrawRectangle(pos_x, pos_y, tile_halfsize, tile_size, danger_col);
+                    }
+                    else if ((i + 1) % level.width != 0 && level.tiles[i + 1].tile_type == SOLID_TILE)
+                    {
+                        DrawRectangle(pos_x + tile_halfsize, pos_y, tile_halfsize, tile_size, danger_col);
+                    }
+                    else
+                    {
+                        DrawRectangle(pos_x, pos_y + tile_halfsize , tile_size, tile_halfsize, danger_col);
+                    }
+                break;
+                default:
+                break;
+            }
+            if (level.tiles[i].water > 0 && level.tiles[i].water < 5) {
+                uint32_t height = tile_size * level.tiles[i].water / 4;
+                DrawRectangle(pos_x, pos_y+tile_size - height, tile_size, height, (Color){0,0,255,64});
+            }
+        }
+        // Entities are not in the tiles
+        for (uint32_t i = 0; i < level.n_spawns; ++i)
+        {
+            const LevelSpawn_t* spawn = level.spawns + i;
+            uint32_t pos_x = tile_size * spawn->x + x_offset;
+            uint32_t pos_y = tile_size * spawn->y + y_offset;
+            if (spawn->tile_type >= 8 && spawn->tile_type < 20)
             {
-                uint32_t tmp_idx = level.tiles[i].tile_type - 8;
+                uint32_t tmp_idx = spawn->tile_type - 8;
                 uint32_t item_type = tmp_idx % 6;
                 Color col = (tmp_idx > 5)? (Color){110,110,110,255} : (Color){160,117,48,255};
                 DrawRectangle(pos_x, pos_y, tile_size, tile_size, col);
@@ -91,75 +148,35 @@ static void level_preview_render_func(Scene_t* scene)
                     break;
                 }
                 DrawRectangleLines(pos_x, pos_y, tile_size, tile_size, (Color){0,0,0,64});
+                continue;
             }
-            else
-            {
 
-                switch(level.tiles[i].tile_type) {
-                    case SOLID_TILE:
-                        DrawRectangle(pos_x, pos_y, tile_size, tile_size, BLACK);
-                    break;
-                    case ONEWAY_TILE:
-                        DrawRectangle(pos_x, pos_y, tile_size, tile_halfsize, (Color){128,64,0,255});
-                    break;
-                    case LADDER:
-                        DrawRectangleLines(pos_x, pos_y, tile_size, tile_size, (Color){214,141,64,255});
-                    break;
-                    case 4:
-                    case 5:
-                    case 6:
-                    case 7:
-                        // Copied from level generation
-                        // Priority: Down, Up, Left, Right
-                        if (i + level.width < n_tiles && level.tiles[i + level.width].tile_type == SOLID_TILE)
-                        {
-                            DrawRectangle(pos_x, pos_y + tile_halfsize , tile_size, tile_halfsize, danger_col);
-                        }
-                        else if (i >= level.width && level.tiles[i - level.width].tile_type == SOLID_TILE)
-                        {
-                            DrawRectangle(pos_x, pos_y, tile_size, tile_halfsize, danger_col);
-                        }
-                        else if (i % level.width != 0 && level.tiles[i - 1].tile_type == SOLID_TILE)
-                        {
-                            DrawRectangle(pos_x, pos_y, tile_halfsize, tile_size, danger_col);
-                        }
-                        else if ((i + 1) % level.width != 0 && level.tiles[i + 1].tile_type == SOLID_TILE)
-                        {
-                            DrawRectangle(pos_x + tile_halfsize, pos_y, tile_halfsize, tile_size, danger_col);
-                        }
-                        else
-                        {
-                            DrawRectangle(pos_x, pos_y + tile_halfsize , tile_size, tile_halfsize, danger_col);
-                        }
-                    break;
-                    case 20:
-                        DrawCircle(pos_x + tile_halfsize, pos_y + tile_halfsize, tile_halfsize, (Color){12,12,12,255});
-                    break;
-                    case 21:
-                    DrawTriangle(
-                        (Vector2){pos_x,pos_y},
-                        (Vector2){pos_x+tile_halfsize,pos_y+tile_size},
-                        (Vector2){pos_x+tile_size,pos_y},
-                        (Color){0,0,128,255}
-                    );
-                    break;
-                    case 22:
-                        DrawRectangle(pos_x, pos_y, tile_size, tile_size, (Color){255,0,255,255});
-                    break;
-                    case 23:
-                        DrawRectangle(pos_x, pos_y, tile_size, tile_size, (Color){255,255,0,255});
-                    break;
-                    case 24:
-                        DrawRectangle(pos_x, pos_y, tile_size, tile_size, (Color){0,255,0,255});
-                    break;
-                    case 25:
-                        DrawCircle(pos_x + tile_halfsize, pos_y + tile_halfsize, tile_halfsize-1, danger_col);
-                    break;
-                }
-            }
-            if (level.tiles[i].water > 0 && level.tiles[i].water < 5) {
-                uint32_t height = tile_size * level.tiles[i].water / 4;
-                DrawRectangle(pos_x, pos_y+tile_size - height, tile_size, height, (Color){0,0,255,64});
+            switch(spawn->tile_type) {
+                case 20:
+                    DrawCircle(pos_x + tile_halfsize, pos_y + tile_halfsize, tile_halfsize, (Color){12,12,12,255});
+                break;
+                case 21:
+                DrawTriangle(
+                    (Vector2){pos_x,pos_y},
+                    (Vector2){pos_x+tile_halfsize,pos_y+tile_size},
+                    (Vector2){pos_x+tile_size,pos_y},
+                    (Color){0,0,128,255}
+                );
+                break;
+                case 22:
+                    DrawRectangle(pos_x, pos_y, tile_size, tile_size, (Color){255,0,255,255});
+                break;
+                case 23:
+                    DrawRectangle(pos_x, pos_y, tile_size, tile_size, (Color){255,255,0,255});
+                break;
+                case 24:
+                    DrawRectangle(pos_x, pos_y, tile_size, tile_size, (Color){0,255,0,255});
+                break;
+                case 25:
+                    DrawCircle(pos_x + tile_halfsize, pos_y + tile_halfsize, tile_halfsize-1, danger_col);
+                break;
+                default:
+                break;
             }
         }
     EndTextureMode();
@@ -217,7 +234,7 @@ static void level_select_do_action(Scene_t* scene, ActionType_t action, bool pre
                         {
                             // TODO: Need to load the current level
                             LevelScene_t* level_scene = (LevelScene_t*)change_scene(scene->engine, GAME_SCENE);
-                            level_scene->data.level_pack = data->level_pack;
+                            set_level_pack(level_scene, data->level_pack);
                             level_scene->data.current_level = data->scroll_area.curr_selection;
                             reload_level_tilemap(level_scene);
 
@@ -233,7 +250,7 @@ static void level_select_do_action(Scene_t* scene, ActionType_t action, bool pre
                 {
                     // TODO: Need to load the current level
                     LevelScene_t* level_scene = (LevelScene_t*)change_scene(scene->engine, GAME_SCENE);
-                    level_scene->data.level_pack = data->level_pack;
+                    set_level_pack(level_scene, data->level_pack);
                     level_scene->data.current_level = data->scroll_area.curr_selection;
                     reload_level_tilemap(level_scene);
 
@@ -248,28 +265,8 @@ static void level_select_do_action(Scene_t* scene, ActionType_t action, bool pre
 #define FONT_SIZE 22
 #define TEXT_PADDING 3
 #define SCROLL_TOTAL_HEIGHT 800
-void init_level_select_scene(LevelSelectScene_t* scene)
+void refresh_level_select_list(LevelSelectScene_t* scene)
 {
-    init_scene(&scene->scene, &level_select_do_action, 0);
-    scene->data.preview = LoadRenderTexture(LEVEL_PREVIEW_SIZE, LEVEL_PREVIEW_SIZE);
-    scene->data.update_preview = true;
-    add_scene_layer(
-        &scene->scene, scene->scene.engine->intended_window_size.x,
-        scene->scene.engine->intended_window_size.y,
-        (Rectangle){
-            0, 0,
-            scene->scene.engine->intended_window_size.x,
-            scene->scene.engine->intended_window_size.y
-        }
-    );
-    scene->scene.bg_colour = BLACK;
-    Sprite_t* level_select = get_sprite(&scene->scene.engine->assets, "lvl_select");
-    vert_scrollarea_init(&scene->data.scroll_area, (Rectangle){50, 75, level_select->frame_size.x * 0.6, level_select->frame_size.y * 3 / 4}, (Vector2){level_select->frame_size.x * 0.6, SCROLL_TOTAL_HEIGHT});
-    vert_scrollarea_set_item_dims(&scene->data.scroll_area, FONT_SIZE, TEXT_PADDING);
-    Font* menu_font = get_font(&scene->scene.engine->assets, "MenuFont");
-    if (menu_font != NULL) {
-        scene->data.scroll_area.comp.font = *menu_font; 
-    }
     char buf[32];
     ScrollAreaRenderBegin(&scene->data.scroll_area);
         ClearBackground(BLANK);
@@ -294,6 +291,50 @@ void init_level_select_scene(LevelSelectScene_t* scene)
             }
         }
     ScrollAreaRenderEnd();
+    scene->data.update_preview = true;
+}
+
+bool select_level_pack(LevelSelectScene_t* scene, const char* name, const char* path)
+{
+    Assets_t* assets = &scene->scene.engine->assets;
+    LevelPack_t* pack = acquire_level_pack(assets, name);
+    if (pack == NULL && path != NULL)
+    {
+        // Comes with a reference already
+        pack = uncompress_level_pack(assets, name, path);
+    }
+    if (pack == NULL) return false;
+
+    if (scene->data.level_pack != NULL) release_level_pack(assets, scene->data.level_pack);
+    scene->data.level_pack = pack;
+    scene->data.scroll_area.curr_selection = 0;
+    refresh_level_select_list(scene);
+    return true;
+}
+
+void init_level_select_scene(LevelSelectScene_t* scene)
+{
+    init_scene(&scene->scene, &level_select_do_action, 0);
+    scene->data.preview = LoadRenderTexture(LEVEL_PREVIEW_SIZE, LEVEL_PREVIEW_SIZE);
+    scene->data.update_preview = true;
+    add_scene_layer(
+        &scene->scene, scene->scene.engine->intended_window_size.x,
+        scene->scene.engine->intended_window_size.y,
+        (Rectangle){
+            0, 0,
+            scene->scene.engine->intended_window_size.x,
+            scene->scene.engine->intended_window_size.y
+        }
+    );
+    scene->scene.bg_colour = BLACK;
+    Sprite_t* level_select = get_sprite(&scene->scene.engine->assets, "lvl_select");
+    vert_scrollarea_init(&scene->data.scroll_area, (Rectangle){50, 75, level_select->frame_size.x * 0.6, level_select->frame_size.y * 3 / 4}, (Vector2){level_select->frame_size.x * 0.6, SCROLL_TOTAL_HEIGHT});
+    vert_scrollarea_set_item_dims(&scene->data.scroll_area, FONT_SIZE, TEXT_PADDING);
+    Font* menu_font = get_font(&scene->scene.engine->assets, "MenuFont");
+    if (menu_font != NULL) {
+        scene->data.scroll_area.comp.font = *menu_font; 
+    }
+    refresh_level_select_list(scene);
 
     sc_array_add(&scene->scene.systems, &level_preview_render_func);
     sc_array_add(&scene->scene.systems, &level_select_render_func);
@@ -305,6 +346,11 @@ void init_level_select_scene(LevelSelectScene_t* scene)
 }
 void free_level_select_scene(LevelSelectScene_t* scene)
 {
+    if (scene->data.level_pack != NULL)
+    {
+        release_level_pack(&scene->scene.engine->assets, scene->data.level_pack);
+        scene->data.level_pack = NULL;
+    }
     UnloadRenderTexture(scene->data.preview);
     vert_scrollarea_free(&scene->data.scroll_area);
     free_scene(&scene->scene);
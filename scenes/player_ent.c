@@ -1,6 +1,7 @@
 #include "engine.h"
 #include "ent_impl.h"
 #include "constants.h"
+#include "asset_manifest.h"
 #include <stdio.h>
 #include <string.h>
 #include "raymath.h"
@@ -201,36 +202,18 @@ Entity_t* create_player_finish(EntityManager_t* ent_manager)
     return p_ent;
 }
 
-static AnchorPoint_t parse_anchor_symbol(const char symbol[2])
+static void set_player_sprite(uint8_t i, const PlayerSpriteRecord_t* record, Assets_t* assets)
 {
-    if (symbol[0] == 't')
-    {
-        if (symbol[1] == 'l') return AP_TOP_LEFT;
-        if (symbol[1] == 'c') return AP_TOP_CENTER;
-        if (symbol[1] == 'r') return AP_TOP_RIGHT;
-    }
-    else if (symbol[0] == 'm')
-    {
-        if (symbol[1] == 'l') return AP_MID_LEFT;
-        if (symbol[1] == 'c') return AP_MID_CENTER;
-        if (symbol[1] == 'r') return AP_MID_RIGHT;
-    }
-    else if (symbol[0] == 'b')
-    {
-        if (symbol[1] == 'l') return AP_BOT_LEFT;
-        if (symbol[1] == 'c') return AP_BOT_CENTER;
-        if (symbol[1] == 'r') return AP_BOT_RIGHT;
-    }
-
-    return AP_TOP_LEFT;
+    Sprite_t* spr = get_sprite(assets, record->name);
+    if (spr != NULL) spr->anchor = Vector2Scale(spr->frame_size, 0.5f);
+    player_sprite_map[i].sprite = spr;
+    player_sprite_map[i].offset = record->offset;
+    player_sprite_map[i].src_anchor = record->src_anchor;
+    player_sprite_map[i].dest_anchor = record->dest_anchor;
 }
 
-static bool init_player_file(FILE* in_file, Assets_t* assets)
+static bool read_player_file(FILE* in_file, Assets_t* assets)
 {
-    static bool already_init = false;
-
-    if (already_init) return false;
-
     char buffer[256];
     char* tmp;
     size_t line_num = 0;
@@ -240,6 +223,7 @@ static bool init_player_file(FILE* in_file, Assets_t* assets)
         tmp = fgets(buffer, 256, in_file);
         if (tmp == NULL) break;
         tmp[strcspn(tmp, "\r\n")] = '\0';
+        line_num++;
 
         if (i == N_PLAYER_SPRITES)  break;
 
@@ -250,30 +234,27 @@ static bool init_player_file(FILE* in_file, Assets_t* assets)
         while(*name == ' ' || *name == '\t') name++;
         while(*info_str == ' ' || *info_str == '\t') info_str++;
 
-        Vector2 offset;
-        char src_ap_symbol[3];
-        char dest_ap_symbol[3];
-        int data_count = sscanf(
-            info_str, "%f,%f,%2s,%2s",
-            &offset.x, &offset.y, src_ap_symbol, dest_ap_symbol
-        );
-        if (data_count != 4)
+        PlayerSpriteRecord_t record;
+        if (!parse_player_sprite_record(name, info_str, &record))
         {
             printf("Unable to parse info for player at line %lu\n", line_num);
             return false;
         }
-        Sprite_t* spr = get_sprite(assets, name);
-        spr->anchor = Vector2Scale(spr->frame_size, 0.5f);
-        player_sprite_map[i].sprite = spr;
-        player_sprite_map[i].offset = offset;
-        player_sprite_map[i].src_anchor = parse_anchor_symbol(src_ap_symbol);
-        player_sprite_map[i].dest_anchor = parse_anchor_symbol(dest_ap_symbol);
+        set_player_sprite(i, &record, assets);
         i++;
     }
-    already_init = true;
     return true;
 }
 
+static bool already_init = false;
+
+static bool init_player_file(FILE* in_file, Assets_t* assets)
+{
+    if (already_init) return false;
+    already_init = read_player_file(in_file, assets);
+    return already_init;
+}
+
 bool init_player_creation(const char* info_file, Assets_t* assets)
 {
     FILE* in_file = fopen(info_file, "r");
@@ -288,30 +269,43 @@ bool init_player_creation(const char* info_file, Assets_t* assets)
     return okay;
 }
 
-bool init_player_creation_rres(const char* rres_fname, const char* file, Assets_t* assets)
+bool reload_player_creation(const char* info_file, Assets_t* assets)
 {
-    RresFileInfo_t rres_file;
-    rres_file.dir = rresLoadCentralDirectory(rres_fname);
-    rres_file.fname = rres_fname;
+    FILE* in_file = fopen(info_file, "r");
+    if (in_file == NULL) return false;
 
-    if (rres_file.dir.count == 0)
-    {
-        puts("Empty central directory");
-        return false;
-    }
+    // The sprite map is shared by the player entities, so they pick it up
+    bool okay = read_player_file(in_file, assets);
+    fclose(in_file);
+    return okay;
+}
+
+bool init_player_creation_rres(const char* rres_fname, Assets_t* assets)
+{
+    if (already_init) return false;
 
-    unsigned int res_id = rresGetResourceId(rres_file.dir, file);
-    rresResourceChunk chunk = rresLoadResourceChunk(rres_file.fname, res_id);
-    
-    bool okay = false;
-    if (chunk.info.id == res_id)
+    RresFileInfo_t rres_file;
+    if (!open_rres_file(&rres_file, rres_fname)) return false;
+
+    // The player sprites are compiled into the manifest by the packer
+    RresChunkView_t chunk;
+    AssetManifest_t manifest;
+    if (
+        get_rres_chunk(&rres_file, ASSET_MANIFEST_NAME, &chunk)
+        && read_asset_manifest(chunk.raw, chunk.size, &manifest)
+    )
     {
-        FILE* in_file = fmemopen(chunk.data.raw, chunk.info.baseSize, "rb");
-        okay = init_player_file(in_file, assets);
-        fclose(in_file);
+        PlayerSpriteRecord_t record;
+        uint16_t n_sprites = manifest.header.n_player_sprites;
+        if (n_sprites > N_PLAYER_SPRITES) n_sprites = N_PLAYER_SPRITES;
+        for (uint16_t i = 0; i < n_sprites; ++i)
+        {
+            get_manifest_player_sprite(&manifest, i, &record);
+            set_player_sprite(i, &record, assets);
+        }
+        already_init = true;
     }
 
-    rresUnloadResourceChunk(chunk);
-    rresUnloadCentralDirectory(rres_file.dir);
-    return okay;
+    close_rres_file(&rres_file);
+    return already_init;
 }
@@ -21,6 +21,11 @@ typedef enum TileType {
 
 #define MAX_TILE_SPRITES 32
 
+typedef struct WaterSolver WaterSolver_t; // Defined in water_flow.h
+typedef struct WaterLayer WaterLayer_t; // Defined in water_render.h
+typedef struct TileLayer TileLayer_t; // Defined in tile_render.h
+typedef struct LevelSnapshot LevelSnapshot_t; // Defined in scene_systems.c
+
 typedef struct CoinCounter
 {
     uint16_t current;
@@ -71,6 +76,7 @@ typedef struct LevelSceneData {
     Sprite_t* tile_sprites[MAX_TILE_SPRITES];
     Sprite_t* solid_tile_sprites;
     uint8_t selected_solid_tilemap;
+    Texture2D* bg_tex; // Held from the scene init to its free
     LevelPack_t* level_pack;
     unsigned int current_level;
     CoinCounter_t coins;
@@ -78,6 +84,12 @@ typedef struct LevelSceneData {
     Vector2 player_spawn;
     LevelSceneStateMachine_t sm;
     RenderManager render_manager;
+    EventBus_t events;
+    WaterSolver_t* water_solver;
+    WaterLayer_t* water_layer;
+    TileLayer_t* tile_layer;
+    // The level as it was right after it was loaded, for quick reloads
+    LevelSnapshot_t* snapshot;
 }LevelSceneData_t;
 
 static inline void change_level_state(LevelSceneData_t* data, LevelSceneState_t state)
@@ -100,11 +112,21 @@ void init_level_scene_data(LevelSceneData_t* data, uint32_t max_tiles, Tile_t* t
 void clear_an_entity(Scene_t* scene, TileGrid_t* tilemap, Entity_t* p_ent);
 void clear_all_game_entities(LevelScene_t* scene);
 void term_level_scene_data(LevelSceneData_t* data);
+// Holds a reference to the pack until another is set. Set NULL before freeing the scene
+void set_level_pack(LevelScene_t* scene, LevelPack_t* pack);
 void reload_level_tilemap(LevelScene_t* scene);
 void load_next_level_tilemap(LevelScene_t* scene);
 void load_prev_level_tilemap(LevelScene_t* scene);
 bool load_level_tilemap(LevelScene_t* scene, unsigned int level_num);
-void change_a_tile(TileGrid_t* tilemap, unsigned int tile_idx, TileType_t new_type);
+// Binary state of the running level, for rewinding. It holds pointers
+// to the assets, so it is only valid for the running program
+uint32_t get_level_state_size(LevelScene_t* scene);
+// Returns the size written, or 0 if it does not fit
+uint32_t save_level_state(LevelScene_t* scene, uint8_t* buf, uint32_t capacity);
+// Only for states saved from the same level
+bool load_level_state(LevelScene_t* scene, const uint8_t* buf, uint32_t size);
+// Returns true if the tile changed between solid and not solid
+bool change_a_tile(TileGrid_t* tilemap, unsigned int tile_idx, TileType_t new_type);
 
 typedef enum GuiMode {
     KEYBOARD_MODE,
@@ -138,5 +160,10 @@ void init_menu_scene(MenuScene_t* scene);
 void free_menu_scene(MenuScene_t* scene);
 void init_level_select_scene(LevelSelectScene_t* scene);
 void free_level_select_scene(LevelSelectScene_t* scene);
+// Redo the level names, once the level pack is loaded
+void refresh_level_select_list(LevelSelectScene_t* scene);
+// Browse another level pack. It is loaded from the path if not resident,
+// and the previous one is released
+bool select_level_pack(LevelSelectScene_t* scene, const char* name, const char* path);
 
 #endif // __SCENE_IMPL_H
@@ -1,14 +1,37 @@
 #include "collisions.h"
 #include "scene_impl.h"
 #include "water_flow.h"
+#include "water_render.h"
+#include "tile_render.h"
 #include "ent_impl.h"
 #include "constants.h"
 
 #include "raymath.h"
 
+struct LevelSnapshot {
+    LevelPack_t* level_pack;
+    uint32_t pack_revision;
+    unsigned int level_num;
+    bool valid;
+    unsigned int width;
+    unsigned int height;
+    uint32_t max_tiles;
+    // The entity sets in the tiles are not part of the snapshot
+    Tile_t* tiles;
+    RenderInfoNode* render_nodes;
+    EntitySnapshot_t entities;
+    CoinCounter_t coins;
+    uint8_t selected_solid_tilemap;
+    Sprite_t* solid_tile_sprites;
+    WaterMode_t water_mode;
+    Vector2 cam_target_pos;
+    Vector2 cam_target;
+};
+
 void init_level_scene_data(LevelSceneData_t* data, uint32_t max_tiles, Tile_t* tiles, Rectangle view_zone)
 {
     init_render_manager(&data->render_manager);
+    init_event_bus(&data->events);
 
     data->game_rec = view_zone;
     memset(&data->camera, 0, sizeof(LevelCamera_t));
@@ -33,6 +56,9 @@ void init_level_scene_data(LevelSceneData_t* data, uint32_t max_tiles, Tile_t* t
     data->tilemap.height = DEFAULT_MAP_HEIGHT;
     data->tilemap.tile_size = TILE_SIZE;
     data->tilemap.n_tiles = data->tilemap.width * data->tilemap.height;
+    // There cannot be more chunks than tiles
+    data->tilemap.dirty_chunks = calloc(max_tiles, sizeof(uint8_t));
+    reset_tilemap_chunks(&data->tilemap);
     memset(data->tile_sprites, 0, sizeof(data->tile_sprites));
     for (size_t i = 0; i < max_tiles;i++)
     {
@@ -49,6 +75,21 @@ void init_level_scene_data(LevelSceneData_t* data, uint32_t max_tiles, Tile_t* t
 
     memset(&data->sm, 0, sizeof(data->sm));
 
+    data->water_solver = create_water_solver(max_tiles);
+    data->water_layer = create_water_layer();
+    data->tile_layer = create_tile_layer();
+    data->snapshot = NULL;
+    data->level_pack = NULL;
+}
+
+static void free_level_snapshot(LevelSnapshot_t* snapshot)
+{
+    if (snapshot == NULL) return;
+
+    free(snapshot->tiles);
+    free(snapshot->render_nodes);
+    free_entity_snapshot(&snapshot->entities);
+    free(snapshot);
 }
 
 void term_level_scene_data(LevelSceneData_t* data)
@@ -57,6 +98,17 @@ void term_level_scene_data(LevelSceneData_t* data)
     {
         sc_map_term_64v(&data->tilemap.tiles[i].entities_set);
     }
+    free_water_solver(data->water_solver);
+    data->water_solver = NULL;
+    free_water_layer(data->water_layer);
+    data->water_layer = NULL;
+    free_tile_layer(data->tile_layer);
+    data->tile_layer = NULL;
+    free(data->tilemap.dirty_chunks);
+    data->tilemap.dirty_chunks = NULL;
+    free_level_snapshot(data->snapshot);
+    data->snapshot = NULL;
+    free_render_manager(&data->render_manager);
 }
 
 void clear_an_entity(Scene_t* scene, TileGrid_t* tilemap, Entity_t* p_ent)
@@ -79,29 +131,408 @@ void clear_an_entity(Scene_t* scene, TileGrid_t* tilemap, Entity_t* p_ent)
     remove_entity_from_tilemap(&scene->ent_manager, tilemap, p_ent);
 }
 
-void clear_all_game_entities(LevelScene_t* scene)
+static void set_tile_render_node(LevelSceneData_t* data, unsigned int tile_idx)
+{
+    const Tile_t* tile = data->tilemap.tiles + tile_idx;
+    RenderInfoNode* node = data->tilemap.render_nodes + tile_idx;
+    if (tile->tile_type == SOLID_TILE)
+    {
+        node->spr = data->solid_tile_sprites;
+        node->frame_num = CONNECTIVITY_TILE_MAPPING[tile->connectivity];
+    }
+    else
+    {
+        node->spr = data->tile_sprites[tile->tile_type + tile->rotation];
+        node->frame_num = 0;
+    }
+}
+
+static void clear_level_entities(LevelScene_t* scene)
 {
     Entity_t* ent;
     sc_map_foreach_value(&scene->scene.ent_manager.entities, ent)
     {
         clear_an_entity(&scene->scene, &scene->data.tilemap, ent);
     }
+    clear_entity_manager(&scene->scene.ent_manager);
+}
+
+void clear_all_game_entities(LevelScene_t* scene)
+{
+    clear_level_entities(scene);
 
     // This is unnecessary as the first pass should clear everything
     // For now, leave it in. This is not expected to call all the time
     // so not too bad
-    clear_entity_manager(&scene->scene.ent_manager);
     for (size_t i = 0; i < scene->data.tilemap.n_tiles;i++)
     {
         sc_map_clear_64v(&scene->data.tilemap.tiles[i].entities_set);
     }
 }
 
+static void spawn_level_entity(LevelScene_t* scene, const LevelSpawn_t* spawn)
+{
+    unsigned int i = spawn->y * scene->data.tilemap.width + spawn->x;
+    if (spawn->tile_type >= 8 && spawn->tile_type < 20)
+    {
+        uint32_t tmp_idx = spawn->tile_type - 8;
+        uint32_t item_type = tmp_idx % 6;
+        ContainerItem_t item = CONTAINER_EMPTY;
+        switch (item_type)
+        {
+            case 1: item = CONTAINER_LEFT_ARROW;break;
+            case 2: item = CONTAINER_RIGHT_ARROW;break;
+            case 3: item = CONTAINER_UP_ARROW;break;
+            case 4: item = CONTAINER_DOWN_ARROW;break;
+            case 5: item = CONTAINER_BOMB;break;
+            default: break;
+        }
+
+        Entity_t* ent = create_crate(&scene->scene.ent_manager, tmp_idx > 5, item);
+        ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
+        ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size;
+        return;
+    }
+
+    switch (spawn->tile_type)
+    {
+        case 20:
+        {
+            Entity_t* ent = create_boulder(&scene->scene.ent_manager);
+            ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
+            ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size;
+        }
+        break;
+        case 21:
+        {
+            create_water_runner(&scene->scene.ent_manager, scene->data.water_solver, i);
+        }
+        break;
+        case 22:
+        {
+            Entity_t* ent = create_player(&scene->scene.ent_manager);
+            ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
+            ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size;
+            scene->data.camera.target_pos.x = ent->position.x;
+            scene->data.camera.target_pos.y = ent->position.y;
+            scene->data.camera.cam.target.x = ent->position.x;
+            scene->data.camera.cam.target.y = ent->position.y;
+        }
+        break;
+        case 23:
+        {
+            Entity_t* ent = create_chest(&scene->scene.ent_manager);
+            ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
+            ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size;
+            CTransform_t* p_ctransform = get_component(ent, CTRANSFORM_COMP_T);
+            p_ctransform->active = true;
+        }
+        break;
+        case 24:
+        {
+            Entity_t* ent = create_level_end(&scene->scene.ent_manager);
+            if (ent != NULL)
+            {
+                ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
+                ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size + (scene->data.tilemap.tile_size >> 1);
+            }
+        }
+        break;
+        default:
+        break;
+    }
+
+    if (spawn->tile_type >= 25) 
+    {
+        Entity_t* ent = create_urchin(&scene->scene.ent_manager);
+        if (ent != NULL)
+        {
+            CBBox_t* p_bbox = get_component(ent, CBBOX_COMP_T);
+            ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size + (scene->data.tilemap.tile_size >> 1) - p_bbox->half_size.x;
+
+            ent->position.y = (int)(i / scene->data.tilemap.width) * scene->data.tilemap.tile_size + (scene->data.tilemap.tile_size >> 1) - p_bbox->half_size.y;
+
+            uint8_t spd_encoding = spawn->tile_type - 25;
+            float angle = 45.0f / 180.0f * PI * ((spd_encoding >> 2) & 7);
+            float mag = 75 * (spd_encoding & 3);
+
+            CTransform_t* p_ct = get_component(ent, CTRANSFORM_COMP_T);
+            p_ct->velocity = Vector2Scale(
+                (Vector2){cosf(angle), sinf(angle)}, mag
+            );
+        }
+    }
+}
+
+// Entities re-created from their component data still refer to what
+// the originals owned, which was freed when they were cleared
+static void relink_level_entities(LevelScene_t* scene)
+{
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    unsigned long ent_idx;
+    CWaterRunner_t* p_crunner;
+    sc_map_foreach(&scene->scene.ent_manager.component_map[CWATERRUNNER_T], ent_idx, p_crunner)
+    {
+        sc_queue_init(&p_crunner->bfs_queue);
+        sc_heap_init(&p_crunner->lowest_heap, 0);
+        p_crunner->solver->runners[p_crunner->slot] = p_crunner;
+    }
+
+    CEmitter_t* p_emitter;
+    sc_map_foreach(&scene->scene.ent_manager.component_map[CEMITTER_T], ent_idx, p_emitter)
+    {
+        // Emitters are only played once the level runs, so the snapshot
+        // holds no emitter state. Any old particles went with clear_an_entity
+        p_emitter->handle = 0;
+    }
+
+    CTileCoord_t* p_tilecoord;
+    sc_map_foreach(&scene->scene.ent_manager.component_map[CTILECOORD_COMP_T], ent_idx, p_tilecoord)
+    {
+        Entity_t* p_ent = get_entity(&scene->scene.ent_manager, ent_idx);
+        unsigned int n_tiles = 0;
+        for (unsigned int i = 0; i < p_tilecoord->n_tiles; ++i)
+        {
+            unsigned int tile_idx = p_tilecoord->tiles[i];
+            if (tile_idx >= tilemap->n_tiles) continue;
+
+            p_tilecoord->tiles[n_tiles++] = tile_idx;
+            sc_map_put_64v(&tilemap->tiles[tile_idx].entities_set, ent_idx, (void *)p_ent);
+        }
+        p_tilecoord->n_tiles = n_tiles;
+    }
+}
+
+// Nothing has run on the level yet, so the entities own no resources
+// other than the water runner searches and are not in any tile
+static void take_level_snapshot(LevelScene_t* scene)
+{
+    LevelSceneData_t* data = &scene->data;
+    if (data->snapshot == NULL)
+    {
+        data->snapshot = calloc(1, sizeof(LevelSnapshot_t));
+        if (data->snapshot == NULL) return;
+    }
+
+    LevelSnapshot_t* snapshot = data->snapshot;
+    snapshot->valid = false;
+    if (snapshot->tiles == NULL)
+    {
+        snapshot->tiles = malloc(data->tilemap.max_tiles * sizeof(Tile_t));
+        snapshot->render_nodes = malloc(data->tilemap.max_tiles * sizeof(RenderInfoNode));
+        snapshot->max_tiles = data->tilemap.max_tiles;
+    }
+    if (snapshot->tiles == NULL || snapshot->render_nodes == NULL) return;
+    if (!snapshot_entities(&scene->scene.ent_manager, &snapshot->entities)) return;
+
+    snapshot->level_pack = data->level_pack;
+    snapshot->pack_revision = data->level_pack->revision;
+    snapshot->level_num = data->current_level;
+    snapshot->width = data->tilemap.width;
+    snapshot->height = data->tilemap.height;
+    memcpy(snapshot->tiles, data->tilemap.tiles, data->tilemap.n_tiles * sizeof(Tile_t));
+    memcpy(snapshot->render_nodes, data->tilemap.render_nodes, data->tilemap.n_tiles * sizeof(RenderInfoNode));
+    snapshot->coins = data->coins;
+    snapshot->selected_solid_tilemap = data->selected_solid_tilemap;
+    snapshot->solid_tile_sprites = data->solid_tile_sprites;
+    snapshot->water_mode = data->water_solver->mode;
+    snapshot->cam_target_pos = data->camera.target_pos;
+    snapshot->cam_target = data->camera.cam.target;
+    snapshot->valid = true;
+}
+
+static bool restore_level_snapshot(LevelScene_t* scene)
+{
+    LevelSceneData_t* data = &scene->data;
+    LevelSnapshot_t* snapshot = data->snapshot;
+    if (snapshot == NULL || !snapshot->valid) return false;
+    if (snapshot->level_pack != data->level_pack || snapshot->level_num != data->current_level) return false;
+    // The pack was edited since
+    if (snapshot->pack_revision != data->level_pack->revision) return false;
+    if (snapshot->max_tiles != data->tilemap.max_tiles) return false;
+
+    // Entities remove themselves from the tiles they are in,
+    // so there is no need to clear the entity set of every tile
+    clear_level_entities(scene);
+
+    data->tilemap.width = snapshot->width;
+    data->tilemap.height = snapshot->height;
+    data->tilemap.n_tiles = snapshot->width * snapshot->height;
+    for (size_t i = 0; i < data->tilemap.n_tiles; i++)
+    {
+        struct sc_map_64v entities_set = data->tilemap.tiles[i].entities_set;
+        data->tilemap.tiles[i] = snapshot->tiles[i];
+        data->tilemap.tiles[i].entities_set = entities_set;
+    }
+    memcpy(data->tilemap.render_nodes, snapshot->render_nodes, data->tilemap.n_tiles * sizeof(RenderInfoNode));
+    reset_tilemap_chunks(&data->tilemap);
+
+    data->coins = snapshot->coins;
+    data->selected_solid_tilemap = snapshot->selected_solid_tilemap;
+    data->solid_tile_sprites = snapshot->solid_tile_sprites;
+    data->camera.target_pos = snapshot->cam_target_pos;
+    data->camera.cam.target = snapshot->cam_target;
+    data->camera.mode = CAMERA_FOLLOW_PLAYER;
+
+    bool restored = restore_entities(&scene->scene.ent_manager, &snapshot->entities);
+    relink_level_entities(scene);
+    if (!restored)
+    {
+        snapshot->valid = false;
+        return false;
+    }
+    set_water_mode(data->water_solver, snapshot->water_mode);
+    return true;
+}
+
+typedef struct LevelStateHeader {
+    char id[4];
+    uint32_t width;
+    uint32_t height;
+    CoinCounter_t coins;
+    uint32_t sm_state;
+    uint32_t sm_counter;
+    float sm_fractional;
+    Vector2 cam_target;
+    Vector2 cam_target_pos;
+    Vector2 cam_vel;
+} LevelStateHeader_t;
+
+// The parts of a tile that change while the level runs
+typedef struct TileState {
+    uint8_t tile_type;
+    uint8_t solid;
+    uint8_t rotation;
+    uint8_t connectivity;
+    uint8_t def;
+    uint8_t water_level;
+    uint8_t max_water_level;
+    uint8_t flags;
+    Vector2 offset;
+    Vector2 size;
+} TileState_t;
+
+static inline TileState_t get_tile_state(const Tile_t* tile)
+{
+    return (TileState_t){
+        .tile_type = tile->tile_type,
+        .solid = tile->solid,
+        .rotation = tile->rotation,
+        .connectivity = tile->connectivity,
+        .def = tile->def,
+        .water_level = tile->water_level,
+        .max_water_level = tile->max_water_level,
+        .flags = (tile->moveable ? 1 : 0) | (tile->wet ? 2 : 0),
+        .offset = tile->offset,
+        .size = tile->size,
+    };
+}
+
+uint32_t get_level_state_size(LevelScene_t* scene)
+{
+    return sizeof(LevelStateHeader_t)
+        + scene->data.tilemap.n_tiles * sizeof(TileState_t)
+        + get_serialised_entities_size(&scene->scene.ent_manager);
+}
+
+uint32_t save_level_state(LevelScene_t* scene, uint8_t* buf, uint32_t capacity)
+{
+    LevelSceneData_t* data = &scene->data;
+    uint32_t tiles_size = data->tilemap.n_tiles * sizeof(TileState_t);
+    if (capacity < sizeof(LevelStateHeader_t) + tiles_size) return 0;
+
+    LevelStateHeader_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.id, "LST1", 4);
+    header.width = data->tilemap.width;
+    header.height = data->tilemap.height;
+    header.coins = data->coins;
+    header.sm_state = data->sm.state;
+    header.sm_counter = data->sm.counter;
+    header.sm_fractional = data->sm.fractional;
+    header.cam_target = data->camera.cam.target;
+    header.cam_target_pos = data->camera.target_pos;
+    header.cam_vel = data->camera.current_vel;
+    memcpy(buf, &header, sizeof(header));
+
+    TileState_t* tile_states = (TileState_t*)(buf + sizeof(header));
+    for (unsigned int i = 0; i < data->tilemap.n_tiles; ++i)
+    {
+        tile_states[i] = get_tile_state(data->tilemap.tiles + i);
+    }
+
+    uint32_t offset = sizeof(header) + tiles_size;
+    uint32_t ent_size = serialise_entities(&scene->scene.ent_manager, buf + offset, capacity - offset);
+    if (ent_size == 0) return 0;
+    return offset + ent_size;
+}
+
+bool load_level_state(LevelScene_t* scene, const uint8_t* buf, uint32_t size)
+{
+    LevelSceneData_t* data = &scene->data;
+    LevelStateHeader_t header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, buf, sizeof(header));
+    if (memcmp(header.id, "LST1", 4) != 0) return false;
+    if (header.width != data->tilemap.width || header.height != data->tilemap.height) return false;
+
+    uint32_t tiles_size = data->tilemap.n_tiles * sizeof(TileState_t);
+    if (size < sizeof(header) + tiles_size) return false;
+
+    clear_level_entities(scene);
+
+    data->coins = header.coins;
+    data->sm.state = header.sm_state;
+    data->sm.counter = header.sm_counter;
+    data->sm.fractional = header.sm_fractional;
+    data->camera.cam.target = header.cam_target;
+    data->camera.target_pos = header.cam_target_pos;
+    data->camera.current_vel = header.cam_vel;
+
+    // Only the changed tiles need redrawing
+    const uint8_t* ptr = buf + sizeof(header);
+    for (unsigned int i = 0; i < data->tilemap.n_tiles; ++i, ptr += sizeof(TileState_t))
+    {
+        TileState_t state;
+        memcpy(&state, ptr, sizeof(TileState_t));
+        Tile_t* tile = data->tilemap.tiles + i;
+        TileState_t curr = get_tile_state(tile);
+        if (memcmp(&curr, &state, sizeof(TileState_t)) == 0) continue;
+
+        bool type_changed = (
+            tile->tile_type != state.tile_type
+            || tile->rotation != state.rotation
+            || tile->connectivity != state.connectivity
+        );
+
+        tile->tile_type = state.tile_type;
+        tile->solid = state.solid;
+        tile->rotation = state.rotation;
+        tile->connectivity = state.connectivity;
+        tile->def = state.def;
+        tile->water_level = state.water_level;
+        tile->max_water_level = state.max_water_level;
+        tile->moveable = (state.flags & 1) != 0;
+        tile->wet = (state.flags & 2) != 0;
+        tile->offset = state.offset;
+        tile->size = state.size;
+        if (type_changed) set_tile_render_node(data, i);
+        mark_tile_dirty(&data->tilemap, i);
+    }
+
+    bool loaded = deserialise_entities(&scene->scene.ent_manager, ptr, size - sizeof(header) - tiles_size);
+    relink_level_entities(scene);
+    // Searches start over from where the runners are
+    reset_water_basins(data->water_solver);
+    return loaded;
+}
+
 bool load_level_tilemap(LevelScene_t* scene, unsigned int level_num)
 {
-    if (level_num >= scene->data.level_pack->n_levels) return false;
+    LevelMap_t* level = get_level(scene->data.level_pack, level_num);
+    if (level == NULL) return false;
 
-    LevelMap_t lvl_map = scene->data.level_pack->levels[level_num];
+    LevelMap_t lvl_map = *level;
     uint32_t n_tiles = lvl_map.width * lvl_map.height;
     if (n_tiles > scene->data.tilemap.max_tiles) return false;
 
@@ -109,6 +540,7 @@ bool load_level_tilemap(LevelScene_t* scene, unsigned int level_num)
     scene->data.tilemap.width = lvl_map.width;
     scene->data.tilemap.height = lvl_map.height;
     scene->data.tilemap.n_tiles = n_tiles;
+    reset_tilemap_chunks(&scene->data.tilemap);
     scene->data.coins.current = 0;
     scene->data.coins.total = lvl_map.n_chests;
 
@@ -116,8 +548,12 @@ bool load_level_tilemap(LevelScene_t* scene, unsigned int level_num)
     static const char* SOLID_TILE_SELECTIONS[N_SOLID_TILESETS] = {
         "stile0", "stile1", "stile2"
     };
-    scene->data.selected_solid_tilemap = lvl_map.flags;
-    scene->data.solid_tile_sprites = get_sprite(&scene->scene.engine->assets, SOLID_TILE_SELECTIONS[lvl_map.flags]);
+    scene->data.selected_solid_tilemap = lvl_map.flags & LEVEL_TILESET_MASK;
+    scene->data.solid_tile_sprites = get_sprite(&scene->scene.engine->assets, SOLID_TILE_SELECTIONS[scene->data.selected_solid_tilemap]);
+    set_water_mode(
+        scene->data.water_solver,
+        (lvl_map.flags & LEVEL_FLAG_CELLULAR_WATER) ? WATER_MODE_CELLULAR : WATER_MODE_RUNNER
+    );
 
     clear_all_game_entities(scene);
 
@@ -164,135 +600,56 @@ bool load_level_tilemap(LevelScene_t* scene, unsigned int level_num)
         {
             change_a_tile(&scene->data.tilemap, i, SOLID_TILE);
         }
-        if (lvl_map.tiles[i].tile_type >= 8 && lvl_map.tiles[i].tile_type < 20)
-        {
-            uint32_t tmp_idx = lvl_map.tiles[i].tile_type - 8;
-            uint32_t item_type = tmp_idx % 6;
-            ContainerItem_t item = CONTAINER_EMPTY;
-            switch (item_type)
-            {
-                case 1: item = CONTAINER_LEFT_ARROW;break;
-                case 2: item = CONTAINER_RIGHT_ARROW;break;
-                case 3: item = CONTAINER_UP_ARROW;break;
-                case 4: item = CONTAINER_DOWN_ARROW;break;
-                case 5: item = CONTAINER_BOMB;break;
-                default: break;
-            }
-
-            Entity_t* ent = create_crate(&scene->scene.ent_manager, tmp_idx > 5, item);
-            ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
-            ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size;
-        }
-        else
+        switch (lvl_map.tiles[i].tile_type)
         {
-        
-            switch (lvl_map.tiles[i].tile_type)
-            {
-                case 2:
-                    change_a_tile(&scene->data.tilemap, i, ONEWAY_TILE);
-                break;
-                case 3:
-                    change_a_tile(&scene->data.tilemap, i, LADDER);
-                break;
-                case 4:
-                case 5:
-                case 6:
-                case 7:
-                    change_a_tile(&scene->data.tilemap, i, SPIKES);
-                break;
-                case 20:
-                {
-                    Entity_t* ent = create_boulder(&scene->scene.ent_manager);
-                    ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
-                    ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size;
-                }
-                break;
-                case 21:
-                {
-                    create_water_runner(&scene->scene.ent_manager, lvl_map.width, lvl_map.height, i);
-                }
-                break;
-                case 22:
-                {
-                    Entity_t* ent = create_player(&scene->scene.ent_manager);
-                    ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
-                    ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size;
-                    scene->data.camera.target_pos.x = ent->position.x;
-                    scene->data.camera.target_pos.y = ent->position.y;
-                    scene->data.camera.cam.target.x = ent->position.x;
-                    scene->data.camera.cam.target.y = ent->position.y;
-                }
-                break;
-                case 23:
-                {
-                    Entity_t* ent = create_chest(&scene->scene.ent_manager);
-                    ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
-                    ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size;
-                    CTransform_t* p_ctransform = get_component(ent, CTRANSFORM_COMP_T);
-                    p_ctransform->active = true;
-                }
-                break;
-                case 24:
-                {
-                    Entity_t* ent = create_level_end(&scene->scene.ent_manager);
-                    if (ent != NULL)
-                    {
-                        ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size;
-                        ent->position.y = (i / scene->data.tilemap.width) * scene->data.tilemap.tile_size + (scene->data.tilemap.tile_size >> 1);
-                    }
-                }
-                break;
-                default:
-                break;
-            }
-
-            if (lvl_map.tiles[i].tile_type >= 25) 
-            {
-                Entity_t* ent = create_urchin(&scene->scene.ent_manager);
-                if (ent != NULL)
-                {
-                    CBBox_t* p_bbox = get_component(ent, CBBOX_COMP_T);
-                    ent->position.x = (i % scene->data.tilemap.width) * scene->data.tilemap.tile_size + (scene->data.tilemap.tile_size >> 1) - p_bbox->half_size.x;
-
-                    ent->position.y = (int)(i / scene->data.tilemap.width) * scene->data.tilemap.tile_size + (scene->data.tilemap.tile_size >> 1) - p_bbox->half_size.y;
-
-                    uint8_t spd_encoding = lvl_map.tiles[i].tile_type - 25;
-                    float angle = 45.0f / 180.0f * PI * ((spd_encoding >> 2) & 7);
-                    float mag = 75 * (spd_encoding & 3);
-
-                    CTransform_t* p_ct = get_component(ent, CTRANSFORM_COMP_T);
-                    p_ct->velocity = Vector2Scale(
-                        (Vector2){cosf(angle), sinf(angle)}, mag
-                    );
-                }
-            }
+            case 2:
+                change_a_tile(&scene->data.tilemap, i, ONEWAY_TILE);
+            break;
+            case 3:
+                change_a_tile(&scene->data.tilemap, i, LADDER);
+            break;
+            case 4:
+            case 5:
+            case 6:
+            case 7:
+                change_a_tile(&scene->data.tilemap, i, SPIKES);
+            break;
+            default:
+            break;
         }
 
         // This only works for static loading.
         // If a tilemap change change to some other arbitrary tile.
         // Then this should be done while changing a tile.
-        if (lvl_map.tiles[i].tile_type == SOLID_TILE)
-        {
-            scene->data.tilemap.render_nodes[i].spr = scene->data.solid_tile_sprites;
-            scene->data.tilemap.render_nodes[i].frame_num = CONNECTIVITY_TILE_MAPPING[
-                scene->data.tilemap.tiles[i].connectivity
-            ];
-        }
-        else
-        {
-            uint8_t tile_sprite_idx = scene->data.tilemap.tiles[i].tile_type + scene->data.tilemap.tiles[i].rotation;
-            scene->data.tilemap.render_nodes[i].spr = scene->data.tile_sprites[
-                tile_sprite_idx
-            ];
-        }
+        set_tile_render_node(&scene->data, i);
+    }
+
+    // Entities only go by the spawn list, not the whole level
+    for (uint32_t i = 0; i < lvl_map.n_spawns; ++i)
+    {
+        spawn_level_entity(scene, lvl_map.spawns + i);
     }
 
     scene->data.camera.mode = CAMERA_FOLLOW_PLAYER;
+    take_level_snapshot(scene);
     return true;
 }
 
+void set_level_pack(LevelScene_t* scene, LevelPack_t* pack)
+{
+    Assets_t* assets = &scene->scene.engine->assets;
+    if (pack == scene->data.level_pack) return;
+
+    // A released pack may be unloaded, and its slot reused by another
+    if (pack != NULL) retain_level_pack(assets, pack);
+    if (scene->data.level_pack != NULL) release_level_pack(assets, scene->data.level_pack);
+    if (scene->data.snapshot != NULL) scene->data.snapshot->valid = false;
+    scene->data.level_pack = pack;
+}
+
 void reload_level_tilemap(LevelScene_t* scene)
 {
+    if (restore_level_snapshot(scene)) return;
     load_level_tilemap(scene, scene->data.current_level);
 }
 
@@ -316,10 +673,12 @@ void load_prev_level_tilemap(LevelScene_t* scene)
     }
 }
 
-void change_a_tile(TileGrid_t* tilemap, unsigned int tile_idx, TileType_t new_type)
+bool change_a_tile(TileGrid_t* tilemap, unsigned int tile_idx, TileType_t new_type)
 {
     TileType_t last_type = tilemap->tiles[tile_idx].tile_type;
+    bool was_solid = tilemap->tiles[tile_idx].solid == SOLID;
     tilemap->tiles[tile_idx].tile_type = new_type;
+    mark_tile_dirty(tilemap, tile_idx);
 
     switch (new_type)
     {
@@ -480,4 +839,5 @@ void change_a_tile(TileGrid_t* tilemap, unsigned int tile_idx, TileType_t new_ty
         }
     }
 
+    return was_solid != (tilemap->tiles[tile_idx].solid == SOLID);
 }
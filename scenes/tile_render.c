@@ -0,0 +1,204 @@
+#include "tile_render.h"
+#include "constants.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include <stdlib.h>
+
+#define CHUNK_PX_SIZE (TILE_CHUNK_SIZE * TILE_SIZE)
+
+TileLayer_t* create_tile_layer(void)
+{
+    TileLayer_t* layer = calloc(1, sizeof(TileLayer_t));
+    if (layer == NULL) return NULL;
+
+    // Textures are only loaded on first use
+    for (uint8_t i = 0; i < TILE_CHUNK_CACHE_SIZE; ++i)
+    {
+        layer->chunks[i].chunk_idx = -1;
+        for (uint8_t j = 0; j < N_TILE_CHUNK_LAYERS; ++j)
+        {
+            TileChunkLayer_t* chunk_layer = layer->chunks[i].layers + j;
+            chunk_layer->spr.texture = &chunk_layer->tex.texture;
+            chunk_layer->spr.frame_size = (Vector2){CHUNK_PX_SIZE, CHUNK_PX_SIZE};
+            chunk_layer->spr.frame_per_row = 1;
+            chunk_layer->spr.frame_count = 1;
+            update_sprite_frames(&chunk_layer->spr);
+            chunk_layer->node.spr = &chunk_layer->spr;
+            chunk_layer->node.scale = (Vector2){1, 1};
+            chunk_layer->node.colour = WHITE;
+            // Render textures are stored upside down
+            chunk_layer->node.flip = 2;
+        }
+    }
+    return layer;
+}
+
+void free_tile_layer(TileLayer_t* layer)
+{
+    if (layer == NULL) return;
+
+    for (uint8_t i = 0; i < TILE_CHUNK_CACHE_SIZE; ++i)
+    {
+        for (uint8_t j = 0; j < N_TILE_CHUNK_LAYERS; ++j)
+        {
+            if (layer->chunks[i].layers[j].tex.id != 0)
+            {
+                UnloadRenderTexture(layer->chunks[i].layers[j].tex);
+            }
+        }
+    }
+    free(layer);
+}
+
+static inline TileChunkLayerType_t get_tile_chunk_layer(const Tile_t* tile)
+{
+    return (tile->tile_type == LADDER) ? TILE_CHUNK_BACK : TILE_CHUNK_FRONT;
+}
+
+static void redraw_tile_chunk(TileChunk_t* chunk, const TileGrid_t* tilemap)
+{
+    TileArea_t area = get_chunk_tile_area(tilemap, chunk->chunk_idx);
+    Vector2 chunk_pos = {
+        area.tile_x1 * tilemap->tile_size,
+        area.tile_y1 * tilemap->tile_size
+    };
+
+    for (uint8_t j = 0; j < N_TILE_CHUNK_LAYERS; ++j)
+    {
+        chunk->layers[j].has_tiles = false;
+        chunk->layers[j].node.pos = chunk_pos;
+    }
+    for (unsigned int tile_y = area.tile_y1; tile_y <= area.tile_y2; tile_y++)
+    {
+        for (unsigned int tile_x = area.tile_x1; tile_x <= area.tile_x2; tile_x++)
+        {
+            unsigned int i = tile_y * tilemap->width + tile_x;
+            if (tilemap->tiles[i].tile_type == EMPTY_TILE) continue;
+            if (tilemap->render_nodes[i].spr == NULL) continue;
+
+            chunk->layers[get_tile_chunk_layer(tilemap->tiles + i)].has_tiles = true;
+        }
+    }
+
+    for (uint8_t j = 0; j < N_TILE_CHUNK_LAYERS; ++j)
+    {
+        TileChunkLayer_t* chunk_layer = chunk->layers + j;
+        if (!chunk_layer->has_tiles) continue;
+
+        if (chunk_layer->tex.id == 0)
+        {
+            chunk_layer->tex = LoadRenderTexture(CHUNK_PX_SIZE, CHUNK_PX_SIZE);
+        }
+
+        BeginTextureMode(chunk_layer->tex);
+            ClearBackground(BLANK);
+            // Tiles do not overlap, so copying the sprite pixels as is
+            // makes the chunk blend the same as drawing the tiles directly
+            rlSetBlendFactors(RL_ONE, RL_ZERO, RL_FUNC_ADD);
+            BeginBlendMode(BLEND_CUSTOM);
+            for (unsigned int tile_y = area.tile_y1; tile_y <= area.tile_y2; tile_y++)
+            {
+                for (unsigned int tile_x = area.tile_x1; tile_x <= area.tile_x2; tile_x++)
+                {
+                    unsigned int i = tile_y * tilemap->width + tile_x;
+                    if (tilemap->tiles[i].tile_type == EMPTY_TILE) continue;
+                    if (get_tile_chunk_layer(tilemap->tiles + i) != j) continue;
+
+                    const RenderInfoNode* node = tilemap->render_nodes + i;
+                    if (node->spr == NULL) continue;
+
+                    draw_sprite_pro(
+                        node->spr, node->frame_num, Vector2Subtract(node->pos, chunk_pos),
+                        node->rotation, node->flip, node->scale,
+                        node->colour
+                    );
+                }
+            }
+            EndBlendMode();
+        EndTextureMode();
+    }
+}
+
+static TileChunk_t* find_tile_chunk(TileLayer_t* layer, int32_t chunk_idx)
+{
+    for (uint8_t i = 0; i < TILE_CHUNK_CACHE_SIZE; ++i)
+    {
+        if (layer->chunks[i].chunk_idx == chunk_idx) return layer->chunks + i;
+    }
+    return NULL;
+}
+
+static TileChunk_t* evict_tile_chunk(TileLayer_t* layer)
+{
+    // Least recently used, but never one that is in view
+    TileChunk_t* oldest = NULL;
+    for (uint8_t i = 0; i < TILE_CHUNK_CACHE_SIZE; ++i)
+    {
+        TileChunk_t* chunk = layer->chunks + i;
+        if (chunk->chunk_idx < 0) return chunk;
+        if (chunk->last_used == layer->frame) continue;
+        if (oldest == NULL || chunk->last_used < oldest->last_used) oldest = chunk;
+    }
+    return oldest;
+}
+
+static void queue_tile_chunk_tiles(TileGrid_t* tilemap, int32_t chunk_idx, RenderManager* render_manager)
+{
+    TileArea_t area = get_chunk_tile_area(tilemap, chunk_idx);
+    for (unsigned int tile_y = area.tile_y1; tile_y <= area.tile_y2; tile_y++)
+    {
+        for (unsigned int tile_x = area.tile_x1; tile_x <= area.tile_x2; tile_x++)
+        {
+            unsigned int i = tile_y * tilemap->width + tile_x;
+            if (tilemap->tiles[i].tile_type == EMPTY_TILE) continue;
+
+            uint8_t depth = (get_tile_chunk_layer(tilemap->tiles + i) == TILE_CHUNK_BACK) ? TILE_BACK_DEPTH : TILE_FRONT_DEPTH;
+            add_render_node(render_manager, tilemap->render_nodes + i, depth);
+        }
+    }
+}
+
+void queue_tile_layer(TileLayer_t* layer, TileGrid_t* tilemap, TileArea_t view, RenderManager* render_manager)
+{
+    if (layer == NULL || tilemap->dirty_chunks == NULL) return;
+
+    layer->frame++;
+    TileArea_t chunk_view = get_chunks_in_area(tilemap, view);
+    for (unsigned int y = chunk_view.tile_y1; y <= chunk_view.tile_y2; y++)
+    {
+        for (unsigned int x = chunk_view.tile_x1; x <= chunk_view.tile_x2; x++)
+        {
+            int32_t chunk_idx = y * tilemap->chunk_width + x;
+            TileChunk_t* chunk = find_tile_chunk(layer, chunk_idx);
+            if (chunk == NULL)
+            {
+                chunk = evict_tile_chunk(layer);
+                if (chunk == NULL)
+                {
+                    // No free slot, queue the tiles one by one
+                    queue_tile_chunk_tiles(tilemap, chunk_idx, render_manager);
+                    continue;
+                }
+
+                chunk->chunk_idx = chunk_idx;
+                tilemap->dirty_chunks[chunk_idx] |= CHUNK_DIRTY_TILES;
+            }
+            chunk->last_used = layer->frame;
+
+            if (tilemap->dirty_chunks[chunk_idx] & CHUNK_DIRTY_TILES)
+            {
+                redraw_tile_chunk(chunk, tilemap);
+                tilemap->dirty_chunks[chunk_idx] &= ~CHUNK_DIRTY_TILES;
+            }
+
+            if (chunk->layers[TILE_CHUNK_BACK].has_tiles)
+            {
+                add_render_node(render_manager, &chunk->layers[TILE_CHUNK_BACK].node, TILE_BACK_DEPTH);
+            }
+            if (chunk->layers[TILE_CHUNK_FRONT].has_tiles)
+            {
+                add_render_node(render_manager, &chunk->layers[TILE_CHUNK_FRONT].node, TILE_FRONT_DEPTH);
+            }
+        }
+    }
+}
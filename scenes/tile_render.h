@@ -0,0 +1,43 @@
+#ifndef __TILE_RENDER_H
+#define __TILE_RENDER_H
+#include "scene_impl.h"
+
+#define TILE_CHUNK_CACHE_SIZE 32
+// Render depths of the tiles, ladders go behind everything
+#define TILE_BACK_DEPTH 0
+#define TILE_FRONT_DEPTH 2
+
+typedef enum TileChunkLayerType {
+    TILE_CHUNK_BACK = 0,
+    TILE_CHUNK_FRONT,
+    N_TILE_CHUNK_LAYERS,
+} TileChunkLayerType_t;
+
+// The texture is drawn through the render queue as a one frame sprite
+typedef struct TileChunkLayer {
+    RenderTexture2D tex;
+    Sprite_t spr;
+    RenderInfoNode node;
+    bool has_tiles;
+} TileChunkLayer_t;
+
+typedef struct TileChunk {
+    TileChunkLayer_t layers[N_TILE_CHUNK_LAYERS];
+    int32_t chunk_idx; // -1 if unused
+    uint32_t last_used;
+} TileChunk_t;
+
+// Static tiles drawn into a texture per tile chunk, so that a frame
+// only queues a few chunk quads instead of every visible tile
+struct TileLayer {
+    TileChunk_t chunks[TILE_CHUNK_CACHE_SIZE];
+    uint32_t frame;
+};
+
+TileLayer_t* create_tile_layer(void);
+void free_tile_layer(TileLayer_t* layer);
+
+// Redraw the dirty chunks in view and add them to the render queue.
+// Call outside of any texture mode
+void queue_tile_layer(TileLayer_t* layer, TileGrid_t* tilemap, TileArea_t view, RenderManager* render_manager);
+#endif // __TILE_RENDER_H
@@ -2,8 +2,78 @@
 #include "constants.h"
 #include "sc/queue/sc_queue.h"
 #include <stdio.h>
-Entity_t* create_water_runner(EntityManager_t* ent_manager, int32_t width, int32_t height, int32_t start_tile)
+
+WaterSolver_t* create_water_solver(uint32_t max_tiles)
 {
+    WaterSolver_t* solver = calloc(1, sizeof(WaterSolver_t));
+    if (solver == NULL) return NULL;
+
+    solver->bfs_tiles = calloc(max_tiles, sizeof(BFSTile_t));
+    solver->visited = calloc(max_tiles, sizeof(uint32_t));
+    solver->owner = calloc(max_tiles, sizeof(uint8_t));
+    solver->ca_level = calloc(max_tiles, sizeof(uint8_t));
+    solver->ca_cap = calloc(max_tiles, sizeof(uint8_t));
+    solver->ca_written = calloc(max_tiles, sizeof(uint8_t));
+    // A level has at most as many row blocks as tiles
+    solver->ca_block_flags = calloc(max_tiles, sizeof(uint8_t));
+    if (
+        solver->bfs_tiles == NULL || solver->visited == NULL || solver->owner == NULL
+        || solver->ca_level == NULL || solver->ca_cap == NULL || solver->ca_written == NULL || solver->ca_block_flags == NULL
+    )
+    {
+        free_water_solver(solver);
+        return NULL;
+    }
+    solver->max_tiles = max_tiles;
+    return solver;
+}
+
+void free_water_solver(WaterSolver_t* solver)
+{
+    if (solver == NULL) return;
+    free(solver->bfs_tiles);
+    free(solver->visited);
+    free(solver->owner);
+    free(solver->ca_level);
+    free(solver->ca_cap);
+    free(solver->ca_written);
+    free(solver->ca_block_flags);
+    free(solver);
+}
+
+void reset_water_basins(WaterSolver_t* solver)
+{
+    if (solver == NULL) return;
+    solver->ca_dirty = true;
+    for (uint8_t i = 0; i < MAX_WATER_RUNNERS; ++i)
+    {
+        CWaterRunner_t* p_crunner = solver->runners[i];
+        if (p_crunner == NULL) continue;
+
+        p_crunner->state = BFS_RESET;
+        p_crunner->bfs_epoch = 0;
+        p_crunner->n_sources = 1;
+        p_crunner->contact_slot = -1;
+    }
+}
+
+void set_water_mode(WaterSolver_t* solver, WaterMode_t mode)
+{
+    if (solver == NULL) return;
+    solver->mode = mode;
+    solver->ca_ticks = 0;
+    solver->ca_fractional = 0;
+    reset_water_basins(solver);
+}
+
+Entity_t* create_water_runner(EntityManager_t* ent_manager, WaterSolver_t* solver, int32_t start_tile)
+{
+    if (solver == NULL) return NULL;
+
+    uint8_t slot = 0;
+    while (slot < MAX_WATER_RUNNERS && solver->runners[slot] != NULL) slot++;
+    if (slot == MAX_WATER_RUNNERS) return NULL;
+
     Entity_t* p_filler = add_entity(ent_manager, DYNMEM_ENT_TAG);
     if (p_filler == NULL) return NULL;
     CWaterRunner_t* p_crunner = add_component(p_filler, CWATERRUNNER_T);
@@ -12,24 +82,24 @@ Entity_t* create_water_runner(EntityManager_t* ent_manager, int32_t width, int32
         remove_entity(ent_manager, p_filler->m_id);
         return NULL;
     }
-    int32_t total = width * height;
-    p_crunner->bfs_tilemap.tilemap = calloc(total, sizeof(BFSTile_t));
-    if (p_crunner->bfs_tilemap.tilemap == NULL)
-    {
-        remove_entity(ent_manager, p_filler->m_id);
-        return NULL;
-    }
-    p_crunner->bfs_tilemap.width = width;
-    p_crunner->bfs_tilemap.height = height;
-    p_crunner->bfs_tilemap.len = total;
+    p_crunner->solver = solver;
+    p_crunner->slot = slot;
+    p_crunner->n_sources = 1;
+    p_crunner->contact_slot = -1;
     p_crunner->movement_delay = 5;
     p_crunner->movement_speed = 6;
 
     sc_queue_init(&p_crunner->bfs_queue);
-    p_crunner->visited = calloc(total, sizeof(bool));
+    sc_heap_init(&p_crunner->lowest_heap, 0);
+    p_crunner->bfs_epoch = 0;
+    p_crunner->reroot = false;
 
     p_crunner->current_tile = start_tile;
-    p_crunner->target_tile = total;
+    p_crunner->target_tile = solver->max_tiles;
+    p_crunner->state = BFS_RESET;
+    solver->runners[slot] = p_crunner;
+    // Any merge involving an existing runner may no longer hold
+    reset_water_basins(solver);
 
     CTransform_t* p_ct = add_component(p_filler, CTRANSFORM_COMP_T);
     p_ct->movement_mode = KINEMATIC_MOVEMENT;
@@ -40,49 +110,84 @@ Entity_t* create_water_runner(EntityManager_t* ent_manager, int32_t width, int32
 void free_water_runner(Entity_t* ent, EntityManager_t* ent_manager)
 {
     CWaterRunner_t* p_crunner = get_component(ent, CWATERRUNNER_T);
-    free(p_crunner->bfs_tilemap.tilemap);
-    p_crunner->bfs_tilemap.tilemap = NULL;
-    free(p_crunner->visited);
-    p_crunner->visited = NULL;
+    WaterSolver_t* solver = p_crunner->solver;
+    solver->runners[p_crunner->slot] = NULL;
+    // The runners merged with this one need to find their own way again
+    reset_water_basins(solver);
     sc_queue_term(&p_crunner->bfs_queue);
+    sc_heap_term(&p_crunner->lowest_heap);
     remove_entity(ent_manager, ent->m_id);
 }
 
-static void runner_BFS(const TileGrid_t* tilemap, CWaterRunner_t* p_crunner, int32_t* lowest_tile, int32_t start_tile)
+static void runner_visit(CWaterRunner_t* p_crunner, int32_t idx, int32_t from)
+{
+    WaterSolver_t* solver = p_crunner->solver;
+    BFSTile_t* bfs_tile = solver->bfs_tiles + idx;
+    solver->visited[idx] = p_crunner->bfs_epoch;
+    solver->owner[idx] = p_crunner->slot;
+    bfs_tile->from = from;
+    bfs_tile->depth = (from >= 0) ? solver->bfs_tiles[from].depth + 1 : 0;
+    sc_queue_add_last(&p_crunner->bfs_queue, idx);
+
+    // Order by lowest row first, then by visiting order
+    int32_t row = idx / solver->width;
+    int64_t key = ((int64_t)(solver->height - row) << 32) | p_crunner->visit_seq++;
+    sc_heap_add(&p_crunner->lowest_heap, key, (void*)(intptr_t)idx);
+}
+
+static void runner_BFS_restart(CWaterRunner_t* p_crunner, int32_t root_tile)
+{
+    WaterSolver_t* solver = p_crunner->solver;
+    solver->next_stamp++;
+    if (solver->next_stamp == 0)
+    {
+        // Only happens on wrap around, so this is cheap on average
+        // Every other search goes along with it
+        memset(solver->visited, 0, solver->max_tiles * sizeof(uint32_t));
+        solver->next_stamp = 1;
+        reset_water_basins(solver);
+    }
+    p_crunner->bfs_epoch = solver->next_stamp;
+    p_crunner->visit_seq = 0;
+    sc_queue_clear(&p_crunner->bfs_queue);
+    sc_heap_clear(&p_crunner->lowest_heap);
+    runner_visit(p_crunner, root_tile, -1);
+}
+
+static inline bool runner_reached(const CWaterRunner_t* p_crunner, int32_t idx)
+{
+    return p_crunner->solver->visited[idx] == p_crunner->bfs_epoch;
+}
+
+// Returns the slot of the runner whose ongoing search has reached the tile, -1 if none
+static int8_t tile_search_owner(const WaterSolver_t* solver, int32_t idx)
+{
+    uint32_t stamp = solver->visited[idx];
+    if (stamp == 0) return -1;
+
+    const CWaterRunner_t* p_other = solver->runners[solver->owner[idx]];
+    if (p_other == NULL || p_other->bfs_epoch != stamp) return -1;
+    return solver->owner[idx];
+}
+
+// Expand the tiles in the queue. The reachable set is kept across calls,
+// so queued tiles only explore neighbours that are not reached yet.
+// Tiles held by another runner are not entered, only noted as a contact
+static void runner_BFS(const TileGrid_t* tilemap, CWaterRunner_t* p_crunner)
 {
-    memset(p_crunner->visited, 0, p_crunner->bfs_tilemap.len * sizeof(bool));
-    p_crunner->visited[start_tile] = true;
-    p_crunner->bfs_tilemap.tilemap[start_tile].reachable = true;
-    sc_queue_add_last(&p_crunner->bfs_queue, start_tile);
-    int init_height = start_tile / p_crunner->bfs_tilemap.width;
-    bool first_reached = false;
+    WaterSolver_t* solver = p_crunner->solver;
     while (!sc_queue_empty(&p_crunner->bfs_queue))
     {
         const int curr_idx = sc_queue_peek_first(&p_crunner->bfs_queue);
         sc_queue_del_first(&p_crunner->bfs_queue);
 
-        int curr_height = curr_idx / p_crunner->bfs_tilemap.width;
-        int curr_low = *lowest_tile / p_crunner->bfs_tilemap.width;
-
-        // Possible optimisation to avoid repeated BFS, dunno how possible
-
         bool to_go[4] = {false, false, false, false};
         Tile_t* curr_tile = tilemap->tiles + curr_idx;
 
-        int next = curr_idx + p_crunner->bfs_tilemap.width;
+        int next = curr_idx + solver->width;
         Tile_t* next_tile = tilemap->tiles + next;
 
-        if (
-            ((curr_height <= init_height && !first_reached) || curr_height > curr_low)
-            && curr_tile->water_level < curr_tile->max_water_level
-        )
-        {
-            first_reached = true;
-            *lowest_tile = curr_idx;
-        }
-
-
-        if (next < p_crunner->bfs_tilemap.len)
+        if (next < solver->len)
         {
             to_go[0] = (next_tile->solid != SOLID && next_tile->max_water_level == MAX_WATER_LEVEL);
 
@@ -92,14 +197,14 @@ static void runner_BFS(const TileGrid_t* tilemap, CWaterRunner_t* p_crunner, int
                 || curr_tile->water_level >= curr_tile->max_water_level
             )
             {
-                if (curr_idx % p_crunner->bfs_tilemap.width != 0)
+                if (curr_idx % solver->width != 0)
                 {
                     next = curr_idx - 1;
                     next_tile = tilemap->tiles + next;
                     to_go[1] = (next_tile->solid != SOLID && next_tile->max_water_level == MAX_WATER_LEVEL);
                 }
                 next = curr_idx + 1;
-                if (next % p_crunner->bfs_tilemap.width != 0)
+                if (next % solver->width != 0)
                 {
                     next_tile = tilemap->tiles + next;
                     to_go[2] = (next_tile->solid != SOLID && next_tile->max_water_level == MAX_WATER_LEVEL);
@@ -110,7 +215,7 @@ static void runner_BFS(const TileGrid_t* tilemap, CWaterRunner_t* p_crunner, int
         if (curr_tile->water_level >= curr_tile->max_water_level)
         {
 
-            next = curr_idx - p_crunner->bfs_tilemap.width;
+            next = curr_idx - solver->width;
             if (next >= 0)
             {
                 next_tile = tilemap->tiles + next;
@@ -118,16 +223,383 @@ static void runner_BFS(const TileGrid_t* tilemap, CWaterRunner_t* p_crunner, int
             }
         }
 
-        const int8_t offsets[4] = {p_crunner->bfs_tilemap.width, -1, 1, -p_crunner->bfs_tilemap.width};
+        const int32_t offsets[4] = {solver->width, -1, 1, -solver->width};
         for (uint8_t i = 0; i < 4; ++i)
         {
             next = curr_idx + offsets[i];
-            if (to_go[i] && !p_crunner->visited[next])
+            if (!to_go[i] || runner_reached(p_crunner, next)) continue;
+
+            int8_t other_slot = tile_search_owner(solver, next);
+            if (other_slot >= 0)
             {
-                sc_queue_add_last(&p_crunner->bfs_queue, next);
-                p_crunner->bfs_tilemap.tilemap[next].from = curr_idx;
-                p_crunner->visited[next] = true;
-                p_crunner->bfs_tilemap.tilemap[next].reachable = true;
+                p_crunner->contact_slot = other_slot;
+                continue;
+            }
+            runner_visit(p_crunner, next, curr_idx);
+        }
+    }
+}
+
+// Returns the lowest reachable tile that can still take water, -1 if none.
+// Water only rises while the search is valid, so tiles found full are dropped
+// for good. Filling a tile opens up its sides and the tile above it,
+// so those are re-explored. This is the only part of the map revisited
+static int32_t runner_find_lowest(const TileGrid_t* tilemap, CWaterRunner_t* p_crunner)
+{
+    runner_BFS(tilemap, p_crunner);
+    struct sc_heap_data* top;
+    while ((top = sc_heap_peek(&p_crunner->lowest_heap)) != NULL)
+    {
+        int32_t idx = (int32_t)(intptr_t)top->data;
+        Tile_t* tile = tilemap->tiles + idx;
+        if (tile->water_level < tile->max_water_level) return idx;
+
+        sc_heap_pop(&p_crunner->lowest_heap);
+        sc_queue_add_last(&p_crunner->bfs_queue, idx);
+        int32_t up_idx = idx - p_crunner->solver->width;
+        if (up_idx >= 0 && runner_reached(p_crunner, up_idx))
+        {
+            sc_queue_add_last(&p_crunner->bfs_queue, up_idx);
+        }
+        runner_BFS(tilemap, p_crunner);
+    }
+    return -1;
+}
+
+// Two runners share a basin if one runs into the search of the other,
+// which is filling at the same height or lower. The water is then handed over
+// so that the basin is filled by one runner at the combined rate
+static bool runner_try_merge(CWaterRunner_t* p_crunner, int32_t lowest_tile)
+{
+    if (p_crunner->contact_slot < 0) return false;
+
+    WaterSolver_t* solver = p_crunner->solver;
+    CWaterRunner_t* p_other = solver->runners[p_crunner->contact_slot];
+    if (p_other == NULL || p_other->bfs_epoch == 0)
+    {
+        p_crunner->contact_slot = -1;
+        return false;
+    }
+
+    int32_t other_tile = (p_other->target_tile < solver->len) ? p_other->target_tile : p_other->current_tile;
+    if (lowest_tile >= 0 && lowest_tile / solver->width > other_tile / solver->width) return false;
+
+    p_other->n_sources += p_crunner->n_sources;
+    p_crunner->n_sources = 0;
+    p_crunner->bfs_epoch = 0;
+    p_crunner->contact_slot = -1;
+    p_crunner->state = RUNNER_MERGED;
+    // Let the other runner search through the tiles given up
+    p_other->state = BFS_RESET;
+    return true;
+}
+
+// Link the path from the current tile to the target through the search tree.
+// The current tile need not be the root, so go up to the common ancestor first
+static void runner_trace_path(CWaterRunner_t* p_crunner, int32_t target_tile)
+{
+    BFSTile_t* bfs_tiles = p_crunner->solver->bfs_tiles;
+    int32_t up_idx = p_crunner->current_tile;
+    int32_t down_idx = target_tile;
+    bfs_tiles[target_tile].to = -1;
+    while (up_idx != down_idx)
+    {
+        if (bfs_tiles[up_idx].depth >= bfs_tiles[down_idx].depth)
+        {
+            bfs_tiles[up_idx].to = bfs_tiles[up_idx].from;
+            up_idx = bfs_tiles[up_idx].from;
+        }
+        else
+        {
+            int32_t prev_idx = bfs_tiles[down_idx].from;
+            bfs_tiles[prev_idx].to = down_idx;
+            down_idx = prev_idx;
+        }
+    }
+}
+
+// ---------------------------- Cellular water mode -----------------------------
+// Water levels are kept in packed byte arrays and stepped at a fixed rate:
+//  - Each runner adds a unit of water at its tile, or the first tile above it with space
+//  - Water falls through empty tiles to where it lands, as much as the tile there can take
+//  - Water then levels out sideways between tile pairs, alternating which pairs go first
+//  - Pairs only move half their difference, so a run of resting water that ends up
+//    as a staircase of single steps is levelled out as a whole
+// There is no floating point state in the levels, so the result only depends on the steps taken.
+// Activity is kept per block of CA_BLOCK_SIZE tiles in a row. A block op is skipped if
+// no water moved in the blocks it reads, in this step and the last, as it would move nothing again.
+// Settled basins then cost nothing, and separate streams do not keep each other awake
+#define WATER_CA_STEP (1.0f/22)
+#define CA_BLOCK_SIZE 16
+#define CA_BLOCK_ACTIVE_PREV (1 << 0)
+#define CA_BLOCK_ACTIVE_NOW (1 << 1)
+#define CA_BLOCK_WRITEBACK (1 << 2)
+#define CA_BLOCK_ACTIVE (CA_BLOCK_ACTIVE_PREV | CA_BLOCK_ACTIVE_NOW)
+
+static void water_ca_gather(WaterSolver_t* solver, const TileGrid_t* tilemap)
+{
+    for (int32_t i = 0; i < solver->len; ++i)
+    {
+        const Tile_t* tile = tilemap->tiles + i;
+        uint8_t cap = (tile->solid == SOLID) ? 0 : tile->max_water_level;
+        solver->ca_cap[i] = cap;
+        solver->ca_level[i] = (tile->water_level < cap) ? tile->water_level : cap;
+        // Forces the first write back, so that the wet flags follow the levels
+        solver->ca_written[i] = ~solver->ca_level[i];
+    }
+    solver->ca_row_blocks = (solver->width + CA_BLOCK_SIZE - 1) / CA_BLOCK_SIZE;
+    memset(
+        solver->ca_block_flags, CA_BLOCK_ACTIVE_PREV | CA_BLOCK_WRITEBACK,
+        solver->ca_row_blocks * solver->height
+    );
+    solver->ca_dirty = false;
+}
+
+static inline void water_ca_mark(uint8_t* row_flags, int32_t x1, int32_t x2)
+{
+    for (int32_t b = x1 / CA_BLOCK_SIZE; b <= x2 / CA_BLOCK_SIZE; ++b)
+    {
+        row_flags[b] |= CA_BLOCK_ACTIVE_NOW;
+    }
+}
+
+// Drops the water in [x1, x2) of a row into the tiles below
+static void water_ca_fall(WaterSolver_t* solver, int32_t y, int32_t x1, int32_t x2)
+{
+    uint8_t* lvl = solver->ca_level;
+    const uint8_t* cap = solver->ca_cap;
+    const int32_t width = solver->width;
+    for (int32_t idx = y * width + x1; idx < y * width + x2; ++idx)
+    {
+        int32_t below = idx + width;
+        if (lvl[idx] == 0 || lvl[below] == cap[below]) continue;
+
+        // Water goes through empty tiles in one go, to where it lands
+        while (
+            lvl[below] == 0 && below + width < solver->len
+            && lvl[below + width] < cap[below + width]
+        ) below += width;
+
+        uint8_t space = cap[below] - lvl[below];
+        uint8_t flow = (lvl[idx] < space) ? lvl[idx] : space;
+        lvl[idx] -= flow;
+        lvl[below] += flow;
+        water_ca_mark(solver->ca_block_flags + y * solver->ca_row_blocks, idx - y * width, idx - y * width);
+        water_ca_mark(
+            solver->ca_block_flags + (below / width) * solver->ca_row_blocks,
+            below % width, below % width
+        );
+    }
+}
+
+// Moves water between the pairs starting in [x1, x2). Returns non-zero if any water moved
+static int16_t water_ca_spread(uint8_t* restrict lvl, const uint8_t* restrict cap, int32_t x1, int32_t x2)
+{
+    int16_t moved = 0;
+    for (int32_t x = x1; x < x2; x += 2)
+    {
+        // Half the difference goes to the lower side, limited by the space there
+        int16_t flow = (lvl[x] - lvl[x + 1]) / 2;
+        int16_t space_right = cap[x + 1] - lvl[x + 1];
+        int16_t space_left = cap[x] - lvl[x];
+        flow = (flow > space_right) ? space_right : flow;
+        flow = (flow < -space_left) ? -space_left : flow;
+        lvl[x] -= flow;
+        lvl[x + 1] += flow;
+        moved |= flow;
+    }
+    return moved;
+}
+
+static void water_ca_spread_row(WaterSolver_t* solver, int32_t y, int32_t first)
+{
+    const int32_t width = solver->width;
+    const int32_t n_blocks = solver->ca_row_blocks;
+    uint8_t* row = solver->ca_level + y * width;
+    const uint8_t* cap_row = solver->ca_cap + y * width;
+    uint8_t* row_flags = solver->ca_block_flags + y * n_blocks;
+
+    for (int32_t b = 0; b < n_blocks; ++b)
+    {
+        // The pairs at the block edges read the neighbouring blocks
+        uint8_t active = row_flags[b];
+        if (b > 0) active |= row_flags[b - 1];
+        if (b < n_blocks - 1) active |= row_flags[b + 1];
+        if ((active & CA_BLOCK_ACTIVE) == 0) continue;
+
+        int32_t x2 = (b + 1) * CA_BLOCK_SIZE;
+        if (x2 > width - 1) x2 = width - 1;
+        if (water_ca_spread(row, cap_row, b * CA_BLOCK_SIZE + first, x2))
+        {
+            row_flags[b] |= CA_BLOCK_ACTIVE_NOW;
+            if (first == 1 && b < n_blocks - 1) row_flags[b + 1] |= CA_BLOCK_ACTIVE_NOW;
+        }
+    }
+}
+
+static inline bool water_ca_resting(const WaterSolver_t* solver, int32_t idx)
+{
+    if (solver->ca_cap[idx] == 0) return false;
+    int32_t below = idx + solver->width;
+    return below >= solver->len || solver->ca_level[below] == solver->ca_cap[below];
+}
+
+// Levels out the run of resting water through x. Returns the end of the run
+static int32_t water_ca_level_run(WaterSolver_t* solver, int32_t y, int32_t x)
+{
+    const int32_t width = solver->width;
+    uint8_t* row = solver->ca_level + y * width;
+    const uint8_t* cap_row = solver->ca_cap + y * width;
+    const int32_t row_start = y * width;
+    if (!water_ca_resting(solver, row_start + x)) return x;
+
+    int32_t x1 = x;
+    while (x1 > 0 && water_ca_resting(solver, row_start + x1 - 1)) x1--;
+
+    uint32_t total = row[x1];
+    uint8_t lo = row[x1];
+    uint8_t hi = row[x1];
+    uint8_t min_cap = cap_row[x1];
+    bool stepped = true;
+    int32_t x2 = x1 + 1;
+    for (; x2 < width && water_ca_resting(solver, row_start + x2); ++x2)
+    {
+        int16_t diff = row[x2] - row[x2 - 1];
+        stepped &= (diff >= -1 && diff <= 1);
+        total += row[x2];
+        if (row[x2] < lo) lo = row[x2];
+        if (row[x2] > hi) hi = row[x2];
+        if (cap_row[x2] < min_cap) min_cap = cap_row[x2];
+    }
+
+    // Larger steps are still being spread by the pairs
+    if (!stepped || hi - lo <= 1) return x2;
+
+    const int32_t n = x2 - x1;
+    const uint8_t base = total / n;
+    int32_t extra = total % n;
+    if (base + (extra > 0) > min_cap) return x2;
+
+    for (int32_t i = x1; i < x2; ++i)
+    {
+        row[i] = base + (extra > 0);
+        if (extra > 0) extra--;
+    }
+    water_ca_mark(solver->ca_block_flags + y * solver->ca_row_blocks, x1, x2 - 1);
+    return x2;
+}
+
+static void water_ca_level_row(WaterSolver_t* solver, int32_t y)
+{
+    const uint8_t* row_flags = solver->ca_block_flags + y * solver->ca_row_blocks;
+    int32_t scanned = 0;
+    for (int32_t b = 0; b < solver->ca_row_blocks; ++b)
+    {
+        if ((row_flags[b] & CA_BLOCK_ACTIVE) == 0) continue;
+
+        int32_t x = (b * CA_BLOCK_SIZE > scanned) ? b * CA_BLOCK_SIZE : scanned;
+        int32_t x_end = (b + 1) * CA_BLOCK_SIZE;
+        if (x_end > solver->width) x_end = solver->width;
+        for (; x < x_end; ++x)
+        {
+            x = water_ca_level_run(solver, y, x);
+        }
+        scanned = x;
+    }
+}
+
+static void water_ca_add_source(WaterSolver_t* solver, int32_t tile_idx)
+{
+    // A full source pushes the water up the column, as a runner would climb
+    while (tile_idx >= 0 && solver->ca_cap[tile_idx] > 0)
+    {
+        if (solver->ca_level[tile_idx] < solver->ca_cap[tile_idx])
+        {
+            solver->ca_level[tile_idx]++;
+            int32_t y = tile_idx / solver->width;
+            int32_t x = tile_idx % solver->width;
+            water_ca_mark(solver->ca_block_flags + y * solver->ca_row_blocks, x, x);
+            return;
+        }
+        tile_idx -= solver->width;
+    }
+}
+
+static void water_ca_step(WaterSolver_t* solver)
+{
+    CWaterRunner_t* p_crunner;
+    for (uint8_t i = 0; i < MAX_WATER_RUNNERS; ++i)
+    {
+        p_crunner = solver->runners[i];
+        if (p_crunner == NULL) continue;
+        water_ca_add_source(solver, p_crunner->current_tile);
+    }
+
+    const int32_t width = solver->width;
+    const int32_t n_blocks = solver->ca_row_blocks;
+    uint8_t* flags = solver->ca_block_flags;
+    for (int32_t y = solver->height - 2; y >= 0; --y)
+    {
+        const uint8_t* row_flags = flags + y * n_blocks;
+        for (int32_t b = 0; b < n_blocks; ++b)
+        {
+            if (((row_flags[b] | row_flags[b + n_blocks]) & CA_BLOCK_ACTIVE) == 0) continue;
+
+            int32_t x2 = (b + 1) * CA_BLOCK_SIZE;
+            water_ca_fall(solver, y, b * CA_BLOCK_SIZE, (x2 > width) ? width : x2);
+        }
+    }
+
+    const int32_t first = solver->ca_ticks & 1;
+    for (int32_t y = 0; y < solver->height; ++y)
+    {
+        water_ca_spread_row(solver, y, first);
+        water_ca_spread_row(solver, y, first ^ 1);
+        water_ca_level_row(solver, y);
+    }
+
+    // This step becomes the previous one
+    for (int32_t i = 0; i < n_blocks * solver->height; ++i)
+    {
+        flags[i] = (flags[i] & CA_BLOCK_WRITEBACK)
+            | ((flags[i] & CA_BLOCK_ACTIVE_NOW) ? (CA_BLOCK_ACTIVE_PREV | CA_BLOCK_WRITEBACK) : 0);
+    }
+    solver->ca_ticks++;
+}
+
+static void water_ca_update(WaterSolver_t* solver, TileGrid_t* tilemap, float delta_time)
+{
+    if (solver->ca_dirty) water_ca_gather(solver, tilemap);
+
+    solver->ca_fractional += delta_time;
+    if (solver->ca_fractional < WATER_CA_STEP) return;
+
+    while (solver->ca_fractional >= WATER_CA_STEP)
+    {
+        water_ca_step(solver);
+        solver->ca_fractional -= WATER_CA_STEP;
+    }
+
+    const int32_t n_blocks = solver->ca_row_blocks;
+    for (int32_t y = 0; y < solver->height; ++y)
+    {
+        uint8_t* row_flags = solver->ca_block_flags + y * n_blocks;
+        for (int32_t b = 0; b < n_blocks; ++b)
+        {
+            if ((row_flags[b] & CA_BLOCK_WRITEBACK) == 0) continue;
+
+            row_flags[b] &= ~CA_BLOCK_WRITEBACK;
+            int32_t x_end = (b + 1) * CA_BLOCK_SIZE;
+            if (x_end > solver->width) x_end = solver->width;
+            for (int32_t i = y * solver->width + b * CA_BLOCK_SIZE; i < y * solver->width + x_end; ++i)
+            {
+                // Only touch the tiles whose level changed since the last write back
+                if (solver->ca_written[i] == solver->ca_level[i]) continue;
+
+                solver->ca_written[i] = solver->ca_level[i];
+                tilemap->tiles[i].water_level = solver->ca_level[i];
+                tilemap->tiles[i].wet = solver->ca_level[i] > 0;
+                mark_tile_dirty(tilemap, i);
             }
         }
     }
@@ -155,6 +627,16 @@ void update_water_runner_system(Scene_t* scene)
     // Repeat scanline fill
     LevelSceneData_t* data = &(CONTAINER_OF(scene, LevelScene_t, scene)->data);
     TileGrid_t tilemap = data->tilemap;
+    WaterSolver_t* solver = data->water_solver;
+    if (solver == NULL) return;
+
+    if (solver->width != (int32_t)tilemap.width || solver->height != (int32_t)tilemap.height)
+    {
+        solver->width = tilemap.width;
+        solver->height = tilemap.height;
+        solver->len = tilemap.n_tiles;
+        reset_water_basins(solver);
+    }
 
     CWaterRunner_t* p_crunner;
     unsigned int ent_idx;
@@ -176,40 +658,54 @@ void update_water_runner_system(Scene_t* scene)
             free_water_runner(ent, &scene->ent_manager);
             continue;
         }
+        if (solver->mode == WATER_MODE_CELLULAR) continue;
 
         switch (p_crunner->state)
         {
             case BFS_RESET:
-                for (int32_t i = 0; i < p_crunner->bfs_tilemap.len; ++i)
+            {
+                // Starting inside another search means sharing its basin
+                p_crunner->bfs_epoch = 0;
+                int8_t other_slot = tile_search_owner(solver, p_crunner->current_tile);
+                if (other_slot >= 0)
                 {
-                    //p_crunner->bfs_tilemap.tilemap[i].to = -1;
-                    p_crunner->bfs_tilemap.tilemap[i].from = -1;
-                    p_crunner->bfs_tilemap.tilemap[i].reachable = false;
+                    p_crunner->contact_slot = other_slot;
+                    if (runner_try_merge(p_crunner, -1)) break;
                 }
+                // Start a new search rooted at the current tile
+                runner_BFS_restart(p_crunner, p_crunner->current_tile);
+                p_crunner->reroot = false;
                 p_crunner->state = LOWEST_POINT_SEARCH;
+            }
                 // Want the fallthough
             case LOWEST_POINT_SEARCH:
             {
-                int32_t lowest_tile = p_crunner->current_tile - p_crunner->bfs_tilemap.width;
-                if (lowest_tile <= 0) lowest_tile = p_crunner->current_tile;
-
-                runner_BFS(&tilemap, p_crunner, &lowest_tile, p_crunner->current_tile);
-                p_crunner->target_tile = lowest_tile;
-                // Trace path from lowest_tile
-                int prev_idx = lowest_tile;
-                int curr_idx = p_crunner->bfs_tilemap.tilemap[prev_idx].from;
-                while (p_crunner->bfs_tilemap.tilemap[prev_idx].from >= 0)
+                if (!runner_reached(p_crunner, p_crunner->current_tile))
+                {
+                    p_crunner->state = BFS_RESET;
+                    break;
+                }
+                int32_t lowest_tile = runner_find_lowest(&tilemap, p_crunner);
+                if (runner_try_merge(p_crunner, lowest_tile)) break;
+                if (lowest_tile < 0)
                 {
-                    p_crunner->bfs_tilemap.tilemap[curr_idx].to = prev_idx;
-                    prev_idx = curr_idx;
-                    curr_idx = p_crunner->bfs_tilemap.tilemap[prev_idx].from;
+                    // Everything reachable is filled. Only a tile change can undo this
+                    p_crunner->state = FILL_COMPLETE;
+                    break;
                 }
-                p_crunner->bfs_tilemap.tilemap[lowest_tile].to = -1;
-                if (prev_idx == lowest_tile)
+                p_crunner->target_tile = lowest_tile;
+                if (lowest_tile == p_crunner->current_tile)
                 {
                     p_crunner->state = REACHABILITY_SEARCH;
                     break;
                 }
+                // Going lower means spilling over into a new basin.
+                // Search again from there so that only that basin is filled
+                p_crunner->reroot = (
+                    lowest_tile / solver->width
+                    > p_crunner->current_tile / solver->width
+                );
+                runner_trace_path(p_crunner, lowest_tile);
                 p_crunner->counter = p_crunner->movement_delay;
                 p_crunner->state = LOWEST_POINT_MOVEMENT;
             }
@@ -222,12 +718,16 @@ void update_water_runner_system(Scene_t* scene)
                     int8_t move_left = p_crunner->movement_speed;
                     while (move_left)
                     {
-                        p_crunner->current_tile = p_crunner->bfs_tilemap.tilemap[p_crunner->current_tile].to;
+                        p_crunner->current_tile = solver->bfs_tiles[p_crunner->current_tile].to;
                         ent->position.x = (p_crunner->current_tile % tilemap.width) * tilemap.tile_size; 
                         ent->position.y = (p_crunner->current_tile / tilemap.width) * tilemap.tile_size; 
 
                         Tile_t* tile = tilemap.tiles + p_crunner->current_tile;
-                        tile->wet = true;
+                        if (!tile->wet)
+                        {
+                            tile->wet = true;
+                            mark_tile_dirty(&tilemap, p_crunner->current_tile);
+                        }
                         move_left--;
                         if (tile->water_level != tile->max_water_level)
                         {
@@ -235,7 +735,7 @@ void update_water_runner_system(Scene_t* scene)
                         }
                         if (p_crunner->current_tile == p_crunner->target_tile)
                         {
-                            p_crunner->state = REACHABILITY_SEARCH;
+                            p_crunner->state = p_crunner->reroot ? BFS_RESET : REACHABILITY_SEARCH;
                             break;
                         }
                         p_crunner->counter = p_crunner->movement_delay;
@@ -247,35 +747,25 @@ void update_water_runner_system(Scene_t* scene)
                 Tile_t* curr_tile = tilemap.tiles + p_crunner->current_tile;
                 if (curr_tile->water_level >= curr_tile->max_water_level)
                 {
-                    p_crunner->state = BFS_RESET;
+                    p_crunner->state = LOWEST_POINT_SEARCH;
                     break;
                 }
                 int start_tile =
-                    (p_crunner->current_tile / p_crunner->bfs_tilemap.width) * p_crunner->bfs_tilemap.width;
-
-                for (int32_t i = 0; i < p_crunner->bfs_tilemap.width; ++i)
-                {
-                    p_crunner->bfs_tilemap.tilemap[start_tile + i].reachable = false;
-                }
-
-                int32_t lowest_tile = p_crunner->current_tile;
-                runner_BFS(&tilemap, p_crunner, &lowest_tile, p_crunner->current_tile);
+                    (p_crunner->current_tile / solver->width) * solver->width;
 
-                for (int i = 0; i < p_crunner->bfs_tilemap.width; ++i)
+                // The search is up to date here, so the fill range is
+                // just the reached part of the row
+                for (int i = 0; i < solver->width; ++i)
                 {
-                    if (
-                        p_crunner->bfs_tilemap.tilemap[start_tile + i].reachable
-                    )
+                    if (runner_reached(p_crunner, start_tile + i))
                     {
                         p_crunner->fill_range[0] = i;
                         break;
                     }
                 }
-                for (int i = p_crunner->bfs_tilemap.width - 1; i >= 0; --i)
+                for (int i = solver->width - 1; i >= 0; --i)
                 {
-                    if (
-                        p_crunner->bfs_tilemap.tilemap[start_tile + i].reachable
-                    )
+                    if (runner_reached(p_crunner, start_tile + i))
                     {
                         p_crunner->fill_range[1] = i;
                         break;
@@ -290,32 +780,33 @@ void update_water_runner_system(Scene_t* scene)
             case SCANLINE_FILL:
             {
                 const float FILL_RATE = 1.0f/22;
-                p_crunner->fractional += scene->delta_time;
+                // Merged runners fill at their combined rate
+                p_crunner->fractional += scene->delta_time * p_crunner->n_sources;
                 if (p_crunner->fractional < FILL_RATE) break;
 
                 // Unsigned usage here is okay
                 unsigned int start_tile =
-                    (p_crunner->current_tile / p_crunner->bfs_tilemap.width) * p_crunner->bfs_tilemap.width;
-                //for (size_t i = 0; i < 10; ++i)
+                    (p_crunner->current_tile / solver->width) * solver->width;
+                for (uint8_t i = 0; i < p_crunner->n_sources && p_crunner->fractional >= FILL_RATE; ++i)
                 {
                     unsigned int curr_idx = start_tile + p_crunner->fill_idx;
                     Tile_t* curr_tile = tilemap.tiles + curr_idx;
-                    if (
-                        p_crunner->bfs_tilemap.tilemap[curr_idx].reachable
-                    )
+                    if (runner_reached(p_crunner, curr_idx))
                     {
                         if (curr_tile->water_level < curr_tile->max_water_level)
                         {
                             curr_tile->water_level++;
                             p_crunner->fractional -= FILL_RATE;
+                            mark_tile_dirty(&tilemap, curr_idx);
                         }
                         if (curr_tile->water_level < curr_tile->max_water_level)
                         {
                             p_crunner->counter++;
                         }
-                        else
+                        else if (curr_tile->wet)
                         {
                             curr_tile->wet = false;
+                            mark_tile_dirty(&tilemap, curr_idx);
                         }
                     }
 
@@ -325,7 +816,8 @@ void update_water_runner_system(Scene_t* scene)
                     {
                         if (p_crunner->counter == 0)
                         {
-                            p_crunner->state = BFS_RESET;
+                            // Row is filled, continue from the existing search
+                            p_crunner->state = LOWEST_POINT_SEARCH;
                             break;
                         }
                         p_crunner->counter = 0;
@@ -338,6 +830,11 @@ void update_water_runner_system(Scene_t* scene)
             break;
         }
     }
+
+    if (solver->mode == WATER_MODE_CELLULAR)
+    {
+        water_ca_update(solver, &tilemap, scene->delta_time);
+    }
 }
 
 void init_water_runner_system(void)
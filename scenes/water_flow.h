@@ -2,9 +2,49 @@
 #define __WATER_FLOW_H
 #include "scene_impl.h"
 #include "ent_impl.h"
-Entity_t* create_water_runner(EntityManager_t* ent_manager, int32_t width, int32_t height, int32_t start_tile);
+
+typedef enum WaterMode {
+    WATER_MODE_RUNNER = 0,
+    // Runners only act as sources, water_level is simulated as a cellular automaton
+    WATER_MODE_CELLULAR,
+} WaterMode_t;
+
+// Level-wide search data shared by all the water runners.
+// A tile belongs to at most one runner search at a time, which is
+// identified by the stamp in visited and the runner slot in owner
+struct WaterSolver {
+    BFSTile_t* bfs_tiles;
+    uint32_t* visited;
+    uint8_t* owner;
+    uint32_t max_tiles;
+    int32_t width;
+    int32_t height;
+    int32_t len;
+    uint32_t next_stamp;
+    CWaterRunner_t* runners[MAX_WATER_RUNNERS];
+
+    WaterMode_t mode;
+    // Packed copies of the tile water levels and capacities for the cellular mode
+    uint8_t* ca_level;
+    uint8_t* ca_cap;
+    // Levels as last written back to the tiles
+    uint8_t* ca_written;
+    // Activity per block of tiles in a row, so that settled water is skipped
+    uint8_t* ca_block_flags;
+    int32_t ca_row_blocks;
+    bool ca_dirty;
+    uint32_t ca_ticks;
+    float ca_fractional;
+};
+
+WaterSolver_t* create_water_solver(uint32_t max_tiles);
+void free_water_solver(WaterSolver_t* solver);
+// Drop all runner searches and merges. Call when the level solidity changes
+void reset_water_basins(WaterSolver_t* solver);
+void set_water_mode(WaterSolver_t* solver, WaterMode_t mode);
+
+Entity_t* create_water_runner(EntityManager_t* ent_manager, WaterSolver_t* solver, int32_t start_tile);
 void free_water_runner(Entity_t* ent, EntityManager_t* ent_manager);
 
 void update_water_runner_system(Scene_t* scene);
 #endif // __WATER_FLOW_H
-
@@ -0,0 +1,231 @@
+#include "water_render.h"
+#include "constants.h"
+#include "rlgl.h"
+#include <stdlib.h>
+
+#define SURFACE_THICKNESS 4
+#define CHUNK_PX_SIZE (TILE_CHUNK_SIZE * TILE_SIZE)
+
+WaterLayer_t* create_water_layer(void)
+{
+    WaterLayer_t* layer = calloc(1, sizeof(WaterLayer_t));
+    if (layer == NULL) return NULL;
+
+    // Textures are only loaded on first use
+    for (uint8_t i = 0; i < WATER_CHUNK_CACHE_SIZE; ++i)
+    {
+        layer->chunks[i].chunk_idx = -1;
+    }
+    return layer;
+}
+
+void free_water_layer(WaterLayer_t* layer)
+{
+    if (layer == NULL) return;
+
+    for (uint8_t i = 0; i < WATER_CHUNK_CACHE_SIZE; ++i)
+    {
+        if (layer->chunks[i].tex.id != 0)
+        {
+            UnloadRenderTexture(layer->chunks[i].tex);
+        }
+    }
+    free(layer);
+}
+
+static void draw_water_tile(const TileGrid_t* tilemap, unsigned int i, int x, int y)
+{
+    const Tile_t* tile = tilemap->tiles + i;
+    if (!tile->wet && tile->water_level == 0) return;
+
+    // Draw water flow
+    unsigned int bot = i + tilemap->width;
+    unsigned int right = i + 1;
+    unsigned int left = i - 1;
+    int bot_line = y + TILE_SIZE - tile->water_level * WATER_BBOX_STEP - SURFACE_THICKNESS / 2;
+    if (i >= tilemap->width && tilemap->tiles[i - tilemap->width].wet)
+    {
+        DrawLineEx((Vector2){x + TILE_SIZE / 2, y}, (Vector2){x + TILE_SIZE / 2, y + TILE_SIZE - tile->water_level * WATER_BBOX_STEP}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
+    }
+
+    if (bot < tilemap->n_tiles && tile->water_level == 0)
+    {
+        if (i % tilemap->width != 0 && tilemap->tiles[left].wet && (tilemap->tiles[bot].solid == SOLID || tilemap->tiles[bot-1].solid == SOLID))
+        {
+            DrawLineEx((Vector2){x, bot_line}, (Vector2){x + TILE_SIZE / 2, bot_line}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
+        }
+        if (right % tilemap->width != 0 && tilemap->tiles[right].wet && (tilemap->tiles[bot].solid == SOLID || tilemap->tiles[bot+1].solid == SOLID))
+        {
+            DrawLineEx((Vector2){x + TILE_SIZE / 2, bot_line}, (Vector2){x + TILE_SIZE, bot_line}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
+        }
+    }
+
+    uint32_t water_height = tile->water_level * WATER_BBOX_STEP;
+    if (water_height == 0) return;
+
+    DrawRectangle(
+        x,
+        y + (TILE_SIZE - water_height),
+        TILE_SIZE,
+        water_height,
+        ColorAlpha(BLUE, 0.5)
+    );
+}
+
+static void redraw_water_chunk(WaterChunk_t* chunk, const TileGrid_t* tilemap)
+{
+    TileArea_t area = get_chunk_tile_area(tilemap, chunk->chunk_idx);
+
+    chunk->has_water = false;
+    for (unsigned int tile_y = area.tile_y1; tile_y <= area.tile_y2 && !chunk->has_water; tile_y++)
+    {
+        for (unsigned int tile_x = area.tile_x1; tile_x <= area.tile_x2; tile_x++)
+        {
+            const Tile_t* tile = tilemap->tiles + tile_y * tilemap->width + tile_x;
+            if (tile->wet || tile->water_level > 0)
+            {
+                chunk->has_water = true;
+                break;
+            }
+        }
+    }
+    // Dry chunks are skipped when drawing, no need to clear the texture
+    if (!chunk->has_water) return;
+
+    if (chunk->tex.id == 0)
+    {
+        chunk->tex = LoadRenderTexture(CHUNK_PX_SIZE, CHUNK_PX_SIZE);
+    }
+
+    BeginTextureMode(chunk->tex);
+        ClearBackground(BLANK);
+        // Keep the alpha of the water as is, and store the colours premultiplied
+        // so the chunk blends the same as drawing the tiles directly
+        rlSetBlendFactorsSeparate(
+            RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA,
+            RL_ONE, RL_ONE_MINUS_SRC_ALPHA,
+            RL_FUNC_ADD, RL_FUNC_ADD
+        );
+        BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+        for (unsigned int tile_y = area.tile_y1; tile_y <= area.tile_y2; tile_y++)
+        {
+            for (unsigned int tile_x = area.tile_x1; tile_x <= area.tile_x2; tile_x++)
+            {
+                draw_water_tile(
+                    tilemap, tile_y * tilemap->width + tile_x,
+                    (tile_x - area.tile_x1) * TILE_SIZE, (tile_y - area.tile_y1) * TILE_SIZE
+                );
+            }
+        }
+        EndBlendMode();
+    EndTextureMode();
+}
+
+static WaterChunk_t* find_water_chunk(WaterLayer_t* layer, int32_t chunk_idx)
+{
+    for (uint8_t i = 0; i < WATER_CHUNK_CACHE_SIZE; ++i)
+    {
+        if (layer->chunks[i].chunk_idx == chunk_idx) return layer->chunks + i;
+    }
+    return NULL;
+}
+
+static WaterChunk_t* evict_water_chunk(WaterLayer_t* layer)
+{
+    // Least recently used, but never one that is in view
+    WaterChunk_t* oldest = NULL;
+    for (uint8_t i = 0; i < WATER_CHUNK_CACHE_SIZE; ++i)
+    {
+        WaterChunk_t* chunk = layer->chunks + i;
+        if (chunk->chunk_idx < 0) return chunk;
+        if (chunk->last_used == layer->frame) continue;
+        if (oldest == NULL || chunk->last_used < oldest->last_used) oldest = chunk;
+    }
+    return oldest;
+}
+
+void update_water_layer(WaterLayer_t* layer, TileGrid_t* tilemap, TileArea_t view)
+{
+    if (layer == NULL || tilemap->dirty_chunks == NULL) return;
+
+    layer->frame++;
+    TileArea_t chunk_view = get_chunks_in_area(tilemap, view);
+    for (unsigned int y = chunk_view.tile_y1; y <= chunk_view.tile_y2; y++)
+    {
+        for (unsigned int x = chunk_view.tile_x1; x <= chunk_view.tile_x2; x++)
+        {
+            int32_t chunk_idx = y * tilemap->chunk_width + x;
+            WaterChunk_t* chunk = find_water_chunk(layer, chunk_idx);
+            if (chunk == NULL)
+            {
+                // No free slot, the chunk will be drawn directly
+                chunk = evict_water_chunk(layer);
+                if (chunk == NULL) continue;
+
+                chunk->chunk_idx = chunk_idx;
+                tilemap->dirty_chunks[chunk_idx] |= CHUNK_DIRTY_WATER;
+            }
+            chunk->last_used = layer->frame;
+
+            if (tilemap->dirty_chunks[chunk_idx] & CHUNK_DIRTY_WATER)
+            {
+                redraw_water_chunk(chunk, tilemap);
+                tilemap->dirty_chunks[chunk_idx] &= ~CHUNK_DIRTY_WATER;
+            }
+        }
+    }
+}
+
+void draw_water_layer(WaterLayer_t* layer, TileGrid_t* tilemap, TileArea_t view)
+{
+    if (layer == NULL) return;
+
+    TileArea_t chunk_view = get_chunks_in_area(tilemap, view);
+    bool has_uncached = false;
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    for (unsigned int y = chunk_view.tile_y1; y <= chunk_view.tile_y2; y++)
+    {
+        for (unsigned int x = chunk_view.tile_x1; x <= chunk_view.tile_x2; x++)
+        {
+            WaterChunk_t* chunk = find_water_chunk(layer, y * tilemap->chunk_width + x);
+            if (chunk == NULL)
+            {
+                has_uncached = true;
+                continue;
+            }
+            if (!chunk->has_water) continue;
+
+            // Render textures are stored upside down
+            DrawTextureRec(
+                chunk->tex.texture,
+                (Rectangle){0, 0, CHUNK_PX_SIZE, -CHUNK_PX_SIZE},
+                (Vector2){x * CHUNK_PX_SIZE, y * CHUNK_PX_SIZE},
+                WHITE
+            );
+        }
+    }
+    EndBlendMode();
+
+    if (!has_uncached) return;
+
+    for (unsigned int y = chunk_view.tile_y1; y <= chunk_view.tile_y2; y++)
+    {
+        for (unsigned int x = chunk_view.tile_x1; x <= chunk_view.tile_x2; x++)
+        {
+            int32_t chunk_idx = y * tilemap->chunk_width + x;
+            if (find_water_chunk(layer, chunk_idx) != NULL) continue;
+
+            TileArea_t area = get_chunk_tile_area(tilemap, chunk_idx);
+            for (unsigned int tile_y = area.tile_y1; tile_y <= area.tile_y2; tile_y++)
+            {
+                for (unsigned int tile_x = area.tile_x1; tile_x <= area.tile_x2; tile_x++)
+                {
+                    draw_water_tile(
+                        tilemap, tile_y * tilemap->width + tile_x,
+                        tile_x * TILE_SIZE, tile_y * TILE_SIZE
+                    );
+                }
+            }
+        }
+    }
+}
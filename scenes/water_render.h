@@ -0,0 +1,29 @@
+#ifndef __WATER_RENDER_H
+#define __WATER_RENDER_H
+#include "scene_impl.h"
+
+// Enough for the chunks in view, plus some to keep when scrolling back and forth
+#define WATER_CHUNK_CACHE_SIZE 32
+
+typedef struct WaterChunk {
+    RenderTexture2D tex;
+    int32_t chunk_idx; // -1 if unused
+    uint32_t last_used;
+    bool has_water;
+} WaterChunk_t;
+
+// Water drawn into a texture per tile chunk, so that only
+// chunks with changed tiles are drawn again
+struct WaterLayer {
+    WaterChunk_t chunks[WATER_CHUNK_CACHE_SIZE];
+    uint32_t frame;
+};
+
+WaterLayer_t* create_water_layer(void);
+void free_water_layer(WaterLayer_t* layer);
+
+// Redraw the dirty chunks in view. Call outside of any texture mode
+void update_water_layer(WaterLayer_t* layer, TileGrid_t* tilemap, TileArea_t view);
+// Call inside the 2D mode of the level camera
+void draw_water_layer(WaterLayer_t* layer, TileGrid_t* tilemap, TileArea_t view);
+#endif // __WATER_RENDER_H
@@ -0,0 +1,161 @@
+#include "mempool.h"
+#include "components.h"
+#include <stdio.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#define TEST_TAG 1
+// The jump pool only has a few, so it runs out first
+#define N_JUMP_COMPS 8
+
+static int setup_ent_manager(void** state)
+{
+    static EntityManager_t manager;
+
+    init_memory_pools();
+    init_entity_manager(&manager);
+    init_entity_tag_map(&manager, TEST_TAG, 16);
+    *state = &manager;
+    return 0;
+}
+
+static int teardown_ent_manager(void** state)
+{
+    free_entity_manager(*state);
+    free_memory_pools();
+    return 0;
+}
+
+static void test_add_and_remove_in_one_update(void **state)
+{
+    EntityManager_t* manager = *state;
+    uint32_t n_free = get_num_of_free_entities();
+
+    // More times than the pool holds, so the component must be freed each time
+    for (unsigned int i = 0; i < N_JUMP_COMPS * 2; ++i)
+    {
+        Entity_t* p_ent = add_entity(manager, TEST_TAG);
+        assert_non_null(p_ent);
+        assert_non_null(add_component(p_ent, CJUMP_COMP_T));
+        assert_non_null(add_component(p_ent, CTRANSFORM_COMP_T));
+        remove_entity(manager, p_ent->m_id);
+        update_entity_manager(manager);
+
+        assert_null(get_entity(manager, p_ent->m_id));
+        assert_int_equal(sc_map_size_64v(&manager->entities), 0);
+        assert_int_equal(sc_map_size_64v(&manager->entities_map[TEST_TAG]), 0);
+        assert_int_equal(sc_map_size_64v(&manager->component_map[CJUMP_COMP_T]), 0);
+        assert_int_equal(sc_map_size_64v(&manager->component_map[CTRANSFORM_COMP_T]), 0);
+        assert_int_equal(get_num_of_free_entities(), n_free);
+    }
+
+    // Same for a component on an entity that stays
+    Entity_t* p_ent = add_entity(manager, TEST_TAG);
+    assert_non_null(p_ent);
+    update_entity_manager(manager);
+    for (unsigned int i = 0; i < N_JUMP_COMPS * 2; ++i)
+    {
+        assert_non_null(add_component(p_ent, CJUMP_COMP_T));
+        remove_component(p_ent, CJUMP_COMP_T);
+        update_entity_manager(manager);
+
+        assert_null(get_component(p_ent, CJUMP_COMP_T));
+        assert_int_equal(sc_map_size_64v(&manager->component_map[CJUMP_COMP_T]), 0);
+    }
+    assert_ptr_equal(get_entity(manager, p_ent->m_id), p_ent);
+}
+
+static void test_pool_exhaustion(void **state)
+{
+    EntityManager_t* manager = *state;
+    uint32_t n_free = get_num_of_free_entities();
+
+    Entity_t* jumpers[N_JUMP_COMPS];
+    Entity_t* p_plain = NULL;
+    uint32_t n_added = 0;
+    Entity_t* p_ent;
+    while ((p_ent = add_entity(manager, TEST_TAG)) != NULL)
+    {
+        if (n_added < N_JUMP_COMPS)
+        {
+            assert_non_null(add_component(p_ent, CJUMP_COMP_T));
+            jumpers[n_added] = p_ent;
+        }
+        else
+        {
+            assert_null(add_component(p_ent, CJUMP_COMP_T));
+            p_plain = p_ent;
+        }
+        n_added++;
+    }
+    assert_int_equal(n_added, n_free);
+    update_entity_manager(manager);
+    assert_int_equal(sc_map_size_64v(&manager->entities), n_added);
+    assert_int_equal(sc_map_size_64v(&manager->component_map[CJUMP_COMP_T]), N_JUMP_COMPS);
+
+    // Removed ones only go back to the pools in the update
+    remove_entity(manager, jumpers[0]->m_id);
+    remove_component(jumpers[1], CJUMP_COMP_T);
+    assert_null(add_entity(manager, TEST_TAG));
+    assert_null(add_component(p_plain, CJUMP_COMP_T));
+    update_entity_manager(manager);
+    assert_int_equal(sc_map_size_64v(&manager->entities), n_added - 1);
+    assert_int_equal(sc_map_size_64v(&manager->component_map[CJUMP_COMP_T]), N_JUMP_COMPS - 2);
+    assert_int_equal(get_num_of_free_entities(), 1);
+
+    p_ent = add_entity(manager, TEST_TAG);
+    assert_non_null(p_ent);
+    assert_non_null(add_component(p_ent, CJUMP_COMP_T));
+    assert_non_null(add_component(jumpers[1], CJUMP_COMP_T));
+    assert_null(add_component(p_plain, CJUMP_COMP_T));
+    update_entity_manager(manager);
+    assert_int_equal(sc_map_size_64v(&manager->entities), n_added);
+    assert_int_equal(sc_map_size_64v(&manager->component_map[CJUMP_COMP_T]), N_JUMP_COMPS);
+    assert_ptr_equal(get_component(p_ent, CJUMP_COMP_T), sc_map_get_64v(&manager->component_map[CJUMP_COMP_T], p_ent->m_id));
+
+    clear_entity_manager(manager);
+    assert_int_equal(sc_map_size_64v(&manager->entities), 0);
+    assert_int_equal(get_num_of_free_entities(), n_free);
+}
+
+static void test_restore_fails_on_full_pool(void **state)
+{
+    EntityManager_t* manager = *state;
+
+    for (unsigned int i = 0; i < N_JUMP_COMPS; ++i)
+    {
+        Entity_t* p_ent = add_entity(manager, TEST_TAG);
+        assert_non_null(p_ent);
+        assert_non_null(add_component(p_ent, CJUMP_COMP_T));
+    }
+    EntitySnapshot_t snapshot = {0};
+    assert_true(snapshot_entities(manager, &snapshot));
+    clear_entity_manager(manager);
+    assert_true(restore_entities(manager, &snapshot));
+    assert_int_equal(sc_map_size_64v(&manager->component_map[CJUMP_COMP_T]), N_JUMP_COMPS);
+
+    // A jump component taken by someone else leaves one short
+    clear_entity_manager(manager);
+    Entity_t* p_ent = add_entity(manager, TEST_TAG);
+    assert_non_null(add_component(p_ent, CJUMP_COMP_T));
+    update_entity_manager(manager);
+    assert_false(restore_entities(manager, &snapshot));
+
+    clear_entity_manager(manager);
+    free_entity_snapshot(&snapshot);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_add_and_remove_in_one_update, setup_ent_manager, teardown_ent_manager),
+        cmocka_unit_test_setup_teardown(test_pool_exhaustion, setup_ent_manager, teardown_ent_manager),
+        cmocka_unit_test_setup_teardown(test_restore_fails_on_full_pool, setup_ent_manager, teardown_ent_manager),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
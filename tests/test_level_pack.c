@@ -0,0 +1,222 @@
+#include "assets.h"
+#include "zstd.h"
+#include <stdio.h>
+#include <string.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+// Indexed packs as written by ldtk_repacker.py --indexed:
+// [magic][n_levels][dict_size], then per level [header, 40 bytes][offset][size],
+// then the dictionary and the level frames
+#define TEST_PACK_PATH "test_level_pack.lpk"
+#define PACK_HEADER_SIZE 12
+#define LEVEL_ENTRY_SIZE 48
+#define TEST_WIDTH 30
+#define TEST_HEIGHT 20
+#define TEST_N_TILES (TEST_WIDTH * TEST_HEIGHT)
+
+static Assets_t assets;
+static uint8_t pack_buffer[4096];
+static uint8_t level_buffer[4096];
+
+static int setup_level_pack(void** state)
+{
+    (void)state;
+
+    init_assets(&assets);
+    return 0;
+}
+
+static int teardown_level_pack(void** state)
+{
+    (void)state;
+
+    term_assets(&assets);
+    remove(TEST_PACK_PATH);
+    return 0;
+}
+
+// One level pack with a single level, holding the given frame. Returns the pack size
+static uint32_t build_pack(const char* magic, const uint8_t* level, size_t level_size)
+{
+    uint32_t n_levels = 1;
+    uint32_t dict_size = 0;
+    memcpy(pack_buffer, magic, 4);
+    memcpy(pack_buffer + 4, &n_levels, 4);
+    memcpy(pack_buffer + 8, &dict_size, 4);
+
+    uint8_t* entry = pack_buffer + PACK_HEADER_SIZE;
+    memset(entry, 0, LEVEL_ENTRY_SIZE);
+    strcpy((char*)entry, "test");
+    uint16_t width = TEST_WIDTH;
+    uint16_t height = TEST_HEIGHT;
+    memcpy(entry + 32, &width, 2);
+    memcpy(entry + 34, &height, 2);
+
+    uint32_t offset = PACK_HEADER_SIZE + LEVEL_ENTRY_SIZE;
+    size_t size = ZSTD_compress(pack_buffer + offset, sizeof(pack_buffer) - offset, level, level_size, 1);
+    assert_false(ZSTD_isError(size));
+    uint32_t frame_size = size;
+    memcpy(entry + 40, &offset, 4);
+    memcpy(entry + 44, &frame_size, 4);
+    return offset + frame_size;
+}
+
+static LevelPack_t* load_pack(uint32_t len)
+{
+    FILE* file = fopen(TEST_PACK_PATH, "wb");
+    assert_non_null(file);
+    fwrite(pack_buffer, 1, len, file);
+    fclose(file);
+    return uncompress_level_pack(&assets, "test", TEST_PACK_PATH);
+}
+
+// [n_spawns][n_runs][spawns][runs]
+static size_t build_runs(const LevelSpawn_t* spawns, uint32_t n_spawns, const uint8_t (*runs)[2], uint32_t n_runs)
+{
+    memcpy(level_buffer, &n_spawns, 4);
+    memcpy(level_buffer + 4, &n_runs, 4);
+    if (n_spawns > 0) memcpy(level_buffer + 8, spawns, n_spawns * sizeof(LevelSpawn_t));
+    memcpy(level_buffer + 8 + n_spawns * sizeof(LevelSpawn_t), runs, n_runs * 2);
+    return 8 + n_spawns * sizeof(LevelSpawn_t) + n_runs * 2;
+}
+
+static void test_plain_level(void **state)
+{
+    (void)state;
+
+    LevelTileInfo_t tiles[TEST_N_TILES] = {0};
+    tiles[5].tile_type = 1;
+    tiles[7].tile_type = LEVEL_SPAWN_TILE_START;
+    tiles[TEST_N_TILES - 1].water = 3;
+    LevelPack_t* pack = load_pack(build_pack("LPK2", (const uint8_t*)tiles, sizeof(tiles)));
+    assert_non_null(pack);
+    assert_int_equal(pack->n_levels, 1);
+
+    LevelMap_t* level = get_level(pack, 0);
+    assert_non_null(level);
+    assert_string_equal(level->level_name, "test");
+    assert_memory_equal(level->tiles, tiles, sizeof(tiles));
+    assert_int_equal(level->n_spawns, 1);
+    assert_int_equal(level->spawns[0].x, 7);
+    assert_int_equal(level->spawns[0].y, 0);
+    assert_null(get_level(pack, 1));
+}
+
+static void test_runs_longer_than_255(void **state)
+{
+    (void)state;
+
+    // The packer splits runs at 255 tiles
+    const LevelSpawn_t spawns[1] = {{.x = 3, .y = 4, .tile_type = LEVEL_SPAWN_TILE_START}};
+    const uint8_t runs[4][2] = {
+        {1, 255}, {1, 255}, {1, 40},
+        {(2 << 5) | 0, TEST_N_TILES - 550},
+    };
+    LevelPack_t* pack = load_pack(build_pack("LPK3", level_buffer, build_runs(spawns, 1, runs, 4)));
+    assert_non_null(pack);
+
+    LevelMap_t* level = get_level(pack, 0);
+    assert_non_null(level);
+    for (uint32_t i = 0; i < TEST_N_TILES; ++i)
+    {
+        assert_int_equal(level->tiles[i].tile_type, (i < 550) ? 1 : 0);
+        assert_int_equal(level->tiles[i].water, (i < 550) ? 0 : 2);
+    }
+    assert_int_equal(level->n_spawns, 1);
+    assert_int_equal(level->spawns[0].x, 3);
+    assert_int_equal(level->spawns[0].y, 4);
+}
+
+static void test_truncated_header(void **state)
+{
+    (void)state;
+
+    const uint8_t runs[3][2] = {{1, 255}, {1, 255}, {1, TEST_N_TILES - 510}};
+    uint32_t len = build_pack("LPK3", level_buffer, build_runs(NULL, 0, runs, 3));
+    // Cut in the pack header, then in the level table, then in the frame
+    assert_null(load_pack(8));
+    assert_null(load_pack(PACK_HEADER_SIZE + LEVEL_ENTRY_SIZE - 1));
+    assert_null(load_pack(len - 1));
+}
+
+static void test_bad_level_table(void **state)
+{
+    (void)state;
+
+    LevelTileInfo_t tiles[TEST_N_TILES] = {0};
+    uint32_t len = build_pack("LPK2", (const uint8_t*)tiles, sizeof(tiles));
+    uint32_t value;
+
+    // More levels than the table can hold
+    value = 1000;
+    memcpy(pack_buffer + 4, &value, 4);
+    assert_null(load_pack(len));
+
+    // Dictionary past the end
+    len = build_pack("LPK2", (const uint8_t*)tiles, sizeof(tiles));
+    value = len;
+    memcpy(pack_buffer + 8, &value, 4);
+    assert_null(load_pack(len));
+
+    // Frame past the end
+    len = build_pack("LPK2", (const uint8_t*)tiles, sizeof(tiles));
+    value = len;
+    memcpy(pack_buffer + PACK_HEADER_SIZE + 40, &value, 4);
+    assert_null(load_pack(len));
+}
+
+static void test_bad_runs(void **state)
+{
+    (void)state;
+
+    // Runs past the last tile
+    const uint8_t long_runs[3][2] = {{1, 255}, {1, 255}, {1, 255}};
+    LevelPack_t* pack = load_pack(build_pack("LPK3", level_buffer, build_runs(NULL, 0, long_runs, 3)));
+    assert_non_null(pack);
+    assert_null(get_level(pack, 0));
+    term_assets(&assets);
+    init_assets(&assets);
+
+    // Runs short of the last tile
+    const uint8_t short_runs[2][2] = {{1, 255}, {1, 255}};
+    pack = load_pack(build_pack("LPK3", level_buffer, build_runs(NULL, 0, short_runs, 2)));
+    assert_non_null(pack);
+    assert_null(get_level(pack, 0));
+    term_assets(&assets);
+    init_assets(&assets);
+
+    // Spawn outside of the level
+    const LevelSpawn_t spawns[1] = {{.x = TEST_WIDTH, .y = 0, .tile_type = LEVEL_SPAWN_TILE_START}};
+    const uint8_t runs[3][2] = {{1, 255}, {1, 255}, {1, TEST_N_TILES - 510}};
+    pack = load_pack(build_pack("LPK3", level_buffer, build_runs(spawns, 1, runs, 3)));
+    assert_non_null(pack);
+    assert_null(get_level(pack, 0));
+    term_assets(&assets);
+    init_assets(&assets);
+
+    // Counts that do not add up to the frame size
+    size_t size = build_runs(NULL, 0, runs, 3);
+    uint32_t n_runs = 4;
+    memcpy(level_buffer + 4, &n_runs, 4);
+    pack = load_pack(build_pack("LPK3", level_buffer, size));
+    assert_non_null(pack);
+    assert_null(get_level(pack, 0));
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_plain_level, setup_level_pack, teardown_level_pack),
+        cmocka_unit_test_setup_teardown(test_runs_longer_than_255, setup_level_pack, teardown_level_pack),
+        cmocka_unit_test_setup_teardown(test_truncated_header, setup_level_pack, teardown_level_pack),
+        cmocka_unit_test_setup_teardown(test_bad_level_table, setup_level_pack, teardown_level_pack),
+        cmocka_unit_test_setup_teardown(test_bad_runs, setup_level_pack, teardown_level_pack),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
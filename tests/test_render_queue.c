@@ -0,0 +1,145 @@
+#include "render_queue.h"
+#include <stdio.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#define N_TEST_NODES (MAX_RENDER_COMMANDS + 500)
+
+static Texture2D textures[3] = {
+    {.id = 7}, {.id = 2}, {.id = 0x1234},
+};
+static Sprite_t sprites[4];
+static RenderInfoNode nodes[N_TEST_NODES];
+
+static int setup_render_queue(void** state)
+{
+    static RenderManager manager;
+
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        sprites[i].texture = textures + i;
+    }
+    // No texture sorts as texture 0
+    sprites[3].texture = NULL;
+    memset(nodes, 0, sizeof(nodes));
+    init_render_manager(&manager);
+    *state = &manager;
+    return 0;
+}
+
+static int teardown_render_queue(void** state)
+{
+    free_render_manager(*state);
+    return 0;
+}
+
+static RenderInfoNode* sorted_node(const RenderManager* manager, uint32_t i)
+{
+    return manager->nodes[manager->keys[i] & RENDER_KEY_SEQ_MASK];
+}
+
+static void test_key_packing(void **state)
+{
+    RenderManager* manager = *state;
+
+    nodes[0].spr = sprites + 2;
+    nodes[1].spr = sprites + 3;
+    nodes[2].spr = NULL;
+    assert_true(add_render_node(manager, nodes + 0, 1));
+    // Layers past the last one go into the last one
+    assert_true(add_render_node(manager, nodes + 1, MAX_RENDERMANAGER_DEPTH + 3));
+    assert_false(add_render_node(manager, nodes + 2, 0));
+
+    assert_int_equal(manager->n_nodes, 2);
+    assert_true(manager->keys[0] == ((1ULL << RENDER_KEY_LAYER_SHIFT) | (0x1234ULL << RENDER_KEY_TEXTURE_SHIFT) | 0));
+    assert_true(manager->keys[1] == (((uint64_t)(MAX_RENDERMANAGER_DEPTH - 1) << RENDER_KEY_LAYER_SHIFT) | 1));
+    assert_ptr_equal(manager->nodes[0], nodes + 0);
+    assert_ptr_equal(manager->nodes[1], nodes + 1);
+}
+
+static void test_sort_by_layer_then_texture(void **state)
+{
+    RenderManager* manager = *state;
+
+    // Layer, sprite
+    const uint8_t queued[8][2] = {
+        {2, 0}, {0, 2}, {1, 1}, {0, 0},
+        {2, 1}, {0, 2}, {1, 3}, {0, 1},
+    };
+    // Indices into queued in draw order. Within a layer, the lower texture id goes first
+    const uint8_t expected[8] = {7, 3, 1, 5, 6, 2, 4, 0};
+
+    for (uint8_t i = 0; i < 8; ++i)
+    {
+        nodes[i].spr = sprites + queued[i][1];
+        assert_true(add_render_node(manager, nodes + i, queued[i][0]));
+    }
+    sort_render_queue(manager);
+
+    assert_int_equal(manager->n_nodes, 8);
+    for (uint8_t i = 0; i < 8; ++i)
+    {
+        assert_ptr_equal(sorted_node(manager, i), nodes + expected[i]);
+    }
+}
+
+static void test_sort_keeps_queue_order(void **state)
+{
+    RenderManager* manager = *state;
+
+    // Past the starting size, to go through a grow as well
+    for (uint32_t i = 0; i < N_TEST_NODES; ++i)
+    {
+        nodes[i].spr = sprites + (i % 3);
+        assert_true(add_render_node(manager, nodes + i, (N_TEST_NODES - i) % MAX_RENDERMANAGER_DEPTH));
+    }
+    assert_int_equal(manager->n_nodes, N_TEST_NODES);
+    assert_true(manager->capacity >= N_TEST_NODES);
+    sort_render_queue(manager);
+
+    for (uint32_t i = 1; i < N_TEST_NODES; ++i)
+    {
+        uint64_t prev = manager->keys[i - 1];
+        uint64_t curr = manager->keys[i];
+        assert_true(prev < curr);
+        // Same layer and texture must be drawn in the queueing order
+        if ((prev >> RENDER_KEY_TEXTURE_SHIFT) == (curr >> RENDER_KEY_TEXTURE_SHIFT))
+        {
+            assert_true(sorted_node(manager, i - 1) < sorted_node(manager, i));
+        }
+    }
+
+    reset_render_manager(manager);
+    assert_int_equal(manager->n_nodes, 0);
+}
+
+static void test_full_queue_drops(void **state)
+{
+    RenderManager* manager = *state;
+
+    // The sequence indexes the nodes, so the queue cannot grow past it
+    nodes[0].spr = sprites;
+    for (uint32_t i = 0; i <= RENDER_KEY_SEQ_MASK; ++i)
+    {
+        assert_true(add_render_node(manager, nodes, 0));
+    }
+    assert_false(add_render_node(manager, nodes, 0));
+    assert_int_equal(manager->n_nodes, RENDER_KEY_SEQ_MASK + 1);
+    assert_true(manager->overflowed);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_key_packing, setup_render_queue, teardown_render_queue),
+        cmocka_unit_test_setup_teardown(test_sort_by_layer_then_texture, setup_render_queue, teardown_render_queue),
+        cmocka_unit_test_setup_teardown(test_sort_keeps_queue_order, setup_render_queue, teardown_render_queue),
+        cmocka_unit_test_setup_teardown(test_full_queue_drops, setup_render_queue, teardown_render_queue),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,187 @@
+#include "rewind.h"
+#include <stdio.h>
+#include <string.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#define FRAME_SIZE 256
+#define N_TEST_FRAMES 40
+
+static uint8_t frames[N_TEST_FRAMES][FRAME_SIZE];
+
+// A mostly fixed state, with a few bytes changing every frame
+static void build_frames(void)
+{
+    for (uint32_t n = 0; n < N_TEST_FRAMES; ++n)
+    {
+        for (uint32_t j = 0; j < FRAME_SIZE; ++j)
+        {
+            frames[n][j] = ((j * 37 + 11) ^ (j >> 3)) | 1;
+        }
+        frames[n][0] = n;
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            frames[n][(n * 7 + j) % FRAME_SIZE] = n + 100;
+        }
+    }
+}
+
+static int setup_rewind(void** state)
+{
+    static RewindBuffer_t buffer;
+
+    build_frames();
+    init_rewind_buffer(&buffer, 1 << 20, 4);
+    *state = &buffer;
+    return 0;
+}
+
+static int teardown_rewind(void** state)
+{
+    free_rewind_buffer(*state);
+    return 0;
+}
+
+// The newest frame pushed was newest
+static void check_frames(RewindBuffer_t* buffer, uint32_t newest)
+{
+    for (uint32_t back = 0; back < buffer->count; ++back)
+    {
+        uint32_t size = 0;
+        const uint8_t* data = get_rewind_frame(buffer, back, &size);
+        assert_non_null(data);
+        assert_int_equal(size, FRAME_SIZE);
+        assert_memory_equal(data, frames[newest - back], FRAME_SIZE);
+    }
+    uint32_t size = 0;
+    assert_null(get_rewind_frame(buffer, buffer->count, &size));
+}
+
+static bool is_keyframe(RewindBuffer_t* buffer, uint32_t n)
+{
+    return buffer->frames[(buffer->head + n) % MAX_REWIND_FRAMES].keyframe;
+}
+
+static void test_round_trip(void **state)
+{
+    RewindBuffer_t* buffer = *state;
+
+    for (uint32_t n = 0; n < 12; ++n)
+    {
+        assert_true(push_rewind_frame(buffer, frames[n], FRAME_SIZE));
+        check_frames(buffer, n);
+    }
+    // A keyframe, then four frames diffed against it
+    assert_int_equal(buffer->count, 12);
+    assert_int_equal(buffer->n_keyframes, 3);
+    assert_true(is_keyframe(buffer, 0));
+    assert_true(is_keyframe(buffer, 5));
+    assert_true(is_keyframe(buffer, 10));
+    assert_false(is_keyframe(buffer, 4));
+    // Only the changed bytes are kept
+    assert_true(buffer->frames[1].size < 32);
+
+    clear_rewind_buffer(buffer);
+    assert_int_equal(buffer->count, 0);
+    assert_int_equal(buffer->used, 0);
+    assert_int_equal(buffer->n_keyframes, 0);
+}
+
+static void test_budget_drops_oldest_keyframe(void **state)
+{
+    RewindBuffer_t* buffer = *state;
+
+    assert_true(push_rewind_frame(buffer, frames[0], FRAME_SIZE));
+    size_t key_size = buffer->used;
+    // Room for two keyframes and their diffs, but not a third keyframe
+    buffer->budget = key_size * 2 + 100;
+
+    for (uint32_t n = 1; n < 12; ++n)
+    {
+        assert_true(push_rewind_frame(buffer, frames[n], FRAME_SIZE));
+        assert_true(buffer->used <= buffer->budget);
+        assert_true(is_keyframe(buffer, 0));
+        check_frames(buffer, n);
+    }
+    // The first keyframe went with its diffs when the third came in
+    assert_int_equal(buffer->n_keyframes, 2);
+    assert_int_equal(buffer->count, 7);
+}
+
+static void test_single_keyframe_rekeys(void **state)
+{
+    RewindBuffer_t* buffer = *state;
+
+    // Never keyed by the interval, so the only keyframe has to give way
+    buffer->key_interval = N_TEST_FRAMES;
+    assert_true(push_rewind_frame(buffer, frames[0], FRAME_SIZE));
+    buffer->budget = buffer->used + 40;
+
+    uint32_t n = 1;
+    while (n < N_TEST_FRAMES && buffer->count == n)
+    {
+        assert_true(push_rewind_frame(buffer, frames[n], FRAME_SIZE));
+        n++;
+    }
+    assert_true(n < N_TEST_FRAMES);
+    // The frame that did not fit became the new keyframe, and the rest were dropped
+    assert_int_equal(buffer->count, 1);
+    assert_int_equal(buffer->n_keyframes, 1);
+    assert_true(is_keyframe(buffer, 0));
+    check_frames(buffer, n - 1);
+
+    // New frames are diffed against it
+    assert_true(push_rewind_frame(buffer, frames[n], FRAME_SIZE));
+    assert_int_equal(buffer->count, 2);
+    assert_false(is_keyframe(buffer, 1));
+    check_frames(buffer, n);
+}
+
+static void test_drop_decodes_older_keyframe(void **state)
+{
+    RewindBuffer_t* buffer = *state;
+
+    buffer->key_interval = 2;
+    for (uint32_t n = 0; n < 8; ++n)
+    {
+        assert_true(push_rewind_frame(buffer, frames[n], FRAME_SIZE));
+    }
+    // Keyframes at 0, 3 and 6
+    assert_int_equal(buffer->n_keyframes, 3);
+
+    // Losing the keyframe at 6 leaves 3 as the one to diff against
+    drop_rewind_frames(buffer, 3);
+    assert_int_equal(buffer->count, 5);
+    assert_int_equal(buffer->n_keyframes, 2);
+    assert_int_equal(buffer->since_key, 1);
+    assert_memory_equal(buffer->key, frames[3], FRAME_SIZE);
+    check_frames(buffer, 4);
+
+    // The frame after goes in as a diff, as the interval is not up yet
+    assert_true(push_rewind_frame(buffer, frames[5], FRAME_SIZE));
+    assert_false(is_keyframe(buffer, 5));
+    check_frames(buffer, 5);
+
+    // Too many frames only empties the buffer
+    drop_rewind_frames(buffer, 100);
+    assert_int_equal(buffer->count, 0);
+    assert_true(push_rewind_frame(buffer, frames[9], FRAME_SIZE));
+    assert_true(is_keyframe(buffer, 0));
+    check_frames(buffer, 9);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_round_trip, setup_rewind, teardown_rewind),
+        cmocka_unit_test_setup_teardown(test_budget_drops_oldest_keyframe, setup_rewind, teardown_rewind),
+        cmocka_unit_test_setup_teardown(test_single_keyframe_rekeys, setup_rewind, teardown_rewind),
+        cmocka_unit_test_setup_teardown(test_drop_decodes_older_keyframe, setup_rewind, teardown_rewind),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
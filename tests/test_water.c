@@ -0,0 +1,384 @@
+#include "constants.h"
+#include "scene_impl.h"
+#include "ent_impl.h"
+#include "water_flow.h"
+#include "mempool.h"
+#include <stdio.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#define BOX_WIDTH 12
+#define BOX_HEIGHT 8
+#define MAX_TEST_FRAMES 20000
+
+static Tile_t all_tiles[BOX_WIDTH * BOX_HEIGHT] = {0};
+
+// Empty box with solid walls all around
+static void build_box(LevelScene_t* scene)
+{
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    tilemap->width = BOX_WIDTH;
+    tilemap->height = BOX_HEIGHT;
+    tilemap->n_tiles = BOX_WIDTH * BOX_HEIGHT;
+    reset_tilemap_chunks(tilemap);
+    for (unsigned int i = 0; i < tilemap->n_tiles; ++i)
+    {
+        unsigned int x = i % BOX_WIDTH;
+        unsigned int y = i / BOX_WIDTH;
+        bool wall = x == 0 || y == 0 || x == BOX_WIDTH - 1 || y == BOX_HEIGHT - 1;
+        change_a_tile(tilemap, i, wall ? SOLID_TILE : EMPTY_TILE);
+        tilemap->tiles[i].water_level = 0;
+        tilemap->tiles[i].max_water_level = MAX_WATER_LEVEL;
+        tilemap->tiles[i].wet = false;
+    }
+}
+
+static int setup_water(void** state)
+{
+    static LevelScene_t scene;
+
+    init_memory_pools();
+    init_scene(&scene.scene, NULL, ENABLE_ENTITY_MANAGEMENT_SYSTEM);
+    init_entity_tag_map(&scene.scene.ent_manager, DYNMEM_ENT_TAG, 16);
+    init_level_scene_data(&scene.data, BOX_WIDTH * BOX_HEIGHT, all_tiles, (Rectangle){0, 0, 0, 0});
+    build_box(&scene);
+    scene.scene.delta_time = DELTA_T;
+    *state = &scene;
+    return 0;
+}
+
+static int teardown_water(void** state)
+{
+    LevelScene_t* scene = *state;
+
+    clear_all_game_entities(scene);
+    free_scene(&scene->scene);
+    term_level_scene_data(&scene->data);
+    free_memory_pools();
+    return 0;
+}
+
+static void step_water(LevelScene_t* scene, unsigned int n_frames)
+{
+    for (unsigned int i = 0; i < n_frames; ++i)
+    {
+        update_water_runner_system(&scene->scene);
+        update_entity_manager(&scene->scene.ent_manager);
+    }
+}
+
+static unsigned int total_water(const TileGrid_t* tilemap)
+{
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < tilemap->n_tiles; ++i)
+    {
+        total += tilemap->tiles[i].water_level;
+    }
+    return total;
+}
+
+// Water in a row only if the rows below are full
+static bool filled_from_bottom(const TileGrid_t* tilemap)
+{
+    for (unsigned int y = 1; y < tilemap->height - 2; ++y)
+    {
+        bool has_water = false;
+        for (unsigned int x = 1; x < tilemap->width - 1; ++x)
+        {
+            has_water |= tilemap->tiles[y * tilemap->width + x].water_level > 0;
+        }
+        if (!has_water) continue;
+
+        for (unsigned int x = 1; x < tilemap->width - 1; ++x)
+        {
+            const Tile_t* below = tilemap->tiles + (y + 1) * tilemap->width + x;
+            if (below->water_level < below->max_water_level) return false;
+        }
+    }
+    return true;
+}
+
+// Water held in the tiles from (x1, y1) to (x2, y2)
+static unsigned int area_water(const TileGrid_t* tilemap, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2)
+{
+    unsigned int total = 0;
+    for (unsigned int y = y1; y <= y2; ++y)
+    {
+        for (unsigned int x = x1; x <= x2; ++x)
+        {
+            total += tilemap->tiles[y * tilemap->width + x].water_level;
+        }
+    }
+    return total;
+}
+
+static bool area_full(const TileGrid_t* tilemap, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2)
+{
+    for (unsigned int y = y1; y <= y2; ++y)
+    {
+        for (unsigned int x = x1; x <= x2; ++x)
+        {
+            const Tile_t* tile = tilemap->tiles + y * tilemap->width + x;
+            if (tile->solid != SOLID && tile->water_level < tile->max_water_level) return false;
+        }
+    }
+    return true;
+}
+
+// Every open tile full, and no water in the solid ones
+static void check_all_filled(const TileGrid_t* tilemap)
+{
+    for (unsigned int i = 0; i < tilemap->n_tiles; ++i)
+    {
+        const Tile_t* tile = tilemap->tiles + i;
+        assert_int_equal(tile->water_level, (tile->solid == SOLID) ? 0 : MAX_WATER_LEVEL);
+    }
+}
+
+static void test_runner_fills_box(void **state)
+{
+    LevelScene_t* scene = *state;
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    set_water_mode(scene->data.water_solver, WATER_MODE_RUNNER);
+    Entity_t* p_ent = create_water_runner(&scene->scene.ent_manager, scene->data.water_solver, BOX_WIDTH + 5);
+    assert_non_null(p_ent);
+    update_entity_manager(&scene->scene.ent_manager);
+    CWaterRunner_t* p_crunner = get_component(p_ent, CWATERRUNNER_T);
+
+    unsigned int frames = 0;
+    while (p_crunner->state != FILL_COMPLETE && frames < MAX_TEST_FRAMES)
+    {
+        step_water(scene, 1);
+        assert_true(filled_from_bottom(tilemap));
+        frames++;
+    }
+    assert_int_equal(p_crunner->state, FILL_COMPLETE);
+    assert_int_equal(total_water(tilemap), (BOX_WIDTH - 2) * (BOX_HEIGHT - 2) * MAX_WATER_LEVEL);
+}
+
+static void test_runners_in_one_basin_merge(void **state)
+{
+    LevelScene_t* scene = *state;
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    set_water_mode(scene->data.water_solver, WATER_MODE_RUNNER);
+    Entity_t* p_ent = create_water_runner(&scene->scene.ent_manager, scene->data.water_solver, BOX_WIDTH + 2);
+    Entity_t* p_other = create_water_runner(&scene->scene.ent_manager, scene->data.water_solver, BOX_WIDTH + 9);
+    assert_non_null(p_ent);
+    assert_non_null(p_other);
+    update_entity_manager(&scene->scene.ent_manager);
+    CWaterRunner_t* p_crunner = get_component(p_ent, CWATERRUNNER_T);
+    CWaterRunner_t* p_crunner2 = get_component(p_other, CWATERRUNNER_T);
+
+    unsigned int frames = 0;
+    while (
+        p_crunner->state != FILL_COMPLETE && p_crunner2->state != FILL_COMPLETE
+        && frames < MAX_TEST_FRAMES
+    )
+    {
+        step_water(scene, 1);
+        assert_true(filled_from_bottom(tilemap));
+        frames++;
+    }
+    // One runner carries both sources
+    assert_true(p_crunner->state == RUNNER_MERGED || p_crunner2->state == RUNNER_MERGED);
+    assert_int_equal(p_crunner->n_sources + p_crunner2->n_sources, 2);
+    assert_int_equal(total_water(tilemap), (BOX_WIDTH - 2) * (BOX_HEIGHT - 2) * MAX_WATER_LEVEL);
+}
+
+static void test_runner_spills_into_lower_pits(void **state)
+{
+    LevelScene_t* scene = *state;
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    // A cup on a pillar, which spills over both lips into a pit on each side
+    for (unsigned int y = 3; y < BOX_HEIGHT - 1; ++y)
+    {
+        for (unsigned int x = 3; x <= 8; ++x)
+        {
+            if (y > 3 || x == 3 || x == 8) change_a_tile(tilemap, y * BOX_WIDTH + x, SOLID_TILE);
+        }
+    }
+    set_water_mode(scene->data.water_solver, WATER_MODE_RUNNER);
+    Entity_t* p_ent = create_water_runner(&scene->scene.ent_manager, scene->data.water_solver, BOX_WIDTH + 5);
+    assert_non_null(p_ent);
+    update_entity_manager(&scene->scene.ent_manager);
+    CWaterRunner_t* p_crunner = get_component(p_ent, CWATERRUNNER_T);
+
+    unsigned int frames = 0;
+    while (p_crunner->state != FILL_COMPLETE && frames < MAX_TEST_FRAMES)
+    {
+        step_water(scene, 1);
+        unsigned int left_pit = area_water(tilemap, 1, 3, 2, BOX_HEIGHT - 2);
+        unsigned int right_pit = area_water(tilemap, 9, 3, 10, BOX_HEIGHT - 2);
+        if (left_pit > 0 || right_pit > 0)
+        {
+            assert_true(area_full(tilemap, 4, 3, 7, 3));
+        }
+        // Both pits are reached in the same search, but only one is filled at a time
+        if (left_pit > 0 && right_pit > 0)
+        {
+            assert_true(
+                area_full(tilemap, 1, 3, 2, BOX_HEIGHT - 2)
+                || area_full(tilemap, 9, 3, 10, BOX_HEIGHT - 2)
+            );
+        }
+        if (area_water(tilemap, 1, 1, BOX_WIDTH - 2, 2) > 0)
+        {
+            assert_true(area_full(tilemap, 1, 3, BOX_WIDTH - 2, BOX_HEIGHT - 2));
+        }
+        frames++;
+    }
+    assert_int_equal(p_crunner->state, FILL_COMPLETE);
+    check_all_filled(tilemap);
+}
+
+static void test_runner_refills_after_wall_opens(void **state)
+{
+    LevelScene_t* scene = *state;
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    // Two sealed chambers, the runner starts in the left one
+    const unsigned int wall_x = 6;
+    for (unsigned int y = 1; y < BOX_HEIGHT - 1; ++y) change_a_tile(tilemap, y * BOX_WIDTH + wall_x, SOLID_TILE);
+    set_water_mode(scene->data.water_solver, WATER_MODE_RUNNER);
+    Entity_t* p_ent = create_water_runner(&scene->scene.ent_manager, scene->data.water_solver, BOX_WIDTH + 2);
+    assert_non_null(p_ent);
+    update_entity_manager(&scene->scene.ent_manager);
+    CWaterRunner_t* p_crunner = get_component(p_ent, CWATERRUNNER_T);
+
+    // Open the bottom of the wall once the lower half of the left chamber is full
+    const unsigned int half_water = (wall_x - 1) * 3 * MAX_WATER_LEVEL;
+    unsigned int frames = 0;
+    while (area_water(tilemap, 1, 1, wall_x - 1, BOX_HEIGHT - 2) < half_water && frames < MAX_TEST_FRAMES)
+    {
+        step_water(scene, 1);
+        frames++;
+    }
+    assert_int_equal(area_water(tilemap, 1, 1, wall_x - 1, BOX_HEIGHT - 2), half_water);
+    assert_int_equal(area_water(tilemap, wall_x + 1, 1, BOX_WIDTH - 2, BOX_HEIGHT - 2), 0);
+    assert_true(change_a_tile(tilemap, (BOX_HEIGHT - 2) * BOX_WIDTH + wall_x, EMPTY_TILE));
+    reset_water_basins(scene->data.water_solver);
+
+    while (p_crunner->state != FILL_COMPLETE && frames < MAX_TEST_FRAMES)
+    {
+        step_water(scene, 1);
+        // The right chamber catches up before the left one rises again
+        if (area_water(tilemap, 1, 1, wall_x - 1, BOX_HEIGHT - 2) > half_water)
+        {
+            assert_true(area_full(tilemap, wall_x, 4, BOX_WIDTH - 2, BOX_HEIGHT - 2));
+        }
+        frames++;
+    }
+    assert_int_equal(p_crunner->state, FILL_COMPLETE);
+    check_all_filled(tilemap);
+}
+
+static void test_cellular_staircase_levels_out(void **state)
+{
+    LevelScene_t* scene = *state;
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    // A staircase with single steps, which the pairs alone leave as is
+    const unsigned int floor_row = (BOX_HEIGHT - 2) * BOX_WIDTH;
+    for (unsigned int x = 1; x <= 4; ++x)
+    {
+        tilemap->tiles[floor_row + x].water_level = 5 - x;
+    }
+    const unsigned int water = total_water(tilemap);
+    set_water_mode(scene->data.water_solver, WATER_MODE_CELLULAR);
+
+    step_water(scene, 600);
+    assert_int_equal(total_water(tilemap), water);
+    uint8_t lo = MAX_WATER_LEVEL;
+    uint8_t hi = 0;
+    for (unsigned int x = 1; x < BOX_WIDTH - 1; ++x)
+    {
+        const Tile_t* tile = tilemap->tiles + floor_row + x;
+        if (tile->water_level < lo) lo = tile->water_level;
+        if (tile->water_level > hi) hi = tile->water_level;
+        assert_int_equal(tile->wet, tile->water_level > 0);
+    }
+    assert_true(hi - lo <= 1);
+}
+
+static void test_cellular_fills_box(void **state)
+{
+    LevelScene_t* scene = *state;
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    set_water_mode(scene->data.water_solver, WATER_MODE_CELLULAR);
+    Entity_t* p_ent = create_water_runner(&scene->scene.ent_manager, scene->data.water_solver, BOX_WIDTH + 5);
+    assert_non_null(p_ent);
+    update_entity_manager(&scene->scene.ent_manager);
+
+    // The source adds one unit per step, so the box fills up in steps
+    step_water(scene, 1200);
+    unsigned int water = total_water(tilemap);
+    assert_true(water > 0);
+    free_water_runner(p_ent, &scene->scene.ent_manager);
+    update_entity_manager(&scene->scene.ent_manager);
+
+    step_water(scene, 600);
+    assert_int_equal(total_water(tilemap), water);
+    assert_true(filled_from_bottom(tilemap));
+    for (unsigned int y = 1; y < BOX_HEIGHT - 1; ++y)
+    {
+        uint8_t lo = MAX_WATER_LEVEL;
+        uint8_t hi = 0;
+        for (unsigned int x = 1; x < BOX_WIDTH - 1; ++x)
+        {
+            const Tile_t* tile = tilemap->tiles + y * BOX_WIDTH + x;
+            if (tile->water_level < lo) lo = tile->water_level;
+            if (tile->water_level > hi) hi = tile->water_level;
+            assert_int_equal(tile->wet, tile->water_level > 0);
+        }
+        assert_true(hi - lo <= 1);
+    }
+}
+
+static void test_cellular_is_deterministic(void **state)
+{
+    LevelScene_t* scene = *state;
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    uint8_t first_run[BOX_WIDTH * BOX_HEIGHT];
+    for (unsigned int run = 0; run < 2; ++run)
+    {
+        build_box(scene);
+        // A ledge to split the flow
+        for (unsigned int x = 3; x < 7; ++x) change_a_tile(tilemap, 4 * BOX_WIDTH + x, SOLID_TILE);
+        set_water_mode(scene->data.water_solver, WATER_MODE_CELLULAR);
+        Entity_t* p_ent = create_water_runner(&scene->scene.ent_manager, scene->data.water_solver, BOX_WIDTH + 4);
+        assert_non_null(p_ent);
+        update_entity_manager(&scene->scene.ent_manager);
+        step_water(scene, 500);
+
+        for (unsigned int i = 0; i < tilemap->n_tiles; ++i)
+        {
+            if (run == 0)
+            {
+                first_run[i] = tilemap->tiles[i].water_level;
+            }
+            else
+            {
+                assert_int_equal(tilemap->tiles[i].water_level, first_run[i]);
+            }
+        }
+        free_water_runner(p_ent, &scene->scene.ent_manager);
+        update_entity_manager(&scene->scene.ent_manager);
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_runner_fills_box, setup_water, teardown_water),
+        cmocka_unit_test_setup_teardown(test_runners_in_one_basin_merge, setup_water, teardown_water),
+        cmocka_unit_test_setup_teardown(test_runner_spills_into_lower_pits, setup_water, teardown_water),
+        cmocka_unit_test_setup_teardown(test_runner_refills_after_wall_opens, setup_water, teardown_water),
+        cmocka_unit_test_setup_teardown(test_cellular_staircase_levels_out, setup_water, teardown_water),
+        cmocka_unit_test_setup_teardown(test_cellular_fills_box, setup_water, teardown_water),
+        cmocka_unit_test_setup_teardown(test_cellular_is_deterministic, setup_water, teardown_water),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,115 @@
+#include "constants.h"
+#include "scene_impl.h"
+#include "ent_impl.h"
+#include "water_flow.h"
+#include "mempool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Headless comparison of the water modes on a large map
+// Usage: water_bench [n_frames] [n_sources]
+#define BENCH_WIDTH 128
+#define BENCH_HEIGHT 128
+#define BENCH_SEED 1234
+
+static Tile_t all_tiles[MAX_N_TILES] = {0};
+
+static void build_bench_level(LevelScene_t* scene, unsigned int n_sources)
+{
+    TileGrid_t* tilemap = &scene->data.tilemap;
+    tilemap->width = BENCH_WIDTH;
+    tilemap->height = BENCH_HEIGHT;
+    tilemap->n_tiles = BENCH_WIDTH * BENCH_HEIGHT;
+    reset_tilemap_chunks(tilemap);
+    for (size_t i = 0; i < tilemap->n_tiles; ++i)
+    {
+        change_a_tile(tilemap, i, EMPTY_TILE);
+        tilemap->tiles[i].water_level = 0;
+        tilemap->tiles[i].max_water_level = MAX_WATER_LEVEL;
+    }
+
+    // Border and a fixed scatter of ledges to get a good number of basins
+    srand(BENCH_SEED);
+    for (unsigned int i = 0; i < BENCH_WIDTH; ++i)
+    {
+        change_a_tile(tilemap, i, SOLID_TILE);
+        change_a_tile(tilemap, (BENCH_HEIGHT - 1) * BENCH_WIDTH + i, SOLID_TILE);
+    }
+    for (unsigned int i = 0; i < BENCH_HEIGHT; ++i)
+    {
+        change_a_tile(tilemap, i * BENCH_WIDTH, SOLID_TILE);
+        change_a_tile(tilemap, i * BENCH_WIDTH + BENCH_WIDTH - 1, SOLID_TILE);
+    }
+    for (unsigned int i = 0; i < 200; ++i)
+    {
+        unsigned int x = 1 + rand() % (BENCH_WIDTH - 12);
+        unsigned int y = 6 + rand() % (BENCH_HEIGHT - 8);
+        unsigned int len = 3 + rand() % 12;
+        for (unsigned int j = 0; j < len; ++j)
+        {
+            change_a_tile(tilemap, y * BENCH_WIDTH + x + j, SOLID_TILE);
+        }
+        if (rand() % 2)
+        {
+            change_a_tile(tilemap, (y - 1) * BENCH_WIDTH + x, SOLID_TILE);
+            change_a_tile(tilemap, (y - 1) * BENCH_WIDTH + x + len - 1, SOLID_TILE);
+        }
+    }
+
+    for (unsigned int i = 0; i < n_sources; ++i)
+    {
+        unsigned int x = 2 + (i * (BENCH_WIDTH - 4)) / n_sources;
+        unsigned int tile_idx = 2 * BENCH_WIDTH + x;
+        change_a_tile(tilemap, tile_idx, EMPTY_TILE);
+        create_water_runner(&scene->scene.ent_manager, scene->data.water_solver, tile_idx);
+    }
+    update_entity_manager(&scene->scene.ent_manager);
+}
+
+static void run_bench(WaterMode_t mode, unsigned int n_frames, unsigned int n_sources)
+{
+    LevelScene_t scene;
+    init_scene(&scene.scene, NULL, ENABLE_ENTITY_MANAGEMENT_SYSTEM);
+    init_entity_tag_map(&scene.scene.ent_manager, DYNMEM_ENT_TAG, 16);
+    init_level_scene_data(&scene.data, MAX_N_TILES, all_tiles, (Rectangle){0, 0, 0, 0});
+    build_bench_level(&scene, n_sources);
+    set_water_mode(scene.data.water_solver, mode);
+    scene.scene.delta_time = DELTA_T;
+
+    clock_t start = clock();
+    for (unsigned int i = 0; i < n_frames; ++i)
+    {
+        update_water_runner_system(&scene.scene);
+        update_entity_manager(&scene.scene.ent_manager);
+    }
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    unsigned long total_water = 0;
+    for (size_t i = 0; i < scene.data.tilemap.n_tiles; ++i)
+    {
+        total_water += scene.data.tilemap.tiles[i].water_level;
+    }
+    printf(
+        "%-8s %u frames, %u sources: %.3f s (%.1f us/frame), total water %lu\n",
+        (mode == WATER_MODE_CELLULAR) ? "cellular" : "runner",
+        n_frames, n_sources, elapsed, elapsed * 1e6 / n_frames, total_water
+    );
+
+    clear_all_game_entities(&scene);
+    free_scene(&scene.scene);
+    term_level_scene_data(&scene.data);
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int n_frames = (argc > 1) ? atoi(argv[1]) : 20000;
+    unsigned int n_sources = (argc > 2) ? atoi(argv[2]) : 8;
+    if (n_sources > MAX_WATER_RUNNERS) n_sources = MAX_WATER_RUNNERS;
+
+    init_memory_pools();
+    run_bench(WATER_MODE_RUNNER, n_frames, n_sources);
+    run_bench(WATER_MODE_CELLULAR, n_frames, n_sources);
+    free_memory_pools();
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include "scene_impl.h"
 #include "ent_impl.h"
 #include "water_flow.h"
+#include "water_render.h"
 #include "game_systems.h"
 #include "assets_loader.h"
 #include "raymath.h"
@@ -32,6 +33,9 @@ static void level_scene_render_func(Scene_t* scene)
 
     Entity_t* p_ent;
 
+    TileArea_t view = {0, 0, tilemap.width - 1, tilemap.height - 1};
+    update_water_layer(data->water_layer, &data->tilemap, view);
+
     BeginTextureMode(scene->layers.render_layers[GAME_LAYER].layer_tex);
         ClearBackground(WHITE);
         BeginMode2D(data->camera.cam);
@@ -53,49 +57,8 @@ static void level_scene_render_func(Scene_t* scene)
             {
                 DrawRectangle(x, y, TILE_SIZE, TILE_SIZE, BLACK);
             }
-            
-            if (tilemap.tiles[i].wet)
-            {
-#define SURFACE_THICKNESS 4
-                int up = i - tilemap.width;
-                int bot = i + tilemap.width;
-                int right = i + 1;
-                int left = i - 1;
-                int bot_line = y + TILE_SIZE - tilemap.tiles[i].water_level * WATER_BBOX_STEP - SURFACE_THICKNESS / 2;
-                if (up >= 0 && tilemap.tiles[up].wet)
-                {
-                    DrawLineEx((Vector2){x + TILE_SIZE / 2, y}, (Vector2){x + TILE_SIZE / 2, y + TILE_SIZE - tilemap.tiles[i].water_level * WATER_BBOX_STEP}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
-                }
-
-
-                if (
-                    (unsigned int)bot <= tilemap.n_tiles
-                    && tilemap.tiles[bot].water_level < MAX_WATER_LEVEL
-                    && tilemap.tiles[i].water_level == 0
-                    )
-                {
-                    if (i % tilemap.width != 0 && tilemap.tiles[left].wet)
-                    {
-                        DrawLineEx((Vector2){x, bot_line}, (Vector2){x + TILE_SIZE / 2, bot_line}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
-                    }
-                    if (right % tilemap.width != 0 && tilemap.tiles[right].wet)
-                    {
-                        DrawLineEx((Vector2){x + TILE_SIZE / 2, bot_line}, (Vector2){x + TILE_SIZE, bot_line}, SURFACE_THICKNESS, ColorAlpha(BLUE, 0.7));
-                    }
-                }
-            }
-
-            uint32_t water_height = tilemap.tiles[i].water_level * WATER_BBOX_STEP;
-            // Draw water tile
-            Color water_colour = ColorAlpha(BLUE, 0.5);
-            DrawRectangle(
-                x,
-                y + (TILE_SIZE - water_height),
-                TILE_SIZE,
-                water_height,
-                water_colour
-            );
         }
+        draw_water_layer(data->water_layer, &data->tilemap, view);
 
         sc_map_foreach_value(&scene->ent_manager.entities, p_ent)
         {
@@ -121,7 +84,7 @@ static void level_scene_render_func(Scene_t* scene)
             unsigned int x = ((p_runner->current_tile) % tilemap.width) * tilemap.tile_size; 
             unsigned int y = ((p_runner->current_tile) / tilemap.width) * tilemap.tile_size; 
             DrawCircle(x+16, y+16, 8, ColorAlpha(BLACK, 0.2));
-            if (p_runner->target_tile < p_runner->bfs_tilemap.len)
+            if (p_runner->target_tile < data->water_solver->len)
             {
                 unsigned int x = ((p_runner->target_tile) % tilemap.width) * tilemap.tile_size; 
                 unsigned int y = ((p_runner->target_tile) / tilemap.width) * tilemap.tile_size; 
@@ -131,7 +94,7 @@ static void level_scene_render_func(Scene_t* scene)
             if (p_runner->state == LOWEST_POINT_MOVEMENT)
             {
                 int curr_idx = p_runner->current_tile;
-                int next_idx = p_runner->bfs_tilemap.tilemap[curr_idx].to;
+                int next_idx = data->water_solver->bfs_tiles[curr_idx].to;
                 while(curr_idx != p_runner->target_tile || curr_idx == next_idx)
                 while(next_idx >= 0)
                 {
@@ -141,7 +104,7 @@ static void level_scene_render_func(Scene_t* scene)
                     unsigned int y2 = (next_idx / tilemap.width) * tilemap.tile_size + tilemap.tile_size / 2; 
                     DrawLine(x1, y1, x2, y2, BLACK);
                     curr_idx = next_idx;
-                    next_idx = p_runner->bfs_tilemap.tilemap[curr_idx].to;
+                    next_idx = data->water_solver->bfs_tiles[curr_idx].to;
                 }
             }
         }
@@ -257,6 +220,7 @@ static void toggle_block_system(Scene_t* scene)
                     {
                         tilemap.tiles[tile_idx].water_level = tilemap.tiles[tile_idx].max_water_level;
                     }
+                    mark_tile_dirty(&tilemap, tile_idx);
                 }
             
             }
@@ -278,20 +242,20 @@ static void toggle_block_system(Scene_t* scene)
                 //            blocked = true;
                 //            break;
                 //        }
-                //        curr_idx = p_crunner->bfs_tilemap.tilemap[curr_idx].from;
+                //        curr_idx = data->water_solver->bfs_tiles[curr_idx].from;
                 //    }
                 //    if (blocked)
                 //    {
                 //        int return_idx = p_crunner->current_tile;
-                //        if (p_crunner->bfs_tilemap.tilemap[curr_idx].from >= 0)
+                //        if (data->water_solver->bfs_tiles[curr_idx].from >= 0)
                 //        {
-                //            p_crunner->current_tile = p_crunner->bfs_tilemap.tilemap[curr_idx].from;
+                //            p_crunner->current_tile = data->water_solver->bfs_tiles[curr_idx].from;
                 //        }
                 //        puts("Blocking...");
                 //        while(curr_idx != return_idx)
                 //        {
                 //            tilemap.tiles[curr_idx].wet = false;
-                //            curr_idx = p_crunner->bfs_tilemap.tilemap[curr_idx].to;
+                //            curr_idx = data->water_solver->bfs_tiles[curr_idx].to;
                 //        }
                 //    }
                 //}
@@ -303,7 +267,7 @@ static void toggle_block_system(Scene_t* scene)
         {
             if (sc_map_size_64v(&tilemap.tiles[tile_idx].entities_set) == 0)
             {
-                Entity_t* p_ent = create_water_runner(&scene->ent_manager, DEFAULT_MAP_WIDTH, DEFAULT_MAP_HEIGHT, tile_idx);
+                Entity_t* p_ent = create_water_runner(&scene->ent_manager, data->water_solver, tile_idx);
                 if (p_ent == NULL) return;
 
                 CTransform_t* p_ct = get_component(p_ent, CTRANSFORM_COMP_T);